@@ -422,6 +422,7 @@ struct udtStringArray
 		PlayerStatsNames,
 		PlugInNames,
 		PerfStatsNames,
+		PerfStageNames,
 		Count
 	};
 };
@@ -838,10 +839,53 @@ struct udtPerfStatsField
 };
 #undef UDT_PERF_STATS_ITEM
 
+/* The stages are nested: the time of a stage includes the time of the stages it calls into. */
+/* ParseMessage includes ParseGameState, ParseSnapshot and ParseCommand. */
+/* ParseSnapshot includes ParsePacketEntities. */
+/* PlugIns and WriteOutput are included in the stage that invoked them. */
+/* Huffman decoding is done while reading the fields and is part of the parsing stages. */
+#define UDT_PERF_STAGE_LIST(N) \
+	N(ReadMessage, "read message") \
+	N(ParseMessage, "parse message") \
+	N(ParseGameState, "parse gamestate") \
+	N(ParseSnapshot, "parse snapshot") \
+	N(ParsePacketEntities, "parse packet entities") \
+	N(ParseCommand, "parse command") \
+	N(PlugIns, "plug-ins") \
+	N(WriteOutput, "write output")
+
+#define UDT_PERF_STAGE_ITEM(Enum, Desc) Enum,
+struct udtPerfStage
+{
+	enum Id
+	{
+		UDT_PERF_STAGE_LIST(UDT_PERF_STAGE_ITEM)
+		Count
+	};
+};
+#undef UDT_PERF_STAGE_ITEM
+
+struct udtContextPoolPolicy
+{
+	enum Id
+	{
+		Disabled,      /* Every call creates and destroys the parser contexts it needs. */
+		KeepCommitted, /* Idle contexts keep all their memory pages. Fastest, uses the most memory. */
+		PurgeUnused,   /* Idle contexts give back the memory pages they don't use. The default. */
+		Count
+	};
+};
+
 #endif
 
 
-#define    UDT_MAX_MERGE_DEMO_COUNT             8
+/* Can be overridden when building the library. */
+#if !defined(UDT_MAX_MERGE_DEMO_COUNT)
+#	define UDT_MAX_MERGE_DEMO_COUNT            64
+#endif
+#define    UDT_PROBE_DEFAULT_MESSAGE_COUNT     16
+#define    UDT_PROBE_MAX_STRING_LENGTH         64
+#define    UDT_PROBE_PLAYER_NAMES_BYTE_COUNT 1024
 #define    UDT_TEAM_STATS_MASK_BYTE_COUNT       8
 #define    UDT_PLAYER_STATS_MASK_BYTE_COUNT    32
 
@@ -876,10 +920,51 @@ extern "C"
 	{
 		enum Id
 		{
+			MemoryMappedInput  = UDT_BIT(0), /* Map the input demo files in memory and decode messages in place instead of copying them. */
+			WriteSeekIndex     = UDT_BIT(1), /* Write a seek index file (demo file path + ".udtidx") for every demo read from the start. Cutting uses it to decode less. */
+			ParallelGameStates = UDT_BIT(2)  /* Analysis only. Parse the gamestates of a big demo on separate threads when all the requested plug-ins support it. Match stats don't. */
 		};
 	};
 #endif
 	
+	typedef struct udtStagePerfStats_s
+	{
+		/* May be NULL. */
+		/* The array size should be udtPerfStage::Count. */
+		/* The time spent in each stage, in nano-seconds, summed over all threads. */
+		u64* StageDurations;
+
+		/* May be NULL. */
+		/* The array size should be udtPerfStage::Count. */
+		/* The number of times each stage was entered. */
+		u64* StageCallCounts;
+
+		/* May be NULL. */
+		/* The array size should be udtParserPlugIn::Count. */
+		/* The time spent in each plug-in's callbacks, in nano-seconds, summed over all threads. */
+		u64* PlugInDurations;
+
+		/* May be NULL. */
+		/* The array size should be udtParserPlugIn::Count. */
+		/* The number of callbacks invoked for each plug-in. */
+		u64* PlugInCallCounts;
+
+		/* May be NULL. */
+		/* When not NULL, every thread writes a Chrome trace event JSON file to this folder */
+		/* named "udt_trace_<thread index>.json". */
+		/* The files can be loaded in chrome://tracing. */
+		const char* TraceFolderPath;
+
+		/* The number of threads that contributed to the stats. */
+		/* Stays 0 when the library was built without UDT_INSTRUMENTATION defined. */
+		u32 ThreadCount;
+
+		/* Ignore this. */
+		s32 Reserved1;
+	}
+	udtStagePerfStats;
+	UDT_ENFORCE_API_STRUCT_SIZE(udtStagePerfStats)
+
 	typedef struct udtParseArg_s
 	{
 		/* Pointer to an array of plug-ins IDs. */
@@ -912,8 +997,10 @@ extern "C"
 		/* The array size should be udtPerfStatsField::Count. */
 		u64* PerformanceStats;
 
-		/* Ignore this. */
-		void* Reserved1;
+		/* May be NULL. */
+		/* Per-stage timings of the parser. */
+		/* Only filled when the library was built with UDT_INSTRUMENTATION defined. */
+		udtStagePerfStats* StagePerfStats;
 
 		/* Number of elements in the array pointed to by the PlugIns pointer. */
 		/* May be 0. */
@@ -953,6 +1040,13 @@ extern "C"
 
 		/* The maximum amount of threads that should be used to process the demos. */
 		u32 MaxThreadCount;
+
+		/* The minimum amount of demo data, in bytes, that justifies launching an extra thread. */
+		/* 0 means the default value of 6 MB is used. */
+		u32 MinByteCountPerThread;
+
+		/* Ignore this. */
+		s32 Reserved1;
 	}
 	udtMultiParseArg;
 	UDT_ENFORCE_API_STRUCT_SIZE(udtMultiParseArg)
@@ -1014,7 +1108,8 @@ extern "C"
 	{
 		enum Id
 		{
-			MergeCutSections = UDT_BIT(0) /* Enable/disable merging cut sections from different patterns. */
+			MergeCutSections = UDT_BIT(0), /* Enable/disable merging cut sections from different patterns. */
+			TwoPassCutting   = UDT_BIT(1)  /* Always parse the demos a second time to write the cuts instead of writing them during the analysis. */
 		};
 	};
 
@@ -1156,6 +1251,20 @@ extern "C"
 	udtCutByTimeArg;
 	UDT_ENFORCE_API_STRUCT_SIZE(udtCutByTimeArg)
 
+	typedef struct udtMultiCutByTimeArg_s
+	{
+		/* Pointer to an array of cut lists, one per input file, in the input file paths' order. */
+		/* Unlike with udtCutDemoFileByTime, every cut uses its own GameStateIndex. */
+		/* Files with an empty cut list are skipped. */
+		/* May not be NULL. */
+		const udtCutByTimeArg* FileCuts;
+
+		/* Ignore this. */
+		const void* Reserved1;
+	}
+	udtMultiCutByTimeArg;
+	UDT_ENFORCE_API_STRUCT_SIZE(udtMultiCutByTimeArg)
+
 	typedef struct udtChatPatternRule_s
 	{
 		/* May not be NULL. */
@@ -2190,6 +2299,83 @@ extern "C"
 	udtJSONArg;
 	UDT_ENFORCE_API_STRUCT_SIZE(udtJSONArg)
 
+	typedef struct udtColumnarExportArg_s
+	{
+		/* Path of the file that will hold the data of all the demos. */
+		/* See uberdemotools_columnar.h for the file format and a reader. */
+		const char* OutputFilePath;
+
+		/* Ignore this. */
+		const void* Reserved1;
+	}
+	udtColumnarExportArg;
+	UDT_ENFORCE_API_STRUCT_SIZE(udtColumnarExportArg)
+
+	/* What udtProbeDemoFiles found out about a demo. */
+	/* All strings are NUL-terminated UTF-8 without color codes, truncated if they don't fit and empty if not available. */
+	typedef struct udtProbeDemoInfo_s
+	{
+		/* The map name. */
+		char MapName[UDT_PROBE_MAX_STRING_LENGTH];
+
+		/* The mod version string. */
+		char ModVersion[UDT_PROBE_MAX_STRING_LENGTH];
+
+		/* The names of the players, stored back to back. */
+		/* The n-th name belongs to the player at index PlayerIndices[n]. */
+		char PlayerNames[UDT_PROBE_PLAYER_NAMES_BYTE_COUNT];
+
+		/* The client numbers of the players. */
+		/* Range: [0;63]. */
+		u8 PlayerIndices[64];
+
+		/* The number of names in PlayerNames. */
+		u32 PlayerCount;
+
+		/* Of type udtProtocol::Id. */
+		u32 Protocol;
+
+		/* Of type udtMod::Id. */
+		u32 Mod;
+
+		/* Of type udtGameType::Id. */
+		u32 GameType;
+
+		/* Index of the player who recorded the demo. */
+		/* Range: [0;63]. */
+		s32 DemoTakerPlayerIndex;
+
+		/* Server time of the first snapshot, in milli-seconds. */
+		/* UDT_S32_MIN if no snapshot was read. */
+		s32 FirstSnapshotTimeMs;
+
+		/* Non-zero if a gamestate message was read and the fields above are valid. */
+		/* When zero, the demo's entry in OutputErrorCodes is not udtErrorCode::None. */
+		u32 Valid;
+
+		/* Ignore this. */
+		u32 Reserved1;
+	}
+	udtProbeDemoInfo;
+	UDT_ENFORCE_API_STRUCT_SIZE(udtProbeDemoInfo)
+
+	typedef struct udtProbeArg_s
+	{
+		/* Pointer to an array of results, one per input file, in the input file paths' order. */
+		/* May not be NULL. */
+		udtProbeDemoInfo* DemoInfos;
+
+		/* The number of messages read after the first gamestate message */
+		/* to get the first snapshot's time and the players that connect right away. */
+		/* 0 means UDT_PROBE_DEFAULT_MESSAGE_COUNT is used. */
+		u32 MessageCount;
+
+		/* Ignore this. */
+		u32 Reserved1;
+	}
+	udtProbeArg;
+	UDT_ENFORCE_API_STRUCT_SIZE(udtProbeArg)
+
 #pragma pack(pop)
 
 	/*
@@ -2288,6 +2474,22 @@ extern "C"
 	/* If you pass NULL, will set it back to the default handler. */
 	UDT_API(s32) udtSetCrashHandler(udtCrashCallback crashHandler);
 
+	/* Sets whether the big long-lived buffers (e.g. the plug-in output of large batches) should use huge pages. */
+	/* They then commit memory in 2 MB chunks and the system is asked to back them with huge pages. Only has an effect on Linux. */
+	/* Disabled by default. The buffers created or grown after the call are affected. */
+	/* Should be called before any other thread uses the library. */
+	UDT_API(s32) udtSetHugePagesEnabled(u32 enabled);
+
+	/* The functions processing demo batches without a user-provided context group (cutting, conversion, JSON export, etc) */
+	/* get their parser contexts from a pool owned by the calling thread and give them back when done. */
+	/* The policy argument is of type udtContextPoolPolicy::Id. */
+	/* Should be called before any other thread uses the library. */
+	UDT_API(s32) udtSetContextPoolPolicy(u32 policy);
+
+	/* Destroys the idle parser contexts of the calling thread's pool. */
+	/* Threads other than the one calling udtShutDownLibrary should call this before exiting. */
+	UDT_API(s32) udtReleaseThreadContextPool();
+
 	/* Creates a context that can be used by multiple parsers. */
 	UDT_API(udtParserContext*) udtCreateContext();
 
@@ -2298,12 +2500,35 @@ extern "C"
 	UDT_API(s32) udtSplitDemoFile(udtParserContext* context, const udtParseArg* info, const char* demoFilePath);
 
 	/* Creates a sub-demo starting and ending at the specified times. */
+	/* The cuts can overlap and are all written while reading the input demo only once. */
 	UDT_API(s32) udtCutDemoFileByTime(udtParserContext* context, const udtParseArg* info, const udtCutByTimeArg* cutInfo, const char* demoFilePath);
 
 	/* Creates a new demo that is basically the first demo passed with extra entity data from the other demos. */
 	/* The maximum amount of demos merged (i.e. the maximum value of fileCount) is UDT_MAX_MERGE_DEMO_COUNT. */
+	/* When more than one CPU core is available, the input demos are decoded on up to one thread per core. */
+	/* info->MessageCb is then called from those threads too, possibly from several of them at once. */
 	UDT_API(s32) udtMergeDemoFiles(const udtParseArg* info, const char** filePaths, u32 fileCount);
 
+	/* Starts parsing a demo whose data will be pushed progressively with udtPushDemoStreamData. */
+	/* The plug-ins specified in info are created and the previous plug-in data of the context is released. */
+	/* The info argument is only used during this call. */
+	/* The protocol argument is of type udtProtocol::Id. */
+	/* The demoName argument is used in log messages and may be NULL. */
+	UDT_API(s32) udtStartDemoStream(udtParserContext* context, const udtParseArg* info, u32 protocol, const char* demoName);
+
+	/* Parses all the complete messages found in the data pushed so far. */
+	/* The data can be split anywhere: an incomplete message waits until the rest of its bytes get pushed. */
+	/* If you should continue pushing data, continueParsing will be set to a non-zero value. */
+	/* After the call, udtGetContextPlugInBuffers returns all the items found so far for the demo */
+	/* but the buffer ranges only include the demo after udtFinishDemoStream was called. */
+	/* Plug-ins that need the whole demo, like the match stats, only output their data in udtFinishDemoStream. */
+	/* The buffers are only valid until the next call to udtPushDemoStreamData. */
+	UDT_API(s32) udtPushDemoStreamData(udtParserContext* context, const void* data, u32 byteCount, u32* continueParsing);
+
+	/* Tells the plug-ins the demo is over. */
+	/* Call it when udtPushDemoStreamData says to stop or when there's no more data to push. */
+	UDT_API(s32) udtFinishDemoStream(udtParserContext* context);
+
 	/* For a given plug-in id, gets the complete buffer descriptor table for all demos in the context. */
 	/* The buffersStruct argument points to a data structure of type udtParseData*Buffers which corresponds to the plug-in type. */
 	/* All strings are UTF-8 encoded and string lengths represent the number of bytes (not characters) excluding the terminating NULL byte. */
@@ -2334,6 +2559,10 @@ extern "C"
 	/* Gets the input index of the specified demo. */
 	UDT_API(s32) udtGetDemoInputIndex(udtParserContext* context, u32 demoIdx, u32* demoInputIdx);
 
+	/* Tells whether parsing of the specified demo stopped successfully before the end of the file */
+	/* because all the plug-ins already had everything they needed. */
+	UDT_API(s32) udtGetDemoEarlyExit(udtParserContext* context, u32 demoIdx, u32* earlyExit);
+
 	/* Releases all the resources associated to the context group. */
 	UDT_API(s32) udtDestroyContextGroup(udtParserContextGroup* contextGroup);
 
@@ -2349,6 +2578,10 @@ extern "C"
 	/* Releases all the resources associated to the search context. */
 	UDT_API(s32) udtDestroySearchContext(udtPatternSearchContext* context);
 
+	/* Creates, for each demo, the sub-demos of its own cut list. */
+	/* Each demo is read only once, no matter how many of its cuts overlap. */
+	UDT_API(s32) udtCutDemoFilesByTime(const udtParseArg* info, const udtMultiParseArg* extraInfo, const udtMultiCutByTimeArg* cutInfo);
+
 	/* Creates, for each demo that isn't in the target protocol, a new demo file with the specified protocol. */
 	UDT_API(s32) udtConvertDemoFiles(const udtParseArg* info, const udtMultiParseArg* extraInfo, const udtProtocolConversionArg* conversionArg);
 
@@ -2358,6 +2591,16 @@ extern "C"
 	/* Creates, for each demo, a .JSON file with the data from all the selected plug-ins. */
 	UDT_API(s32) udtSaveDemoFilesAnalysisDataToJSON(const udtParseArg* info, const udtMultiParseArg* extraInfo, const udtJSONArg* jsonInfo);
 
+	/* Creates a single columnar binary file with the data of all demos from the chat, obituaries, captures, scores and stats plug-ins. */
+	/* Per-demo row ranges are stored in the input file paths' order. */
+	UDT_API(s32) udtSaveDemoFilesAnalysisDataToColumnar(const udtParseArg* info, const udtMultiParseArg* extraInfo, const udtColumnarExportArg* columnarInfo);
+
+	/* Reads the demos' first gamestate message and a few messages after it to fill in probeInfo->DemoInfos. */
+	/* Snapshots are not decoded, so the cost doesn't grow with the demo's length. */
+	/* The work is split across threads even when the files are small. */
+	/* A demo without a readable gamestate message gets a non-zero entry in extraInfo->OutputErrorCodes. */
+	UDT_API(s32) udtProbeDemoFiles(const udtParseArg* info, const udtMultiParseArg* extraInfo, const udtProbeArg* probeInfo);
+
 	/*
 	Custom parsing constants and data structures.
 	*/
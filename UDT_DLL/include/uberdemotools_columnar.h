@@ -0,0 +1,377 @@
+#pragma once
+
+
+/*
+Columnar analysis data files, as written by udtSaveDemoFilesAnalysisDataToColumnar.
+
+All data is little-endian and every offset is relative to the start of the file,
+so a file can be memory-mapped and read in place without any parsing.
+
+Layout:
+- udtColumnarHeader
+- udtColumnarDemo[DemoCount], in the same order as the input file paths
+- udtColumnarTable[TableCount]
+- for each table: udtColumnarColumn[ColumnCount] and udtParseDataBufferRange[DemoCount]
+- the column data: RowCount fixed-width values per column, 8-byte aligned
+- the string dictionary: u32[StringCount + 1] byte offsets followed by NUL-terminated UTF-8 strings
+
+String columns and name fields hold indices into the string dictionary.
+UDT_COLUMNAR_NULL_STRING marks a missing string.
+
+This header has no link-time dependency on the UDT library.
+*/
+
+
+#include "uberdemotools.h"
+
+
+#define    UDT_COLUMNAR_MAGIC          0x43544455 /* "UDTC" */
+#define    UDT_COLUMNAR_VERSION        1
+#define    UDT_COLUMNAR_NULL_STRING    0xFFFFFFFF
+
+#if defined(__cplusplus)
+#	define UDT_COLUMNAR_FUNC inline
+#elif defined(UDT_MSVC)
+#	define UDT_COLUMNAR_FUNC static __inline
+#else
+#	define UDT_COLUMNAR_FUNC static __inline__
+#endif
+
+
+#if defined(__cplusplus)
+
+struct udtColumnarTableId
+{
+	enum Id
+	{
+		Chat,              /* udtParseDataChat */
+		Obituaries,        /* udtParseDataObituary */
+		Captures,          /* udtParseDataCapture */
+		Scores,            /* udtParseDataScore */
+		MatchStats,        /* udtParseDataStats, the First*Index columns are row indices into the tables below */
+		StatsTimeOuts,     /* udtParseDataStatsBuffers::TimeOutStartAndEndTimes, one row per time-out */
+		StatsTeamFlags,    /* udtParseDataStatsBuffers::TeamFlags, one byte per row */
+		StatsPlayerFlags,  /* udtParseDataStatsBuffers::PlayerFlags, one byte per row */
+		StatsTeamFields,   /* udtParseDataStatsBuffers::TeamFields */
+		StatsPlayerFields, /* udtParseDataStatsBuffers::PlayerFields */
+		StatsPlayers,      /* udtParseDataStatsBuffers::PlayerStats */
+		Count
+	};
+};
+
+struct udtColumnType
+{
+	enum Id
+	{
+		U8,
+		S32,
+		U32,
+		F32,
+		U64,
+		String, /* u32 string dictionary index */
+		Count
+	};
+};
+
+#endif
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#pragma pack(push, 1)
+
+	typedef struct udtColumnarHeader_s
+	{
+		/* Always UDT_COLUMNAR_MAGIC. */
+		u32 Magic;
+
+		/* Always UDT_COLUMNAR_VERSION. */
+		u32 Version;
+
+		/* The number of input demo files. */
+		u32 DemoCount;
+
+		/* The number of tables. */
+		u32 TableCount;
+
+		/* The number of strings in the dictionary. */
+		u32 StringCount;
+
+		/* Ignore this. */
+		u32 Reserved1;
+
+		/* The total byte count of the file. */
+		u64 FileByteCount;
+
+		/* File offset of the udtColumnarDemo array. */
+		u64 DemosOffset;
+
+		/* File offset of the udtColumnarTable array. */
+		u64 TablesOffset;
+
+		/* File offset of the u32 string offsets array. */
+		/* The array has StringCount + 1 entries and the offsets are relative to StringDataOffset. */
+		u64 StringOffsetsOffset;
+
+		/* File offset of the string data. */
+		u64 StringDataOffset;
+	}
+	udtColumnarHeader;
+	UDT_ENFORCE_API_STRUCT_SIZE(udtColumnarHeader)
+
+	typedef struct udtColumnarDemo_s
+	{
+		/* String index. The input file path. */
+		u32 FilePath;
+
+		/* Non-zero if the demo was processed. */
+		u32 Processed;
+	}
+	udtColumnarDemo;
+	UDT_ENFORCE_API_STRUCT_SIZE(udtColumnarDemo)
+
+	typedef struct udtColumnarTable_s
+	{
+		/* Of type udtColumnarTableId::Id. */
+		u32 Id;
+
+		/* The number of values in each column. */
+		u32 RowCount;
+
+		/* The length of the array at ColumnsOffset. */
+		u32 ColumnCount;
+
+		/* Ignore this. */
+		u32 Reserved1;
+
+		/* File offset of the udtColumnarColumn array. */
+		u64 ColumnsOffset;
+
+		/* File offset of the udtParseDataBufferRange array. */
+		/* Array length: the file's demo count. */
+		/* For a demo index, tells you which rows to use. */
+		u64 RowRangesOffset;
+	}
+	udtColumnarTable;
+	UDT_ENFORCE_API_STRUCT_SIZE(udtColumnarTable)
+
+	typedef struct udtColumnarColumn_s
+	{
+		/* String index. The name of the field the column was made from. */
+		u32 Name;
+
+		/* Of type udtColumnType::Id. */
+		u32 Type;
+
+		/* File offset of the first value. */
+		u64 DataOffset;
+	}
+	udtColumnarColumn;
+	UDT_ENFORCE_API_STRUCT_SIZE(udtColumnarColumn)
+
+	/* A validated view of a columnar file in memory. */
+	typedef struct udtColumnarFile_s
+	{
+		const u8* Data;
+		const udtColumnarHeader* Header;
+		const udtColumnarDemo* Demos;
+		const udtColumnarTable* Tables;
+		const u32* StringOffsets;
+		const char* StringData;
+		u64 ByteCount;
+	}
+	udtColumnarFile;
+
+#pragma pack(pop)
+
+	UDT_COLUMNAR_FUNC u32 udtColumnarGetTypeByteCount(u32 type)
+	{
+		/* See udtColumnType::Id. */
+		switch(type)
+		{
+			case 0: return 1; /* U8 */
+			case 4: return 8; /* U64 */
+			default: return 4; /* S32, U32, F32, String */
+		}
+	}
+
+	UDT_COLUMNAR_FUNC u32 udtColumnarIsRangeValid(const udtColumnarFile* file, u64 offset, u64 byteCount)
+	{
+		return offset <= file->ByteCount && byteCount <= file->ByteCount - offset;
+	}
+
+	/* Returns non-zero on success. */
+	/* Checks that every array the other functions access lies inside the buffer. */
+	UDT_COLUMNAR_FUNC u32 udtColumnarOpen(udtColumnarFile* file, const void* data, u64 byteCount)
+	{
+		const udtColumnarHeader* header;
+		const udtColumnarTable* tables;
+		const u32* stringOffsets;
+		u32 i, j;
+
+		if(file == 0 || data == 0 || byteCount < (u64)sizeof(udtColumnarHeader))
+		{
+			return 0;
+		}
+
+		header = (const udtColumnarHeader*)data;
+		if(header->Magic != UDT_COLUMNAR_MAGIC ||
+		   header->Version != UDT_COLUMNAR_VERSION ||
+		   header->FileByteCount != byteCount)
+		{
+			return 0;
+		}
+
+		file->Data = (const u8*)data;
+		file->Header = header;
+		file->ByteCount = byteCount;
+		if(!udtColumnarIsRangeValid(file, header->DemosOffset, (u64)header->DemoCount * sizeof(udtColumnarDemo)) ||
+		   !udtColumnarIsRangeValid(file, header->TablesOffset, (u64)header->TableCount * sizeof(udtColumnarTable)) ||
+		   !udtColumnarIsRangeValid(file, header->StringOffsetsOffset, ((u64)header->StringCount + 1) * sizeof(u32)))
+		{
+			return 0;
+		}
+
+		tables = (const udtColumnarTable*)(file->Data + header->TablesOffset);
+		for(i = 0; i < header->TableCount; ++i)
+		{
+			const udtColumnarTable* const table = tables + i;
+			const udtColumnarColumn* columns;
+			const udtParseDataBufferRange* ranges;
+			if(!udtColumnarIsRangeValid(file, table->ColumnsOffset, (u64)table->ColumnCount * sizeof(udtColumnarColumn)) ||
+			   !udtColumnarIsRangeValid(file, table->RowRangesOffset, (u64)header->DemoCount * sizeof(udtParseDataBufferRange)))
+			{
+				return 0;
+			}
+
+			ranges = (const udtParseDataBufferRange*)(file->Data + table->RowRangesOffset);
+			for(j = 0; j < header->DemoCount; ++j)
+			{
+				if((u64)ranges[j].FirstIndex + (u64)ranges[j].Count > (u64)table->RowCount)
+				{
+					return 0;
+				}
+			}
+
+			columns = (const udtColumnarColumn*)(file->Data + table->ColumnsOffset);
+			for(j = 0; j < table->ColumnCount; ++j)
+			{
+				const u64 columnByteCount = (u64)table->RowCount * (u64)udtColumnarGetTypeByteCount(columns[j].Type);
+				if(columns[j].Type >= 6 /* udtColumnType::Count */ ||
+				   !udtColumnarIsRangeValid(file, columns[j].DataOffset, columnByteCount))
+				{
+					return 0;
+				}
+			}
+		}
+
+		stringOffsets = (const u32*)(file->Data + header->StringOffsetsOffset);
+		if(!udtColumnarIsRangeValid(file, header->StringDataOffset, (u64)stringOffsets[header->StringCount]))
+		{
+			return 0;
+		}
+
+		file->Demos = (const udtColumnarDemo*)(file->Data + header->DemosOffset);
+		file->Tables = tables;
+		file->StringOffsets = stringOffsets;
+		file->StringData = (const char*)(file->Data + header->StringDataOffset);
+
+		return 1;
+	}
+
+	/* Returns NULL if invalid or not found. */
+	UDT_COLUMNAR_FUNC const char* udtColumnarGetString(const udtColumnarFile* file, u32 stringIndex, u32* length)
+	{
+		u32 start, end;
+		if(stringIndex >= file->Header->StringCount)
+		{
+			return 0;
+		}
+
+		start = file->StringOffsets[stringIndex];
+		end = file->StringOffsets[stringIndex + 1];
+		if(start >= end || end > file->StringOffsets[file->Header->StringCount])
+		{
+			return 0;
+		}
+
+		if(length != 0)
+		{
+			*length = end - start - 1; /* Not counting the terminating NUL. */
+		}
+
+		return file->StringData + start;
+	}
+
+	/* Returns NULL if not found. */
+	/* tableId is of type udtColumnarTableId::Id. */
+	UDT_COLUMNAR_FUNC const udtColumnarTable* udtColumnarFindTable(const udtColumnarFile* file, u32 tableId)
+	{
+		u32 i;
+		for(i = 0; i < file->Header->TableCount; ++i)
+		{
+			if(file->Tables[i].Id == tableId)
+			{
+				return file->Tables + i;
+			}
+		}
+
+		return 0;
+	}
+
+	/* Returns NULL if not found. */
+	UDT_COLUMNAR_FUNC const udtColumnarColumn* udtColumnarFindColumn(const udtColumnarFile* file, const udtColumnarTable* table, const char* name)
+	{
+		const udtColumnarColumn* const columns = (const udtColumnarColumn*)(file->Data + table->ColumnsOffset);
+		u32 i;
+		for(i = 0; i < table->ColumnCount; ++i)
+		{
+			const char* const columnName = udtColumnarGetString(file, columns[i].Name, 0);
+			const char* a = columnName;
+			const char* b = name;
+			if(a == 0)
+			{
+				continue;
+			}
+
+			while(*a != '\0' && *a == *b)
+			{
+				++a;
+				++b;
+			}
+
+			if(*a == *b)
+			{
+				return columns + i;
+			}
+		}
+
+		return 0;
+	}
+
+	/* Cast to the type matching the column's type: u8, s32, u32, f32, u64 or u32 for strings. */
+	UDT_COLUMNAR_FUNC const void* udtColumnarGetColumnData(const udtColumnarFile* file, const udtColumnarColumn* column)
+	{
+		return file->Data + column->DataOffset;
+	}
+
+	/* The rows of a table that belong to a given demo. */
+	UDT_COLUMNAR_FUNC udtParseDataBufferRange udtColumnarGetRowRange(const udtColumnarFile* file, const udtColumnarTable* table, u32 demoIndex)
+	{
+		udtParseDataBufferRange range;
+		range.FirstIndex = 0;
+		range.Count = 0;
+		if(demoIndex < file->Header->DemoCount)
+		{
+			range = ((const udtParseDataBufferRange*)(file->Data + table->RowRangesOffset))[demoIndex];
+		}
+
+		return range;
+	}
+
+#ifdef __cplusplus
+}
+#endif
@@ -39,4 +39,5 @@ mingw32-make.exe config=%gmake_config% UDT_json
 mingw32-make.exe config=%gmake_config% UDT_merger
 mingw32-make.exe config=%gmake_config% UDT_splitter
 mingw32-make.exe config=%gmake_config% UDT_timeshifter
+mingw32-make.exe config=%gmake_config% UDT_bench
 pause
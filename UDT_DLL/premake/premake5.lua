@@ -6,6 +6,12 @@ path_libs = path_root.."/libs"
 path_build = path_root.."/.build"
 path_bin = path_root.."/.bin"
 
+newoption
+{
+	trigger = "instrumentation",
+	description = "Compile in the parser's per-stage timers (defines UDT_INSTRUMENTATION)"
+}
+
 local function SetTargetAndLink(option) 
 
 	targetdir(option)
@@ -49,6 +55,10 @@ local function ApplyProjectSettings()
 	exceptionhandling "Off"
 	flags { "Unicode", "NoPCH", "StaticRuntime", "NoManifest", "ExtraWarnings" } -- "FatalWarnings"
 	
+	if _OPTIONS["instrumentation"] then
+		defines { "UDT_INSTRUMENTATION" }
+	end
+	
 	-- The PG instrumented and PG optimized builds need to share their .obj files.
 	filter { "configurations:ReleaseInst", "platforms:x32" }
 		objdir "!../.build/vs_pgo/obj/x32/ReleaseInst/%{prj.name}"
@@ -250,6 +260,14 @@ solution "UDT"
 		files { path_src_apps.."/shared.cpp" }
 		ApplyProjectSettings()
 		
+	project "UDT_bench"
+	
+		kind "ConsoleApp"
+		defines { "UDT_CREATE_DLL" }
+		files { path_src_apps.."/app_bench.cpp" }
+		files { path_src_apps.."/shared.cpp" }
+		ApplyProjectSettings()
+		
 	-- This project exists only to test the API in C89 mode to ensure nothing got messed up for C programmers.
 	project "UDT_c89"
 	
@@ -30,6 +30,7 @@ call "helpers/vs_msbuild.cmd" UDT_captures %CONFIG% x64
 call "helpers/vs_msbuild.cmd" UDT_converter %CONFIG% x64
 call "helpers/vs_msbuild.cmd" UDT_cutter %CONFIG% x64
 call "helpers/vs_msbuild.cmd" UDT_json %CONFIG% x64
+call "helpers/vs_msbuild.cmd" UDT_bench %CONFIG% x64
 
 pause
 exit
@@ -51,6 +52,7 @@ UDT_converter.exe -r -q -p=91 -o=cut "%DEMOPATH%\dm_73"
 UDT_converter.exe -r -q -p=91 -o=cut "%DEMOPATH%\dm_90"
 UDT_cutter.exe m -r -q -o=cut "%DEMOPATH%"
 UDT_json.exe -r -q -o=cut "%DEMOPATH%"
+UDT_bench.exe -r -q -w=0 -n=1 "%DEMOPATH%"
 UDT_GUI.exe "%DEMOPATH%"
 
 pause
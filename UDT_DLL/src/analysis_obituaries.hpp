@@ -29,6 +29,7 @@ public:
 	void ProcessCommandMessage(const udtCommandCallbackArg& arg, udtBaseParser& parser);
 
 	udtVMLinearAllocator& GetStringAllocator() { return _stringAllocator; }
+	const udtVMLinearAllocator& GetStringAllocator() const { return _stringAllocator; }
 
 	udtVMArray<udtParseDataObituary> Obituaries { "ObituariesAnalyzer::ObituariesArray" };
 
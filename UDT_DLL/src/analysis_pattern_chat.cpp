@@ -106,6 +106,9 @@ void udtChatPatternAnalyzer::ProcessCommandMessage(const udtCommandCallbackArg&
 	cutSection.EndTimeMs = endTimeMs;
 	cutSection.PatternTypes = UDT_BIT((u32)udtPatternType::Chat);
 	_cutSections.Add(cutSection);
+
+	// Keep the public list up to date so cuts can be applied during the analysis pass.
+	MergeRanges(CutSections, _cutSections);
 }
 
 void udtChatPatternAnalyzer::StartAnalysis()
@@ -9,3 +9,103 @@ void udtParserPlugInSplitter::ProcessGamestateMessage(const udtGamestateCallback
 {
 	GamestateFileOffsets.Add(parser._inFileOffset);
 }
+
+bool FindGamestateFileOffsets(udtVMArray<u32>& fileOffsets, udtBaseParser& parser, udtStream& file, const s32* cancelOperation)
+{
+	const udtProtocol::Id protocol = parser._inProtocol;
+	if(protocol <= udtProtocol::Dm48)
+	{
+		return false;
+	}
+
+	udtContext& context = *parser._context;
+	udtMessage message;
+	message.InitContext(&context);
+	message.InitProtocol(protocol);
+
+	const u64 fileStartOffset = (u64)file.Offset();
+	const u64 maxByteCount = file.Length() - fileStartOffset;
+	u64 fileOffset = 0;
+	for(;;)
+	{
+		if(cancelOperation != NULL && *cancelOperation != 0)
+		{
+			return false;
+		}
+
+		// Same checks as udtParserRunner::ReadMessage.
+		s32 header[2]; // Server message sequence, message length.
+		if(file.Read(header, 8, 1) != 1)
+		{
+			context.LogWarning("Demo file %s is truncated", parser.GetFileNamePtr());
+			return true;
+		}
+
+		const s32 messageLength = header[1];
+		if(messageLength == -1)
+		{
+			return true;
+		}
+
+		// Snapshots aren't validated here, so this may be the first sign of a corrupted snapshot
+		// the full parse would have stopped at, keeping the gamestates found so far.
+		if((u32)messageLength > (u32)ID_MAX_MSG_LENGTH)
+		{
+			context.LogWarning("Demo file %s has a message length greater than MAX_SIZE", parser.GetFileNamePtr());
+			return true;
+		}
+
+		message.Init(parser._inMsgData, ID_MAX_MSG_LENGTH);
+		if(file.Read(message.Buffer.data, (u32)messageLength, 1) != 1)
+		{
+			context.LogWarning("Demo file %s is truncated", parser.GetFileNamePtr());
+			return true;
+		}
+		message.Buffer.cursize = messageLength;
+		message.SetHuffman(true);
+
+		// Gamestate messages start with the reliable commands the client hasn't acknowledged yet.
+		// The first snapshot ends the search since we can't skip over it without decoding it.
+		message.ReadLong(); // Reliable sequence acknowledge.
+		for(;;)
+		{
+			if(message.Buffer.readcount > message.Buffer.cursize)
+			{
+				context.LogError("FindGamestateFileOffsets: Read past the end of the server message (in file: %s)", parser.GetFileNamePtr());
+				return true;
+			}
+
+			if(message.Buffer.readcount == message.Buffer.cursize)
+			{
+				break;
+			}
+
+			const s32 command = message.ReadByte();
+			if(command == svc_EOF || command == svc_snapshot)
+			{
+				break;
+			}
+
+			if(command == svc_gamestate)
+			{
+				fileOffsets.Add((u32)fileOffset);
+				break;
+			}
+
+			if(command == svc_serverCommand)
+			{
+				s32 commandStringLength = 0;
+				message.ReadLong(); // Command sequence.
+				message.ReadString(commandStringLength);
+			}
+			else if(command != svc_nop)
+			{
+				context.LogError("FindGamestateFileOffsets: Unrecognized server message command byte: %d (in file: %s)", command, parser.GetFileNamePtr());
+				return true;
+			}
+		}
+
+		context.NotifyProgress((f32)fileOffset / (f32)maxByteCount);
+		fileOffset += (u64)messageLength + 8;
+	}
+}
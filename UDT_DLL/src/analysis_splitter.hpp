@@ -14,6 +14,7 @@ public:
 
 	void InitAllocators(u32 demoCount);
 	u32  GetElementSize() const { return (u32)sizeof(u32); };
+	u32  GetSubscribedEvents() const override { return UDT_PLUG_IN_EVENT_BIT(Gamestate); }
 
 	void ProcessGamestateMessage(const udtGamestateCallbackArg& info, udtBaseParser& parser);
 
@@ -22,3 +23,8 @@ public:
 private:
 	UDT_NO_COPY_SEMANTICS(udtParserPlugInSplitter);
 };
+
+// Finds the same offsets as udtParserPlugInSplitter without a full parse pass.
+// Only the reliable acknowledge number and the commands preceding the first snapshot of each message are decoded.
+// The dm3 and dm_48 message formats aren't supported, use the plug-in for those.
+extern bool FindGamestateFileOffsets(udtVMArray<u32>& fileOffsets, udtBaseParser& parser, udtStream& file, const s32* cancelOperation);
@@ -12,9 +12,11 @@
 #include "analysis_splitter.hpp"
 #include "path.hpp"
 #include "thread_local_allocators.hpp"
+#include "context_pool.hpp"
 #include "system.hpp"
 #include "custom_context.hpp"
 #include "pattern_search_context.hpp"
+#include "columnar_export.hpp"
 
 // For malloc and free.
 #include <stdlib.h>
@@ -194,6 +196,14 @@ static const char* PerfStatsFieldNames[]
 };
 #undef UDT_PERF_STATS_ITEM
 
+#define UDT_PERF_STAGE_ITEM(Enum, Desc) Desc,
+static const char* PerfStageNames[]
+{
+	UDT_PERF_STAGE_LIST(UDT_PERF_STAGE_ITEM)
+	"after last perf stage"
+};
+#undef UDT_PERF_STAGE_ITEM
+
 #define UDT_PLAYER_STATS_ITEM(Enum, Desc, Comp, Type) (u8)udtStatsCompMode::Comp,
 static const u8 PlayerStatsCompModesArray[]
 {
@@ -476,6 +486,11 @@ UDT_API(s32) udtGetStringArray(u32 arrayId, const char*** elements, u32* element
 			*elementCount = (u32)(UDT_COUNT_OF(PerfStatsFieldNames) - 1);
 			break;
 
+		case udtStringArray::PerfStageNames:
+			*elements = PerfStageNames;
+			*elementCount = (u32)(UDT_COUNT_OF(PerfStageNames) - 1);
+			break;
+
 		default:
 			return (s32)udtErrorCode::InvalidArgument;
 	}
@@ -621,13 +636,16 @@ UDT_API(s32) udtGetProcessorCoreCount(u32* cpuCoreCount)
 UDT_API(s32) udtInitLibrary()
 {
 	udtThreadLocalAllocators::Init();
+	udtParserContextPool::Init();
 	BuildLookUpTables();
+	BuildHuffmanDecoderTables();
 
 	return (s32)udtErrorCode::None;
 }
 
 UDT_API(s32) udtShutDownLibrary()
 {
+	udtParserContextPool::Destroy();
 	udtThreadLocalAllocators::Destroy();
 
 	return (s32)udtErrorCode::None;
@@ -640,6 +658,32 @@ UDT_API(s32) udtSetCrashHandler(udtCrashCallback crashHandler)
 	return (s32)udtErrorCode::None;
 }
 
+UDT_API(s32) udtSetHugePagesEnabled(u32 enabled)
+{
+	udtVMLinearAllocator::SetHugePagesEnabled(enabled != 0);
+
+	return (s32)udtErrorCode::None;
+}
+
+UDT_API(s32) udtSetContextPoolPolicy(u32 policy)
+{
+	if(policy >= (u32)udtContextPoolPolicy::Count)
+	{
+		return (s32)udtErrorCode::InvalidArgument;
+	}
+
+	udtParserContextPool::SetPolicy((udtContextPoolPolicy::Id)policy);
+
+	return (s32)udtErrorCode::None;
+}
+
+UDT_API(s32) udtReleaseThreadContextPool()
+{
+	udtParserContextPool::ReleaseThreadContexts();
+
+	return (s32)udtErrorCode::None;
+}
+
 static bool CreateDemoFileSplit(udtVMLinearAllocator& tempAllocator, udtContext& context, udtStream& file, const char* filePath, const char* outputFolderPath, u32 index, u32 startOffset, u32 endOffset)
 {
 	if(endOffset <= startOffset)
@@ -778,11 +822,22 @@ UDT_API(s32) udtSplitDemoFile(udtParserContext* context, const udtParseArg* info
 
 	// TODO: Move this to api_helpers.cpp and implement it the same way Cut by Pattern is?
 	udtParserPlugInSplitter plugIn;
-	plugIn.Init(1, context->PlugInTempAllocator);
-	context->Parser.AddPlugIn(&plugIn);
-	if(!RunParser(context->Parser, file, info->CancelOperation))
+	if(protocol > udtProtocol::Dm48)
 	{
-		return (s32)udtErrorCode::OperationFailed;
+		// Only the message headers and leading commands need decoding.
+		if(!FindGamestateFileOffsets(plugIn.GamestateFileOffsets, context->Parser, file, info->CancelOperation))
+		{
+			return (s32)udtErrorCode::OperationFailed;
+		}
+	}
+	else
+	{
+		plugIn.Init(1, context->PlugInTempAllocator);
+		context->Parser.AddPlugIn(&plugIn);
+		if(!RunParser(context->Parser, file, info->CancelOperation))
+		{
+			return (s32)udtErrorCode::OperationFailed;
+		}
 	}
 
 	if(plugIn.GamestateFileOffsets.GetSize() <= 1)
@@ -838,7 +893,26 @@ UDT_API(s32) udtCutDemoFileByTime(udtParserContext* context, const udtParseArg*
 		return (s32)udtErrorCode::OperationFailed;
 	}
 
-	if(info->FileOffset > 0 && file.Seek((s32)info->FileOffset, udtSeekOrigin::Start) != 0)
+	// The cuts are all written in the same pass, so decoding has to start before the earliest one.
+	const udtCut* firstCut = NULL;
+	for(u32 i = 0; i < cutInfo->CutCount; ++i)
+	{
+		const udtCut& cut = cutInfo->Cuts[i];
+		if(cut.StartTimeMs < cut.EndTimeMs &&
+		   (firstCut == NULL || cut.StartTimeMs < firstCut->StartTimeMs))
+		{
+			firstCut = &cut;
+		}
+	}
+
+	// Start decoding at the closest keyframe before the first cut if the demo has an up-to-date seek index.
+	udtSeekIndex* const seekIndex = firstCut != NULL ? context->LoadSeekIndex(demoFilePath, protocol) : NULL;
+	u32 fileOffset = info->FileOffset;
+	const bool useKeyframe =
+		seekIndex != NULL &&
+		seekIndex->PrepareKeyframe(fileOffset, info->FileOffset, info->GameStateIndex, info->GameStateIndex, firstCut->StartTimeMs);
+
+	if(fileOffset > 0 && file.Seek((s32)fileOffset, udtSeekOrigin::Start) != 0)
 	{
 		return (s32)udtErrorCode::OperationFailed;
 	}
@@ -852,6 +926,10 @@ UDT_API(s32) udtCutDemoFileByTime(udtParserContext* context, const udtParseArg*
 	streamInfo.OutputFolderPath = info->OutputFolderPath;
 
 	context->Parser.SetFilePath(demoFilePath);
+	if(useKeyframe)
+	{
+		seekIndex->ApplyKeyframe(context->Parser);
+	}
 
 	for(u32 i = 0; i < cutInfo->CutCount; ++i)
 	{
@@ -964,6 +1042,76 @@ UDT_API(s32) udtGetContextPlugInBuffers(udtParserContext* context, u32 plugInId,
 	return (s32)udtErrorCode::None;
 }
 
+UDT_API(s32) udtStartDemoStream(udtParserContext* context, const udtParseArg* info, u32 protocol, const char* demoName)
+{
+	if(context == NULL || info == NULL || !udtIsValidProtocol(protocol) || !HasValidPlugInOptions(*info))
+	{
+		return (s32)udtErrorCode::InvalidArgument;
+	}
+
+	context->DemoStreamParser.Finish();
+	context->ResetForNextDemo(false);
+	if(!InitContextWithPlugIns(*context, *info, 1, udtParsingJobType::General, NULL))
+	{
+		return (s32)udtErrorCode::OperationFailed;
+	}
+
+	context->ResetForNextDemo(true);
+	if(!context->Context.SetCallbacks(info->MessageCb, NULL, NULL))
+	{
+		return (s32)udtErrorCode::OperationFailed;
+	}
+
+	const udtProtocol::Id protocolId = (udtProtocol::Id)protocol;
+	if(!context->Parser.Init(&context->Context, protocolId, protocolId))
+	{
+		return (s32)udtErrorCode::OperationFailed;
+	}
+
+	context->Parser.SetFilePath(demoName != NULL ? demoName : "stream");
+	context->InputIndices.Add(0);
+	context->DemoStreamParser.Start(context->Parser);
+
+	return (s32)udtErrorCode::None;
+}
+
+UDT_API(s32) udtPushDemoStreamData(udtParserContext* context, const void* data, u32 byteCount, u32* continueParsing)
+{
+	if(context == NULL || (data == NULL && byteCount > 0) || continueParsing == NULL)
+	{
+		return (s32)udtErrorCode::InvalidArgument;
+	}
+
+	if(!context->DemoStreamParser.IsParsing())
+	{
+		return (s32)udtErrorCode::OperationFailed;
+	}
+
+	const bool cont = context->DemoStreamParser.PushData((const u8*)data, byteCount);
+	context->UpdatePlugInBufferStructs();
+	*continueParsing = cont ? 1 : 0;
+
+	return (s32)udtErrorCode::None;
+}
+
+UDT_API(s32) udtFinishDemoStream(udtParserContext* context)
+{
+	if(context == NULL)
+	{
+		return (s32)udtErrorCode::InvalidArgument;
+	}
+
+	if(!context->DemoStreamParser.IsParsing())
+	{
+		return (s32)udtErrorCode::OperationFailed;
+	}
+
+	context->DemoStreamParser.Finish();
+	context->UpdatePlugInBufferStructs();
+
+	return context->DemoStreamParser.WasSuccess() ? (s32)udtErrorCode::None : (s32)udtErrorCode::OperationFailed;
+}
+
 struct udtParserContextGroup_s
 {
 	udtParserContext* Contexts;
@@ -1023,22 +1171,37 @@ static s32 RunJobWithLocalContextGroup(udtParsingJobType::Id jobType, const udtP
 	jobTimer.Start();
 
 	udtDemoThreadAllocator threadAllocator;
-	const bool threadJob = threadAllocator.Process(extraInfo->FilePaths, extraInfo->FileCount, extraInfo->MaxThreadCount);
+	const bool threadJob = threadAllocator.Process(extraInfo->FilePaths, extraInfo->FileCount, extraInfo->MaxThreadCount, extraInfo->MinByteCountPerThread);
 	if(!threadJob)
 	{
 		return udtParseMultipleDemosSingleThread(jobType, NULL, info, extraInfo, jobSpecificArg);
 	}
 
-	udtParserContextGroup* contextGroup;
-	if(!CreateContextGroup(&contextGroup, threadAllocator.Threads.GetSize()))
+	const u32 threadCount = threadAllocator.Threads.GetSize();
+	bool contextsCreated = true;
+	for(u32 i = 0; i < threadCount; ++i)
 	{
-		return udtParseMultipleDemosSingleThread(jobType, NULL, info, extraInfo, jobSpecificArg);
+		udtParserContext* const context = udtParserContextPool::Acquire();
+		threadAllocator.Threads[i].Context = context;
+		contextsCreated = contextsCreated && context != NULL;
 	}
 
-	udtMultiThreadedParsing parser;
-	const bool success = parser.Process(jobTimer, contextGroup->Contexts, threadAllocator, info, extraInfo, jobType, jobSpecificArg);
+	bool success = false;
+	if(contextsCreated)
+	{
+		udtMultiThreadedParsing parser;
+		success = parser.Process(jobTimer, threadAllocator, info, extraInfo, jobType, jobSpecificArg);
+	}
 
-	DestroyContextGroup(contextGroup);
+	for(u32 i = 0; i < threadCount; ++i)
+	{
+		udtParserContextPool::Release(threadAllocator.Threads[i].Context);
+	}
+
+	if(!contextsCreated)
+	{
+		return udtParseMultipleDemosSingleThread(jobType, NULL, info, extraInfo, jobSpecificArg);
+	}
 
 	return GetErrorCode(success, info->CancelOperation);
 }
@@ -1067,7 +1230,7 @@ UDT_API(s32) udtParseDemoFiles(udtParserContextGroup** contextGroup, const udtPa
 	jobTimer.Start();
 
 	udtDemoThreadAllocator threadAllocator;
-	const bool threadJob = threadAllocator.Process(extraInfo->FilePaths, extraInfo->FileCount, extraInfo->MaxThreadCount);
+	const bool threadJob = threadAllocator.Process(extraInfo->FilePaths, extraInfo->FileCount, extraInfo->MaxThreadCount, extraInfo->MinByteCountPerThread);
 	const u32 threadCount = threadJob ? threadAllocator.Threads.GetSize() : 1;
 	if(!CreateContextGroup(contextGroup, threadCount))
 	{
@@ -1080,8 +1243,13 @@ UDT_API(s32) udtParseDemoFiles(udtParserContextGroup** contextGroup, const udtPa
 		return udtParseMultipleDemosSingleThread(udtParsingJobType::General, (*contextGroup)->Contexts, info, extraInfo, NULL);
 	}
 	
+	for(u32 i = 0; i < threadCount; ++i)
+	{
+		threadAllocator.Threads[i].Context = &(*contextGroup)->Contexts[i];
+	}
+
 	udtMultiThreadedParsing parser;
-	const bool success = parser.Process(jobTimer, (*contextGroup)->Contexts, threadAllocator, info, extraInfo, udtParsingJobType::General, NULL);
+	const bool success = parser.Process(jobTimer, threadAllocator, info, extraInfo, udtParsingJobType::General, NULL);
 
 	return GetErrorCode(success, info->CancelOperation);
 }
@@ -1148,6 +1316,26 @@ UDT_API(s32) udtDestroySearchContext(udtPatternSearchContext* context)
 	return (s32)udtErrorCode::None;
 }
 
+UDT_API(s32) udtCutDemoFilesByTime(const udtParseArg* info, const udtMultiParseArg* extraInfo, const udtMultiCutByTimeArg* cutInfo)
+{
+	if(info == NULL || extraInfo == NULL || cutInfo == NULL ||
+	   !IsValid(*extraInfo) || !IsValid(*cutInfo))
+	{
+		return (s32)udtErrorCode::InvalidArgument;
+	}
+
+	for(u32 i = 0; i < extraInfo->FileCount; ++i)
+	{
+		const udtCutByTimeArg& fileCuts = cutInfo->FileCuts[i];
+		if(fileCuts.CutCount > 0 && fileCuts.Cuts == NULL)
+		{
+			return (s32)udtErrorCode::InvalidArgument;
+		}
+	}
+
+	return RunJobWithLocalContextGroup(udtParsingJobType::CutByTime, info, extraInfo, cutInfo);
+}
+
 UDT_API(s32) udtConvertDemoFiles(const udtParseArg* info, const udtMultiParseArg* extraInfo, const udtProtocolConversionArg* conversionArg)
 {
 	if(info == NULL || extraInfo == NULL || conversionArg == NULL ||
@@ -1181,6 +1369,47 @@ UDT_API(s32) udtSaveDemoFilesAnalysisDataToJSON(const udtParseArg* info, const u
 	return RunJobWithLocalContextGroup(udtParsingJobType::ExportToJSON, info, extraInfo, jsonInfo);
 }
 
+UDT_API(s32) udtSaveDemoFilesAnalysisDataToColumnar(const udtParseArg* info, const udtMultiParseArg* extraInfo, const udtColumnarExportArg* columnarInfo)
+{
+	if(info == NULL || extraInfo == NULL || columnarInfo == NULL || columnarInfo->OutputFilePath == NULL ||
+	   !IsValid(*extraInfo) || !HasValidPlugInOptions(*info))
+	{
+		return (s32)udtErrorCode::InvalidArgument;
+	}
+
+	// All demos go to the same file, so we keep the plug-in data of every demo until the end.
+	udtParserContextGroup* contextGroup = NULL;
+	const s32 result = udtParseDemoFiles(&contextGroup, info, extraInfo);
+	if(result != (s32)udtErrorCode::None)
+	{
+		DestroyContextGroup(contextGroup);
+		return result;
+	}
+
+	const bool success = ExportPlugInsDataToColumnar(contextGroup->Contexts, contextGroup->ContextCount, extraInfo->FilePaths, extraInfo->FileCount, columnarInfo->OutputFilePath);
+	DestroyContextGroup(contextGroup);
+
+	return success ? (s32)udtErrorCode::None : (s32)udtErrorCode::OperationFailed;
+}
+
+UDT_API(s32) udtProbeDemoFiles(const udtParseArg* info, const udtMultiParseArg* extraInfo, const udtProbeArg* probeInfo)
+{
+	if(info == NULL || extraInfo == NULL || probeInfo == NULL ||
+	   !IsValid(*extraInfo) || !IsValid(*probeInfo))
+	{
+		return (s32)udtErrorCode::InvalidArgument;
+	}
+
+	// Only the start of each file gets read, so the file sizes say nothing about the amount of work.
+	udtMultiParseArg probeExtraInfo = *extraInfo;
+	if(probeExtraInfo.MinByteCountPerThread == 0)
+	{
+		probeExtraInfo.MinByteCountPerThread = 1;
+	}
+
+	return RunJobWithLocalContextGroup(udtParsingJobType::Probe, info, &probeExtraInfo, probeInfo);
+}
+
 UDT_API(s32) udtGetContextCountFromGroup(udtParserContextGroup* contextGroup, u32* count)
 {
 	if(contextGroup == NULL || count == NULL)
@@ -1250,6 +1479,19 @@ UDT_API(s32) udtGetDemoInputIndex(udtParserContext* context, u32 demoIdx, u32* d
 	return (s32)udtErrorCode::None;
 }
 
+UDT_API(s32) udtGetDemoEarlyExit(udtParserContext* context, u32 demoIdx, u32* earlyExit)
+{
+	if(context == NULL || earlyExit == NULL ||
+	   demoIdx >= context->GetDemoCount() || demoIdx >= context->Parser.PlugInEarlyExits.GetSize())
+	{
+		return (s32)udtErrorCode::InvalidArgument;
+	}
+
+	*earlyExit = (u32)context->Parser.PlugInEarlyExits[demoIdx];
+
+	return (s32)udtErrorCode::None;
+}
+
 UDT_API(udtCuContext*) udtCuCreateContext()
 {
 	// @NOTE: We don't use the standard operator new approach to avoid C++ exceptions.
@@ -1316,10 +1558,10 @@ UDT_API(s32) udtCuParseMessage(udtCuContext* context, udtCuMessageOutput* messag
 	}
 
 	udtMessage& message = context->InMessage;
-	message.Init((u8*)messageInput->Buffer, ID_MAX_MSG_LENGTH);
+	message.Init((u8*)messageInput->Buffer, (s32)messageInput->BufferByteCount);
 	message.Buffer.cursize = (s32)messageInput->BufferByteCount;
-	context->Context.Parser.PlugIns.Clear();
-	context->Context.Parser.PlugIns.Add(&context->PlugIn);
+	context->Context.Parser.ClearPlugIns();
+	context->Context.Parser.AddPlugIn(&context->PlugIn);
 	const bool cont = context->Context.Parser.ParseNextMessage(message, messageInput->MessageSequence, 0);
 	*messageOutput = context->Message;
 	*continueParsing = cont ? 1 : 0;
@@ -11,6 +11,11 @@ static bool IsValid(const udtCutByTimeArg& arg)
 	return arg.CutCount > 0 && arg.Cuts != NULL;
 }
 
+static bool IsValid(const udtMultiCutByTimeArg& arg)
+{
+	return arg.FileCuts != NULL;
+}
+
 static bool IsValid(const udtChatPatternArg& arg)
 {
 	if(arg.Rules == NULL || arg.RuleCount == 0)
@@ -117,6 +122,11 @@ static bool IsValid(const udtProtocolConversionArg& arg)
 	return arg.OutputProtocol == (u32)udtProtocol::Dm68 || arg.OutputProtocol == (u32)udtProtocol::Dm91;
 }
 
+static bool IsValid(const udtProbeArg& arg)
+{
+	return arg.DemoInfos != NULL;
+}
+
 static bool HasValidOutputOption(const udtParseArg& arg)
 {
 	return arg.OutputFolderPath == NULL || IsValidDirectory(arg.OutputFolderPath);
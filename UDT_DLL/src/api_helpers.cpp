@@ -8,12 +8,26 @@
 #include "analysis_pattern_frag_run.hpp"
 #include "plug_in_pattern_search.hpp"
 #include "plug_in_converter_quake_to_udt.hpp"
+#include "plug_in_probe.hpp"
 #include "parser_runner.hpp"
 #include "converter_entity_timer_shifter.hpp"
 #include "path.hpp"
 #include "memory_stream.hpp"
 #include "json_export.hpp"
 #include "pattern_search_context.hpp"
+#include "streaming_cutter.hpp"
+#include "seek_index.hpp"
+#include "instrumentation.hpp"
+#include "context_pool.hpp"
+#include "parallel_game_states.hpp"
+#include "threads.hpp"
+#include "system.hpp"
+
+// For malloc and free.
+#include <stdlib.h>
+
+// For the placement new operator.
+#include <new>
 
 
 bool InitContextWithPlugIns(udtParserContext& context, const udtParseArg& info, u32 demoCount, udtParsingJobType::Id jobType, const void* jobSpecificInfo)
@@ -33,7 +47,8 @@ bool InitContextWithPlugIns(udtParserContext& context, const udtParseArg& info,
 		return context.Init(demoCount, info.PlugIns, info.PlugInCount);
 	}
 
-	if(jobType == udtParsingJobType::Conversion)
+	if(jobType == udtParsingJobType::Conversion ||
+	   jobType == udtParsingJobType::CutByTime)
 	{
 		if(jobSpecificInfo == NULL)
 		{
@@ -111,9 +126,63 @@ bool InitContextWithPlugIns(udtParserContext& context, const udtParseArg& info,
 		return true;
 	}
 
+	if(jobType == udtParsingJobType::Probe)
+	{
+		if(jobSpecificInfo == NULL)
+		{
+			return false;
+		}
+
+		const u32 plugInId = udtPrivateParserPlugIn::Probe;
+		if(!context.Init(demoCount, &plugInId, 1))
+		{
+			return false;
+		}
+
+		udtBaseParserPlugIn* plugInBase = NULL;
+		context.GetPlugInById(plugInBase, plugInId);
+		if(plugInBase == NULL)
+		{
+			return false;
+		}
+
+		const udtProbeArg* const probeInfo = (const udtProbeArg*)jobSpecificInfo;
+		udtParserPlugInProbe& plugIn = *(udtParserPlugInProbe*)plugInBase;
+		plugIn.SetMessageCount(probeInfo->MessageCount);
+
+		return true;
+	}
+
 	return false;
 }
 
+static bool RunParserAndWriteSeekIndex(udtParserContext* context, udtStream& file, const char* demoFilePath, const s32* cancelOperation)
+{
+	udtParserRunner runner;
+	if(!runner.Init(context->Parser, file, cancelOperation))
+	{
+		return false;
+	}
+
+	udtSeekIndexWriter* const seekIndexWriter = context->GetSeekIndexWriter();
+	if(seekIndexWriter == NULL)
+	{
+		return false;
+	}
+
+	seekIndexWriter->StartDemo(context->Parser, demoFilePath);
+	while(runner.ParseNextMessage())
+	{
+		seekIndexWriter->ProcessMessage();
+	}
+
+	runner.FinishParsing();
+	const bool success = runner.WasSuccess();
+	seekIndexWriter->FinishDemo(success);
+
+	return success;
+}
+
 static bool ParseDemoFile(udtProtocol::Id protocol, udtParserContext* context, const udtParseArg* info, const char* demoFilePath, bool clearPlugInData)
 {
 	context->ResetForNextDemo(!clearPlugInData);
@@ -122,7 +191,7 @@ static bool ParseDemoFile(udtProtocol::Id protocol, udtParserContext* context, c
 		return false;
 	}
 
-	UDT_INIT_DEMO_FILE_READER(file, demoFilePath, context);
+	UDT_INIT_DEMO_FILE_READER(file, demoFilePath, context, info->Flags);
 
 	if(!context->Parser.Init(&context->Context, protocol, protocol))
 	{
@@ -130,6 +199,20 @@ static bool ParseDemoFile(udtProtocol::Id protocol, udtParserContext* context, c
 	}
 
 	context->Parser.SetFilePath(demoFilePath);
+	if((info->Flags & (u32)udtParseArgFlag::WriteSeekIndex) != 0)
+	{
+		return RunParserAndWriteSeekIndex(context, file, demoFilePath, info->CancelOperation);
+	}
+
+	if((info->Flags & (u32)udtParseArgFlag::ParallelGameStates) != 0)
+	{
+		bool success = false;
+		if(ParseGameStatesInParallel(success, context, info, demoFilePath))
+		{
+			return success;
+		}
+	}
+
 	if(!RunParser(context->Parser, file, info->CancelOperation))
 	{
 		return false;
@@ -149,15 +232,74 @@ static bool ParseDemoFile(udtParserContext* context, const udtParseArg* info, co
 	return ParseDemoFile(protocol, context, info, demoFilePath, clearPlugInData);
 }
 
-static bool CutByPattern(udtParserContext* context, const udtParseArg* info, const char* demoFilePath)
+static bool ParseDemoFileAndApplyCuts(bool& cutsApplied, udtProtocol::Id protocol, udtParserContext* context, const udtParseArg* info, const char* demoFilePath, udtPatternSearchPlugIn& plugIn)
 {
-	const udtProtocol::Id protocol = (udtProtocol::Id)udtGetProtocolByFilePath(demoFilePath);
-	if(protocol == udtProtocol::Invalid)
+	cutsApplied = false;
+	udtStreamingCutter* const streamingCutter = context->GetStreamingCutter();
+	if(streamingCutter == NULL)
 	{
 		return false;
 	}
 
-	if(!ParseDemoFile(protocol, context, info, demoFilePath, false))
+	context->ResetForNextDemo(true);
+	if(!context->Context.SetCallbacks(info->MessageCb, info->ProgressCb, info->ProgressContext))
+	{
+		return false;
+	}
+
+	UDT_INIT_DEMO_FILE_READER(file, demoFilePath, context, info->Flags);
+
+	if(!context->Parser.Init(&context->Context, protocol, protocol))
+	{
+		return false;
+	}
+
+	context->Parser.SetFilePath(demoFilePath);
+
+	udtParserRunner runner;
+	if(!runner.Init(context->Parser, file, info->CancelOperation))
+	{
+		return false;
+	}
+
+	udtSeekIndexWriter* seekIndexWriter = NULL;
+	if((info->Flags & (u32)udtParseArgFlag::WriteSeekIndex) != 0)
+	{
+		seekIndexWriter = context->GetSeekIndexWriter();
+		if(seekIndexWriter == NULL)
+		{
+			return false;
+		}
+
+		seekIndexWriter->StartDemo(context->Parser, demoFilePath);
+	}
+
+	udtStreamingCutter& cutter = *streamingCutter;
+	cutter.StartDemo(context->Parser, plugIn, info->OutputFolderPath);
+	while(runner.ParseNextMessage())
+	{
+		cutter.ProcessMessage();
+		if(seekIndexWriter != NULL)
+		{
+			seekIndexWriter->ProcessMessage();
+		}
+	}
+
+	runner.FinishParsing();
+	const bool success = runner.WasSuccess();
+	cutsApplied = cutter.FinishDemo(success);
+	if(seekIndexWriter != NULL)
+	{
+		seekIndexWriter->FinishDemo(success);
+	}
+
+	return success;
+}
+
+static bool CutByPattern(udtParserContext* context, const udtParseArg* info, const char* demoFilePath)
+{
+	const udtProtocol::Id protocol = (udtProtocol::Id)udtGetProtocolByFilePath(demoFilePath);
+	if(protocol == udtProtocol::Invalid)
 	{
 		return false;
 	}
@@ -166,6 +308,25 @@ static bool CutByPattern(udtParserContext* context, const udtParseArg* info, con
 	context->GetPlugInById(plugInBase, udtPrivateParserPlugIn::FindPatterns);
 	udtPatternSearchPlugIn& plugIn = *(udtPatternSearchPlugIn*)plugInBase;
 
+	if((plugIn.GetInfo().Flags & (u32)udtPatternSearchArgMask::TwoPassCutting) == 0)
+	{
+		// Try writing the cuts during the analysis and fall back to a second pass if it didn't work out.
+		bool cutsApplied = false;
+		if(!ParseDemoFileAndApplyCuts(cutsApplied, protocol, context, info, demoFilePath, plugIn))
+		{
+			return false;
+		}
+
+		if(cutsApplied)
+		{
+			return true;
+		}
+	}
+	else if(!ParseDemoFile(protocol, context, info, demoFilePath, false))
+	{
+		return false;
+	}
+
 	if(plugIn.CutSections.IsEmpty())
 	{
 		return true;
@@ -178,8 +339,15 @@ static bool CutByPattern(udtParserContext* context, const udtParseArg* info, con
 	}
 
 	const s32 gsIndex = plugIn.CutSections[0].GameStateIndex;
-	const u32 fileOffset = context->Parser._inGameStateFileOffsets[gsIndex];
-	UDT_INIT_DEMO_FILE_READER_AT(file, demoFilePath, context, fileOffset);
+	const u32 gsFileOffset = context->Parser._inGameStateFileOffsets[gsIndex];
+
+	// Start decoding at the closest keyframe before the first cut if the demo has an up-to-date seek index.
+	udtSeekIndex* const seekIndex = context->LoadSeekIndex(demoFilePath, protocol);
+	u32 fileOffset = gsFileOffset;
+	const bool useKeyframe = 
+		seekIndex != NULL &&
+		seekIndex->PrepareKeyframe(fileOffset, gsFileOffset, gsIndex, gsIndex, plugIn.CutSections[0].StartTimeMs);
+	UDT_INIT_DEMO_FILE_READER_AT(file, demoFilePath, context, fileOffset, info->Flags);
 
 	// Save the cut sections in a temporary array.
 	udtVMArray<udtCutSection> sections("CutByPattern::SectionsArray");
@@ -195,6 +363,10 @@ static bool CutByPattern(udtParserContext* context, const udtParseArg* info, con
 	}
 
 	context->Parser.SetFilePath(demoFilePath);
+	if(useKeyframe)
+	{
+		seekIndex->ApplyKeyframe(context->Parser);
+	}
 
 	CallbackCutDemoFileStreamCreationInfo cutCbInfo;
 	cutCbInfo.OutputFolderPath = info->OutputFolderPath;
@@ -254,6 +426,25 @@ static bool FindPatterns(udtParserContext* context, u32 demoIndex, const udtPars
 	return true;
 }
 
+static bool ProbeDemoFile(udtParserContext* context, u32 demoIndex, const udtParseArg* info, const char* demoFilePath, const udtProbeArg* probeInfo)
+{
+	udtProbeDemoInfo& demoInfo = probeInfo->DemoInfos[demoIndex];
+	memset(&demoInfo, 0, sizeof(demoInfo));
+
+	if(!ParseDemoFile(context, info, demoFilePath, false))
+	{
+		return false;
+	}
+
+	udtBaseParserPlugIn* plugInBase = NULL;
+	context->GetPlugInById(plugInBase, udtPrivateParserPlugIn::Probe);
+	udtParserPlugInProbe& plugIn = *(udtParserPlugInProbe*)plugInBase;
+	demoInfo = plugIn.Info;
+
+	// No gamestate message means there's nothing to report, so the demo's error code says so too.
+	return demoInfo.Valid != 0;
+}
+
 static bool ConvertDemoFile(udtParserContext* context, const udtParseArg* info, const char* demoFilePath, const udtProtocolConversionArg* conversionInfo)
 {
 	const udtProtocol::Id protocol = (udtProtocol::Id)udtGetProtocolByFilePath(demoFilePath);
@@ -274,7 +465,7 @@ static bool ConvertDemoFile(udtParserContext* context, const udtParseArg* info,
 		return false;
 	}
 
-	UDT_INIT_DEMO_FILE_READER(file, demoFilePath, context);
+	UDT_INIT_DEMO_FILE_READER(file, demoFilePath, context, info->Flags);
 
 	if(!context->Parser.Init(&context->Context, protocol, (udtProtocol::Id)conversionInfo->OutputProtocol))
 	{
@@ -297,6 +488,84 @@ static bool ConvertDemoFile(udtParserContext* context, const udtParseArg* info,
 	return true;
 }
 
+static bool CutDemoFileByTime(udtParserContext* context, u32 demoIndex, const udtParseArg* info, const char* demoFilePath, const udtMultiCutByTimeArg* cutInfo)
+{
+	// Decoding has to start before the earliest cut.
+	const udtCutByTimeArg& fileCuts = cutInfo->FileCuts[demoIndex];
+	const udtCut* firstCut = NULL;
+	for(u32 i = 0; i < fileCuts.CutCount; ++i)
+	{
+		const udtCut& cut = fileCuts.Cuts[i];
+		if(cut.StartTimeMs < cut.EndTimeMs &&
+		   (firstCut == NULL ||
+		    cut.GameStateIndex < firstCut->GameStateIndex ||
+		    (cut.GameStateIndex == firstCut->GameStateIndex && cut.StartTimeMs < firstCut->StartTimeMs)))
+		{
+			firstCut = &cut;
+		}
+	}
+
+	if(firstCut == NULL)
+	{
+		// Nothing to cut!
+		return true;
+	}
+
+	const udtProtocol::Id protocol = (udtProtocol::Id)udtGetProtocolByFilePath(demoFilePath);
+	if(protocol == udtProtocol::Invalid)
+	{
+		return false;
+	}
+
+	context->ResetForNextDemo(false);
+	if(!context->Context.SetCallbacks(info->MessageCb, info->ProgressCb, info->ProgressContext))
+	{
+		return false;
+	}
+
+	// Start decoding at the closest keyframe before the first cut if the demo has an up-to-date seek index.
+	udtSeekIndex* const seekIndex = context->LoadSeekIndex(demoFilePath, protocol);
+	u32 fileOffset = 0;
+	const bool useKeyframe =
+		seekIndex != NULL &&
+		seekIndex->PrepareKeyframe(fileOffset, 0, 0, firstCut->GameStateIndex, firstCut->StartTimeMs);
+
+	UDT_INIT_DEMO_FILE_READER_AT(file, demoFilePath, context, fileOffset, info->Flags);
+
+	if(!context->Parser.Init(&context->Context, protocol, protocol))
+	{
+		return false;
+	}
+
+	context->Parser.SetFilePath(demoFilePath);
+	if(useKeyframe)
+	{
+		seekIndex->ApplyKeyframe(context->Parser);
+	}
+
+	CallbackCutDemoFileStreamCreationInfo cutCbInfo;
+	cutCbInfo.OutputFolderPath = info->OutputFolderPath;
+	for(u32 i = 0; i < fileCuts.CutCount; ++i)
+	{
+		const udtCut& cut = fileCuts.Cuts[i];
+		if(cut.StartTimeMs >= cut.EndTimeMs)
+		{
+			continue;
+		}
+
+		if(cut.FilePath != NULL)
+		{
+			context->Parser.AddCut(cut.GameStateIndex, cut.StartTimeMs, cut.EndTimeMs, cut.FilePath);
+		}
+		else
+		{
+			context->Parser.AddCut(cut.GameStateIndex, cut.StartTimeMs, cut.EndTimeMs, &CallbackCutDemoFileNameCreation, NULL, &cutCbInfo);
+		}
+	}
+
+	return RunParser(context->Parser, file, info->CancelOperation);
+}
+
 static void CreateTimeShiftDemoName(udtString& outputFilePath, udtVMLinearAllocator& allocator, const udtString& inputFilePath, const char* outputFolderPath, const udtTimeShiftArg* timeShiftArg, udtProtocol::Id protocol)
 {
 	udtString inputFileName;
@@ -352,7 +621,7 @@ static bool TimeShiftDemo(udtParserContext* context, const udtParseArg* info, co
 		return false;
 	}
 
-	UDT_INIT_DEMO_FILE_READER(input, demoFilePath, context);
+	UDT_INIT_DEMO_FILE_READER(input, demoFilePath, context, info->Flags);
 
 	context->ModifierContext.ResetForNextDemo();
 
@@ -510,6 +779,12 @@ bool ProcessSingleDemoFile(udtParsingJobType::Id jobType, udtParserContext* cont
 		case udtParsingJobType::FindPatterns:
 			return FindPatterns(context, inputDemoIndex, info, demoFilePath, (udtPatternSearchContext*)jobSpecificInfo);
 
+		case udtParsingJobType::Probe:
+			return ProbeDemoFile(context, inputDemoIndex, info, demoFilePath, (const udtProbeArg*)jobSpecificInfo);
+
+		case udtParsingJobType::CutByTime:
+			return CutDemoFileByTime(context, inputDemoIndex, info, demoFilePath, (const udtMultiCutByTimeArg*)jobSpecificInfo);
+
 		default:
 			return false;
 	}
@@ -546,10 +821,15 @@ s32 udtParseMultipleDemosSingleThread(udtParsingJobType::Id jobType, udtParserCo
 		PerfStatsInit(info->PerformanceStats);
 	}
 
+	if(info->StagePerfStats != NULL)
+	{
+		StagePerfStatsInit(info->StagePerfStats);
+	}
+
 	bool customContext = false;
 	if(context == NULL)
 	{
-		context = udtCreateContext();
+		context = udtParserContextPool::Acquire();
 		if(context == NULL)
 		{
 			return (s32)udtErrorCode::OperationFailed;
@@ -559,6 +839,10 @@ s32 udtParseMultipleDemosSingleThread(udtParsingJobType::Id jobType, udtParserCo
 
 	if(!InitContextWithPlugIns(*context, *info, extraInfo->FileCount, jobType, jobSpecificInfo))
 	{
+		if(customContext)
+		{
+			udtParserContextPool::Release(context);
+		}
 		return (s32)udtErrorCode::OperationFailed;
 	}
 
@@ -596,6 +880,8 @@ s32 udtParseMultipleDemosSingleThread(udtParsingJobType::Id jobType, udtParserCo
 	newInfo.ProgressCb = &SingleThreadProgressCallback;
 	newInfo.ProgressContext = &progressContext;
 
+	InstrumentationBeginThread(info->StagePerfStats, 0);
+
 	u64 actualProcessedByteCount = 0;
 	for(u32 i = 0; i < extraInfo->FileCount; ++i)
 	{
@@ -617,6 +903,12 @@ s32 udtParseMultipleDemosSingleThread(udtParsingJobType::Id jobType, udtParserCo
 		}
 	}
 
+	udtStageCounters stageCounters;
+	if(InstrumentationEndThread(stageCounters))
+	{
+		StagePerfStatsAddThread(info->StagePerfStats, stageCounters);
+	}
+
 	if(!customContext)
 	{
 		context->UpdatePlugInBufferStructs();
@@ -635,7 +927,7 @@ s32 udtParseMultipleDemosSingleThread(udtParsingJobType::Id jobType, udtParserCo
 
 	if(customContext)
 	{
-		udtDestroyContext(context);
+		udtParserContextPool::Release(context);
 	}
 
 	return GetErrorCode(true, info->CancelOperation);
@@ -674,43 +966,102 @@ static void CreateMergedDemoName(udtString& outputFilePath, udtVMLinearAllocator
 	outputFilePath = udtString::NewFromConcatenatingMultiple(allocator, outputFilePathParts, (u32)UDT_COUNT_OF(outputFilePathParts));
 }
 
+// The number of udtd chunks an input's decoder can get ahead of the merge stage.
+#define UDT_MERGE_QUEUE_LENGTH 16
+
 struct DemoMerger
 {
+	// The inputs are decoded from Quake to udtd by at most one thread per core, input i by decoder i % decoder count.
+	// Each input's chunks go through a bounded single-producer single-consumer queue:
+	// the decoder fills slot WriteCount and the merge stage reads slot ReadCount.
+	// A decoder sleeps when all its inputs' queues are full and the merge stage sleeps when the queue it needs is empty.
+	// They only wake each other up once a queue is half full or half empty, so that they don't take turns on every chunk.
 	struct DemoData
 	{
+		DemoData()
+		{
+			Context = NULL;
+			ConverterToUDT = NULL;
+			WriteCount = 0;
+			ReadCount = 0;
+			Finished = 0;
+			HoldsChunk = false;
+		}
+
 		udtFileStream Input;
 		udtParserRunner Runner;
-		udtVMMemoryStream WriteBuffer;
+		udtVMMemoryStream Chunks[UDT_MERGE_QUEUE_LENGTH];
 		udtReadOnlyMemoryStream ReadBuffer;
 		udtdConverter ConverterToQuake;
 		udtParserContext* Context;
 		udtParserPlugInQuakeToUDT* ConverterToUDT;
+		volatile s32 WriteCount; // Only written by the decoder.
+		volatile s32 ReadCount;  // Only written by the merge stage.
+		volatile s32 Finished;   // Set by the decoder once WriteCount is final.
+		bool HoldsChunk;         // The merge stage is still reading from slot ReadCount.
 	};
 
-	DemoMerger()
+	struct Decoder
 	{
-		for(u32 i = 0; i < UDT_MAX_MERGE_DEMO_COUNT; ++i)
+		Decoder()
 		{
-			_demos[i].Context = NULL;
-			_demos[i].ConverterToUDT = NULL;
+			Merger = NULL;
+			Index = 0;
+			ThreadStarted = false;
 		}
 
+		udtThread Thread;
+		udtEvent QueueSpaceAvailable;
+		DemoMerger* Merger;
+		u32 Index;
+		bool ThreadStarted;
+	};
+
+	DemoMerger()
+	{
+		_demos = NULL;
+		_decoders = NULL;
 		_fileCount = 0;
+		_decoderCount = 0;
+		_stopDecoders = 0;
+		_progress = 0.0f;
+		_reportedProgress = 0.0f;
+		_threaded = false;
 	}
 
 	~DemoMerger()
 	{
-		for(u32 i = 0; i < UDT_MAX_MERGE_DEMO_COUNT; ++i)
+		StopDecoders();
+
+		if(_demos == NULL)
+		{
+			return;
+		}
+
+		for(u32 i = 0; i < _fileCount; ++i)
 		{
 			if(_demos[i].Context != NULL)
 			{
-				udtDestroyContext(_demos[i].Context);
+				udtParserContextPool::Release(_demos[i].Context);
 			}
+			_demos[i].~DemoData();
 		}
+
+		free(_demos);
 	}
 
 	bool MergeDemos(const udtParseArg* info, const char** filePaths, u32 fileCount, udtProtocol::Id protocol)
 	{
+		_demos = (DemoData*)malloc((size_t)fileCount * sizeof(DemoData));
+		if(_demos == NULL)
+		{
+			return false;
+		}
+
+		for(u32 i = 0; i < fileCount; ++i)
+		{
+			new (_demos + i) DemoData;
+		}
 		_fileCount = fileCount;
 
 		udtVMLinearAllocator tempAllocator("DemoMerger::MergeDemos::Temp");
@@ -728,7 +1079,7 @@ struct DemoMerger
 		{
 			DemoData& demo = _demos[i];
 
-			demo.Context = udtCreateContext();
+			demo.Context = udtParserContextPool::Acquire();
 			if(demo.Context == NULL)
 			{
 				return false;
@@ -752,7 +1103,8 @@ struct DemoMerger
 				return false;
 			}
 
-			if(!demo.Context->Context.SetCallbacks(info->MessageCb, i == 0 ? info->ProgressCb : NULL, info->ProgressContext))
+			// The first demo's decoder may run on another thread, so progress is forwarded by the merge stage.
+			if(!demo.Context->Context.SetCallbacks(info->MessageCb, i == 0 ? &ProgressCallback : NULL, this))
 			{
 				return false;
 			}
@@ -774,10 +1126,14 @@ struct DemoMerger
 				return false;
 			}
 
-			demo.ConverterToUDT->SetOutputStream(&demo.WriteBuffer);
 			demo.ConverterToQuake.ResetForNextDemo(demo.ReadBuffer, i == 0 ? &output : NULL, protocol);
 		}
 
+		if(!StartDecoders())
+		{
+			return false;
+		}
+
 		DemoData& firstDemo = _demos[0];
 		s32 firstTime = UDT_S32_MIN;
 		udtdMessageType::Id messageType = udtdMessageType::Invalid;
@@ -787,24 +1143,20 @@ struct DemoMerger
 
 		for(;;)
 		{
-			if(!firstDemo.Runner.ParseNextMessage())
+			udtVMMemoryStream* const chunk = GetNextChunk(firstDemo);
+			if(chunk == NULL)
 			{
 				break;
 			}
 
-			const u64 writeBufferSize = firstDemo.WriteBuffer.Length();
-			if(writeBufferSize == 0)
-			{
-				continue;
-			}
+			ReportProgress(info);
 
-			if(!firstDemo.ReadBuffer.Open(firstDemo.WriteBuffer.GetBuffer(), (u32)firstDemo.WriteBuffer.Length()))
+			if(!firstDemo.ReadBuffer.Open(chunk->GetBuffer(), (u32)chunk->Length()))
 			{
 				return false;
 			}
 
 			firstDemo.ConverterToQuake.ProcessNextMessageRead(messageType, snapshotInfo);
-			firstDemo.WriteBuffer.Clear();
 
 			if(messageType == udtdMessageType::Snapshot)
 			{
@@ -847,18 +1199,13 @@ struct DemoMerger
 		udtdMessageType::Id messageType = udtdMessageType::Invalid;
 		for(;;)
 		{
-			if(!demo.Runner.ParseNextMessage())
+			udtVMMemoryStream* const chunk = GetNextChunk(demo);
+			if(chunk == NULL)
 			{
 				break;
 			}
 
-			const u64 writeBufferSize = demo.WriteBuffer.Length();
-			if(writeBufferSize == 0)
-			{
-				continue;
-			}
-
-			if(!demo.ReadBuffer.Open(demo.WriteBuffer.GetBuffer(), (u32)demo.WriteBuffer.Length()))
+			if(!demo.ReadBuffer.Open(chunk->GetBuffer(), (u32)chunk->Length()))
 			{
 				break;
 			}
@@ -874,7 +1221,6 @@ struct DemoMerger
 				}
 			}
 
-			demo.WriteBuffer.Clear();
 			if(stop)
 			{
 				break;
@@ -898,8 +1244,235 @@ struct DemoMerger
 		}
 	}
 
-	DemoData _demos[UDT_MAX_MERGE_DEMO_COUNT];
+private:
+	static void ProgressCallback(f32 progress, void* userData)
+	{
+		((DemoMerger*)userData)->_progress = progress;
+	}
+
+	static void DecoderThreadEntryPoint(void* userData)
+	{
+		Decoder* const decoder = (Decoder*)userData;
+		decoder->Merger->RunDecoder(*decoder);
+	}
+
+	bool StartDecoders()
+	{
+		// With a single core, the merge stage decodes on demand instead.
+		u32 processorCoreCount = 1;
+		GetProcessorCoreCount(processorCoreCount);
+		if(processorCoreCount <= 1)
+		{
+			return true;
+		}
+
+		const u32 decoderCount = udt_min(_fileCount, processorCoreCount);
+		_decoders = (Decoder*)malloc((size_t)decoderCount * sizeof(Decoder));
+		if(_decoders == NULL)
+		{
+			return false;
+		}
+
+		for(u32 i = 0; i < decoderCount; ++i)
+		{
+			new (_decoders + i) Decoder;
+			_decoders[i].Merger = this;
+			_decoders[i].Index = i;
+		}
+		_decoderCount = decoderCount;
+
+		if(!_chunkAvailable.Create())
+		{
+			return false;
+		}
+
+		for(u32 i = 0; i < decoderCount; ++i)
+		{
+			if(!_decoders[i].QueueSpaceAvailable.Create())
+			{
+				return false;
+			}
+		}
+
+		_threaded = true;
+		for(u32 i = 0; i < decoderCount; ++i)
+		{
+			Decoder& decoder = _decoders[i];
+			if(!decoder.Thread.CreateAndStart(&DecoderThreadEntryPoint, &decoder))
+			{
+				return false;
+			}
+			decoder.ThreadStarted = true;
+		}
+
+		return true;
+	}
+
+	void StopDecoders()
+	{
+		if(_decoders == NULL)
+		{
+			return;
+		}
+
+		udtAtomicStore(&_stopDecoders, 1);
+		for(u32 i = 0; i < _decoderCount; ++i)
+		{
+			Decoder& decoder = _decoders[i];
+			if(decoder.ThreadStarted)
+			{
+				decoder.QueueSpaceAvailable.Signal();
+				decoder.Thread.Join();
+				decoder.Thread.Release();
+				decoder.ThreadStarted = false;
+			}
+			decoder.~Decoder();
+		}
+
+		free(_decoders);
+		_decoders = NULL;
+		_decoderCount = 0;
+		_threaded = false;
+	}
+
+	// Returns false when the input has nothing left to give.
+	bool DecodeNextChunk(DemoData& demo, udtVMMemoryStream& chunk)
+	{
+		chunk.Clear();
+		demo.ConverterToUDT->SetOutputStream(&chunk);
+		for(;;)
+		{
+			if(!demo.Runner.ParseNextMessage())
+			{
+				return false;
+			}
+
+			if(chunk.Length() > 0)
+			{
+				return true;
+			}
+		}
+	}
+
+	// Decodes one chunk at a time for each of the decoder's inputs that has room in its queue.
+	void RunDecoder(Decoder& decoder)
+	{
+		while(udtAtomicLoad(&_stopDecoders) == 0)
+		{
+			bool decoding = false;
+			bool waiting = false;
+			for(u32 i = decoder.Index; i < _fileCount; i += _decoderCount)
+			{
+				DemoData& demo = _demos[i];
+				if(demo.Finished != 0)
+				{
+					continue;
+				}
+
+				const s32 writeCount = demo.WriteCount;
+				if((u32)(writeCount - udtAtomicLoad(&demo.ReadCount)) >= (u32)UDT_MERGE_QUEUE_LENGTH)
+				{
+					waiting = true;
+					continue;
+				}
+
+				decoding = true;
+				if(DecodeNextChunk(demo, demo.Chunks[(u32)writeCount % (u32)UDT_MERGE_QUEUE_LENGTH]))
+				{
+					udtAtomicStore(&demo.WriteCount, writeCount + 1);
+					if((u32)(writeCount + 1 - udtAtomicLoad(&demo.ReadCount)) >= (u32)UDT_MERGE_QUEUE_LENGTH / 2)
+					{
+						_chunkAvailable.Signal();
+					}
+				}
+				else
+				{
+					udtAtomicStore(&demo.Finished, 1);
+					_chunkAvailable.Signal();
+				}
+			}
+
+			if(!decoding)
+			{
+				if(!waiting)
+				{
+					// All the inputs are fully decoded.
+					break;
+				}
+
+				decoder.QueueSpaceAvailable.Wait();
+			}
+		}
+	}
+
+	// Returns NULL once the input has no chunks left.
+	// The chunk's data stays valid until the next call for the same input.
+	udtVMMemoryStream* GetNextChunk(DemoData& demo)
+	{
+		if(demo.HoldsChunk)
+		{
+			demo.HoldsChunk = false;
+			const s32 newReadCount = demo.ReadCount + 1;
+			udtAtomicStore(&demo.ReadCount, newReadCount);
+			if(_threaded &&
+			   (u32)(udtAtomicLoad(&demo.WriteCount) - newReadCount) <= (u32)UDT_MERGE_QUEUE_LENGTH / 2)
+			{
+				_decoders[(u32)(&demo - _demos) % _decoderCount].QueueSpaceAvailable.Signal();
+			}
+		}
+
+		const s32 readCount = demo.ReadCount;
+		udtVMMemoryStream& chunk = demo.Chunks[(u32)readCount % (u32)UDT_MERGE_QUEUE_LENGTH];
+		if(!_threaded)
+		{
+			if(demo.Finished != 0 || !DecodeNextChunk(demo, chunk))
+			{
+				demo.Finished = 1;
+				return NULL;
+			}
+
+			demo.HoldsChunk = true;
+			return &chunk;
+		}
+
+		for(;;)
+		{
+			// Finished must be read first: the last chunk is published before it.
+			const bool finished = udtAtomicLoad(&demo.Finished) != 0;
+			if(udtAtomicLoad(&demo.WriteCount) != readCount)
+			{
+				demo.HoldsChunk = true;
+				return &chunk;
+			}
+
+			if(finished)
+			{
+				return NULL;
+			}
+
+			_chunkAvailable.Wait();
+		}
+	}
+
+	void ReportProgress(const udtParseArg* info)
+	{
+		const f32 progress = _progress;
+		if(progress != _reportedProgress && info->ProgressCb != NULL)
+		{
+			_reportedProgress = progress;
+			(*info->ProgressCb)(progress, info->ProgressContext);
+		}
+	}
+
+	DemoData* _demos;
+	Decoder* _decoders;
 	u32 _fileCount;
+	u32 _decoderCount;
+	udtEvent _chunkAvailable; // Signaled by the decoders when a queue is at least half full and when an input is finished.
+	volatile s32 _stopDecoders;
+	volatile f32 _progress;
+	f32 _reportedProgress;
+	bool _threaded;
 };
 
 bool MergeDemosNoInputCheck(const udtParseArg* info, const char** filePaths, u32 fileCount, udtProtocol::Id protocol)
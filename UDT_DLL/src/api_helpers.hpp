@@ -15,6 +15,8 @@ struct udtParsingJobType
 		TimeShift,    // Shift non-first-person living player entities back in time to act as an anti-lag.
 		ExportToJSON, // Write a .JSON file with the data from the selected plug-ins.
 		FindPatterns, // Generate and keep the list of cuts.
+		Probe,        // Read the first gamestate and a few messages after it.
+		CutByTime,    // Apply the demo's own list of timed cuts in a single pass.
 		Count
 	};
 };
@@ -0,0 +1,1695 @@
+#include "shared.hpp"
+#include "file_system.hpp"
+#include "file_stream.hpp"
+#include "path.hpp"
+#include "utils.hpp"
+#include "timer.hpp"
+#include "linear_allocator.hpp"
+#include "array.hpp"
+#include "string.hpp"
+#include "parser_context.hpp"
+#include "message.hpp"
+#include "look_up_tables.hpp"
+#include "scoped_stack_allocator.hpp"
+#include "uberdemotools_columnar.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+
+#define    UDT_BENCH_MAX_RUN_COUNT       64
+#define    UDT_BENCH_MESSAGE_PADDING     16 // The message readers can load a few bytes past the end of the data.
+#define    UDT_BENCH_MAGIC_NUMBER_SWEEPS 1000
+
+
+#define UDT_BENCH_SCENARIO_LIST(N) \
+	N(RawParse,        "raw_parse",       'p') \
+	N(PlugIn,          "plug_in",         'i') \
+	N(AllPlugIns,      "all_plug_ins",    'a') \
+	N(CutByTime,       "cut_by_time",     't') \
+	N(CutByPattern,    "cut_by_pattern",  'c') \
+	N(Conversion,      "conversion",      'v') \
+	N(TimeShift,       "time_shift",      's') \
+	N(JSONExport,      "json_export",     'j') \
+	N(ColumnarExport,  "columnar_export", 'b') \
+	N(HuffmanDecoding, "huffman_decoding", 'f') \
+	N(MagicNumbers,    "magic_numbers",   'm')
+
+#define UDT_BENCH_SCENARIO_ITEM(Enum, Name, Letter) Enum,
+struct Scenario
+{
+	enum Id
+	{
+		UDT_BENCH_SCENARIO_LIST(UDT_BENCH_SCENARIO_ITEM)
+		Count
+	};
+};
+#undef UDT_BENCH_SCENARIO_ITEM
+
+#define UDT_BENCH_SCENARIO_ITEM(Enum, Name, Letter) Name,
+static const char* ScenarioNames[Scenario::Count + 1] =
+{
+	UDT_BENCH_SCENARIO_LIST(UDT_BENCH_SCENARIO_ITEM)
+	""
+};
+#undef UDT_BENCH_SCENARIO_ITEM
+
+#define UDT_BENCH_SCENARIO_ITEM(Enum, Name, Letter) Letter,
+static const char ScenarioLetters[Scenario::Count + 1] =
+{
+	UDT_BENCH_SCENARIO_LIST(UDT_BENCH_SCENARIO_ITEM)
+	'\0'
+};
+#undef UDT_BENCH_SCENARIO_ITEM
+
+#define UDT_BENCH_STAGE_ITEM(Enum, Desc) #Enum,
+static const char* StageNames[udtPerfStage::Count + 1] =
+{
+	UDT_PERF_STAGE_LIST(UDT_BENCH_STAGE_ITEM)
+	""
+};
+#undef UDT_BENCH_STAGE_ITEM
+
+#define UDT_BENCH_PLUG_IN_ITEM(Enum, Desc, Type, OutputType) #Enum,
+static const char* PlugInNames[udtParserPlugIn::Count + 1] =
+{
+	UDT_PLUG_IN_LIST(UDT_BENCH_PLUG_IN_ITEM)
+	""
+};
+#undef UDT_BENCH_PLUG_IN_ITEM
+
+
+void PrintHelp()
+{
+	printf("Runs repeatable performance scenarios over a demo corpus and prints the results as JSON to stdout.\n");
+	printf("\n");
+	printf("UDT_bench [-r] [-q] [-h] [-t=maxthreads] [-w=warmupruns] [-n=runs] [-s=scenarios] [-o=outputfolder] [-x=tracefolder] inputfolder\n");
+	printf("\n");
+	printf("-q    quiet mode: no progress output to stderr   (default: off)\n");
+	printf("-r    enable recursive demo file search          (default: off)\n");
+	printf("-h    enable huge pages for the big buffers      (default: off, Linux only)\n");
+	printf("-t=N  measure with 1, 2, 4, ... up to N threads  (default: 1)\n");
+	printf("-w=N  set the number of warm-up runs to N        (default: 1, at most 64)\n");
+	printf("-n=N  set the number of measured runs to N       (default: 5, at most 64)\n");
+	printf("-o=p  set the output folder path to p            (default: none, the scenarios writing files are skipped)\n");
+	printf("-x=p  write Chrome trace files to folder p      (default: none, instrumented builds only)\n");
+	printf("-s=   select scenarios                           (default: all enabled)\n");
+	printf("        p: raw Parsing without plug-ins  i: each plug-In individually\n");
+	printf("        a: All plug-ins together         t: cut by Time\n");
+	printf("        c: Cut by patterns               v: protocol conVersion\n");
+	printf("        s: time Shifting                 j: JSON export\n");
+	printf("        b: Binary columnar export        f: hufFman decoding\n");
+	printf("        m: Magic number translation\n");
+	printf("\n");
+	printf("Cutting, conversion, time shifting and JSON/columnar export need an output folder.\n");
+	printf("The output files get overwritten with every run but not deleted.\n");
+	printf("The columnar export is also read back and checked against the JSON export, any mismatch fails the run.\n");
+	printf("Cutting by patterns is measured with the cuts written during the analysis and with a second pass.\n");
+	printf("Huffman decoding reads the messages of the dm_66 and later demos loaded in memory, 1 or 4 symbols at a time.\n");
+	printf("Raw parsing is measured for all the demos and then for each protocol.\n");
+	printf("Magic numbers translates every id number of every type, protocol and mod to its UDT number %d times,\n", UDT_BENCH_MAGIC_NUMBER_SWEEPS);
+	printf("with the direct-indexed tables and with a binary search over sorted pairs. It doesn't read the demos.\n");
+	printf("Raw parsing and cutting by time are single-threaded: they only get measured once with 1 thread.\n");
+	printf("Libraries built with UDT_INSTRUMENTATION defined also get their per-stage timings reported.\n");
+}
+
+struct Demo
+{
+	const char* FilePath;
+	u64 ByteCount;
+	u32 Protocol;
+	u32 SnapshotCount;
+	s32 FirstSnapshotTimeMs; // Of the first gamestate.
+	s32 LastSnapshotTimeMs; // Of the first gamestate.
+};
+
+struct Config
+{
+	const char* OutputFolderPath;
+	const char* TraceFolderPath;
+	u32 MaxThreadCount;
+	u32 WarmUpRunCount;
+	u32 RunCount;
+	bool Scenarios[Scenario::Count];
+	bool Recursive;
+	bool Quiet;
+	bool HugePages;
+};
+
+// What a scenario gets measured on.
+struct Job
+{
+	udtVMArray<const char*> FilePaths { "Job::FilePathsArray" };
+	udtVMArray<s32> ErrorCodes { "Job::ErrorCodesArray" };
+	udtVMArray<const Demo*> Demos { "Job::DemosArray" };
+	u64 ByteCount;
+	u64 SnapshotCount; // 0 if the scenario doesn't read all the snapshots.
+};
+
+// Where a map's (id number, UDT number) pairs are, sorted by id number.
+// Offset is in s16 elements, Count in pairs.
+struct SortedMagicNumbers
+{
+	u32 Offset;
+	u32 Count;
+};
+
+struct Bench;
+typedef bool (*RunScenarioFunc)(Bench& bench, Job& job, u32 threadCount, u32 variant, u64* perfStats);
+
+struct Bench
+{
+	Config Settings;
+	udtVMArray<Demo> Demos { "Bench::DemosArray" };
+	udtStagePerfStats StageStats;
+	u64 StageDurations[udtPerfStage::Count];
+	u64 StageCallCounts[udtPerfStage::Count];
+	u64 PlugInDurations[udtParserPlugIn::Count];
+	u64 PlugInCallCounts[udtParserPlugIn::Count];
+	udtVMArray<u8> HuffmanMessages { "Bench::HuffmanMessagesArray" }; // Each message's byte count followed by its data.
+	udtVMArray<s16> SortedMagicNumberPairs { "Bench::SortedMagicNumberPairsArray" };
+	SortedMagicNumbers SortedMagicNumberMaps[udtMagicNumberType::Count][udtProtocol::Count][2];
+	udtCuContext* CuContext;
+	udtParserContext* Context;
+	u8* MessageData;
+	u32 ResultCount;
+	u32 HuffmanChecksum; // Keeps the compiler from dropping the decoding.
+	u32 MagicNumberChecksum; // Keeps the compiler from dropping the translations.
+};
+
+static bool KeepOnlyDemoFiles(const char* name, u64 /*size*/, void* /*userData*/)
+{
+	return udtPath::HasValidDemoFileExtension(name);
+}
+
+static void InitParseArg(udtParseArg& parseArg, Bench& bench, u64* perfStats)
+{
+	memset(&parseArg, 0, sizeof(parseArg));
+	parseArg.MessageCb = NULL; // Keep stdout clean for the JSON output.
+	parseArg.OutputFolderPath = bench.Settings.OutputFolderPath;
+	parseArg.PerformanceStats = perfStats;
+	parseArg.StagePerfStats = &bench.StageStats; // Only filled by instrumented builds.
+}
+
+static void InitMultiParseArg(udtMultiParseArg& multiParseArg, Job& job, u32 threadCount)
+{
+	memset(&multiParseArg, 0, sizeof(multiParseArg));
+	multiParseArg.FilePaths = job.FilePaths.GetStartAddress();
+	multiParseArg.OutputErrorCodes = job.ErrorCodes.GetStartAddress();
+	multiParseArg.FileCount = job.FilePaths.GetSize();
+	multiParseArg.MaxThreadCount = threadCount;
+	multiParseArg.MinByteCountPerThread = 1; // Always use the requested thread count if there are enough files.
+}
+
+static bool CheckResult(const char* functionName, s32 errorCode, const Job& job)
+{
+	if(errorCode != (s32)udtErrorCode::None)
+	{
+		fprintf(stderr, "%s failed with error: %s\n", functionName, udtGetErrorCodeString(errorCode));
+		return false;
+	}
+
+	for(u32 i = 0, count = job.ErrorCodes.GetSize(); i < count; ++i)
+	{
+		if(job.ErrorCodes[i] != (s32)udtErrorCode::None)
+		{
+			fprintf(stderr, "%s failed for %s with error: %s\n", functionName, job.FilePaths[i], udtGetErrorCodeString(job.ErrorCodes[i]));
+		}
+	}
+
+	return true;
+}
+
+static bool ParseDemoWithoutPlugIns(Bench& bench, Demo& demo)
+{
+	udtFileStream file;
+	if(!file.Open(demo.FilePath, udtFileOpenMode::Read))
+	{
+		fprintf(stderr, "Failed to open demo file %s\n", demo.FilePath);
+		return false;
+	}
+
+	const s32 errorCode = udtCuStartParsing(bench.CuContext, demo.Protocol);
+	if(errorCode != (s32)udtErrorCode::None)
+	{
+		fprintf(stderr, "udtCuStartParsing failed with error: %s\n", udtGetErrorCodeString(errorCode));
+		return false;
+	}
+
+	u32 snapshotCount = 0;
+	s32 gameStateIndex = -1;
+	s32 firstSnapshotTimeMs = UDT_S32_MIN;
+	s32 lastSnapshotTimeMs = UDT_S32_MIN;
+	udtCuMessageInput input;
+	udtCuMessageOutput output;
+	memset(&input, 0, sizeof(input));
+	for(;;)
+	{
+		u32 header[2];
+		if(file.Read(header, 4, 2) != 2)
+		{
+			break;
+		}
+
+		input.MessageSequence = (s32)header[0];
+		input.BufferByteCount = header[1];
+		if(input.MessageSequence == -1 && input.BufferByteCount == (u32)-1)
+		{
+			break;
+		}
+
+		if(input.BufferByteCount == 0 ||
+		   input.BufferByteCount > (u32)ID_MAX_MSG_LENGTH ||
+		   file.Read(bench.MessageData, input.BufferByteCount, 1) != 1)
+		{
+			break;
+		}
+		input.Buffer = bench.MessageData;
+
+		u32 continueParsing = 0;
+		if(udtCuParseMessage(bench.CuContext, &output, &continueParsing, &input) != (s32)udtErrorCode::None ||
+		   continueParsing == 0)
+		{
+			break;
+		}
+
+		if(output.IsGameState)
+		{
+			++gameStateIndex;
+		}
+		else if(output.GameStateOrSnapshot.Snapshot != NULL)
+		{
+			++snapshotCount;
+			if(gameStateIndex == 0)
+			{
+				const s32 serverTimeMs = output.GameStateOrSnapshot.Snapshot->ServerTimeMs;
+				if(firstSnapshotTimeMs == UDT_S32_MIN)
+				{
+					firstSnapshotTimeMs = serverTimeMs;
+				}
+				lastSnapshotTimeMs = serverTimeMs;
+			}
+		}
+	}
+
+	demo.SnapshotCount = snapshotCount;
+	demo.FirstSnapshotTimeMs = firstSnapshotTimeMs;
+	demo.LastSnapshotTimeMs = lastSnapshotTimeMs;
+
+	return true;
+}
+
+static bool RunRawParse(Bench& bench, Job& job, u32, u32, u64*)
+{
+	for(u32 i = 0, count = job.Demos.GetSize(); i < count; ++i)
+	{
+		if(!ParseDemoWithoutPlugIns(bench, *(Demo*)job.Demos[i]))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool RunPlugIns(Bench& bench, Job& job, u32 threadCount, u32 variant, u64* perfStats)
+{
+	u32 plugIns[udtParserPlugIn::Count];
+	u32 plugInCount = 0;
+	if(variant < (u32)udtParserPlugIn::Count)
+	{
+		plugIns[plugInCount++] = variant;
+	}
+	else
+	{
+		for(u32 i = 0; i < (u32)udtParserPlugIn::Count; ++i)
+		{
+			plugIns[plugInCount++] = i;
+		}
+	}
+
+	udtParseArg parseArg;
+	udtMultiParseArg multiParseArg;
+	InitParseArg(parseArg, bench, perfStats);
+	InitMultiParseArg(multiParseArg, job, threadCount);
+	parseArg.PlugIns = plugIns;
+	parseArg.PlugInCount = plugInCount;
+
+	udtParserContextGroup* contextGroup = NULL;
+	const s32 errorCode = udtParseDemoFiles(&contextGroup, &parseArg, &multiParseArg);
+	if(contextGroup != NULL)
+	{
+		udtDestroyContextGroup(contextGroup);
+	}
+
+	return CheckResult("udtParseDemoFiles", errorCode, job);
+}
+
+static bool RunCutByTime(Bench& bench, Job& job, u32, u32, u64* perfStats)
+{
+	udtParseArg parseArg;
+	InitParseArg(parseArg, bench, perfStats);
+
+	for(u32 i = 0, count = job.Demos.GetSize(); i < count; ++i)
+	{
+		// Cut the middle third of the first gamestate.
+		const Demo& demo = *job.Demos[i];
+		const s32 durationMs = demo.LastSnapshotTimeMs - demo.FirstSnapshotTimeMs;
+		udtCut cut;
+		memset(&cut, 0, sizeof(cut));
+		cut.GameStateIndex = 0;
+		cut.StartTimeMs = demo.FirstSnapshotTimeMs + durationMs / 3;
+		cut.EndTimeMs = demo.FirstSnapshotTimeMs + (2 * durationMs) / 3;
+
+		udtCutByTimeArg cutArg;
+		memset(&cutArg, 0, sizeof(cutArg));
+		cutArg.Cuts = &cut;
+		cutArg.CutCount = 1;
+
+		const s32 errorCode = udtCutDemoFileByTime(bench.Context, &parseArg, &cutArg, demo.FilePath);
+		if(errorCode != (s32)udtErrorCode::None)
+		{
+			fprintf(stderr, "udtCutDemoFileByTime failed for %s with error: %s\n", demo.FilePath, udtGetErrorCodeString(errorCode));
+		}
+	}
+
+	return true;
+}
+
+static bool RunCutByPattern(Bench& bench, Job& job, u32 threadCount, u32 variant, u64* perfStats)
+{
+	udtParseArg parseArg;
+	udtMultiParseArg multiParseArg;
+	InitParseArg(parseArg, bench, perfStats);
+	InitMultiParseArg(multiParseArg, job, threadCount);
+
+	udtFragRunPatternArg fragRunArg;
+	memset(&fragRunArg, 0, sizeof(fragRunArg));
+	fragRunArg.MinFragCount = 2;
+	fragRunArg.TimeBetweenFragsSec = 5;
+	fragRunArg.AllowedMeansOfDeaths = (u32)-1;
+
+	udtPatternInfo pattern;
+	memset(&pattern, 0, sizeof(pattern));
+	pattern.Type = (u32)udtPatternType::FragSequences;
+	pattern.TypeSpecificInfo = &fragRunArg;
+
+	udtPatternSearchArg patternArg;
+	memset(&patternArg, 0, sizeof(patternArg));
+	patternArg.Patterns = &pattern;
+	patternArg.PatternCount = 1;
+	patternArg.StartOffsetSec = 10;
+	patternArg.EndOffsetSec = 10;
+	patternArg.PlayerIndex = (s32)udtPlayerIndex::FirstPersonPlayer;
+	patternArg.Flags = (u32)udtPatternSearchArgMask::MergeCutSections;
+	if(variant != 0)
+	{
+		patternArg.Flags |= (u32)udtPatternSearchArgMask::TwoPassCutting;
+	}
+
+	return CheckResult("udtCutDemoFilesByPattern", udtCutDemoFilesByPattern(&parseArg, &multiParseArg, &patternArg), job);
+}
+
+static bool RunConversion(Bench& bench, Job& job, u32 threadCount, u32 variant, u64* perfStats)
+{
+	udtParseArg parseArg;
+	udtMultiParseArg multiParseArg;
+	InitParseArg(parseArg, bench, perfStats);
+	InitMultiParseArg(multiParseArg, job, threadCount);
+
+	udtProtocolConversionArg conversionArg;
+	memset(&conversionArg, 0, sizeof(conversionArg));
+	conversionArg.OutputProtocol = variant;
+
+	return CheckResult("udtConvertDemoFiles", udtConvertDemoFiles(&parseArg, &multiParseArg, &conversionArg), job);
+}
+
+static bool RunTimeShift(Bench& bench, Job& job, u32 threadCount, u32, u64* perfStats)
+{
+	udtParseArg parseArg;
+	udtMultiParseArg multiParseArg;
+	InitParseArg(parseArg, bench, perfStats);
+	InitMultiParseArg(multiParseArg, job, threadCount);
+
+	udtTimeShiftArg timeShiftArg;
+	memset(&timeShiftArg, 0, sizeof(timeShiftArg));
+	timeShiftArg.SnapshotCount = 2;
+
+	return CheckResult("udtTimeShiftDemoFiles", udtTimeShiftDemoFiles(&parseArg, &multiParseArg, &timeShiftArg), job);
+}
+
+static bool RunJSONExport(Bench& bench, Job& job, u32 threadCount, u32, u64* perfStats)
+{
+	u32 plugIns[udtParserPlugIn::Count];
+	for(u32 i = 0; i < (u32)udtParserPlugIn::Count; ++i)
+	{
+		plugIns[i] = i;
+	}
+
+	udtParseArg parseArg;
+	udtMultiParseArg multiParseArg;
+	InitParseArg(parseArg, bench, perfStats);
+	InitMultiParseArg(multiParseArg, job, threadCount);
+	parseArg.PlugIns = plugIns;
+	parseArg.PlugInCount = (u32)udtParserPlugIn::Count;
+
+	udtJSONArg jsonArg;
+	memset(&jsonArg, 0, sizeof(jsonArg));
+
+	return CheckResult("udtSaveDemoFilesAnalysisDataToJSON", udtSaveDemoFilesAnalysisDataToJSON(&parseArg, &multiParseArg, &jsonArg), job);
+}
+
+static bool RunColumnarExport(Bench& bench, Job& job, u32 threadCount, u32, u64* perfStats)
+{
+	u32 plugIns[udtParserPlugIn::Count];
+	for(u32 i = 0; i < (u32)udtParserPlugIn::Count; ++i)
+	{
+		plugIns[i] = i;
+	}
+
+	udtParseArg parseArg;
+	udtMultiParseArg multiParseArg;
+	InitParseArg(parseArg, bench, perfStats);
+	InitMultiParseArg(multiParseArg, job, threadCount);
+	parseArg.PlugIns = plugIns;
+	parseArg.PlugInCount = (u32)udtParserPlugIn::Count;
+
+	udtVMLinearAllocator allocator("RunColumnarExport::Path");
+	udtString filePath;
+	udtPath::Combine(filePath, allocator, udtString::NewConstRef(bench.Settings.OutputFolderPath), udtString::NewConstRef("bench.udtc"));
+
+	udtColumnarExportArg columnarArg;
+	memset(&columnarArg, 0, sizeof(columnarArg));
+	columnarArg.OutputFilePath = filePath.GetPtr();
+
+	return CheckResult("udtSaveDemoFilesAnalysisDataToColumnar", udtSaveDemoFilesAnalysisDataToColumnar(&parseArg, &multiParseArg, &columnarArg), job);
+}
+
+// Just enough of a JSON reader to read back what udtSaveDemoFilesAnalysisDataToJSON writes.
+struct JSONReader
+{
+	const char* Cur;
+	const char* End;
+};
+
+static void SkipJSONWhiteSpace(JSONReader& reader)
+{
+	while(reader.Cur < reader.End && (*reader.Cur == ' ' || *reader.Cur == '\t' || *reader.Cur == '\r' || *reader.Cur == '\n'))
+	{
+		++reader.Cur;
+	}
+}
+
+static bool ReadJSONChar(JSONReader& reader, char c)
+{
+	SkipJSONWhiteSpace(reader);
+	if(reader.Cur >= reader.End || *reader.Cur != c)
+	{
+		return false;
+	}
+
+	++reader.Cur;
+
+	return true;
+}
+
+static bool ReadJSONHexDigit(u32& value, char c)
+{
+	if(c >= '0' && c <= '9')      value = (value << 4) | (u32)(c - '0');
+	else if(c >= 'A' && c <= 'F') value = (value << 4) | (u32)(c - 'A' + 10);
+	else if(c >= 'a' && c <= 'f') value = (value << 4) | (u32)(c - 'a' + 10);
+	else return false;
+
+	return true;
+}
+
+// Decodes the escape sequences udtJSONWriter writes. A NULL buffer skips the string.
+static bool ReadJSONString(JSONReader& reader, char* buffer, u32 bufferByteCount)
+{
+	if(!ReadJSONChar(reader, '"'))
+	{
+		return false;
+	}
+
+	u32 length = 0;
+	while(reader.Cur < reader.End && *reader.Cur != '"')
+	{
+		char c = *reader.Cur++;
+		if(c == '\\')
+		{
+			if(reader.Cur >= reader.End)
+			{
+				return false;
+			}
+
+			c = *reader.Cur++;
+			switch(c)
+			{
+				case 'b': c = '\b'; break;
+				case 't': c = '\t'; break;
+				case 'n': c = '\n'; break;
+				case 'f': c = '\f'; break;
+				case 'r': c = '\r'; break;
+				case 'u':
+				{
+					u32 codePoint = 0;
+					for(u32 i = 0; i < 4; ++i)
+					{
+						if(reader.Cur >= reader.End || !ReadJSONHexDigit(codePoint, *reader.Cur++))
+						{
+							return false;
+						}
+					}
+
+					// Only ASCII control characters get written that way.
+					if(codePoint >= 0x80)
+					{
+						return false;
+					}
+					c = (char)codePoint;
+					break;
+				}
+				default: break; // '"', '\\' and '/'.
+			}
+		}
+
+		if(buffer != NULL)
+		{
+			if(length + 1 >= bufferByteCount)
+			{
+				return false;
+			}
+			buffer[length] = c;
+		}
+		++length;
+	}
+
+	if(reader.Cur >= reader.End)
+	{
+		return false;
+	}
+
+	++reader.Cur;
+	if(buffer != NULL)
+	{
+		buffer[length] = '\0';
+	}
+
+	return true;
+}
+
+static bool ReadJSONInt(JSONReader& reader, s32& value)
+{
+	SkipJSONWhiteSpace(reader);
+	const bool negative = reader.Cur < reader.End && *reader.Cur == '-';
+	if(negative)
+	{
+		++reader.Cur;
+	}
+
+	const char* const digits = reader.Cur;
+	s64 result = 0;
+	while(reader.Cur < reader.End && *reader.Cur >= '0' && *reader.Cur <= '9')
+	{
+		result = result * 10 + (s64)(*reader.Cur++ - '0');
+		if(result > (s64)UDT_S32_MAX + 1)
+		{
+			return false;
+		}
+	}
+
+	if(reader.Cur == digits)
+	{
+		return false;
+	}
+
+	value = (s32)(negative ? -result : result);
+
+	return true;
+}
+
+static bool SkipJSONValue(JSONReader& reader)
+{
+	SkipJSONWhiteSpace(reader);
+	if(reader.Cur >= reader.End)
+	{
+		return false;
+	}
+
+	if(*reader.Cur == '"')
+	{
+		return ReadJSONString(reader, NULL, 0);
+	}
+
+	if(*reader.Cur != '{' && *reader.Cur != '[')
+	{
+		// Numbers, booleans and null.
+		while(reader.Cur < reader.End && strchr(",}] \t\r\n", *reader.Cur) == NULL)
+		{
+			++reader.Cur;
+		}
+
+		return true;
+	}
+
+	u32 depth = 0;
+	do
+	{
+		const char c = *reader.Cur;
+		if(c == '"')
+		{
+			if(!ReadJSONString(reader, NULL, 0))
+			{
+				return false;
+			}
+			continue;
+		}
+
+		if(c == '{' || c == '[')
+		{
+			++depth;
+		}
+		else if(c == '}' || c == ']')
+		{
+			--depth;
+		}
+		++reader.Cur;
+	}
+	while(depth > 0 && reader.Cur < reader.End);
+
+	return depth == 0;
+}
+
+// Returns false when the closing character is next, which the caller then reads.
+static bool StartNextJSONItem(JSONReader& reader, char closingChar, u32 itemIndex)
+{
+	SkipJSONWhiteSpace(reader);
+	if(reader.Cur >= reader.End || *reader.Cur == closingChar)
+	{
+		return false;
+	}
+
+	return itemIndex == 0 || ReadJSONChar(reader, ',');
+}
+
+// A JSON object member read back from the matching columnar column.
+struct RoundTripField
+{
+	const char* JSONName;
+	const char* ColumnName;
+	s32 Offset; // Added to the column's value, JSON game state numbers start at 1.
+};
+
+// The JSON export writes one object per row for these tables.
+struct RoundTripTable
+{
+	const char* JSONName;
+	udtColumnarTableId::Id TableId;
+	const RoundTripField* Fields;
+	u32 FieldCount;
+};
+
+static const RoundTripField ChatRoundTripFields[] =
+{
+	{ "gameStateNumber", "GameStateIndex", 1 },
+	{ "serverTime", "ServerTimeMs", 0 },
+	{ "clientNumber", "PlayerIndex", 0 },
+	{ "playerName", "PlayerName", 0 },
+	{ "message", "Message", 0 },
+	{ "cleanMessage", "CleanMessage", 0 }
+};
+
+static const RoundTripField ObituaryRoundTripFields[] =
+{
+	{ "gameStateNumber", "GameStateIndex", 1 },
+	{ "serverTime", "ServerTimeMs", 0 },
+	{ "attackerClientNumber", "AttackerIdx", 0 },
+	{ "targetClientNumber", "TargetIdx", 0 },
+	{ "attackerCleanName", "AttackerName", 0 },
+	{ "targetCleanName", "TargetName", 0 },
+	{ "causeOfDeath", "MeanOfDeathName", 0 }
+};
+
+static const RoundTripField CaptureRoundTripFields[] =
+{
+	{ "gameStateIndex", "GameStateIndex", 0 },
+	{ "pickUpTime", "PickUpTimeMs", 0 },
+	{ "captureTime", "CaptureTimeMs", 0 },
+	{ "playerIndex", "PlayerIndex", 0 },
+	{ "playerName", "PlayerName", 0 },
+	{ "map", "MapName", 0 }
+};
+
+static const RoundTripField ScoreRoundTripFields[] =
+{
+	{ "gameStateIndex", "GameStateIndex", 0 },
+	{ "serverTime", "ServerTimeMs", 0 },
+	{ "score1", "Score1", 0 },
+	{ "score2", "Score2", 0 },
+	{ "client1", "Id1", 0 },
+	{ "client2", "Id2", 0 }
+};
+
+#define ROUND_TRIP_TABLE(Name, TableId, Fields) { Name, udtColumnarTableId::TableId, Fields, (u32)UDT_COUNT_OF(Fields) },
+static const RoundTripTable RoundTripTables[] =
+{
+	ROUND_TRIP_TABLE("chat", Chat, ChatRoundTripFields)
+	ROUND_TRIP_TABLE("obituaries", Obituaries, ObituaryRoundTripFields)
+	ROUND_TRIP_TABLE("captures", Captures, CaptureRoundTripFields)
+	ROUND_TRIP_TABLE("scores", Scores, ScoreRoundTripFields)
+};
+#undef ROUND_TRIP_TABLE
+
+static const u32 RoundTripTableCount = (u32)(sizeof(RoundTripTables) / sizeof(RoundTripTables[0]));
+
+struct RoundTripStats
+{
+	u32 RowCounts[RoundTripTableCount];
+	u32 ValueCount;
+	u32 MismatchCount;
+};
+
+// udtJSONWriter stops writing a string at the first byte that can't start a UTF-8 sequence.
+static bool IsSameJSONString(const char* jsonString, const char* columnString)
+{
+	const size_t length = strlen(jsonString);
+	if(strncmp(jsonString, columnString, length) != 0)
+	{
+		return false;
+	}
+
+	const u8 next = (u8)columnString[length];
+
+	return next == 0 || (next >= 0x80 && next < 0xC0) || next >= 0xF8;
+}
+
+static bool CheckRoundTripValue(JSONReader& reader, const udtColumnarFile& file, const udtColumnarTable& table, const RoundTripField& field, u32 row, RoundTripStats& stats, const char* demoFilePath)
+{
+	const udtColumnarColumn* const column = udtColumnarFindColumn(&file, &table, field.ColumnName);
+	if(column == NULL)
+	{
+		fprintf(stderr, "Column %s is missing from the columnar file\n", field.ColumnName);
+		return false;
+	}
+
+	bool same = false;
+	const void* const columnData = udtColumnarGetColumnData(&file, column);
+	if(column->Type == (u32)udtColumnType::String)
+	{
+		char jsonString[1024];
+		if(!ReadJSONString(reader, jsonString, (u32)sizeof(jsonString)))
+		{
+			return false;
+		}
+
+		const char* const columnString = udtColumnarGetString(&file, ((const u32*)columnData)[row], NULL);
+		same = columnString != NULL && IsSameJSONString(jsonString, columnString);
+	}
+	else if(column->Type == (u32)udtColumnType::S32 || column->Type == (u32)udtColumnType::U32)
+	{
+		s32 jsonValue = 0;
+		if(!ReadJSONInt(reader, jsonValue))
+		{
+			return false;
+		}
+
+		same = jsonValue == ((const s32*)columnData)[row] + field.Offset;
+	}
+	else
+	{
+		fprintf(stderr, "Column %s has an unexpected type\n", field.ColumnName);
+		return false;
+	}
+
+	++stats.ValueCount;
+	if(!same)
+	{
+		fprintf(stderr, "Columnar round trip mismatch for %s: %s of row %u\n", demoFilePath, field.JSONName, row);
+		++stats.MismatchCount;
+	}
+
+	return true;
+}
+
+static bool CheckRoundTripRows(JSONReader& reader, const udtColumnarFile& file, u32 demoIndex, u32 tableIndex, RoundTripStats& stats, const char* demoFilePath)
+{
+	const RoundTripTable& tableInfo = RoundTripTables[tableIndex];
+	const udtColumnarTable* const table = udtColumnarFindTable(&file, (u32)tableInfo.TableId);
+	if(table == NULL)
+	{
+		fprintf(stderr, "Table %s is missing from the columnar file\n", tableInfo.JSONName);
+		return false;
+	}
+
+	const udtParseDataBufferRange range = udtColumnarGetRowRange(&file, table, demoIndex);
+	if(!ReadJSONChar(reader, '['))
+	{
+		return false;
+	}
+
+	u32 rowCount = 0;
+	while(StartNextJSONItem(reader, ']', rowCount))
+	{
+		const u32 row = range.FirstIndex + rowCount++;
+		if(rowCount > range.Count)
+		{
+			if(!SkipJSONValue(reader))
+			{
+				return false;
+			}
+			continue;
+		}
+
+		if(!ReadJSONChar(reader, '{'))
+		{
+			return false;
+		}
+
+		char name[64];
+		for(u32 m = 0; StartNextJSONItem(reader, '}', m); ++m)
+		{
+			if(!ReadJSONString(reader, name, (u32)sizeof(name)) ||
+			   !ReadJSONChar(reader, ':'))
+			{
+				return false;
+			}
+
+			u32 f = 0;
+			while(f < tableInfo.FieldCount && strcmp(tableInfo.Fields[f].JSONName, name) != 0)
+			{
+				++f;
+			}
+
+			const bool success = f < tableInfo.FieldCount ?
+				CheckRoundTripValue(reader, file, *table, tableInfo.Fields[f], row, stats, demoFilePath) :
+				SkipJSONValue(reader);
+			if(!success)
+			{
+				return false;
+			}
+		}
+
+		if(!ReadJSONChar(reader, '}'))
+		{
+			return false;
+		}
+	}
+
+	if(!ReadJSONChar(reader, ']'))
+	{
+		return false;
+	}
+
+	stats.RowCounts[tableIndex] += rowCount;
+	if(rowCount != range.Count)
+	{
+		fprintf(stderr, "Columnar round trip mismatch for %s: %u %s rows in JSON, %u in the columnar file\n", demoFilePath, rowCount, tableInfo.JSONName, range.Count);
+		++stats.MismatchCount;
+	}
+
+	return true;
+}
+
+static bool CheckRoundTripDemo(const udtColumnarFile& file, u32 demoIndex, const udtString& json, RoundTripStats& stats, const char* demoFilePath)
+{
+	JSONReader reader;
+	reader.Cur = json.GetPtr();
+	reader.End = json.GetPtr() + json.GetLength();
+	if(!ReadJSONChar(reader, '{'))
+	{
+		return false;
+	}
+
+	// Tables the JSON export skipped have no rows.
+	u32 jsonRowCounts[RoundTripTableCount];
+	memcpy(jsonRowCounts, stats.RowCounts, sizeof(jsonRowCounts));
+
+	char name[64];
+	for(u32 m = 0; StartNextJSONItem(reader, '}', m); ++m)
+	{
+		if(!ReadJSONString(reader, name, (u32)sizeof(name)) ||
+		   !ReadJSONChar(reader, ':'))
+		{
+			return false;
+		}
+
+		u32 t = 0;
+		while(t < RoundTripTableCount && strcmp(RoundTripTables[t].JSONName, name) != 0)
+		{
+			++t;
+		}
+
+		const bool success = t < RoundTripTableCount ?
+			CheckRoundTripRows(reader, file, demoIndex, t, stats, demoFilePath) :
+			SkipJSONValue(reader);
+		if(!success)
+		{
+			return false;
+		}
+	}
+
+	if(!ReadJSONChar(reader, '}'))
+	{
+		return false;
+	}
+
+	for(u32 t = 0; t < RoundTripTableCount; ++t)
+	{
+		const udtColumnarTable* const table = udtColumnarFindTable(&file, (u32)RoundTripTables[t].TableId);
+		if(table != NULL &&
+		   jsonRowCounts[t] == stats.RowCounts[t] &&
+		   udtColumnarGetRowRange(&file, table, demoIndex).Count != 0)
+		{
+			fprintf(stderr, "Columnar round trip mismatch for %s: no %s in JSON\n", demoFilePath, RoundTripTables[t].JSONName);
+			++stats.MismatchCount;
+		}
+	}
+
+	return true;
+}
+
+// Exports the analysis data of all the demos to a columnar file and reads it back through uberdemotools_columnar.h.
+// The row counts and key fields must match what the JSON export wrote for every demo.
+static bool CheckColumnarRoundTrip(Bench& bench)
+{
+	if(!bench.Settings.Quiet)
+	{
+		fprintf(stderr, "Checking the columnar export against the JSON export...\n");
+	}
+
+	u32 plugIns[udtParserPlugIn::Count];
+	for(u32 i = 0; i < (u32)udtParserPlugIn::Count; ++i)
+	{
+		plugIns[i] = i;
+	}
+
+	Job job;
+	for(u32 i = 0, count = bench.Demos.GetSize(); i < count; ++i)
+	{
+		job.FilePaths.Add(bench.Demos[i].FilePath);
+		job.ErrorCodes.Add(0);
+	}
+
+	u64 perfStats[udtPerfStatsField::Count];
+	udtParseArg parseArg;
+	udtMultiParseArg multiParseArg;
+	InitParseArg(parseArg, bench, perfStats);
+	InitMultiParseArg(multiParseArg, job, 1);
+	parseArg.PlugIns = plugIns;
+	parseArg.PlugInCount = (u32)udtParserPlugIn::Count;
+	parseArg.StagePerfStats = NULL;
+
+	udtVMLinearAllocator allocator("CheckColumnarRoundTrip::Temp");
+	udtVMLinearAllocator columnarAllocator("CheckColumnarRoundTrip::Columnar"); // Never grows after the read so the file view stays valid.
+	const udtString outputFolderPath = udtString::NewConstRef(bench.Settings.OutputFolderPath);
+	udtString columnarFilePath;
+	udtPath::Combine(columnarFilePath, allocator, outputFolderPath, udtString::NewConstRef("bench_round_trip.udtc"));
+
+	udtColumnarExportArg columnarArg;
+	memset(&columnarArg, 0, sizeof(columnarArg));
+	columnarArg.OutputFilePath = columnarFilePath.GetPtr();
+	if(!CheckResult("udtSaveDemoFilesAnalysisDataToColumnar", udtSaveDemoFilesAnalysisDataToColumnar(&parseArg, &multiParseArg, &columnarArg), job))
+	{
+		return false;
+	}
+
+	udtFileStream columnarFile;
+	if(!columnarFile.Open(columnarFilePath.GetPtr(), udtFileOpenMode::Read))
+	{
+		fprintf(stderr, "Failed to open the columnar file %s\n", columnarFilePath.GetPtr());
+		return false;
+	}
+
+	const udtString columnarData = columnarFile.ReadAllAsString(columnarAllocator);
+	columnarFile.Close();
+	udtColumnarFile file;
+	if(!udtColumnarOpen(&file, columnarData.GetPtr(), (u64)columnarData.GetLength()) ||
+	   file.Header->DemoCount != job.FilePaths.GetSize())
+	{
+		fprintf(stderr, "Invalid columnar file %s\n", columnarFilePath.GetPtr());
+		return false;
+	}
+
+	RoundTripStats stats;
+	memset(&stats, 0, sizeof(stats));
+	udtJSONArg jsonArg;
+	memset(&jsonArg, 0, sizeof(jsonArg));
+	for(u32 i = 0, count = job.FilePaths.GetSize(); i < count; ++i)
+	{
+		// One demo at a time, so that demos with the same file name don't overwrite each other's JSON file.
+		udtVMScopedStackAllocator allocatorScope(allocator);
+		const char* const demoFilePath = job.FilePaths[i];
+		multiParseArg.FilePaths = &job.FilePaths[i];
+		multiParseArg.OutputErrorCodes = &job.ErrorCodes[i];
+		multiParseArg.FileCount = 1;
+		if(udtSaveDemoFilesAnalysisDataToJSON(&parseArg, &multiParseArg, &jsonArg) != (s32)udtErrorCode::None ||
+		   job.ErrorCodes[i] != (s32)udtErrorCode::None)
+		{
+			fprintf(stderr, "udtSaveDemoFilesAnalysisDataToJSON failed for %s\n", demoFilePath);
+			return false;
+		}
+
+		udtString fileName, jsonFilePath;
+		udtPath::GetFileNameWithoutExtension(fileName, allocator, udtString::NewConstRef(demoFilePath));
+		udtPath::Combine(jsonFilePath, allocator, outputFolderPath, fileName);
+		jsonFilePath = udtString::NewFromConcatenating(allocator, jsonFilePath, udtString::NewConstRef(".json"));
+
+		udtFileStream jsonFile;
+		if(!jsonFile.Open(jsonFilePath.GetPtr(), udtFileOpenMode::Read))
+		{
+			fprintf(stderr, "Failed to open the JSON file %s\n", jsonFilePath.GetPtr());
+			return false;
+		}
+
+		const udtString json = jsonFile.ReadAllAsString(allocator);
+		if(!CheckRoundTripDemo(file, i, json, stats, demoFilePath))
+		{
+			fprintf(stderr, "Failed to read the JSON file %s\n", jsonFilePath.GetPtr());
+			return false;
+		}
+	}
+
+	if(!bench.Settings.Quiet)
+	{
+		fprintf(stderr, "Columnar round trip: ");
+		for(u32 t = 0; t < RoundTripTableCount; ++t)
+		{
+			fprintf(stderr, "%u %s rows, ", stats.RowCounts[t], RoundTripTables[t].JSONName);
+		}
+		fprintf(stderr, "%u values, %u mismatches\n", stats.ValueCount, stats.MismatchCount);
+	}
+
+	return stats.MismatchCount == 0;
+}
+
+static bool LoadHuffmanMessages(Bench& bench)
+{
+	bench.HuffmanMessages.Clear();
+	for(u32 i = 0, count = bench.Demos.GetSize(); i < count; ++i)
+	{
+		const Demo& demo = bench.Demos[i];
+		if(demo.Protocol < (u32)udtProtocol::Dm66)
+		{
+			continue;
+		}
+
+		udtFileStream file;
+		if(!file.Open(demo.FilePath, udtFileOpenMode::Read))
+		{
+			fprintf(stderr, "Failed to open demo file %s\n", demo.FilePath);
+			return false;
+		}
+
+		for(;;)
+		{
+			u32 header[2];
+			if(file.Read(header, 4, 2) != 2 ||
+			   header[1] == 0 ||
+			   header[1] > (u32)ID_MAX_MSG_LENGTH)
+			{
+				break;
+			}
+
+			u8* const message = bench.HuffmanMessages.Extend(4 + header[1]);
+			memcpy(message, &header[1], 4);
+			if(file.Read(message + 4, header[1], 1) != 1)
+			{
+				bench.HuffmanMessages.Resize(bench.HuffmanMessages.GetSize() - 4 - header[1]);
+				break;
+			}
+		}
+	}
+
+	return true;
+}
+
+static bool RunHuffmanDecoding(Bench& bench, Job&, u32, u32 variant, u64*)
+{
+	const s32 bitsPerRead = (s32)variant;
+	udtMessage message;
+	message.InitContext(&bench.Context->Context);
+	message.InitProtocol(udtProtocol::Dm68);
+
+	u32 checksum = 0;
+	const u8* data = bench.HuffmanMessages.GetStartAddress();
+	const u8* const dataEnd = bench.HuffmanMessages.GetEndAddress();
+	while(data < dataEnd)
+	{
+		u32 byteCount = 0;
+		memcpy(&byteCount, data, 4);
+		data += 4;
+
+		// The whole message gets decoded as symbols, whatever the fields it actually holds.
+		message.Init((u8*)data, (s32)byteCount);
+		message.Buffer.cursize = (s32)byteCount;
+		message.SetHuffman(true);
+		const s32 bitCount = (s32)byteCount * 8;
+		while(message.Buffer.bit < bitCount)
+		{
+			checksum += (u32)message.ReadBits(bitsPerRead);
+		}
+
+		data += byteCount;
+	}
+
+	bench.HuffmanChecksum += checksum;
+
+	return true;
+}
+
+static void LoadSortedMagicNumbers(Bench& bench)
+{
+	bench.SortedMagicNumberPairs.Clear();
+	for(u32 t = 0; t < (u32)udtMagicNumberType::Count; ++t)
+	{
+		for(u32 p = 0; p < (u32)udtProtocol::Count; ++p)
+		{
+			for(u32 m = 0; m < 2; ++m)
+			{
+				const udtMagicNumberMap& map = MagicNumberMaps[t][p][m];
+				SortedMagicNumbers& sorted = bench.SortedMagicNumberMaps[t][p][m];
+				sorted.Offset = bench.SortedMagicNumberPairs.GetSize();
+				sorted.Count = 0;
+				for(u32 i = 0; i < map.IdNumberCount; ++i)
+				{
+					if(map.IdToUDT[i] != UDT_S16_MIN)
+					{
+						bench.SortedMagicNumberPairs.Add((s16)(map.MinIdNumber + (s32)i));
+						bench.SortedMagicNumberPairs.Add(map.IdToUDT[i]);
+						++sorted.Count;
+					}
+				}
+			}
+		}
+	}
+}
+
+static int CompareMagicNumberPairs(const void* a, const void* b)
+{
+	return *(const s16*)a - *(const s16*)b;
+}
+
+// Variant 0 uses the direct-indexed tables, variant 1 a binary search like GetUDTNumber used to.
+static bool RunMagicNumbers(Bench& bench, Job&, u32, u32 variant, u64*)
+{
+	u32 checksum = 0;
+	for(u32 s = 0; s < UDT_BENCH_MAGIC_NUMBER_SWEEPS; ++s)
+	{
+		for(u32 t = 0; t < (u32)udtMagicNumberType::Count; ++t)
+		{
+			for(u32 p = 0; p < (u32)udtProtocol::Count; ++p)
+			{
+				for(u32 m = 0; m < 2; ++m)
+				{
+					const udtMagicNumberMap& map = MagicNumberMaps[t][p][m];
+					const s32 firstId = map.MinIdNumber;
+					const s32 lastId = map.MinIdNumber + (s32)map.IdNumberCount - 1;
+					if(variant == 0)
+					{
+						const udtMod::Id mod = m == 1 ? udtMod::CPMA : udtMod::None;
+						for(s32 id = firstId; id <= lastId; ++id)
+						{
+							u32 udtNumber = 0;
+							if(GetUDTNumber(udtNumber, (udtMagicNumberType::Id)t, id, (udtProtocol::Id)p, mod))
+							{
+								checksum += udtNumber;
+							}
+						}
+					}
+					else
+					{
+						const SortedMagicNumbers& sorted = bench.SortedMagicNumberMaps[t][p][m];
+						const s16* const pairs = bench.SortedMagicNumberPairs.GetStartAddress() + sorted.Offset;
+						for(s32 id = firstId; id <= lastId; ++id)
+						{
+							const s16 key = (s16)id;
+							const s16* const pair = (const s16*)bsearch(&key, pairs, (size_t)sorted.Count, sizeof(s16) * 2, &CompareMagicNumberPairs);
+							if(pair != NULL)
+							{
+								checksum += (u32)pair[1];
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+
+	bench.MagicNumberChecksum += checksum;
+
+	return true;
+}
+
+static bool IsValidConversion(u32 input, u32 output)
+{
+	return
+		(output == (u32)udtProtocol::Dm91 && (input == (u32)udtProtocol::Dm73 || input == (u32)udtProtocol::Dm90)) ||
+		(output == (u32)udtProtocol::Dm68 && (input == (u32)udtProtocol::Dm3 || input == (u32)udtProtocol::Dm48));
+}
+
+static bool IsDemoUsable(const Demo& demo, Scenario::Id scenario, u32 variant)
+{
+	switch(scenario)
+	{
+		case Scenario::RawParse:
+			return variant == (u32)udtProtocol::Count || demo.Protocol == variant;
+
+		case Scenario::CutByTime:
+			return
+				udtIsProtocolWriteSupported(demo.Protocol) != 0 &&
+				demo.FirstSnapshotTimeMs != UDT_S32_MIN &&
+				demo.LastSnapshotTimeMs - demo.FirstSnapshotTimeMs >= 3000;
+
+		case Scenario::CutByPattern:
+		case Scenario::TimeShift:
+			return udtIsProtocolWriteSupported(demo.Protocol) != 0;
+
+		case Scenario::Conversion:
+			return IsValidConversion(demo.Protocol, variant);
+
+		case Scenario::HuffmanDecoding:
+			return demo.Protocol >= (u32)udtProtocol::Dm66;
+
+		default:
+			return true;
+	}
+}
+
+static void SortDurations(u64* durations, u32 count)
+{
+	// Insertion sort, we never have many runs.
+	for(u32 i = 1; i < count; ++i)
+	{
+		const u64 duration = durations[i];
+		u32 j = i;
+		while(j > 0 && durations[j - 1] > duration)
+		{
+			durations[j] = durations[j - 1];
+			--j;
+		}
+		durations[j] = duration;
+	}
+}
+
+static void PrintCounters(const char* name, const char** counterNames, const u64* counters, u32 counterCount)
+{
+	printf(",\n\t\t\t\"%s\": { ", name);
+	for(u32 i = 0; i < counterCount; ++i)
+	{
+		printf("%s\"%s\": %llu", i > 0 ? ", " : "", counterNames[i], (unsigned long long)counters[i]);
+	}
+	printf(" }");
+}
+
+static void PrintStageStats(const Bench& bench)
+{
+	const udtStagePerfStats& stats = bench.StageStats;
+	if(stats.ThreadCount == 0)
+	{
+		return;
+	}
+
+	PrintCounters("stage_durations_ns", StageNames, stats.StageDurations, (u32)udtPerfStage::Count);
+	PrintCounters("stage_call_counts", StageNames, stats.StageCallCounts, (u32)udtPerfStage::Count);
+	PrintCounters("plug_in_durations_ns", PlugInNames, stats.PlugInDurations, (u32)udtParserPlugIn::Count);
+	PrintCounters("plug_in_call_counts", PlugInNames, stats.PlugInCallCounts, (u32)udtParserPlugIn::Count);
+}
+
+static void PrintResult(Bench& bench, const Job& job, Scenario::Id scenario, const char* variantName, u32 threadCount, u64* durationsUs, u32 runCount, const u64* perfStats)
+{
+	SortDurations(durationsUs, runCount);
+	const u64 minUs = durationsUs[0];
+	const u64 medianUs = durationsUs[runCount / 2];
+	const u64 maxUs = durationsUs[runCount - 1];
+	const f64 medianSec = (f64)udt_max(medianUs, (u64)1) / 1000000.0;
+
+	printf("%s\n\t\t{\n", bench.ResultCount > 0 ? "," : "");
+	printf("\t\t\t\"scenario\": \"%s\",\n", ScenarioNames[scenario]);
+	printf("\t\t\t\"variant\": \"%s\",\n", variantName);
+	printf("\t\t\t\"requested_thread_count\": %u,\n", threadCount);
+	printf("\t\t\t\"thread_count\": %u,\n", (u32)udt_max(perfStats[udtPerfStatsField::ThreadCount], (u64)1));
+	printf("\t\t\t\"file_count\": %u,\n", job.FilePaths.GetSize());
+	printf("\t\t\t\"byte_count\": %llu,\n", (unsigned long long)job.ByteCount);
+	printf("\t\t\t\"snapshot_count\": %llu,\n", (unsigned long long)job.SnapshotCount);
+	printf("\t\t\t\"run_count\": %u,\n", runCount);
+	printf("\t\t\t\"min_duration_us\": %llu,\n", (unsigned long long)minUs);
+	printf("\t\t\t\"median_duration_us\": %llu,\n", (unsigned long long)medianUs);
+	printf("\t\t\t\"max_duration_us\": %llu,\n", (unsigned long long)maxUs);
+	printf("\t\t\t\"megabytes_per_second\": %.3f,\n", ((f64)job.ByteCount / (1024.0 * 1024.0)) / medianSec);
+	printf("\t\t\t\"snapshots_per_second\": %.1f,\n", (f64)job.SnapshotCount / medianSec);
+	printf("\t\t\t\"allocator_count\": %llu,\n", (unsigned long long)perfStats[udtPerfStatsField::AllocatorCount]);
+	printf("\t\t\t\"memory_reserved\": %llu,\n", (unsigned long long)perfStats[udtPerfStatsField::MemoryReserved]);
+	printf("\t\t\t\"memory_committed\": %llu,\n", (unsigned long long)perfStats[udtPerfStatsField::MemoryCommitted]);
+	printf("\t\t\t\"memory_used\": %llu,\n", (unsigned long long)perfStats[udtPerfStatsField::MemoryUsed]);
+	printf("\t\t\t\"resize_count\": %llu", (unsigned long long)perfStats[udtPerfStatsField::ResizeCount]);
+	PrintStageStats(bench);
+	printf("\n\t\t}");
+	fflush(stdout);
+
+	++bench.ResultCount;
+}
+
+static bool RunScenario(Bench& bench, Scenario::Id scenario, RunScenarioFunc run, u32 variant, const char* variantName, bool multiThreaded, bool readsAllSnapshots)
+{
+	Job job;
+	job.ByteCount = 0;
+	job.SnapshotCount = 0;
+	for(u32 i = 0, count = bench.Demos.GetSize(); i < count; ++i)
+	{
+		const Demo& demo = bench.Demos[i];
+		if(IsDemoUsable(demo, scenario, variant))
+		{
+			job.FilePaths.Add(demo.FilePath);
+			job.ErrorCodes.Add(0);
+			job.Demos.Add(&demo);
+			job.ByteCount += demo.ByteCount;
+			job.SnapshotCount += readsAllSnapshots ? (u64)demo.SnapshotCount : 0;
+		}
+	}
+
+	if(job.FilePaths.IsEmpty())
+	{
+		return true;
+	}
+
+	const Config& config = bench.Settings;
+	const u32 maxThreadCount = multiThreaded ? config.MaxThreadCount : 1;
+	for(u32 threadCount = 1; threadCount <= maxThreadCount; threadCount = (threadCount == maxThreadCount || 2 * threadCount <= maxThreadCount) ? 2 * threadCount : maxThreadCount)
+	{
+		if(!config.Quiet)
+		{
+			fprintf(stderr, "Running %s%s%s with %u thread(s)...\n", ScenarioNames[scenario], *variantName != '\0' ? " " : "", variantName, threadCount);
+		}
+
+		u64 durationsUs[UDT_BENCH_MAX_RUN_COUNT];
+		u64 perfStats[udtPerfStatsField::Count];
+		for(u32 r = 0; r < config.WarmUpRunCount + config.RunCount; ++r)
+		{
+			memset(perfStats, 0, sizeof(perfStats));
+			bench.StageStats.ThreadCount = 0;
+			udtTimer timer;
+			timer.Start();
+			if(!(*run)(bench, job, threadCount, variant, perfStats))
+			{
+				return false;
+			}
+			timer.Stop();
+
+			if(r >= config.WarmUpRunCount)
+			{
+				durationsUs[r - config.WarmUpRunCount] = timer.GetElapsedUs();
+			}
+		}
+
+		if(perfStats[udtPerfStatsField::AllocatorCount] == 0)
+		{
+			// The scenario ran on this thread only and didn't report anything.
+			udtVMLinearAllocator::Stats stats;
+			udtVMLinearAllocator::GetThreadStats(stats);
+			perfStats[udtPerfStatsField::ThreadCount] = 1;
+			perfStats[udtPerfStatsField::AllocatorCount] = (u64)stats.AllocatorCount;
+			perfStats[udtPerfStatsField::MemoryReserved] = (u64)stats.ReservedByteCount;
+			perfStats[udtPerfStatsField::MemoryCommitted] = (u64)stats.CommittedByteCount;
+			perfStats[udtPerfStatsField::MemoryUsed] = (u64)stats.UsedByteCount;
+			perfStats[udtPerfStatsField::ResizeCount] = (u64)stats.ResizeCount;
+		}
+
+		PrintResult(bench, job, scenario, variantName, threadCount, durationsUs, config.RunCount, perfStats);
+	}
+
+	return true;
+}
+
+static bool RunBench(Bench& bench)
+{
+	const Config& config = bench.Settings;
+	const bool canWrite = config.OutputFolderPath != NULL;
+
+	// Reading the corpus once gets the snapshot counts and the time ranges we need,
+	// and warms up the file system cache for everyone.
+	u64 totalByteCount = 0;
+	u64 totalSnapshotCount = 0;
+	for(u32 i = 0, count = bench.Demos.GetSize(); i < count; ++i)
+	{
+		Demo& demo = bench.Demos[i];
+		if(!ParseDemoWithoutPlugIns(bench, demo))
+		{
+			return false;
+		}
+
+		totalByteCount += demo.ByteCount;
+		totalSnapshotCount += (u64)demo.SnapshotCount;
+	}
+
+	printf("{\n");
+	printf("\t\"version\": \"%s\",\n", udtGetVersionString());
+	printf("\t\"file_count\": %u,\n", bench.Demos.GetSize());
+	printf("\t\"byte_count\": %llu,\n", (unsigned long long)totalByteCount);
+	printf("\t\"snapshot_count\": %llu,\n", (unsigned long long)totalSnapshotCount);
+	printf("\t\"warm_up_run_count\": %u,\n", config.WarmUpRunCount);
+	printf("\t\"run_count\": %u,\n", config.RunCount);
+	printf("\t\"huge_pages\": %s,\n", config.HugePages ? "true" : "false");
+	printf("\t\"results\": [");
+
+	bool success = true;
+	if(success && config.Scenarios[Scenario::RawParse])
+	{
+		success = RunScenario(bench, Scenario::RawParse, &RunRawParse, (u32)udtProtocol::Count, "", false, true);
+
+		// Each protocol has its own specialized delta readers.
+		for(u32 i = 0; success && i < (u32)udtProtocol::Count; ++i)
+		{
+			success = RunScenario(bench, Scenario::RawParse, &RunRawParse, i, udtGetFileExtensionByProtocol(i) + 1, false, true);
+		}
+	}
+
+	if(config.Scenarios[Scenario::PlugIn])
+	{
+		for(u32 i = 0; success && i < (u32)udtParserPlugIn::Count; ++i)
+		{
+			success = RunScenario(bench, Scenario::PlugIn, &RunPlugIns, i, PlugInNames[i], true, true);
+		}
+	}
+
+	if(success && config.Scenarios[Scenario::AllPlugIns])
+	{
+		success = RunScenario(bench, Scenario::AllPlugIns, &RunPlugIns, (u32)udtParserPlugIn::Count, "", true, true);
+	}
+
+	if(success && canWrite && config.Scenarios[Scenario::CutByTime])
+	{
+		success = RunScenario(bench, Scenario::CutByTime, &RunCutByTime, 0, "", false, false);
+	}
+
+	if(success && canWrite && config.Scenarios[Scenario::CutByPattern])
+	{
+		success = RunScenario(bench, Scenario::CutByPattern, &RunCutByPattern, 0, "single_pass", true, true);
+		success = success && RunScenario(bench, Scenario::CutByPattern, &RunCutByPattern, 1, "two_pass", true, true);
+	}
+
+	if(success && canWrite && config.Scenarios[Scenario::Conversion])
+	{
+		success = RunScenario(bench, Scenario::Conversion, &RunConversion, (u32)udtProtocol::Dm68, "dm_68", true, true);
+		success = success && RunScenario(bench, Scenario::Conversion, &RunConversion, (u32)udtProtocol::Dm91, "dm_91", true, true);
+	}
+
+	if(success && canWrite && config.Scenarios[Scenario::TimeShift])
+	{
+		success = RunScenario(bench, Scenario::TimeShift, &RunTimeShift, 0, "", true, true);
+	}
+
+	if(success && canWrite && config.Scenarios[Scenario::JSONExport])
+	{
+		success = RunScenario(bench, Scenario::JSONExport, &RunJSONExport, 0, "", true, true);
+	}
+
+	if(success && canWrite && config.Scenarios[Scenario::ColumnarExport])
+	{
+		success = RunScenario(bench, Scenario::ColumnarExport, &RunColumnarExport, 0, "", true, true);
+		success = success && CheckColumnarRoundTrip(bench);
+	}
+
+	if(success && config.Scenarios[Scenario::HuffmanDecoding])
+	{
+		success = LoadHuffmanMessages(bench);
+		success = success && RunScenario(bench, Scenario::HuffmanDecoding, &RunHuffmanDecoding, 8, "8_bit_reads", false, false);
+		success = success && RunScenario(bench, Scenario::HuffmanDecoding, &RunHuffmanDecoding, 32, "32_bit_reads", false, false);
+		bench.HuffmanMessages.Clear();
+	}
+
+	if(success && config.Scenarios[Scenario::MagicNumbers])
+	{
+		LoadSortedMagicNumbers(bench);
+		success = RunScenario(bench, Scenario::MagicNumbers, &RunMagicNumbers, 0, "direct_tables", false, false);
+		success = success && RunScenario(bench, Scenario::MagicNumbers, &RunMagicNumbers, 1, "binary_search", false, false);
+		bench.SortedMagicNumberPairs.Clear();
+	}
+
+	printf("\n\t]\n}\n");
+
+	return success;
+}
+
+static bool ParseCount(u32& count, const udtString& arg, u32 minValue, u32 maxValue)
+{
+	s32 value = 0;
+	if(arg.GetLength() < 4 ||
+	   !StringParseInt(value, arg.GetPtr() + 3) ||
+	   value < (s32)minValue ||
+	   value > (s32)maxValue)
+	{
+		return false;
+	}
+
+	count = (u32)value;
+
+	return true;
+}
+
+int udt_main(int argc, char** argv)
+{
+	if(argc < 2)
+	{
+		PrintHelp();
+		return 0;
+	}
+
+	const char* const inputPath = argv[argc - 1];
+	if(!IsValidDirectory(inputPath))
+	{
+		fprintf(stderr, "Invalid folder path.\n");
+		return 1;
+	}
+
+	Bench bench;
+	Config& config = bench.Settings;
+	config.OutputFolderPath = NULL;
+	config.TraceFolderPath = NULL;
+	config.MaxThreadCount = 1;
+	config.WarmUpRunCount = 1;
+	config.RunCount = 5;
+	config.Recursive = false;
+	config.Quiet = false;
+	config.HugePages = false;
+	for(u32 i = 0; i < (u32)Scenario::Count; ++i)
+	{
+		config.Scenarios[i] = true;
+	}
+
+	for(int i = 1; i < argc - 1; ++i)
+	{
+		const udtString arg = udtString::NewConstRef(argv[i]);
+		if(udtString::Equals(arg, "-r"))
+		{
+			config.Recursive = true;
+		}
+		else if(udtString::Equals(arg, "-q"))
+		{
+			config.Quiet = true;
+		}
+		else if(udtString::Equals(arg, "-h"))
+		{
+			config.HugePages = true;
+		}
+		else if(udtString::StartsWith(arg, "-o=") &&
+				arg.GetLength() >= 4 &&
+				IsValidDirectory(argv[i] + 3))
+		{
+			config.OutputFolderPath = argv[i] + 3;
+		}
+		else if(udtString::StartsWith(arg, "-x=") &&
+				arg.GetLength() >= 4 &&
+				IsValidDirectory(argv[i] + 3))
+		{
+			config.TraceFolderPath = argv[i] + 3;
+		}
+		else if(udtString::StartsWith(arg, "-t="))
+		{
+			if(!ParseCount(config.MaxThreadCount, arg, 1, (u32)UDT_S32_MAX))
+			{
+				fprintf(stderr, "Invalid maximum thread count: %s\n", argv[i]);
+				PrintHelp();
+				return 1;
+			}
+		}
+		else if(udtString::StartsWith(arg, "-w="))
+		{
+			if(!ParseCount(config.WarmUpRunCount, arg, 0, UDT_BENCH_MAX_RUN_COUNT))
+			{
+				fprintf(stderr, "Invalid warm-up run count: %s\n", argv[i]);
+				PrintHelp();
+				return 1;
+			}
+		}
+		else if(udtString::StartsWith(arg, "-n="))
+		{
+			if(!ParseCount(config.RunCount, arg, 1, UDT_BENCH_MAX_RUN_COUNT))
+			{
+				fprintf(stderr, "Invalid run count: %s\n", argv[i]);
+				PrintHelp();
+				return 1;
+			}
+		}
+		else if(udtString::StartsWith(arg, "-s=") &&
+				arg.GetLength() >= 4)
+		{
+			for(u32 s = 0; s < (u32)Scenario::Count; ++s)
+			{
+				config.Scenarios[s] = strchr(argv[i] + 3, ScenarioLetters[s]) != NULL;
+			}
+		}
+	}
+
+	udtFileListQuery query;
+	query.FileFilter = &KeepOnlyDemoFiles;
+	query.FolderPath = udtString::NewConstRef(inputPath);
+	query.Recursive = config.Recursive;
+	GetDirectoryFileList(query);
+	for(u32 i = 0, count = query.Files.GetSize(); i < count; ++i)
+	{
+		const udtFileInfo& file = query.Files[i];
+		Demo demo;
+		memset(&demo, 0, sizeof(demo));
+		demo.FilePath = file.Path.GetPtr();
+		demo.ByteCount = file.Size;
+		demo.Protocol = udtGetProtocolByFilePath(demo.FilePath);
+		if(udtIsValidProtocol(demo.Protocol))
+		{
+			bench.Demos.Add(demo);
+		}
+	}
+
+	if(bench.Demos.IsEmpty())
+	{
+		fprintf(stderr, "No demo file found.\n");
+		return 1;
+	}
+
+	udtSetHugePagesEnabled(config.HugePages ? 1 : 0);
+
+	memset(&bench.StageStats, 0, sizeof(bench.StageStats));
+	bench.StageStats.StageDurations = bench.StageDurations;
+	bench.StageStats.StageCallCounts = bench.StageCallCounts;
+	bench.StageStats.PlugInDurations = bench.PlugInDurations;
+	bench.StageStats.PlugInCallCounts = bench.PlugInCallCounts;
+	bench.StageStats.TraceFolderPath = config.TraceFolderPath;
+	bench.ResultCount = 0;
+	bench.HuffmanChecksum = 0;
+	bench.MagicNumberChecksum = 0;
+	bench.MessageData = (u8*)malloc(ID_MAX_MSG_LENGTH + UDT_BENCH_MESSAGE_PADDING);
+	bench.CuContext = udtCuCreateContext();
+	bench.Context = udtCreateContext();
+	if(bench.MessageData == NULL || bench.CuContext == NULL || bench.Context == NULL)
+	{
+		fprintf(stderr, "Failed to create the parsing contexts.\n");
+		return 1;
+	}
+
+	const bool success = RunBench(bench);
+
+	udtDestroyContext(bench.Context);
+	udtCuDestroyContext(bench.CuContext);
+	free(bench.MessageData);
+
+	return success ? 0 : 1;
+}
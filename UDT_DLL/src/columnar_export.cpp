@@ -0,0 +1,627 @@
+#include "columnar_export.hpp"
+#include "uberdemotools_columnar.h"
+#include "file_stream.hpp"
+#include "array.hpp"
+
+#include <stddef.h>
+
+
+struct udtColumnDesc
+{
+	const char* Name;
+	u32 Type; // Of type udtColumnType::Id.
+	u32 Offset; // Byte offset of the field in the source row.
+	u32 RowIndexTable; // Of type udtColumnarTableId::Id when the field is an index into another table, UDT_U32_MAX otherwise.
+};
+
+#define COLUMN(Struct, Field, Type) { #Field, (u32)udtColumnType::Type, (u32)offsetof(Struct, Field), UDT_U32_MAX },
+#define NAMED_COLUMN(Name, Struct, Field, Type) { Name, (u32)udtColumnType::Type, (u32)offsetof(Struct, Field), UDT_U32_MAX },
+#define ROW_INDEX_COLUMN(Struct, Field, Table) { #Field, (u32)udtColumnType::U32, (u32)offsetof(Struct, Field), (u32)udtColumnarTableId::Table },
+
+static const udtColumnDesc ChatColumns[] =
+{
+	COLUMN(udtParseDataChat, GameStateIndex, S32)
+	COLUMN(udtParseDataChat, ServerTimeMs, S32)
+	COLUMN(udtParseDataChat, PlayerIndex, S32)
+	COLUMN(udtParseDataChat, TeamMessage, U32)
+	NAMED_COLUMN("OriginalCommand", udtParseDataChat, Strings[0].OriginalCommand, String)
+	NAMED_COLUMN("ClanName", udtParseDataChat, Strings[0].ClanName, String)
+	NAMED_COLUMN("PlayerName", udtParseDataChat, Strings[0].PlayerName, String)
+	NAMED_COLUMN("Message", udtParseDataChat, Strings[0].Message, String)
+	NAMED_COLUMN("Location", udtParseDataChat, Strings[0].Location, String)
+	NAMED_COLUMN("CleanOriginalCommand", udtParseDataChat, Strings[1].OriginalCommand, String)
+	NAMED_COLUMN("CleanClanName", udtParseDataChat, Strings[1].ClanName, String)
+	NAMED_COLUMN("CleanPlayerName", udtParseDataChat, Strings[1].PlayerName, String)
+	NAMED_COLUMN("CleanMessage", udtParseDataChat, Strings[1].Message, String)
+	NAMED_COLUMN("CleanLocation", udtParseDataChat, Strings[1].Location, String)
+};
+
+static const udtColumnDesc ObituaryColumns[] =
+{
+	COLUMN(udtParseDataObituary, GameStateIndex, S32)
+	COLUMN(udtParseDataObituary, ServerTimeMs, S32)
+	COLUMN(udtParseDataObituary, AttackerIdx, S32)
+	COLUMN(udtParseDataObituary, TargetIdx, S32)
+	COLUMN(udtParseDataObituary, MeanOfDeath, S32)
+	COLUMN(udtParseDataObituary, AttackerTeamIdx, S32)
+	COLUMN(udtParseDataObituary, TargetTeamIdx, S32)
+	COLUMN(udtParseDataObituary, AttackerName, String)
+	COLUMN(udtParseDataObituary, TargetName, String)
+	COLUMN(udtParseDataObituary, MeanOfDeathName, String)
+};
+
+static const udtColumnDesc CaptureColumns[] =
+{
+	COLUMN(udtParseDataCapture, GameStateIndex, S32)
+	COLUMN(udtParseDataCapture, PickUpTimeMs, S32)
+	COLUMN(udtParseDataCapture, CaptureTimeMs, S32)
+	COLUMN(udtParseDataCapture, Distance, F32)
+	COLUMN(udtParseDataCapture, Flags, U32)
+	COLUMN(udtParseDataCapture, PlayerIndex, S32)
+	COLUMN(udtParseDataCapture, MapName, String)
+	COLUMN(udtParseDataCapture, PlayerName, String)
+};
+
+static const udtColumnDesc ScoreColumns[] =
+{
+	COLUMN(udtParseDataScore, GameStateIndex, S32)
+	COLUMN(udtParseDataScore, ServerTimeMs, S32)
+	COLUMN(udtParseDataScore, Score1, S32)
+	COLUMN(udtParseDataScore, Score2, S32)
+	COLUMN(udtParseDataScore, Id1, U32)
+	COLUMN(udtParseDataScore, Id2, U32)
+	COLUMN(udtParseDataScore, Flags, U32)
+	COLUMN(udtParseDataScore, Name1, String)
+	COLUMN(udtParseDataScore, Name2, String)
+	COLUMN(udtParseDataScore, CleanName1, String)
+	COLUMN(udtParseDataScore, CleanName2, String)
+};
+
+static const udtColumnDesc MatchStatsColumns[] =
+{
+	COLUMN(udtParseDataStats, ValidTeams, U64)
+	COLUMN(udtParseDataStats, ValidPlayers, U64)
+	COLUMN(udtParseDataStats, ModVersion, String)
+	COLUMN(udtParseDataStats, MapName, String)
+	COLUMN(udtParseDataStats, FirstPlaceName, String)
+	COLUMN(udtParseDataStats, SecondPlaceName, String)
+	COLUMN(udtParseDataStats, CustomRedName, String)
+	COLUMN(udtParseDataStats, CustomBlueName, String)
+	ROW_INDEX_COLUMN(udtParseDataStats, FirstTimeOutRangeIndex, StatsTimeOuts)
+	ROW_INDEX_COLUMN(udtParseDataStats, FirstTeamFlagIndex, StatsTeamFlags)
+	ROW_INDEX_COLUMN(udtParseDataStats, FirstPlayerFlagIndex, StatsPlayerFlags)
+	ROW_INDEX_COLUMN(udtParseDataStats, FirstTeamFieldIndex, StatsTeamFields)
+	ROW_INDEX_COLUMN(udtParseDataStats, FirstPlayerFieldIndex, StatsPlayerFields)
+	ROW_INDEX_COLUMN(udtParseDataStats, FirstPlayerStatsIndex, StatsPlayers)
+	COLUMN(udtParseDataStats, GameType, U32)
+	COLUMN(udtParseDataStats, MatchDurationMs, U32)
+	COLUMN(udtParseDataStats, Mod, U32)
+	COLUMN(udtParseDataStats, GamePlay, U32)
+	COLUMN(udtParseDataStats, OverTimeType, U32)
+	COLUMN(udtParseDataStats, OverTimeCount, U32)
+	COLUMN(udtParseDataStats, Forfeited, U32)
+	COLUMN(udtParseDataStats, TimeOutCount, U32)
+	COLUMN(udtParseDataStats, TotalTimeOutDurationMs, U32)
+	COLUMN(udtParseDataStats, MercyLimited, U32)
+	COLUMN(udtParseDataStats, FirstPlaceScore, S32)
+	COLUMN(udtParseDataStats, SecondPlaceScore, S32)
+	COLUMN(udtParseDataStats, SecondPlaceWon, U32)
+	COLUMN(udtParseDataStats, TeamMode, U32)
+	COLUMN(udtParseDataStats, StartDateEpoch, U32)
+	COLUMN(udtParseDataStats, TimeLimit, U32)
+	COLUMN(udtParseDataStats, ScoreLimit, U32)
+	COLUMN(udtParseDataStats, FragLimit, U32)
+	COLUMN(udtParseDataStats, CaptureLimit, U32)
+	COLUMN(udtParseDataStats, RoundLimit, U32)
+	COLUMN(udtParseDataStats, StartTimeMs, S32)
+	COLUMN(udtParseDataStats, EndTimeMs, S32)
+	COLUMN(udtParseDataStats, GameStateIndex, U32)
+	COLUMN(udtParseDataStats, CountDownStartTimeMs, S32)
+	COLUMN(udtParseDataStats, IntermissionEndTimeMs, S32)
+};
+
+static const udtColumnDesc TimeOutColumns[] =
+{
+	{ "StartTimeMs", (u32)udtColumnType::S32, 0, UDT_U32_MAX },
+	{ "EndTimeMs", (u32)udtColumnType::S32, (u32)sizeof(s32), UDT_U32_MAX }
+};
+
+static const udtColumnDesc FlagColumns[] =
+{
+	{ "Mask", (u32)udtColumnType::U8, 0, UDT_U32_MAX }
+};
+
+static const udtColumnDesc FieldColumns[] =
+{
+	{ "Value", (u32)udtColumnType::S32, 0, UDT_U32_MAX }
+};
+
+static const udtColumnDesc PlayerStatsColumns[] =
+{
+	COLUMN(udtPlayerStats, Name, String)
+	COLUMN(udtPlayerStats, CleanName, String)
+};
+
+#undef COLUMN
+#undef NAMED_COLUMN
+#undef ROW_INDEX_COLUMN
+
+struct udtColumnarTableDesc
+{
+	const udtColumnDesc* Columns;
+	u32 ColumnCount;
+	u32 RowByteCount;
+};
+
+#define TABLE(Columns, RowByteCount) { Columns, (u32)(sizeof(Columns) / sizeof(Columns[0])), (u32)(RowByteCount) }
+static const udtColumnarTableDesc TableDescs[udtColumnarTableId::Count] =
+{
+	TABLE(ChatColumns, sizeof(udtParseDataChat)),
+	TABLE(ObituaryColumns, sizeof(udtParseDataObituary)),
+	TABLE(CaptureColumns, sizeof(udtParseDataCapture)),
+	TABLE(ScoreColumns, sizeof(udtParseDataScore)),
+	TABLE(MatchStatsColumns, sizeof(udtParseDataStats)),
+	TABLE(TimeOutColumns, 2 * sizeof(s32)),
+	TABLE(FlagColumns, sizeof(u8)),
+	TABLE(FlagColumns, sizeof(u8)),
+	TABLE(FieldColumns, sizeof(s32)),
+	TABLE(FieldColumns, sizeof(s32)),
+	TABLE(PlayerStatsColumns, sizeof(udtPlayerStats))
+};
+#undef TABLE
+
+// Where a table's rows come from in a single context.
+struct udtColumnarSource
+{
+	const u8* Rows;
+	const u8* StringBuffer;
+	u32 RowCount;
+	u32 StringBufferSize;
+};
+
+struct udtColumnarContextData
+{
+	udtParseDataChatBuffers Chat;
+	udtParseDataObituaryBuffers Obituaries;
+	udtParseDataCaptureBuffers Captures;
+	udtParseDataScoreBuffers Scores;
+	udtParseDataStatsBuffers Stats;
+	udtColumnarSource Sources[udtColumnarTableId::Count];
+};
+
+static void GetBuffers(udtParserContext& context, u32 plugInId, void* buffers, size_t byteCount)
+{
+	if(udtGetContextPlugInBuffers(&context, plugInId, buffers) != (s32)udtErrorCode::None)
+	{
+		memset(buffers, 0, byteCount);
+	}
+}
+
+static void SetSource(udtColumnarSource& source, const void* rows, u32 rowCount, const u8* stringBuffer, u32 stringBufferSize)
+{
+	source.Rows = (const u8*)rows;
+	source.RowCount = rows != NULL ? rowCount : 0;
+	source.StringBuffer = stringBuffer;
+	source.StringBufferSize = stringBuffer != NULL ? stringBufferSize : 0;
+}
+
+static void GetContextData(udtColumnarContextData& data, udtParserContext& context)
+{
+	context.UpdatePlugInBufferStructs();
+	GetBuffers(context, (u32)udtParserPlugIn::Chat, &data.Chat, sizeof(data.Chat));
+	GetBuffers(context, (u32)udtParserPlugIn::Obituaries, &data.Obituaries, sizeof(data.Obituaries));
+	GetBuffers(context, (u32)udtParserPlugIn::Captures, &data.Captures, sizeof(data.Captures));
+	GetBuffers(context, (u32)udtParserPlugIn::Scores, &data.Scores, sizeof(data.Scores));
+	GetBuffers(context, (u32)udtParserPlugIn::Stats, &data.Stats, sizeof(data.Stats));
+
+	const udtParseDataStatsBuffers& stats = data.Stats;
+	udtColumnarSource* const sources = data.Sources;
+	SetSource(sources[udtColumnarTableId::Chat], data.Chat.ChatMessages, data.Chat.ChatMessageCount, data.Chat.StringBuffer, data.Chat.StringBufferSize);
+	SetSource(sources[udtColumnarTableId::Obituaries], data.Obituaries.Obituaries, data.Obituaries.ObituaryCount, data.Obituaries.StringBuffer, data.Obituaries.StringBufferSize);
+	SetSource(sources[udtColumnarTableId::Captures], data.Captures.Captures, data.Captures.CaptureCount, data.Captures.StringBuffer, data.Captures.StringBufferSize);
+	SetSource(sources[udtColumnarTableId::Scores], data.Scores.Scores, data.Scores.ScoreCount, data.Scores.StringBuffer, data.Scores.StringBufferSize);
+	SetSource(sources[udtColumnarTableId::MatchStats], stats.MatchStats, stats.MatchCount, stats.StringBuffer, stats.StringBufferSize);
+	SetSource(sources[udtColumnarTableId::StatsTimeOuts], stats.TimeOutStartAndEndTimes, stats.TimeOutRangeCount, NULL, 0);
+	SetSource(sources[udtColumnarTableId::StatsTeamFlags], stats.TeamFlags, stats.TeamFlagCount, NULL, 0);
+	SetSource(sources[udtColumnarTableId::StatsPlayerFlags], stats.PlayerFlags, stats.PlayerFlagCount, NULL, 0);
+	SetSource(sources[udtColumnarTableId::StatsTeamFields], stats.TeamFields, stats.TeamFieldCount, NULL, 0);
+	SetSource(sources[udtColumnarTableId::StatsPlayerFields], stats.PlayerFields, stats.PlayerFieldCount, NULL, 0);
+	SetSource(sources[udtColumnarTableId::StatsPlayers], stats.PlayerStats, stats.PlayerStatsCount, stats.StringBuffer, stats.StringBufferSize);
+}
+
+// The stats plug-in has no per-demo ranges for its arrays,
+// so we derive them from the first index fields of the demo's matches.
+static udtParseDataBufferRange GetStatsArrayRange(const udtColumnarContextData& data, u32 demoIndex, u32 tableId, u32 firstIndexOffset)
+{
+	udtParseDataBufferRange range;
+	range.FirstIndex = 0;
+	range.Count = 0;
+
+	const udtParseDataStatsBuffers& stats = data.Stats;
+	if(stats.MatchStatsRanges == NULL)
+	{
+		return range;
+	}
+
+	const udtParseDataBufferRange matches = stats.MatchStatsRanges[demoIndex];
+	if(matches.Count == 0)
+	{
+		return range;
+	}
+
+	const u8* const firstMatch = (const u8*)(stats.MatchStats + matches.FirstIndex);
+	const u32 nextMatchIndex = matches.FirstIndex + matches.Count;
+	u32 first;
+	u32 end = data.Sources[tableId].RowCount;
+	memcpy(&first, firstMatch + firstIndexOffset, sizeof(u32));
+	if(nextMatchIndex < stats.MatchCount)
+	{
+		memcpy(&end, (const u8*)(stats.MatchStats + nextMatchIndex) + firstIndexOffset, sizeof(u32));
+	}
+
+	if(first <= end)
+	{
+		range.FirstIndex = first;
+		range.Count = end - first;
+	}
+
+	return range;
+}
+
+static udtParseDataBufferRange GetDemoRange(const udtColumnarContextData& data, u32 demoIndex, u32 tableId)
+{
+	const udtParseDataBufferRange* ranges = NULL;
+	switch((udtColumnarTableId::Id)tableId)
+	{
+		case udtColumnarTableId::Chat: ranges = data.Chat.ChatMessageRanges; break;
+		case udtColumnarTableId::Obituaries: ranges = data.Obituaries.ObituaryRanges; break;
+		case udtColumnarTableId::Captures: ranges = data.Captures.CaptureRanges; break;
+		case udtColumnarTableId::Scores: ranges = data.Scores.ScoreRanges; break;
+		case udtColumnarTableId::MatchStats: ranges = data.Stats.MatchStatsRanges; break;
+		case udtColumnarTableId::StatsTimeOuts: return GetStatsArrayRange(data, demoIndex, tableId, (u32)offsetof(udtParseDataStats, FirstTimeOutRangeIndex));
+		case udtColumnarTableId::StatsTeamFlags: return GetStatsArrayRange(data, demoIndex, tableId, (u32)offsetof(udtParseDataStats, FirstTeamFlagIndex));
+		case udtColumnarTableId::StatsPlayerFlags: return GetStatsArrayRange(data, demoIndex, tableId, (u32)offsetof(udtParseDataStats, FirstPlayerFlagIndex));
+		case udtColumnarTableId::StatsTeamFields: return GetStatsArrayRange(data, demoIndex, tableId, (u32)offsetof(udtParseDataStats, FirstTeamFieldIndex));
+		case udtColumnarTableId::StatsPlayerFields: return GetStatsArrayRange(data, demoIndex, tableId, (u32)offsetof(udtParseDataStats, FirstPlayerFieldIndex));
+		case udtColumnarTableId::StatsPlayers: return GetStatsArrayRange(data, demoIndex, tableId, (u32)offsetof(udtParseDataStats, FirstPlayerStatsIndex));
+		default: break;
+	}
+
+	udtParseDataBufferRange range;
+	range.FirstIndex = 0;
+	range.Count = 0;
+	if(ranges != NULL)
+	{
+		range = ranges[demoIndex];
+	}
+
+	return range;
+}
+
+// De-duplicates strings with an open-addressing hash table of string indices.
+struct udtColumnarStringDictionary
+{
+public:
+	udtColumnarStringDictionary()
+	{
+		_slots.ExtendAndMemset(1024, 0);
+	}
+
+	u32 Intern(const char* string)
+	{
+		const u32 length = (u32)strlen(string);
+		const u32 hash = ComputeHash(string, length);
+		const u32 slotMask = _slots.GetSize() - 1;
+		u32 slot = hash & slotMask;
+		for(;;)
+		{
+			const u32 entry = _slots[slot];
+			if(entry == 0)
+			{
+				break;
+			}
+
+			const u32 index = entry - 1;
+			if(_hashes[index] == hash &&
+			   _offsets[index + 1] - _offsets[index] == length + 1 &&
+			   memcmp(_data.GetStartAddress() + _offsets[index], string, (size_t)length) == 0)
+			{
+				return index;
+			}
+
+			slot = (slot + 1) & slotMask;
+		}
+
+		const u32 index = _hashes.GetSize();
+		if(index == 0)
+		{
+			_offsets.Add(0);
+		}
+		char* const copy = _data.Extend(length + 1);
+		memcpy(copy, string, (size_t)length + 1);
+		_offsets.Add(_data.GetSize());
+		_hashes.Add(hash);
+		_slots[slot] = index + 1;
+
+		if(2 * _hashes.GetSize() >= _slots.GetSize())
+		{
+			Grow();
+		}
+
+		return index;
+	}
+
+	u32 GetStringCount() const { return _hashes.GetSize(); }
+	u32 GetDataByteCount() const { return _data.GetSize(); }
+	const char* GetData() const { return _data.GetStartAddress(); }
+
+	// StringCount + 1 offsets, the last one being the data byte count.
+	void GetOffsets(u32* offsets) const
+	{
+		if(_offsets.GetSize() == 0)
+		{
+			offsets[0] = 0;
+			return;
+		}
+
+		memcpy(offsets, _offsets.GetStartAddress(), (size_t)_offsets.GetSize() * sizeof(u32));
+	}
+
+private:
+	UDT_NO_COPY_SEMANTICS(udtColumnarStringDictionary);
+
+	static u32 ComputeHash(const char* string, u32 length)
+	{
+		// FNV-1a
+		u32 hash = 2166136261u;
+		for(u32 i = 0; i < length; ++i)
+		{
+			hash ^= (u32)(u8)string[i];
+			hash *= 16777619u;
+		}
+
+		return hash;
+	}
+
+	void Grow()
+	{
+		const u32 slotCount = _slots.GetSize() * 2;
+		const u32 slotMask = slotCount - 1;
+		_slots.Clear();
+		_slots.ExtendAndMemset(slotCount, 0);
+		for(u32 i = 0, count = _hashes.GetSize(); i < count; ++i)
+		{
+			u32 slot = _hashes[i] & slotMask;
+			while(_slots[slot] != 0)
+			{
+				slot = (slot + 1) & slotMask;
+			}
+			_slots[slot] = i + 1;
+		}
+	}
+
+	udtVMArray<u32> _slots { "ColumnarStringDictionary::Slots" }; // String index + 1, 0 when empty.
+	udtVMArray<u32> _hashes { "ColumnarStringDictionary::Hashes" };
+	udtVMArray<u32> _offsets { "ColumnarStringDictionary::Offsets" };
+	udtVMArray<char> _data { "ColumnarStringDictionary::Data" };
+};
+
+static u64 AlignOffset(u64 offset)
+{
+	return (offset + 7) & ~(u64)7;
+}
+
+static u32 InternString(udtColumnarStringDictionary& strings, const udtColumnarSource& source, u32 stringOffset)
+{
+	if(stringOffset >= source.StringBufferSize)
+	{
+		return UDT_COLUMNAR_NULL_STRING;
+	}
+
+	return strings.Intern((const char*)source.StringBuffer + stringOffset);
+}
+
+bool ExportPlugInsDataToColumnar(udtParserContext* contexts, u32 contextCount, const char** filePaths, u32 fileCount, const char* outputFilePath)
+{
+	if(contextCount == 0)
+	{
+		return false;
+	}
+
+	const udtContext& logger = contexts[0].Context;
+
+	udtVMArray<udtColumnarContextData> contextData("ExportPlugInsDataToColumnar::ContextData");
+	udtVMArray<u32> rowBases("ExportPlugInsDataToColumnar::RowBases"); // [contextIdx * tableCount + tableId]
+	contextData.Resize(contextCount);
+	rowBases.Resize(contextCount * (u32)udtColumnarTableId::Count);
+
+	u32 rowCounts[udtColumnarTableId::Count];
+	memset(rowCounts, 0, sizeof(rowCounts));
+	for(u32 c = 0; c < contextCount; ++c)
+	{
+		GetContextData(contextData[c], contexts[c]);
+		for(u32 t = 0; t < (u32)udtColumnarTableId::Count; ++t)
+		{
+			rowBases[c * (u32)udtColumnarTableId::Count + t] = rowCounts[t];
+			rowCounts[t] += contextData[c].Sources[t].RowCount;
+		}
+	}
+
+	//
+	// Compute the layout of everything but the string dictionary.
+	//
+
+	const u32 tableCount = (u32)udtColumnarTableId::Count;
+	u64 columnsOffsets[udtColumnarTableId::Count];
+	u64 rangesOffsets[udtColumnarTableId::Count];
+	u64 dataOffsets[udtColumnarTableId::Count];
+	const u64 demosOffset = (u64)sizeof(udtColumnarHeader);
+	const u64 tablesOffset = demosOffset + (u64)fileCount * sizeof(udtColumnarDemo);
+	u64 offset = tablesOffset + (u64)tableCount * sizeof(udtColumnarTable);
+	for(u32 t = 0; t < tableCount; ++t)
+	{
+		columnsOffsets[t] = offset;
+		offset += (u64)TableDescs[t].ColumnCount * sizeof(udtColumnarColumn);
+		rangesOffsets[t] = offset;
+		offset += (u64)fileCount * sizeof(udtParseDataBufferRange);
+	}
+	for(u32 t = 0; t < tableCount; ++t)
+	{
+		offset = AlignOffset(offset);
+		dataOffsets[t] = offset;
+		for(u32 i = 0; i < TableDescs[t].ColumnCount; ++i)
+		{
+			offset = AlignOffset(offset + (u64)rowCounts[t] * (u64)udtColumnarGetTypeByteCount(TableDescs[t].Columns[i].Type));
+		}
+	}
+
+	const u64 stringOffsetsOffset = offset;
+	if(stringOffsetsOffset > (u64)UDT_U32_MAX / 2)
+	{
+		logger.LogError("The columnar data is too large to fit in a single file");
+		return false;
+	}
+
+	udtVMArray<u8> image("ExportPlugInsDataToColumnar::Image");
+	image.ExtendAndMemset((u32)stringOffsetsOffset, 0);
+
+	//
+	// Fill in the directory and the column data.
+	//
+
+	udtColumnarStringDictionary strings;
+
+	for(u32 i = 0; i < fileCount; ++i)
+	{
+		udtColumnarDemo& demo = ((udtColumnarDemo*)(image.GetStartAddress() + demosOffset))[i];
+		demo.FilePath = filePaths[i] != NULL ? strings.Intern(filePaths[i]) : UDT_COLUMNAR_NULL_STRING;
+	}
+
+	for(u32 t = 0; t < tableCount; ++t)
+	{
+		const udtColumnarTableDesc& tableDesc = TableDescs[t];
+
+		udtColumnarTable& table = ((udtColumnarTable*)(image.GetStartAddress() + tablesOffset))[t];
+		table.Id = t;
+		table.RowCount = rowCounts[t];
+		table.ColumnCount = tableDesc.ColumnCount;
+		table.ColumnsOffset = columnsOffsets[t];
+		table.RowRangesOffset = rangesOffsets[t];
+
+		udtParseDataBufferRange* const ranges = (udtParseDataBufferRange*)(image.GetStartAddress() + rangesOffsets[t]);
+		for(u32 c = 0; c < contextCount; ++c)
+		{
+			const udtParserContext& context = contexts[c];
+			const u32 rowBase = rowBases[c * tableCount + t];
+			for(u32 d = 0, count = context.InputIndices.GetSize(); d < count; ++d)
+			{
+				const u32 inputIndex = context.InputIndices[d];
+				if(inputIndex >= fileCount)
+				{
+					continue;
+				}
+
+				const udtParseDataBufferRange range = GetDemoRange(contextData[c], d, t);
+				ranges[inputIndex].FirstIndex = rowBase + range.FirstIndex;
+				ranges[inputIndex].Count = range.Count;
+				((udtColumnarDemo*)(image.GetStartAddress() + demosOffset))[inputIndex].Processed = 1;
+			}
+		}
+
+		u64 columnDataOffset = dataOffsets[t];
+		for(u32 i = 0; i < tableDesc.ColumnCount; ++i)
+		{
+			const udtColumnDesc& columnDesc = tableDesc.Columns[i];
+			const u32 valueByteCount = udtColumnarGetTypeByteCount(columnDesc.Type);
+
+			udtColumnarColumn& column = ((udtColumnarColumn*)(image.GetStartAddress() + columnsOffsets[t]))[i];
+			column.Name = strings.Intern(columnDesc.Name);
+			column.Type = columnDesc.Type;
+			column.DataOffset = columnDataOffset;
+
+			u8* output = image.GetStartAddress() + columnDataOffset;
+			for(u32 c = 0; c < contextCount; ++c)
+			{
+				const udtColumnarSource& source = contextData[c].Sources[t];
+				if(source.RowCount == 0)
+				{
+					continue;
+				}
+
+				const u32 rowIndexBase = columnDesc.RowIndexTable != UDT_U32_MAX ? rowBases[c * tableCount + columnDesc.RowIndexTable] : 0;
+				const u8* input = source.Rows + columnDesc.Offset;
+				for(u32 r = 0; r < source.RowCount; ++r)
+				{
+					if(columnDesc.Type == (u32)udtColumnType::String)
+					{
+						u32 stringOffset;
+						memcpy(&stringOffset, input, sizeof(u32));
+						const u32 stringIndex = InternString(strings, source, stringOffset);
+						memcpy(output, &stringIndex, sizeof(u32));
+					}
+					else if(columnDesc.RowIndexTable != UDT_U32_MAX)
+					{
+						u32 rowIndex;
+						memcpy(&rowIndex, input, sizeof(u32));
+						rowIndex += rowIndexBase;
+						memcpy(output, &rowIndex, sizeof(u32));
+					}
+					else
+					{
+						memcpy(output, input, (size_t)valueByteCount);
+					}
+					input += tableDesc.RowByteCount;
+					output += valueByteCount;
+				}
+			}
+
+			columnDataOffset = AlignOffset(columnDataOffset + (u64)rowCounts[t] * (u64)valueByteCount);
+		}
+	}
+
+	//
+	// Append the string dictionary and finish the header.
+	//
+
+	const u32 stringCount = strings.GetStringCount();
+	const u64 stringDataOffset = stringOffsetsOffset + ((u64)stringCount + 1) * sizeof(u32);
+	const u64 fileByteCount = stringDataOffset + (u64)strings.GetDataByteCount();
+	if(fileByteCount > (u64)UDT_U32_MAX)
+	{
+		logger.LogError("The columnar data is too large to fit in a single file");
+		return false;
+	}
+
+	image.Resize((u32)fileByteCount);
+	strings.GetOffsets((u32*)(image.GetStartAddress() + stringOffsetsOffset));
+	memcpy(image.GetStartAddress() + stringDataOffset, strings.GetData(), (size_t)strings.GetDataByteCount());
+
+	udtColumnarHeader& header = *(udtColumnarHeader*)image.GetStartAddress();
+	header.Magic = UDT_COLUMNAR_MAGIC;
+	header.Version = UDT_COLUMNAR_VERSION;
+	header.DemoCount = fileCount;
+	header.TableCount = tableCount;
+	header.StringCount = stringCount;
+	header.FileByteCount = fileByteCount;
+	header.DemosOffset = demosOffset;
+	header.TablesOffset = tablesOffset;
+	header.StringOffsetsOffset = stringOffsetsOffset;
+	header.StringDataOffset = stringDataOffset;
+
+	udtFileStream file;
+	if(!file.Open(outputFilePath, udtFileOpenMode::Write))
+	{
+		logger.LogError("Failed to open file '%s' for writing", outputFilePath);
+		return false;
+	}
+
+	if(file.Write(image.GetStartAddress(), image.GetSize(), 1) != 1)
+	{
+		logger.LogError("Failed to write to columnar file '%s'", outputFilePath);
+		return false;
+	}
+
+	logger.LogInfo("Successfully wrote to file '%s'.", outputFilePath);
+
+	return true;
+}
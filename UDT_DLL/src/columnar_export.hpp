@@ -0,0 +1,9 @@
+#pragma once
+
+
+#include "parser_context.hpp"
+
+
+// Writes the plug-in data of all demos processed by the contexts to a single columnar file.
+// See uberdemotools_columnar.h for the file format.
+extern bool ExportPlugInsDataToColumnar(udtParserContext* contexts, u32 contextCount, const char** filePaths, u32 fileCount, const char* outputFilePath);
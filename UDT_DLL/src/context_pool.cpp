@@ -0,0 +1,140 @@
+#include "context_pool.hpp"
+#include "parser_context.hpp"
+#include "thread_local_storage.hpp"
+#include "assert_or_fatal.hpp"
+#include "memory.hpp"
+
+#include <stdlib.h>
+#include <new>
+
+
+static u8 ThreadLocalStorageBytes[sizeof(udtThreadLocalStorage)];
+static udtThreadLocalStorage* ThreadLocalStorage = NULL;
+static udtContextPoolPolicy::Id Policy = udtContextPoolPolicy::PurgeUnused;
+
+
+struct ThreadLocalPool
+{
+	udtVMArray<udtParserContext*> IdleContexts { "ThreadLocal::IdleContextsArray" };
+};
+
+
+static udtParserContext* CreateContext()
+{
+	// @NOTE: We don't use the standard operator new approach to avoid C++ exceptions.
+	udtParserContext* const context = (udtParserContext*)malloc(sizeof(udtParserContext));
+	if(context == NULL)
+	{
+		return NULL;
+	}
+
+	new (context) udtParserContext;
+
+	return context;
+}
+
+static void DestroyContext(udtParserContext* context)
+{
+	context->~udtParserContext();
+	free(context);
+}
+
+
+void udtParserContextPool::Init()
+{
+	if(ThreadLocalStorage != NULL)
+	{
+		return;
+	}
+
+	new (ThreadLocalStorageBytes) udtThreadLocalStorage();
+	ThreadLocalStorage = (udtThreadLocalStorage*)ThreadLocalStorageBytes;
+	const bool slotAllocated = ThreadLocalStorage->AllocateSlot();
+	UDT_ASSERT_OR_FATAL_MSG(slotAllocated, "Failed to allocate thread-local storage for the parser context pool.");
+}
+
+void udtParserContextPool::Destroy()
+{
+	if(ThreadLocalStorage == NULL)
+	{
+		return;
+	}
+
+	ReleaseThreadContexts();
+	ThreadLocalStorage->~udtThreadLocalStorage();
+	ThreadLocalStorage = NULL;
+}
+
+void udtParserContextPool::SetPolicy(udtContextPoolPolicy::Id policy)
+{
+	Policy = policy;
+}
+
+udtParserContext* udtParserContextPool::Acquire()
+{
+	UDT_ASSERT_OR_FATAL_MSG(ThreadLocalStorage != NULL, "You forgot to call udtInitLibrary.");
+
+	ThreadLocalPool* const pool = (ThreadLocalPool*)ThreadLocalStorage->GetData();
+	if(pool == NULL || pool->IdleContexts.IsEmpty())
+	{
+		return CreateContext();
+	}
+
+	const u32 lastIndex = pool->IdleContexts.GetSize() - 1;
+	udtParserContext* const context = pool->IdleContexts[lastIndex];
+	pool->IdleContexts.RemoveUnordered(lastIndex);
+
+	return context;
+}
+
+void udtParserContextPool::Release(udtParserContext* context)
+{
+	UDT_ASSERT_OR_FATAL_MSG(ThreadLocalStorage != NULL, "You forgot to call udtInitLibrary.");
+
+	if(context == NULL)
+	{
+		return;
+	}
+
+	if(Policy == udtContextPoolPolicy::Disabled)
+	{
+		DestroyContext(context);
+		return;
+	}
+
+	ThreadLocalPool* pool = (ThreadLocalPool*)ThreadLocalStorage->GetData();
+	if(pool == NULL)
+	{
+		pool = (ThreadLocalPool*)udt_malloc(sizeof(ThreadLocalPool));
+		new (pool) ThreadLocalPool();
+		ThreadLocalStorage->SetData(pool);
+	}
+
+	context->ResetForNextDemo(false);
+	if(Policy == udtContextPoolPolicy::PurgeUnused)
+	{
+		context->Purge();
+	}
+
+	pool->IdleContexts.Add(context);
+}
+
+void udtParserContextPool::ReleaseThreadContexts()
+{
+	UDT_ASSERT_OR_FATAL_MSG(ThreadLocalStorage != NULL, "You forgot to call udtInitLibrary.");
+
+	ThreadLocalPool* const pool = (ThreadLocalPool*)ThreadLocalStorage->GetData();
+	if(pool == NULL)
+	{
+		return;
+	}
+
+	for(u32 i = 0, count = pool->IdleContexts.GetSize(); i < count; ++i)
+	{
+		DestroyContext(pool->IdleContexts[i]);
+	}
+
+	ThreadLocalStorage->SetData(NULL);
+	pool->~ThreadLocalPool();
+	free(pool);
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+
+#include "uberdemotools.h"
+
+
+// Keeps the parser contexts the batch functions need around for the next call on the same thread.
+// Creating a context means constructing a big object and reserving address space for dozens of allocators,
+// which can cost more than parsing a short demo.
+namespace udtParserContextPool
+{
+	// Global calls.
+	extern void Init();
+	extern void Destroy();
+	extern void SetPolicy(udtContextPoolPolicy::Id policy);
+
+	// Thread-local calls.
+	extern udtParserContext* Acquire(); // Returns NULL on failure. The context has no plug-ins.
+	extern void              Release(udtParserContext* context); // Destroys the plug-ins and their data.
+	extern void              ReleaseThreadContexts(); // Destroys the idle contexts.
+}
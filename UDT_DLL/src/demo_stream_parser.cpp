@@ -0,0 +1,130 @@
+#include "demo_stream_parser.hpp"
+#include "utils.hpp"
+
+
+udtDemoStreamParser::udtDemoStreamParser()
+{
+	_parser = NULL;
+	_headerByteCount = 0;
+	_messageByteCount = 0;
+	_fileOffset = 0;
+	_messageSequence = 0;
+	_finished = false;
+	_success = false;
+}
+
+void udtDemoStreamParser::Start(udtBaseParser& parser)
+{
+	_parser = &parser;
+	_inMsg.InitContext(parser._context);
+	_inMsg.InitProtocol(parser._inProtocol);
+	_inMsg.Init(parser._inMsgData, ID_MAX_MSG_LENGTH);
+	_headerByteCount = 0;
+	_messageByteCount = 0;
+	_fileOffset = 0;
+	_messageSequence = 0;
+	_finished = false;
+	_success = true;
+}
+
+bool udtDemoStreamParser::PushData(const u8* data, u32 byteCount)
+{
+	if(_parser == NULL)
+	{
+		return false;
+	}
+
+	while(!_finished)
+	{
+		if(_headerByteCount < 8)
+		{
+			const u32 headerByteCount = udt_min(8 - _headerByteCount, byteCount);
+			memcpy(_header + _headerByteCount, data, (size_t)headerByteCount);
+			_headerByteCount += headerByteCount;
+			data += headerByteCount;
+			byteCount -= headerByteCount;
+			if(_headerByteCount < 8)
+			{
+				break;
+			}
+
+			if(!ProcessHeader())
+			{
+				_finished = true;
+				break;
+			}
+		}
+
+		const u32 messageByteCount = udt_min((u32)_inMsg.Buffer.cursize - _messageByteCount, byteCount);
+		memcpy(_inMsg.Buffer.data + _messageByteCount, data, (size_t)messageByteCount);
+		_messageByteCount += messageByteCount;
+		data += messageByteCount;
+		byteCount -= messageByteCount;
+		if(_messageByteCount < (u32)_inMsg.Buffer.cursize)
+		{
+			break;
+		}
+
+		if(!ProcessMessage())
+		{
+			_finished = true;
+			break;
+		}
+	}
+
+	return !_finished;
+}
+
+void udtDemoStreamParser::Finish()
+{
+	if(_parser == NULL)
+	{
+		return;
+	}
+
+	if(!_finished && _headerByteCount > 0)
+	{
+		_parser->_context->LogWarning("Demo stream %s is truncated", _parser->GetFileNamePtr());
+	}
+
+	_parser->FinishParsing(_success);
+	_parser = NULL;
+}
+
+bool udtDemoStreamParser::ProcessHeader()
+{
+	s32 messageLength = 0;
+	memcpy(&_messageSequence, _header, 4);
+	memcpy(&messageLength, _header + 4, 4);
+	if(messageLength == -1)
+	{
+		return false;
+	}
+
+	if((u32)messageLength > (u32)ID_MAX_MSG_LENGTH)
+	{
+		_success = _parser->HandleInvalidMessageLength();
+		return false;
+	}
+
+	_inMsg.Init(_parser->_inMsgData, ID_MAX_MSG_LENGTH);
+	_inMsg.Buffer.cursize = messageLength;
+	_messageByteCount = 0;
+
+	return true;
+}
+
+bool udtDemoStreamParser::ProcessMessage()
+{
+	_inMsg.Buffer.readcount = 0;
+	if(!_parser->ParseNextMessage(_inMsg, _messageSequence, _fileOffset))
+	{
+		return false;
+	}
+
+	_fileOffset += (u32)_inMsg.Buffer.cursize + 8;
+	_headerByteCount = 0;
+	_messageByteCount = 0;
+
+	return true;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+
+#include "parser.hpp"
+
+
+// Parses a demo whose bytes arrive progressively, e.g. while the match is still being recorded.
+// The data can be pushed in chunks of any size: incomplete messages are kept until the rest of their bytes
+// show up and complete messages go through the parser one at a time, exactly like when reading a file.
+struct udtDemoStreamParser
+{
+public:
+	udtDemoStreamParser();
+
+	void Start(udtBaseParser& parser); // After the parser's Init and SetFilePath.
+	bool PushData(const u8* data, u32 byteCount); // Returns true as long as there's supposed to be more to read.
+	void Finish(); // Calls the parser's FinishParsing. The data pushed so far is all there will ever be.
+	bool IsParsing() const { return _parser != NULL; }
+	bool WasSuccess() const { return _success; }
+
+private:
+	UDT_NO_COPY_SEMANTICS(udtDemoStreamParser);
+
+	bool ProcessHeader(); // Returns false if the demo is over.
+	bool ProcessMessage(); // Returns false if the demo is over.
+
+	udtMessage _inMsg;
+	udtBaseParser* _parser; // NULL when not parsing.
+	u8 _header[8]; // The message sequence number and the message length.
+	u32 _headerByteCount; // How much of the header we have.
+	u32 _messageByteCount; // How much of the message data we have.
+	u32 _fileOffset; // Of the message being received.
+	s32 _messageSequence;
+	bool _finished; // True when the last message was received or parsing stopped.
+	bool _success;
+};
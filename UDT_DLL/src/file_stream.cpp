@@ -39,6 +39,20 @@ u64 udtFileStream::GetFileLength(const char* filePath)
 	return (u64)size.QuadPart;
 }
 
+u64 udtFileStream::GetModificationTime(const char* filePath)
+{
+	udtVMLinearAllocator& allocator = udtThreadLocalAllocators::GetTempAllocator();
+	udtVMScopedStackAllocator allocatorScope(allocator);
+	wchar_t* const wideFilePath = udtString::ConvertToUTF16(allocator, udtString::NewConstRef(filePath));
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	if(GetFileAttributesExW(wideFilePath, GetFileExInfoStandard, &attributes) == FALSE)
+	{
+		return 0;
+	}
+
+	return ((u64)attributes.ftLastWriteTime.dwHighDateTime << 32) | (u64)attributes.ftLastWriteTime.dwLowDateTime;
+}
+
 bool udtFileStream::Open(const char* filePath, udtFileOpenMode::Id mode)
 {
 	if(mode < 0 || mode >= udtFileOpenMode::Count)
@@ -53,9 +67,29 @@ bool udtFileStream::Open(const char* filePath, udtFileOpenMode::Id mode)
 	return (_file = _wfopen(wideFilePath, stdioFileOpenModes[mode])) != NULL;
 }
 
+bool udtFileStream::Delete(const char* filePath)
+{
+	udtVMLinearAllocator& allocator = udtThreadLocalAllocators::GetTempAllocator();
+	udtVMScopedStackAllocator allocatorScope(allocator);
+	wchar_t* const wideFilePath = udtString::ConvertToUTF16(allocator, udtString::NewConstRef(filePath));
+
+	return DeleteFileW(wideFilePath) != FALSE;
+}
+
+bool udtFileStream::Rename(const char* filePath, const char* newFilePath)
+{
+	udtVMLinearAllocator& allocator = udtThreadLocalAllocators::GetTempAllocator();
+	udtVMScopedStackAllocator allocatorScope(allocator);
+	wchar_t* const wideFilePath = udtString::ConvertToUTF16(allocator, udtString::NewConstRef(filePath));
+	wchar_t* const wideNewFilePath = udtString::ConvertToUTF16(allocator, udtString::NewConstRef(newFilePath));
+
+	return MoveFileExW(wideFilePath, wideNewFilePath, MOVEFILE_REPLACE_EXISTING) != FALSE;
+}
+
 #else
 
 #include <sys/stat.h>
+#include <unistd.h>
 
 static const char* const stdioFileOpenModes[udtFileOpenMode::Count] =
 {
@@ -75,6 +109,18 @@ u64 udtFileStream::GetFileLength(const char* filePath)
 	return (u64)fileStat.st_size;
 }
 
+u64 udtFileStream::GetModificationTime(const char* filePath)
+{
+	struct stat fileStat;
+	if(stat(filePath, &fileStat) != 0)
+	{
+		return 0;
+	}
+
+	// The nanoseconds matter: a demo can be rewritten several times within the same second.
+	return (u64)fileStat.st_mtim.tv_sec * (u64)1000000000 + (u64)fileStat.st_mtim.tv_nsec;
+}
+
 bool udtFileStream::Open(const char* filePath, udtFileOpenMode::Id mode)
 {
 	if(mode < 0 || mode >= udtFileOpenMode::Count)
@@ -85,6 +131,16 @@ bool udtFileStream::Open(const char* filePath, udtFileOpenMode::Id mode)
 	return (_file = fopen(filePath, stdioFileOpenModes[mode])) != NULL;
 }
 
+bool udtFileStream::Delete(const char* filePath)
+{
+	return unlink(filePath) == 0;
+}
+
+bool udtFileStream::Rename(const char* filePath, const char* newFilePath)
+{
+	return rename(filePath, newFilePath) == 0;
+}
+
 #endif
 
 
@@ -25,6 +25,9 @@ public:
 
 	static bool Exists(const char* filePath);
 	static u64  GetFileLength(const char* filePath);
+	static u64  GetModificationTime(const char* filePath); // Returns 0 on failure.
+	static bool Delete(const char* filePath);
+	static bool Rename(const char* filePath, const char* newFilePath); // Replaces the destination file if it exists.
 
 	bool   Open(const char* filePath, udtFileOpenMode::Id mode);
 
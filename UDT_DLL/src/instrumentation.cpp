@@ -0,0 +1,273 @@
+#include "instrumentation.hpp"
+#include "file_stream.hpp"
+#include "path.hpp"
+#include "memory.hpp"
+#include "utils.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+
+#if defined(UDT_WINDOWS)
+#	include <Windows.h>
+#else
+#	include <time.h>
+#endif
+
+
+void StagePerfStatsInit(udtStagePerfStats* stats)
+{
+	if(stats->StageDurations != NULL)
+	{
+		memset(stats->StageDurations, 0, sizeof(u64) * (size_t)udtPerfStage::Count);
+	}
+
+	if(stats->StageCallCounts != NULL)
+	{
+		memset(stats->StageCallCounts, 0, sizeof(u64) * (size_t)udtPerfStage::Count);
+	}
+
+	if(stats->PlugInDurations != NULL)
+	{
+		memset(stats->PlugInDurations, 0, sizeof(u64) * (size_t)udtParserPlugIn::Count);
+	}
+
+	if(stats->PlugInCallCounts != NULL)
+	{
+		memset(stats->PlugInCallCounts, 0, sizeof(u64) * (size_t)udtParserPlugIn::Count);
+	}
+
+	stats->ThreadCount = 0;
+}
+
+static void AddCounters(u64* dest, const u64* source, u32 count)
+{
+	if(dest == NULL)
+	{
+		return;
+	}
+
+	for(u32 i = 0; i < count; ++i)
+	{
+		dest[i] += source[i];
+	}
+}
+
+void StagePerfStatsAddThread(udtStagePerfStats* stats, const udtStageCounters& counters)
+{
+	AddCounters(stats->StageDurations, counters.StageDurations, (u32)udtPerfStage::Count);
+	AddCounters(stats->StageCallCounts, counters.StageCallCounts, (u32)udtPerfStage::Count);
+	AddCounters(stats->PlugInDurations, counters.PlugInDurations, (u32)udtParserPlugIn::Count);
+	AddCounters(stats->PlugInCallCounts, counters.PlugInCallCounts, (u32)udtParserPlugIn::Count);
+	++stats->ThreadCount;
+}
+
+
+#if defined(UDT_INSTRUMENTATION)
+
+
+#define    UDT_TRACE_BUFFER_BYTE_COUNT    (1 << 16)
+#define    UDT_TRACE_MAX_EVENT_LENGTH     256
+
+
+#define UDT_PERF_STAGE_ITEM(Enum, Desc) Desc,
+static const char* StageNames[udtPerfStage::Count + 1] =
+{
+	UDT_PERF_STAGE_LIST(UDT_PERF_STAGE_ITEM)
+	""
+};
+#undef UDT_PERF_STAGE_ITEM
+
+#define UDT_PLUG_IN_ITEM(Enum, Desc, Type, OutputType) Desc,
+static const char* PlugInNames[udtParserPlugIn::Count + 1] =
+{
+	UDT_PLUG_IN_LIST(UDT_PLUG_IN_ITEM)
+	"private plug-in"
+};
+#undef UDT_PLUG_IN_ITEM
+
+
+// Don't ever allocate an instance of this on the stack.
+struct udtInstrumentationThread
+{
+	udtInstrumentationThread()
+		: TraceByteCount(0)
+		, ThreadIndex(0)
+		, FirstTraceEvent(true)
+		, Tracing(false)
+	{
+		memset(&Counters, 0, sizeof(Counters));
+	}
+
+	void StartTrace(const char* folderPath)
+	{
+		char fileName[64];
+		sprintf(fileName, "udt_trace_%u.json", ThreadIndex);
+
+		udtString filePath;
+		if(!udtPath::Combine(filePath, FilePathAllocator, udtString::NewConstRef(folderPath), fileName) ||
+		   !TraceFile.Open(filePath.GetPtr(), udtFileOpenMode::Write))
+		{
+			return;
+		}
+
+		Tracing = true;
+		AppendTrace("{\"traceEvents\":[\n");
+	}
+
+	void FinishTrace()
+	{
+		if(!Tracing)
+		{
+			return;
+		}
+
+		AppendTrace("\n]}\n");
+		FlushTrace();
+		TraceFile.Close();
+		Tracing = false;
+	}
+
+	void AddTraceEvent(const char* category, const char* name, u64 startTimeNs, u64 durationNs)
+	{
+		if(TraceByteCount + UDT_TRACE_MAX_EVENT_LENGTH > UDT_TRACE_BUFFER_BYTE_COUNT)
+		{
+			FlushTrace();
+		}
+
+		// The time stamps are in micro-seconds.
+		TraceByteCount += (u32)sprintf(TraceBuffer + TraceByteCount,
+			"%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%llu.%03u,\"dur\":%llu.%03u}",
+			FirstTraceEvent ? "" : ",\n", name, category, ThreadIndex,
+			(unsigned long long)(startTimeNs / 1000), (u32)(startTimeNs % 1000),
+			(unsigned long long)(durationNs / 1000), (u32)(durationNs % 1000));
+		FirstTraceEvent = false;
+	}
+
+	void AppendTrace(const char* string)
+	{
+		const u32 length = (u32)strlen(string);
+		if(TraceByteCount + length > UDT_TRACE_BUFFER_BYTE_COUNT)
+		{
+			FlushTrace();
+		}
+
+		memcpy(TraceBuffer + TraceByteCount, string, (size_t)length);
+		TraceByteCount += length;
+	}
+
+	void FlushTrace()
+	{
+		if(TraceByteCount > 0)
+		{
+			TraceFile.Write(TraceBuffer, TraceByteCount, 1);
+			TraceByteCount = 0;
+		}
+	}
+
+	udtStageCounters Counters;
+	udtFileStream TraceFile;
+	udtVMLinearAllocator FilePathAllocator { "Instrumentation::FilePaths" };
+	char TraceBuffer[UDT_TRACE_BUFFER_BYTE_COUNT];
+	u32 TraceByteCount;
+	u32 ThreadIndex;
+	bool FirstTraceEvent;
+	bool Tracing;
+
+private:
+	UDT_NO_COPY_SEMANTICS(udtInstrumentationThread);
+};
+
+
+UDT_THREAD_LOCAL udtInstrumentationThread* InstrumentationThread = NULL;
+
+
+void InstrumentationBeginThread(const udtStagePerfStats* stats, u32 threadIndex)
+{
+	if(stats == NULL || InstrumentationThread != NULL)
+	{
+		return;
+	}
+
+	udtInstrumentationThread* const thread = (udtInstrumentationThread*)udt_malloc(sizeof(udtInstrumentationThread));
+	new (thread) udtInstrumentationThread();
+	thread->ThreadIndex = threadIndex;
+	if(stats->TraceFolderPath != NULL)
+	{
+		thread->StartTrace(stats->TraceFolderPath);
+	}
+
+	InstrumentationThread = thread;
+}
+
+bool InstrumentationEndThread(udtStageCounters& counters)
+{
+	udtInstrumentationThread* const thread = InstrumentationThread;
+	if(thread == NULL)
+	{
+		return false;
+	}
+
+	InstrumentationThread = NULL;
+	thread->FinishTrace();
+	counters = thread->Counters;
+	thread->~udtInstrumentationThread();
+	free(thread);
+
+	return true;
+}
+
+u64 InstrumentationGetTimeNs()
+{
+#if defined(UDT_WINDOWS)
+	static LARGE_INTEGER frequency = { 0 };
+	if(frequency.QuadPart == 0)
+	{
+		QueryPerformanceFrequency(&frequency);
+	}
+
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	const u64 ticks = (u64)counter.QuadPart;
+	const u64 ticksPerSec = (u64)frequency.QuadPart;
+
+	return (ticks / ticksPerSec) * 1000000000 + ((ticks % ticksPerSec) * 1000000000) / ticksPerSec;
+#else
+	timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+
+	return (u64)time.tv_sec * 1000000000 + (u64)time.tv_nsec;
+#endif
+}
+
+void InstrumentationAddStage(udtInstrumentationThread* thread, udtPerfStage::Id stage, u64 startTimeNs)
+{
+	const u64 durationNs = InstrumentationGetTimeNs() - startTimeNs;
+	thread->Counters.StageDurations[stage] += durationNs;
+	thread->Counters.StageCallCounts[stage] += 1;
+	if(thread->Tracing)
+	{
+		thread->AddTraceEvent("stage", StageNames[stage], startTimeNs, durationNs);
+	}
+}
+
+void InstrumentationAddPlugIn(udtInstrumentationThread* thread, u32 plugInId, u64 startTimeNs)
+{
+	const u64 durationNs = InstrumentationGetTimeNs() - startTimeNs;
+	thread->Counters.StageDurations[udtPerfStage::PlugIns] += durationNs;
+	thread->Counters.StageCallCounts[udtPerfStage::PlugIns] += 1;
+	if(plugInId < (u32)udtParserPlugIn::Count)
+	{
+		thread->Counters.PlugInDurations[plugInId] += durationNs;
+		thread->Counters.PlugInCallCounts[plugInId] += 1;
+	}
+
+	if(thread->Tracing)
+	{
+		thread->AddTraceEvent("plug-in", PlugInNames[udt_min(plugInId, (u32)udtParserPlugIn::Count)], startTimeNs, durationNs);
+	}
+}
+
+
+#endif
@@ -0,0 +1,100 @@
+#pragma once
+
+
+#include "uberdemotools.h"
+#include "macros.hpp"
+
+
+// The counters of a single thread.
+struct udtStageCounters
+{
+	u64 StageDurations[udtPerfStage::Count];
+	u64 StageCallCounts[udtPerfStage::Count];
+	u64 PlugInDurations[udtParserPlugIn::Count];
+	u64 PlugInCallCounts[udtParserPlugIn::Count];
+};
+
+extern void StagePerfStatsInit(udtStagePerfStats* stats);
+extern void StagePerfStatsAddThread(udtStagePerfStats* stats, const udtStageCounters& counters);
+
+
+#if defined(UDT_INSTRUMENTATION)
+
+
+// Opt-in timers for the parser's hot paths.
+// A thread only updates its counters between InstrumentationBeginThread and InstrumentationEndThread
+// and the scopes cost a single thread-local pointer test otherwise.
+struct udtInstrumentationThread;
+extern UDT_THREAD_LOCAL udtInstrumentationThread* InstrumentationThread;
+
+extern void InstrumentationBeginThread(const udtStagePerfStats* stats, u32 threadIndex); // Does nothing if stats is NULL.
+extern bool InstrumentationEndThread(udtStageCounters& counters); // Returns false if the thread wasn't instrumented. Finishes the trace file.
+extern u64  InstrumentationGetTimeNs();
+extern void InstrumentationAddStage(udtInstrumentationThread* thread, udtPerfStage::Id stage, u64 startTimeNs);
+extern void InstrumentationAddPlugIn(udtInstrumentationThread* thread, u32 plugInId, u64 startTimeNs);
+
+struct udtStageScope
+{
+	udtStageScope(udtPerfStage::Id stage)
+		: _thread(InstrumentationThread)
+		, _stage(stage)
+	{
+		_startTimeNs = _thread != NULL ? InstrumentationGetTimeNs() : 0;
+	}
+
+	~udtStageScope()
+	{
+		if(_thread != NULL)
+		{
+			InstrumentationAddStage(_thread, _stage, _startTimeNs);
+		}
+	}
+
+private:
+	UDT_NO_COPY_SEMANTICS(udtStageScope);
+
+	udtInstrumentationThread* _thread;
+	u64 _startTimeNs;
+	udtPerfStage::Id _stage;
+};
+
+struct udtPlugInScope
+{
+	udtPlugInScope(u32 plugInId)
+		: _thread(InstrumentationThread)
+		, _plugInId(plugInId)
+	{
+		_startTimeNs = _thread != NULL ? InstrumentationGetTimeNs() : 0;
+	}
+
+	~udtPlugInScope()
+	{
+		if(_thread != NULL)
+		{
+			InstrumentationAddPlugIn(_thread, _plugInId, _startTimeNs);
+		}
+	}
+
+private:
+	UDT_NO_COPY_SEMANTICS(udtPlugInScope);
+
+	udtInstrumentationThread* _thread;
+	u64 _startTimeNs;
+	u32 _plugInId;
+};
+
+#define UDT_INSTRUMENT_STAGE(Stage)        udtStageScope stageScope##Stage(udtPerfStage::Stage)
+#define UDT_INSTRUMENT_PLUG_IN(PlugInId)   udtPlugInScope plugInScope((u32)(PlugInId))
+
+
+#else
+
+
+inline void InstrumentationBeginThread(const udtStagePerfStats*, u32) {}
+inline bool InstrumentationEndThread(udtStageCounters&) { return false; }
+
+#define UDT_INSTRUMENT_STAGE(Stage)
+#define UDT_INSTRUMENT_PLUG_IN(PlugInId)
+
+
+#endif
@@ -1,168 +1,171 @@
 #include "json_writer.hpp"
 
-
-static bool UTF8_NextCodePoint(u32& codePoint, u32& byteCount, const char* input)
+#if defined(UDT_INTRINSICS) && (defined(UDT_X64) || (defined(UDT_X86) && (defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))))
+#	define UDT_JSON_SSE2
+#	include <emmintrin.h>
+#	if defined(UDT_MSVC)
+#		include <intrin.h>
+#	endif
+#endif
+
+
+// Escape table entries:
+// - Plain: copied as is
+// - Stop: end of the string (NUL or a byte that can't start a UTF-8 sequence)
+// - 2, 3, 4: lead byte of a multi-byte UTF-8 sequence
+// - 'u': written as "\u00XX"
+// - anything else: written as a backslash followed by the entry's character
+#define P 0 // plain
+#define S 1 // stop
+#define U 'u'
+static const u8 EscapeTable[256] =
 {
-	if(*input == '\0')
-	{
-		return false;
-	}
+	S, U, U, U, U, U, U, U, 'b', 't', 'n', U, 'f', 'r', U, U, // 0x00
+	U, U, U, U, U, U, U, U, U, U, U, U, U, U, U, U, // 0x10
+	P, P, '"', P, P, P, P, P, P, P, P, P, P, P, P, '/', // 0x20
+	P, P, P, P, P, P, P, P, P, P, P, P, P, P, P, P, // 0x30
+	P, P, P, P, P, P, P, P, P, P, P, P, P, P, P, P, // 0x40
+	P, P, P, P, P, P, P, P, P, P, P, P, '\\', P, P, P, // 0x50
+	P, P, P, P, P, P, P, P, P, P, P, P, P, P, P, P, // 0x60
+	P, P, P, P, P, P, P, P, P, P, P, P, P, P, P, P, // 0x70
+	S, S, S, S, S, S, S, S, S, S, S, S, S, S, S, S, // 0x80
+	S, S, S, S, S, S, S, S, S, S, S, S, S, S, S, S, // 0x90
+	S, S, S, S, S, S, S, S, S, S, S, S, S, S, S, S, // 0xA0
+	S, S, S, S, S, S, S, S, S, S, S, S, S, S, S, S, // 0xB0
+	2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, // 0xC0
+	2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, // 0xD0
+	3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, // 0xE0
+	4, 4, 4, 4, 4, 4, 4, 4, S, S, S, S, S, S, S, S  // 0xF0
+};
+#undef P
+#undef S
+#undef U
 
-	const u8 byte0 = (u8)input[0];
-	if(byte0 <= 127)
-	{
-		codePoint = (u32)byte0;
-		byteCount = 1;
-		return true;
-	}
+static const u8 EscapePlain = 0;
+static const u8 EscapeStop = 1;
+static const u8 EscapeMaxLeadByteCount = 4;
 
-	// Starts with 110?
-	if((byte0 >> 5) == 6)
-	{
-		const u8 byte1 = (u8)input[1];
-		codePoint = ((u32)byte1 & 63) | (((u32)byte0 & 31) << 6);
-		byteCount = 2;
-		return true;
-	}
+static const char HexDigits[16] = { '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'A', 'B', 'C', 'D', 'E', 'F' };
 
-	// Starts with 1110?
-	if((byte0 >> 4) == 14)
-	{
-		const u8 byte1 = (u8)input[1];
-		const u8 byte2 = (u8)input[2];
-		codePoint = ((u32)byte2 & 63) | (((u32)byte1 & 63) << 6) | (((u32)byte0 & 15) << 12);
-		byteCount = 3;
-		return true;
-	}
-	
-	// Starts with 11110?
-	if((byte0 >> 3) == 30)
-	{
-		const u8 byte1 = (u8)input[1];
-		const u8 byte2 = (u8)input[2];
-		const u8 byte3 = (u8)input[3];
-		codePoint = ((u32)byte3 & 63) | (((u32)byte2 & 63) << 6) | (((u32)byte1 & 63) << 12) | (((u32)byte0 & 7) << 18);
-		byteCount = 4;
-		return true;
-	}
-	
-	return false;
-}
+static const char DigitPairs[201] =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899";
+
+// Enough for every nesting level the writer supports.
+static const char NewLineAndTabs[] = "\r\n\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t";
+
+
+#if defined(UDT_JSON_SSE2)
 
-struct ShortEscape
+static u32 FindFirstSetBit(u32 mask)
 {
-	u32 CodePoint;
-	char OutputChar;
-};
+#if defined(UDT_MSVC)
+	unsigned long index;
+	_BitScanForward(&index, (unsigned long)mask);
+	return (u32)index;
+#else
+	return (u32)__builtin_ctz(mask);
+#endif
+}
 
-#define ENTRY(HexValue, Char) { 0x##HexValue, Char }
-static const ShortEscape ShortEscapeCodePoints[] =
+// One bit per byte that isn't plain: control characters, NUL, bytes >= 0x80
+// (negative in the signed comparison), '"', '\\' and '/'.
+static u32 GetSpecialByteMask(__m128i bytes)
 {
-	ENTRY(0022, '"'),
-	ENTRY(005C, '\\'),
-	ENTRY(002F, '/'),
-	ENTRY(0008, 'b'),
-	ENTRY(000C, 'f'),
-	ENTRY(000A, 'n'),
-	ENTRY(000D, 'r'),
-	ENTRY(0009, 't')
-};
-#undef ENTRY
+	const __m128i control = _mm_cmplt_epi8(bytes, _mm_set1_epi8(0x20));
+	const __m128i quote = _mm_cmpeq_epi8(bytes, _mm_set1_epi8('"'));
+	const __m128i backslash = _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\\'));
+	const __m128i slash = _mm_cmpeq_epi8(bytes, _mm_set1_epi8('/'));
+	const __m128i special = _mm_or_si128(_mm_or_si128(control, quote), _mm_or_si128(backslash, slash));
 
-static const char HexDigits[16] = { '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'A', 'B', 'C', 'D', 'E', 'F' };
+	return (u32)_mm_movemask_epi8(special);
+}
 
-static bool UTF8_NeedsEscaping(u32& newLength, u32 codePoint)
+// Aligned loads never cross a page boundary, so reading the whole block
+// that holds the terminating NUL is safe.
+static const char* SkipPlainBytes(const char* string)
 {
-	for(u32 i = 0; i < (u32)UDT_COUNT_OF(ShortEscapeCodePoints); ++i)
+	const u32 misalignment = (u32)((uptr)string & 15);
+	const __m128i* block = (const __m128i*)(string - misalignment);
+	u32 mask = GetSpecialByteMask(_mm_load_si128(block)) >> misalignment;
+	if(mask != 0)
+	{
+		return string + FindFirstSetBit(mask);
+	}
+
+	for(;;)
 	{
-		if(codePoint == ShortEscapeCodePoints[i].CodePoint)
+		++block;
+		mask = GetSpecialByteMask(_mm_load_si128(block));
+		if(mask != 0)
 		{
-			newLength = 2; // Of form: "\A".
-			return true;
+			return (const char*)block + FindFirstSetBit(mask);
 		}
 	}
+}
+
+#else
 
-	// Range: 0x0000 - 0x001F
-	if(codePoint <= 0x001F)
+static const char* SkipPlainBytes(const char* string)
+{
+	while(EscapeTable[(u8)*string] == EscapePlain)
 	{
-		newLength = 6; // Of form: "\uABCD".
-		return true;
+		++string;
 	}
 
-	return false;
+	return string;
 }
 
-static void UTF8_WriteCodePoint(u32& newLength, char* output, u32 codePoint, const char* input)
+#endif
+
+static u32 DecodeCodePoint(const u8* input, u32 byteCount)
 {
-	for(u32 i = 0; i < (u32)UDT_COUNT_OF(ShortEscapeCodePoints); ++i)
+	switch(byteCount)
 	{
-		if(codePoint == ShortEscapeCodePoints[i].CodePoint)
-		{
-			newLength = 2;
-			output[0] = '\\';
-			output[1] = ShortEscapeCodePoints[i].OutputChar;
-			return;
-		}
+		case 2: return ((u32)input[1] & 63) | (((u32)input[0] & 31) << 6);
+		case 3: return ((u32)input[2] & 63) | (((u32)input[1] & 63) << 6) | (((u32)input[0] & 15) << 12);
+		default: return ((u32)input[3] & 63) | (((u32)input[2] & 63) << 6) | (((u32)input[1] & 63) << 12) | (((u32)input[0] & 7) << 18);
 	}
+}
 
-	// Range: 0x0000 - 0x001F
-	if(codePoint <= 0x001F)
+// Writes the digits at the end of the buffer and returns the index of the first character.
+static u32 FormatInteger(char* buffer, u32 bufferSize, s32 number)
+{
+	u32 magnitude = number < 0 ? (0u - (u32)number) : (u32)number;
+	u32 index = bufferSize;
+	while(magnitude >= 100)
 	{
-		newLength = 6;
-		output[0] = '\\';
-		output[1] = 'u';
-		output[2] = HexDigits[(codePoint >> 12) & 15];
-		output[3] = HexDigits[(codePoint >> 8) & 15];
-		output[4] = HexDigits[(codePoint >> 4) & 15];
-		output[5] = HexDigits[codePoint & 15];
-		return;
+		const u32 pair = (magnitude % 100) * 2;
+		magnitude /= 100;
+		buffer[--index] = DigitPairs[pair + 1];
+		buffer[--index] = DigitPairs[pair];
 	}
 
-	for(u32 i = 0; i < newLength; ++i)
+	if(magnitude >= 10)
 	{
-		output[i] = input[i];
+		const u32 pair = magnitude * 2;
+		buffer[--index] = DigitPairs[pair + 1];
+		buffer[--index] = DigitPairs[pair];
 	}
-}
-
-static u32 UTF8_LengthForJSON(const char* input)
-{
-	const char* s = input;
-	u32 codePoint = 0;
-	u32 byteCount = 0;
-	u32 newLength = 0;
-	while(UTF8_NextCodePoint(codePoint, byteCount, s))
+	else
 	{
-		s += byteCount;
-		UTF8_NeedsEscaping(byteCount, codePoint);
-		newLength += byteCount;
+		buffer[--index] = (char)('0' + magnitude);
 	}
 
-	return newLength;
-}
-
-static void UTF8_CleanForJSON(char* output, const char* input)
-{
-	const char* in = input;
-	char* out = output;
-	u32 codePoint = 0;
-	u32 inputByteCount = 0;
-	while(UTF8_NextCodePoint(codePoint, inputByteCount, in))
+	if(number < 0)
 	{
-		u32 outputByteCount = inputByteCount;
-		UTF8_WriteCodePoint(outputByteCount, out, codePoint, in);
-		in += inputByteCount;
-		out += outputByteCount;
+		buffer[--index] = '-';
 	}
-	*out = '\0';
-}
-
-static char* UTF8_CloneForJSON(udtVMLinearAllocator& allocator, const char* input)
-{
-	const u32 newLength = UTF8_LengthForJSON(input);
-	char* const output = (char*)allocator.AllocateAndGetAddress((uptr)newLength + 1);
-	UTF8_CleanForJSON(output, input);
 
-	return output;
+	return index;
 }
 
 
@@ -171,6 +174,7 @@ udtJSONWriter::udtJSONWriter()
 	_stream = NULL;
 	memset(_itemIndices, 0, sizeof(_itemIndices));
 	_level = 0;
+	_bufferByteCount = 0;
 }
 
 udtJSONWriter::~udtJSONWriter()
@@ -186,42 +190,34 @@ void udtJSONWriter::StartFile()
 {
 	memset(_itemIndices, 0, sizeof(_itemIndices));
 	_level = 0;
+	_bufferByteCount = 0;
 
-	Write("{");
+	WriteLiteral("{");
 	++_level;
 }
 
 void udtJSONWriter::EndFile()
 {
-	Write("\r\n}");
+	WriteLiteral("\r\n}");
+	Flush();
 }
 
 void udtJSONWriter::StartObject()
 {
-	if(_itemIndices[_level] > 0)
-	{
-		Write(",");
-	}
-
+	WriteSeparator();
 	WriteNewLine();
-	Write("{");
+	WriteLiteral("{");
 	++_level;
 	_itemIndices[_level] = 0;
 }
 
 void udtJSONWriter::StartObject(const char* name)
 {
-	if(_itemIndices[_level] > 0)
-	{
-		Write(",");
-	}
-
+	WriteSeparator();
+	WriteName(name);
+	WriteLiteral(":");
 	WriteNewLine();
-	Write("\"");
-	Write(name);
-	Write("\":");
-	WriteNewLine();
-	Write("{");
+	WriteLiteral("{");
 	++_level;
 	_itemIndices[_level] = 0;
 }
@@ -230,36 +226,26 @@ void udtJSONWriter::EndObject()
 {
 	--_level;
 	WriteNewLine();
-	Write("}");
+	WriteLiteral("}");
 	++_itemIndices[_level];
 }
 
 void udtJSONWriter::StartArray()
 {
-	if(_itemIndices[_level] > 0)
-	{
-		Write(",");
-	}
-
+	WriteSeparator();
 	WriteNewLine();
-	Write("[");
+	WriteLiteral("[");
 	++_level;
 	_itemIndices[_level] = 0;
 }
 
 void udtJSONWriter::StartArray(const char* name)
 {
-	if(_itemIndices[_level] > 0)
-	{
-		Write(",");
-	}
-
-	WriteNewLine();
-	Write("\"");
-	Write(name);
-	Write("\":");
+	WriteSeparator();
+	WriteName(name);
+	WriteLiteral(":");
 	WriteNewLine();
-	Write("[");
+	WriteLiteral("[");
 	++_level;
 	_itemIndices[_level] = 0;
 }
@@ -268,61 +254,150 @@ void udtJSONWriter::EndArray()
 {
 	--_level;
 	WriteNewLine();
-	Write("]");
+	WriteLiteral("]");
 	++_itemIndices[_level];
 }
 
-void udtJSONWriter::WriteNewLine()
+void udtJSONWriter::WriteSeparator()
 {
-	Write("\r\n");
-	for(u32 i = 0; i < _level; ++i)
+	if(_itemIndices[_level] > 0)
 	{
-		Write("\t");
+		WriteLiteral(",");
 	}
 }
 
+void udtJSONWriter::WriteName(const char* name)
+{
+	WriteNewLine();
+	WriteLiteral("\"");
+	Write(name);
+	WriteLiteral("\"");
+}
+
+void udtJSONWriter::WriteNewLine()
+{
+	Write(NewLineAndTabs, 2 + _level);
+}
+
 void udtJSONWriter::Write(const char* string)
 {
-	_stream->Write(string, (u32)strlen(string), 1);
+	Write(string, (u32)strlen(string));
 }
 
-void udtJSONWriter::CleanAndWrite(const char* string)
+void udtJSONWriter::Write(const char* data, u32 byteCount)
 {
-	char* cleanCopy = UTF8_CloneForJSON(_stringAllocator, string);
-	Write(cleanCopy);
-	_stringAllocator.Clear();
+	if(_bufferByteCount + byteCount > (u32)UDT_JSON_WRITER_BUFFER_SIZE)
+	{
+		Flush();
+		if(byteCount > (u32)UDT_JSON_WRITER_BUFFER_SIZE)
+		{
+			_stream->Write(data, byteCount, 1);
+			return;
+		}
+	}
+
+	memcpy(_buffer + _bufferByteCount, data, (size_t)byteCount);
+	_bufferByteCount += byteCount;
 }
 
-void udtJSONWriter::WriteIntValue(const char* name, s32 number)
+void udtJSONWriter::Flush()
 {
-	char numberString[64];
-	sprintf(numberString, "%d", number);
+	if(_bufferByteCount > 0)
+	{
+		_stream->Write(_buffer, _bufferByteCount, 1);
+		_bufferByteCount = 0;
+	}
+}
 
-	if(_itemIndices[_level] > 0)
+void udtJSONWriter::WriteEscapedCodePoint(u32 codePoint)
+{
+	const u8 entry = codePoint == 0 ? (u8)'u' : EscapeTable[codePoint];
+	if(entry == 'u')
 	{
-		Write(",");
+		const char escape[6] = { '\\', 'u', '0', '0', HexDigits[(codePoint >> 4) & 15], HexDigits[codePoint & 15] };
+		Write(escape, 6);
 	}
+	else
+	{
+		const char escape[2] = { '\\', (char)entry };
+		Write(escape, 2);
+	}
+}
 
-	WriteNewLine();
-	Write("\"");
-	Write(name);
-	Write("\": ");
-	Write(numberString);
+void udtJSONWriter::CleanAndWrite(const char* string)
+{
+	const char* s = string;
+	for(;;)
+	{
+		const char* const plainEnd = SkipPlainBytes(s);
+		if(plainEnd != s)
+		{
+			Write(s, (u32)(plainEnd - s));
+			s = plainEnd;
+		}
+
+		const u8 entry = EscapeTable[(u8)*s];
+		if(entry == EscapeStop)
+		{
+			return;
+		}
+
+		if(entry > EscapeMaxLeadByteCount)
+		{
+			WriteEscapedCodePoint((u32)(u8)*s);
+			++s;
+			continue;
+		}
+
+		// Continuation bytes aren't validated, but a NUL still ends the string.
+		const u32 byteCount = (u32)entry;
+		for(u32 i = 1; i < byteCount; ++i)
+		{
+			if(s[i] == '\0')
+			{
+				Write(s, i);
+				return;
+			}
+		}
+
+		// Overlong encodings can decode to ASCII characters that need escaping.
+		const u32 codePoint = DecodeCodePoint((const u8*)s, byteCount);
+		if(codePoint < 0x80 && (codePoint == 0 || EscapeTable[codePoint] != EscapePlain))
+		{
+			WriteEscapedCodePoint(codePoint);
+		}
+		else
+		{
+			Write(s, byteCount);
+		}
+		s += byteCount;
+	}
+}
+
+void udtJSONWriter::WriteIntValue(const char* name, s32 number)
+{
+	char numberString[16];
+	const u32 firstIndex = FormatInteger(numberString, (u32)sizeof(numberString), number);
+
+	WriteSeparator();
+	WriteName(name);
+	WriteLiteral(": ");
+	Write(numberString + firstIndex, (u32)sizeof(numberString) - firstIndex);
 	++_itemIndices[_level];
 }
 
 void udtJSONWriter::WriteBoolValue(const char* name, bool value)
 {
-	if(_itemIndices[_level] > 0)
+	WriteSeparator();
+	WriteName(name);
+	if(value)
 	{
-		Write(",");
+		WriteLiteral(": true");
+	}
+	else
+	{
+		WriteLiteral(": false");
 	}
-
-	WriteNewLine();
-	Write("\"");
-	Write(name);
-	Write("\": ");
-	Write(value ? "true" : "false");
 	++_itemIndices[_level];
 }
 
@@ -335,15 +410,12 @@ void udtJSONWriter::WriteStringValue(const char* name, const char* string)
 
 	if(_itemIndices[_level] > 0)
 	{
-		Write(", ");
+		WriteLiteral(", ");
 	}
 
-	WriteNewLine();
-	Write("\"");
-	Write(name);
-	Write("\": \"");
+	WriteName(name);
+	WriteLiteral(": \"");
 	CleanAndWrite(string);
-	//Write(string);
-	Write("\"");
+	WriteLiteral("\"");
 	++_itemIndices[_level];
 }
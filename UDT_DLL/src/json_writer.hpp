@@ -4,6 +4,9 @@
 #include "stream.hpp"
 
 
+// Output is staged here and only handed to the stream when the buffer is full or the file ends.
+#define UDT_JSON_WRITER_BUFFER_SIZE (64 * 1024)
+
 struct udtJSONWriter
 {
 public:
@@ -11,9 +14,9 @@ public:
 	~udtJSONWriter();
 
 	void SetOutputStream(udtStream* stream);
-	
+
 	void StartFile();
-	void EndFile();
+	void EndFile(); // Flushes all buffered output to the stream.
 	void StartObject();
 	void StartObject(const char* name);
 	void EndObject();
@@ -28,12 +31,24 @@ public:
 private:
 	UDT_NO_COPY_SEMANTICS(udtJSONWriter);
 
+	void WriteSeparator();
+	void WriteName(const char* name);
 	void WriteNewLine();
 	void Write(const char* string);
+	void Write(const char* data, u32 byteCount);
+	void WriteEscapedCodePoint(u32 codePoint);
 	void CleanAndWrite(const char* string);
+	void Flush();
+
+	template<u32 N>
+	void WriteLiteral(const char (&string)[N])
+	{
+		Write(string, N - 1);
+	}
 
-	udtVMLinearAllocator _stringAllocator { "JSONWriter::Strings" };
 	udtStream* _stream;
 	u32 _itemIndices[16];
 	u32 _level;
+	u32 _bufferByteCount;
+	char _buffer[UDT_JSON_WRITER_BUFFER_SIZE];
 };
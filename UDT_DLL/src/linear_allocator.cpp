@@ -13,8 +13,17 @@
 
 #define    SAFE_NAME    (_name != NULL ? _name : "?")
 
+// Allocators with a smaller reservation would waste too much committed memory with huge pages.
+#define    UDT_HUGE_PAGE_MIN_RESERVED_BYTE_COUNT    UDT_MB(16)
+
 
 static udtAllocatorTracker AllocatorTracker;
+static bool HugePagesEnabled = false;
+
+void udtVMLinearAllocator::SetHugePagesEnabled(bool enabled)
+{
+	HugePagesEnabled = enabled;
+}
 
 void udtVMLinearAllocator::GetThreadStats(Stats& stats)
 {
@@ -65,6 +74,30 @@ void udtVMLinearAllocator::GetThreadAllocators(u32& allocatorCount, udtVMLinearA
 }
 
 
+void udtVMLinearAllocator::PurgeThreadAllocators(const void* objectAddress, uptr objectByteCount)
+{
+	udtIntrusiveList* allocators = NULL;
+	AllocatorTracker.GetAllocatorList(allocators);
+	if(allocators == NULL)
+	{
+		return;
+	}
+
+	const uptr objectStart = (uptr)objectAddress;
+	const uptr objectEnd = objectStart + objectByteCount;
+	udtIntrusiveListNode* node = allocators->Root.Next;
+	while(node != &allocators->Root)
+	{
+		udtVMLinearAllocator* const allocator = (udtVMLinearAllocator*)((u8*)node - offsetof(udtVMLinearAllocator, _listNode));
+		if((uptr)allocator >= objectStart && (uptr)allocator < objectEnd)
+		{
+			allocator->Purge();
+		}
+		node = node->Next;
+	}
+}
+
+
 udtVMLinearAllocator::udtVMLinearAllocator(const char* name)
 {
 	_addressSpaceStart = NULL;
@@ -94,7 +127,9 @@ void udtVMLinearAllocator::Init(uptr reservedByteCount)
 		return;
 	}
 	
-	const uptr commitByteCountGranularity = UDT_MEMORY_PAGE_SIZE;
+	_commitByteCountGranularity = UDT_MEMORY_PAGE_SIZE;
+	UpdateCommitGranularity(reservedByteCount);
+	const uptr commitByteCountGranularity = _commitByteCountGranularity;
 
 	// Ensure the reserve size is a multiple of the commit granularity.
 	// If it is, leave it as is. If it's not, bump it up to the next multiple.
@@ -110,12 +145,24 @@ void udtVMLinearAllocator::Init(uptr reservedByteCount)
 	{
 		UDT_ASSERT_OR_FATAL_ALWAYS("VirtualMemoryReserve failed in allocator '%s'.", SAFE_NAME);
 	}
+
+	if(commitByteCountGranularity == UDT_HUGE_PAGE_SIZE)
+	{
+		VirtualMemoryAdviseHugePages(data, reservedByteCount);
+	}
 	
 	_addressSpaceStart = data;
 	_usedByteCount = 0;
 	_reservedByteCount = reservedByteCount;
 	_committedByteCount = 0;
-	_commitByteCountGranularity = commitByteCountGranularity;
+}
+
+void udtVMLinearAllocator::UpdateCommitGranularity(uptr reservedByteCount)
+{
+	if(HugePagesEnabled && reservedByteCount >= (uptr)UDT_HUGE_PAGE_MIN_RESERVED_BYTE_COUNT)
+	{
+		_commitByteCountGranularity = UDT_HUGE_PAGE_SIZE;
+	}
 }
 
 uptr udtVMLinearAllocator::Allocate(uptr byteCount)
@@ -157,42 +204,70 @@ uptr udtVMLinearAllocator::Allocate(uptr byteCount)
 
 uptr udtVMLinearAllocator::AllocateWithRelocation(uptr byteCount)
 {
-	// Reserve new address space.
-	const uptr commitByteCountGranularity = _commitByteCountGranularity;
+	const uptr oldCommitByteCountGranularity = _commitByteCountGranularity;
 	uptr newReservedByteCount = udt_max(_usedByteCount + byteCount, ComputeNewReservedByteCount());
+	UpdateCommitGranularity(newReservedByteCount);
+	const uptr commitByteCountGranularity = _commitByteCountGranularity;
 	newReservedByteCount = (newReservedByteCount + commitByteCountGranularity - 1) & (~(commitByteCountGranularity - 1));
 	UDT_ASSERT_OR_FATAL(newReservedByteCount >= (uptr)commitByteCountGranularity);
-	u8* const data = (u8*)VirtualMemoryReserve(newReservedByteCount);
-	if(data == NULL)
-	{
-		UDT_ASSERT_OR_FATAL_ALWAYS("VirtualMemoryReserve failed in allocator '%s'.", SAFE_NAME);
-		return UDT_U32_MAX;
-	}
 
 	// Commit just enough for the new used size.
 	const uptr neededByteCount = _usedByteCount + byteCount;
 	const uptr chunkCount = (neededByteCount + commitByteCountGranularity - 1) / commitByteCountGranularity;
 	const uptr newCommitByteCount = chunkCount * commitByteCountGranularity;
-	if(!VirtualMemoryCommit(data, newCommitByteCount))
-	{
-		UDT_ASSERT_OR_FATAL_ALWAYS("VirtualMemoryCommit failed in allocator '%s'.", SAFE_NAME);
-		return UDT_U32_MAX;
-	}
 
-	// Copy the old data to the new location.
+	// Try moving the committed pages to a bigger reservation first, so that we don't have to copy anything.
 	const uptr oldUsedByteCount = _usedByteCount;
-	if(oldUsedByteCount > 0)
+	u8* data = (u8*)VirtualMemoryGrow(_addressSpaceStart, _committedByteCount, _reservedByteCount, newReservedByteCount);
+	if(data != NULL)
 	{
-		memcpy(data, _addressSpaceStart, (size_t)oldUsedByteCount);
+		if(commitByteCountGranularity != oldCommitByteCountGranularity)
+		{
+			VirtualMemoryAdviseHugePages(data, newReservedByteCount);
+		}
+
+		if(newCommitByteCount > _committedByteCount &&
+		   !VirtualMemoryCommit(data + _committedByteCount, newCommitByteCount - _committedByteCount))
+		{
+			UDT_ASSERT_OR_FATAL_ALWAYS("VirtualMemoryCommit failed in allocator '%s'.", SAFE_NAME);
+			return UDT_U32_MAX;
+		}
+	}
+	else
+	{
+		// Reserve new address space.
+		data = (u8*)VirtualMemoryReserve(newReservedByteCount);
+		if(data == NULL)
+		{
+			UDT_ASSERT_OR_FATAL_ALWAYS("VirtualMemoryReserve failed in allocator '%s'.", SAFE_NAME);
+			return UDT_U32_MAX;
+		}
+
+		if(commitByteCountGranularity == UDT_HUGE_PAGE_SIZE)
+		{
+			VirtualMemoryAdviseHugePages(data, newReservedByteCount);
+		}
+
+		if(!VirtualMemoryCommit(data, newCommitByteCount))
+		{
+			UDT_ASSERT_OR_FATAL_ALWAYS("VirtualMemoryCommit failed in allocator '%s'.", SAFE_NAME);
+			return UDT_U32_MAX;
+		}
+
+		// Copy the old data to the new location.
+		if(oldUsedByteCount > 0)
+		{
+			memcpy(data, _addressSpaceStart, (size_t)oldUsedByteCount);
+		}
+
+		// Return the old address space and pages to the system.
+		VirtualMemoryDecommitAndRelease(_addressSpaceStart, _reservedByteCount);
 	}
-	
-	// Return the old address space and pages to the system.
-	VirtualMemoryDecommitAndRelease(_addressSpaceStart, _reservedByteCount);
 	
 	// Update the members.
 	_addressSpaceStart = data;
 	_reservedByteCount = newReservedByteCount;
-	_committedByteCount = newCommitByteCount;
+	_committedByteCount = udt_max(newCommitByteCount, _committedByteCount);
 	_usedByteCount += byteCount;
 	_peakUsedByteCount = udt_max(_peakUsedByteCount, _usedByteCount);
 	++_resizeCount;
@@ -236,12 +311,13 @@ void udtVMLinearAllocator::Clear()
 
 void udtVMLinearAllocator::Purge()
 {
-	if(_committedByteCount - _usedByteCount < UDT_MEMORY_PAGE_SIZE)
+	// We keep whole commit chunks to avoid breaking up huge pages.
+	if(_committedByteCount - _usedByteCount < _commitByteCountGranularity)
 	{
 		return;
 	}
 
-	const uptr pageSizeM1 = (uptr)(UDT_MEMORY_PAGE_SIZE - 1);
+	const uptr pageSizeM1 = _commitByteCountGranularity - 1;
 	u8* const memoryToDecommit = (u8*)((uptr)(_addressSpaceStart + _usedByteCount + pageSizeM1) & (~pageSizeM1));
 	u8* const committedEnd = _addressSpaceStart + _committedByteCount;
 	const uptr byteCount = (uptr)(committedEnd - memoryToDecommit);
@@ -6,6 +6,7 @@
 
 
 #define    UDT_MEMORY_PAGE_SIZE    4096
+#define    UDT_HUGE_PAGE_SIZE      (2 << 20)
 #define    UDT_KB(x)               (x << 10)
 #define    UDT_MB(x)               (x << 20)
 #define    UDT_GB(x)               (x << 30)
@@ -29,6 +30,14 @@ public:
 	
 	static void GetThreadStats(Stats& stats);
 	static void GetThreadAllocators(u32& allocatorCount, udtVMLinearAllocator** allocators);
+	
+	// When enabled, allocators whose reservation grows large commit memory in huge page chunks
+	// and ask the system to back them with huge pages.
+	// Only affects the allocators that get initialized or grow after the call.
+	static void SetHugePagesEnabled(bool enabled);
+
+	// Purges all the allocators of the calling thread that are members of the object.
+	static void PurgeThreadAllocators(const void* objectAddress, uptr objectByteCount);
 
 public:
 	udtVMLinearAllocator(const char* name = nullptr);
@@ -60,6 +69,7 @@ private:
 
 	uptr AllocateWithRelocation(uptr byteCount);
 	uptr ComputeNewReservedByteCount();
+	void UpdateCommitGranularity(uptr reservedByteCount);
 	void Destroy();
 
 	udtIntrusiveListNode _listNode;
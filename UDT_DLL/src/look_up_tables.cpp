@@ -1,15 +1,14 @@
 #include "look_up_tables.hpp"
 #include "timer.hpp"
-
-#include <stdlib.h>
-#include <string.h>
+#include "assert_or_fatal.hpp"
+#include "utils.hpp"
 
 
 #define UNDEFINED UDT_S16_MIN
+#define UDT_MAGIC_NUMBER_MAP_DATA_COUNT 8192
 
 
 static s16 PowerUps_3_90_U2Q[udtPowerUpIndex::Count];
-static s16 PowerUps_3_90_Q2U[udtPowerUpIndex::Count * 2];
 static const s16 PowerUps_3_90[udtPowerUpIndex::Count * 2] =
 {
 	(s16)udtPowerUpIndex::QuadDamage, 1,
@@ -29,7 +28,6 @@ static const s16 PowerUps_3_90[udtPowerUpIndex::Count * 2] =
 };
 
 static s16 PowerUps_91_U2Q[udtPowerUpIndex::Count];
-static s16 PowerUps_91_Q2U[udtPowerUpIndex::Count * 2];
 static const s16 PowerUps_91[udtPowerUpIndex::Count * 2] =
 {
 	(s16)udtPowerUpIndex::QuadDamage, 5,
@@ -48,20 +46,19 @@ static const s16 PowerUps_91[udtPowerUpIndex::Count * 2] =
 	(s16)udtPowerUpIndex::Invulnerability, 11
 };
 
-static const s16* PowerUpTables[udtProtocol::Count * 3] =
+static const s16* PowerUpTables[udtProtocol::Count * 2] =
 {
-	PowerUps_3_90, PowerUps_3_90_U2Q, PowerUps_3_90_Q2U,
-	PowerUps_3_90, PowerUps_3_90_U2Q, PowerUps_3_90_Q2U,
-	PowerUps_3_90, PowerUps_3_90_U2Q, PowerUps_3_90_Q2U,
-	PowerUps_3_90, PowerUps_3_90_U2Q, PowerUps_3_90_Q2U,
-	PowerUps_3_90, PowerUps_3_90_U2Q, PowerUps_3_90_Q2U,
-	PowerUps_3_90, PowerUps_3_90_U2Q, PowerUps_3_90_Q2U,
-	PowerUps_3_90, PowerUps_3_90_U2Q, PowerUps_3_90_Q2U,
-	PowerUps_91, PowerUps_91_U2Q, PowerUps_91_Q2U
+	PowerUps_3_90, PowerUps_3_90_U2Q,
+	PowerUps_3_90, PowerUps_3_90_U2Q,
+	PowerUps_3_90, PowerUps_3_90_U2Q,
+	PowerUps_3_90, PowerUps_3_90_U2Q,
+	PowerUps_3_90, PowerUps_3_90_U2Q,
+	PowerUps_3_90, PowerUps_3_90_U2Q,
+	PowerUps_3_90, PowerUps_3_90_U2Q,
+	PowerUps_91, PowerUps_91_U2Q
 };
 
 static s16 LifeStats_3_68_U2Q[udtLifeStatsIndex::Count];
-static s16 LifeStats_3_68_Q2U[udtLifeStatsIndex::Count * 2];
 static const s16 LifeStats_3_68[udtLifeStatsIndex::Count * 2] =
 {
 	(s16)udtLifeStatsIndex::Health, 0,
@@ -72,7 +69,6 @@ static const s16 LifeStats_3_68[udtLifeStatsIndex::Count * 2] =
 };
 
 static s16 LifeStats_73p_U2Q[udtLifeStatsIndex::Count];
-static s16 LifeStats_73p_Q2U[udtLifeStatsIndex::Count * 2];
 static const s16 LifeStats_73p[udtLifeStatsIndex::Count * 2] =
 {
 	(s16)udtLifeStatsIndex::Health, 0,
@@ -82,20 +78,19 @@ static const s16 LifeStats_73p[udtLifeStatsIndex::Count * 2] =
 	(s16)udtLifeStatsIndex::MaxHealth, 7
 };
 
-static const s16* LifeStatsTables[udtProtocol::Count * 3] =
+static const s16* LifeStatsTables[udtProtocol::Count * 2] =
 {
-	LifeStats_3_68, LifeStats_3_68_U2Q, LifeStats_3_68_Q2U,
-	LifeStats_3_68, LifeStats_3_68_U2Q, LifeStats_3_68_Q2U,
-	LifeStats_3_68, LifeStats_3_68_U2Q, LifeStats_3_68_Q2U,
-	LifeStats_3_68, LifeStats_3_68_U2Q, LifeStats_3_68_Q2U,
-	LifeStats_3_68, LifeStats_3_68_U2Q, LifeStats_3_68_Q2U,
-	LifeStats_73p, LifeStats_73p_U2Q, LifeStats_73p_Q2U,
-	LifeStats_73p, LifeStats_73p_U2Q, LifeStats_73p_Q2U,
-	LifeStats_73p, LifeStats_73p_U2Q, LifeStats_73p_Q2U
+	LifeStats_3_68, LifeStats_3_68_U2Q,
+	LifeStats_3_68, LifeStats_3_68_U2Q,
+	LifeStats_3_68, LifeStats_3_68_U2Q,
+	LifeStats_3_68, LifeStats_3_68_U2Q,
+	LifeStats_3_68, LifeStats_3_68_U2Q,
+	LifeStats_73p, LifeStats_73p_U2Q,
+	LifeStats_73p, LifeStats_73p_U2Q,
+	LifeStats_73p, LifeStats_73p_U2Q
 };
 
 static s16 PersStats_3_U2Q[udtPersStatsIndex::Count];
-static s16 PersStats_3_Q2U[udtPersStatsIndex::Count * 2];
 static const s16 PersStats_3[udtPersStatsIndex::Count * 2] =
 {
 	(s16)udtPersStatsIndex::FlagCaptures, UNDEFINED,
@@ -115,7 +110,6 @@ static const s16 PersStats_3[udtPersStatsIndex::Count * 2] =
 };
 
 static s16 PersStats_48_68_U2Q[udtPersStatsIndex::Count];
-static s16 PersStats_48_68_Q2U[udtPersStatsIndex::Count * 2];
 static const s16 PersStats_48_68[udtPersStatsIndex::Count * 2] =
 {
 	(s16)udtPersStatsIndex::FlagCaptures, 14,
@@ -135,7 +129,6 @@ static const s16 PersStats_48_68[udtPersStatsIndex::Count * 2] =
 };
 
 static s16 PersStats_73p_U2Q[udtPersStatsIndex::Count];
-static s16 PersStats_73p_Q2U[udtPersStatsIndex::Count * 2];
 static const s16 PersStats_73p[udtPersStatsIndex::Count * 2] =
 {
 	(s16)udtPersStatsIndex::FlagCaptures, 13,
@@ -154,20 +147,19 @@ static const s16 PersStats_73p[udtPersStatsIndex::Count * 2] =
 	(s16)udtPersStatsIndex::Humiliations, 12
 };
 
-static const s16* PersStatsTables[udtProtocol::Count * 3] =
+static const s16* PersStatsTables[udtProtocol::Count * 2] =
 {
-	PersStats_3, PersStats_3_U2Q, PersStats_3_Q2U,
-	PersStats_48_68, PersStats_48_68_U2Q, PersStats_48_68_Q2U,
-	PersStats_48_68, PersStats_48_68_U2Q, PersStats_48_68_Q2U,
-	PersStats_48_68, PersStats_48_68_U2Q, PersStats_48_68_Q2U,
-	PersStats_48_68, PersStats_48_68_U2Q, PersStats_48_68_Q2U,
-	PersStats_73p, PersStats_73p_U2Q, PersStats_73p_Q2U,
-	PersStats_73p, PersStats_73p_U2Q, PersStats_73p_Q2U,
-	PersStats_73p, PersStats_73p_U2Q, PersStats_73p_Q2U
+	PersStats_3, PersStats_3_U2Q,
+	PersStats_48_68, PersStats_48_68_U2Q,
+	PersStats_48_68, PersStats_48_68_U2Q,
+	PersStats_48_68, PersStats_48_68_U2Q,
+	PersStats_48_68, PersStats_48_68_U2Q,
+	PersStats_73p, PersStats_73p_U2Q,
+	PersStats_73p, PersStats_73p_U2Q,
+	PersStats_73p, PersStats_73p_U2Q
 };
 
 static s16 EntityTypes_3_U2Q[udtEntityType::Count];
-static s16 EntityTypes_3_Q2U[udtEntityType::Count * 2];
 static const s16 EntityTypes_3[udtEntityType::Count * 2] =
 {
 	(s16)udtEntityType::Event, 12,
@@ -187,7 +179,6 @@ static const s16 EntityTypes_3[udtEntityType::Count * 2] =
 };
 
 static s16 EntityTypes_48p_U2Q[udtEntityType::Count];
-static s16 EntityTypes_48p_Q2U[udtEntityType::Count * 2];
 static const s16 EntityTypes_48p[udtEntityType::Count * 2] =
 {
 	(s16)udtEntityType::Event, 13,
@@ -206,20 +197,19 @@ static const s16 EntityTypes_48p[udtEntityType::Count * 2] =
 	(s16)udtEntityType::Team, 12
 };
 
-static const s16* EntityTypeTables[udtProtocol::Count * 3] =
+static const s16* EntityTypeTables[udtProtocol::Count * 2] =
 {
-	EntityTypes_3, EntityTypes_3_U2Q, EntityTypes_3_Q2U,
-	EntityTypes_48p, EntityTypes_48p_U2Q, EntityTypes_48p_Q2U,
-	EntityTypes_48p, EntityTypes_48p_U2Q, EntityTypes_48p_Q2U,
-	EntityTypes_48p, EntityTypes_48p_U2Q, EntityTypes_48p_Q2U,
-	EntityTypes_48p, EntityTypes_48p_U2Q, EntityTypes_48p_Q2U,
-	EntityTypes_48p, EntityTypes_48p_U2Q, EntityTypes_48p_Q2U,
-	EntityTypes_48p, EntityTypes_48p_U2Q, EntityTypes_48p_Q2U,
-	EntityTypes_48p, EntityTypes_48p_U2Q, EntityTypes_48p_Q2U
+	EntityTypes_3, EntityTypes_3_U2Q,
+	EntityTypes_48p, EntityTypes_48p_U2Q,
+	EntityTypes_48p, EntityTypes_48p_U2Q,
+	EntityTypes_48p, EntityTypes_48p_U2Q,
+	EntityTypes_48p, EntityTypes_48p_U2Q,
+	EntityTypes_48p, EntityTypes_48p_U2Q,
+	EntityTypes_48p, EntityTypes_48p_U2Q,
+	EntityTypes_48p, EntityTypes_48p_U2Q
 };
 
 static s16 EntityFlagBits_3_U2Q[udtEntityFlag::Count];
-static s16 EntityFlagBits_3_Q2U[udtEntityFlag::Count * 2];
 static const s16 EntityFlagBits_3[udtEntityFlag::Count * 2] =
 {
 	(s16)udtEntityFlag::Dead, 0,
@@ -242,7 +232,6 @@ static const s16 EntityFlagBits_3[udtEntityFlag::Count * 2] =
 };
 
 static s16 EntityFlagBits_48_U2Q[udtEntityFlag::Count];
-static s16 EntityFlagBits_48_Q2U[udtEntityFlag::Count * 2];
 static const s16 EntityFlagBits_48[udtEntityFlag::Count * 2] =
 {
 	(s16)udtEntityFlag::Dead, 0,
@@ -265,7 +254,6 @@ static const s16 EntityFlagBits_48[udtEntityFlag::Count * 2] =
 };
 
 static s16 EntityFlagBits_66_90_U2Q[udtEntityFlag::Count];
-static s16 EntityFlagBits_66_90_Q2U[udtEntityFlag::Count * 2];
 static const s16 EntityFlagBits_66_90[udtEntityFlag::Count * 2] =
 {
 	(s16)udtEntityFlag::Dead, 0,
@@ -288,7 +276,6 @@ static const s16 EntityFlagBits_66_90[udtEntityFlag::Count * 2] =
 };
 
 static s16 EntityFlagBits_91_U2Q[udtEntityFlag::Count];
-static s16 EntityFlagBits_91_Q2U[udtEntityFlag::Count * 2];
 static const s16 EntityFlagBits_91[udtEntityFlag::Count * 2] =
 {
 	(s16)udtEntityFlag::Dead, 0,
@@ -310,20 +297,19 @@ static const s16 EntityFlagBits_91[udtEntityFlag::Count * 2] =
 	(s16)udtEntityFlag::Spectator, 14
 };
 
-static const s16* EntityFlagBitTables[udtProtocol::Count * 3] =
+static const s16* EntityFlagBitTables[udtProtocol::Count * 2] =
 {
-	EntityFlagBits_3, EntityFlagBits_3_U2Q, EntityFlagBits_3_Q2U,
-	EntityFlagBits_48, EntityFlagBits_48_U2Q, EntityFlagBits_48_Q2U,
-	EntityFlagBits_66_90, EntityFlagBits_66_90_U2Q, EntityFlagBits_66_90_Q2U,
-	EntityFlagBits_66_90, EntityFlagBits_66_90_U2Q, EntityFlagBits_66_90_Q2U,
-	EntityFlagBits_66_90, EntityFlagBits_66_90_U2Q, EntityFlagBits_66_90_Q2U,
-	EntityFlagBits_66_90, EntityFlagBits_66_90_U2Q, EntityFlagBits_66_90_Q2U,
-	EntityFlagBits_66_90, EntityFlagBits_66_90_U2Q, EntityFlagBits_66_90_Q2U,
-	EntityFlagBits_91, EntityFlagBits_91_U2Q, EntityFlagBits_91_Q2U
+	EntityFlagBits_3, EntityFlagBits_3_U2Q,
+	EntityFlagBits_48, EntityFlagBits_48_U2Q,
+	EntityFlagBits_66_90, EntityFlagBits_66_90_U2Q,
+	EntityFlagBits_66_90, EntityFlagBits_66_90_U2Q,
+	EntityFlagBits_66_90, EntityFlagBits_66_90_U2Q,
+	EntityFlagBits_66_90, EntityFlagBits_66_90_U2Q,
+	EntityFlagBits_66_90, EntityFlagBits_66_90_U2Q,
+	EntityFlagBits_91, EntityFlagBits_91_U2Q
 };
 
 static s16 EntityEvents_3_U2Q[udtEntityEvent::Count];
-static s16 EntityEvents_3_Q2U[udtEntityEvent::Count * 2];
 static const s16 EntityEvents_3[udtEntityEvent::Count * 2] =
 {
 	(s16)udtEntityEvent::Obituary, 58,
@@ -350,7 +336,6 @@ static const s16 EntityEvents_3[udtEntityEvent::Count * 2] =
 };
 
 static s16 EntityEvents_48_68_U2Q[udtEntityEvent::Count];
-static s16 EntityEvents_48_68_Q2U[udtEntityEvent::Count * 2];
 static const s16 EntityEvents_48_68[udtEntityEvent::Count * 2] =
 {
 	(s16)udtEntityEvent::Obituary, 60,
@@ -377,7 +362,6 @@ static const s16 EntityEvents_48_68[udtEntityEvent::Count * 2] =
 };
 
 static s16 EntityEvents_73p_U2Q[udtEntityEvent::Count];
-static s16 EntityEvents_73p_Q2U[udtEntityEvent::Count * 2];
 static const s16 EntityEvents_73p[udtEntityEvent::Count * 2] =
 {
 	(s16)udtEntityEvent::Obituary, 58,
@@ -403,20 +387,19 @@ static const s16 EntityEvents_73p[udtEntityEvent::Count * 2] =
 	(s16)udtEntityEvent::QL_GameOver, 85
 };
 
-static const s16* EntityEventTables[udtProtocol::Count * 3] =
+static const s16* EntityEventTables[udtProtocol::Count * 2] =
 {
-	EntityEvents_3, EntityEvents_3_U2Q, EntityEvents_3_Q2U,
-	EntityEvents_48_68, EntityEvents_48_68_U2Q, EntityEvents_48_68_Q2U,
-	EntityEvents_48_68, EntityEvents_48_68_U2Q, EntityEvents_48_68_Q2U,
-	EntityEvents_48_68, EntityEvents_48_68_U2Q, EntityEvents_48_68_Q2U,
-	EntityEvents_48_68, EntityEvents_48_68_U2Q, EntityEvents_48_68_Q2U,
-	EntityEvents_73p, EntityEvents_73p_U2Q, EntityEvents_73p_Q2U,
-	EntityEvents_73p, EntityEvents_73p_U2Q, EntityEvents_73p_Q2U,
-	EntityEvents_73p, EntityEvents_73p_U2Q, EntityEvents_73p_Q2U
+	EntityEvents_3, EntityEvents_3_U2Q,
+	EntityEvents_48_68, EntityEvents_48_68_U2Q,
+	EntityEvents_48_68, EntityEvents_48_68_U2Q,
+	EntityEvents_48_68, EntityEvents_48_68_U2Q,
+	EntityEvents_48_68, EntityEvents_48_68_U2Q,
+	EntityEvents_73p, EntityEvents_73p_U2Q,
+	EntityEvents_73p, EntityEvents_73p_U2Q,
+	EntityEvents_73p, EntityEvents_73p_U2Q
 };
 
 static s16 ConfigStringIndices_3_U2Q[udtConfigStringIndex::Count];
-static s16 ConfigStringIndices_3_Q2U[udtConfigStringIndex::Count * 2];
 static const s16 ConfigStringIndices_3[udtConfigStringIndex::Count * 2] =
 {
 	(s16)udtConfigStringIndex::FirstPlayer, 544,
@@ -456,7 +439,6 @@ static const s16 ConfigStringIndices_3[udtConfigStringIndex::Count * 2] =
 };
 
 static s16 ConfigStringIndices_48_68_U2Q[udtConfigStringIndex::Count];
-static s16 ConfigStringIndices_48_68_Q2U[udtConfigStringIndex::Count * 2];
 static const s16 ConfigStringIndices_48_68[udtConfigStringIndex::Count * 2] =
 {
 	(s16)udtConfigStringIndex::FirstPlayer, 544,
@@ -496,7 +478,6 @@ static const s16 ConfigStringIndices_48_68[udtConfigStringIndex::Count * 2] =
 };
 
 static s16 ConfigStringIndices_73_90_U2Q[udtConfigStringIndex::Count];
-static s16 ConfigStringIndices_73_90_Q2U[udtConfigStringIndex::Count * 2];
 static const s16 ConfigStringIndices_73_90[udtConfigStringIndex::Count * 2] =
 {
 	(s16)udtConfigStringIndex::FirstPlayer, 529,
@@ -536,7 +517,6 @@ static const s16 ConfigStringIndices_73_90[udtConfigStringIndex::Count * 2] =
 };
 
 static s16 ConfigStringIndices_91_U2Q[udtConfigStringIndex::Count];
-static s16 ConfigStringIndices_91_Q2U[udtConfigStringIndex::Count * 2];
 static const s16 ConfigStringIndices_91[udtConfigStringIndex::Count * 2] =
 {
 	(s16)udtConfigStringIndex::FirstPlayer, 529,
@@ -575,20 +555,19 @@ static const s16 ConfigStringIndices_91[udtConfigStringIndex::Count * 2] =
 	(s16)udtConfigStringIndex::OSP_GamePlay, UNDEFINED
 };
 
-static const s16* ConfigStringIndexTables[udtProtocol::Count * 3] =
+static const s16* ConfigStringIndexTables[udtProtocol::Count * 2] =
 {
-	ConfigStringIndices_3, ConfigStringIndices_3_U2Q, ConfigStringIndices_3_Q2U,
-	ConfigStringIndices_48_68, ConfigStringIndices_48_68_U2Q, ConfigStringIndices_48_68_Q2U,
-	ConfigStringIndices_48_68, ConfigStringIndices_48_68_U2Q, ConfigStringIndices_48_68_Q2U,
-	ConfigStringIndices_48_68, ConfigStringIndices_48_68_U2Q, ConfigStringIndices_48_68_Q2U,
-	ConfigStringIndices_48_68, ConfigStringIndices_48_68_U2Q, ConfigStringIndices_48_68_Q2U,
-	ConfigStringIndices_73_90, ConfigStringIndices_73_90_U2Q, ConfigStringIndices_73_90_Q2U,
-	ConfigStringIndices_73_90, ConfigStringIndices_73_90_U2Q, ConfigStringIndices_73_90_Q2U,
-	ConfigStringIndices_91, ConfigStringIndices_91_U2Q, ConfigStringIndices_91_Q2U
+	ConfigStringIndices_3, ConfigStringIndices_3_U2Q,
+	ConfigStringIndices_48_68, ConfigStringIndices_48_68_U2Q,
+	ConfigStringIndices_48_68, ConfigStringIndices_48_68_U2Q,
+	ConfigStringIndices_48_68, ConfigStringIndices_48_68_U2Q,
+	ConfigStringIndices_48_68, ConfigStringIndices_48_68_U2Q,
+	ConfigStringIndices_73_90, ConfigStringIndices_73_90_U2Q,
+	ConfigStringIndices_73_90, ConfigStringIndices_73_90_U2Q,
+	ConfigStringIndices_91, ConfigStringIndices_91_U2Q
 };
 
 static s16 Teams_U2Q[udtTeam::Count];
-static s16 Teams_Q2U[udtTeam::Count * 2];
 static const s16 Teams[udtTeam::Count * 2] =
 {
 	(s16)udtTeam::Free, 0,
@@ -597,20 +576,19 @@ static const s16 Teams[udtTeam::Count * 2] =
 	(s16)udtTeam::Spectators, 3
 };
 
-static const s16* TeamTables[udtProtocol::Count * 3] =
+static const s16* TeamTables[udtProtocol::Count * 2] =
 {
-	Teams, Teams_U2Q, Teams_Q2U,
-	Teams, Teams_U2Q, Teams_Q2U,
-	Teams, Teams_U2Q, Teams_Q2U,
-	Teams, Teams_U2Q, Teams_Q2U,
-	Teams, Teams_U2Q, Teams_Q2U,
-	Teams, Teams_U2Q, Teams_Q2U,
-	Teams, Teams_U2Q, Teams_Q2U,
-	Teams, Teams_U2Q, Teams_Q2U
+	Teams, Teams_U2Q,
+	Teams, Teams_U2Q,
+	Teams, Teams_U2Q,
+	Teams, Teams_U2Q,
+	Teams, Teams_U2Q,
+	Teams, Teams_U2Q,
+	Teams, Teams_U2Q,
+	Teams, Teams_U2Q
 };
 
 static s16 GameTypes_3_U2Q[udtGameType::Count];
-static s16 GameTypes_3_Q2U[udtGameType::Count * 2];
 static const s16 GameTypes_3[udtGameType::Count * 2] =
 {
 	(s16)udtGameType::SP, UNDEFINED,
@@ -634,7 +612,6 @@ static const s16 GameTypes_3[udtGameType::Count * 2] =
 };
 
 static s16 GameTypes_48_68_U2Q[udtGameType::Count];
-static s16 GameTypes_48_68_Q2U[udtGameType::Count * 2];
 static const s16 GameTypes_48_68[udtGameType::Count * 2] =
 {
 	(s16)udtGameType::SP, UNDEFINED,
@@ -658,7 +635,6 @@ static const s16 GameTypes_48_68[udtGameType::Count * 2] =
 };
 
 static s16 GameTypes_73p_U2Q[udtGameType::Count];
-static s16 GameTypes_73p_Q2U[udtGameType::Count * 2];
 static const s16 GameTypes_73p[udtGameType::Count * 2] =
 {
 	(s16)udtGameType::SP, UNDEFINED,
@@ -681,20 +657,19 @@ static const s16 GameTypes_73p[udtGameType::Count * 2] =
 	(s16)udtGameType::FT, 9
 };
 
-static const s16* GameTypeTables[udtProtocol::Count * 3] =
+static const s16* GameTypeTables[udtProtocol::Count * 2] =
 {
-	GameTypes_3, GameTypes_3_U2Q, GameTypes_3_Q2U,
-	GameTypes_48_68, GameTypes_48_68_U2Q, GameTypes_48_68_Q2U,
-	GameTypes_48_68, GameTypes_48_68_U2Q, GameTypes_48_68_Q2U,
-	GameTypes_48_68, GameTypes_48_68_U2Q, GameTypes_48_68_Q2U,
-	GameTypes_48_68, GameTypes_48_68_U2Q, GameTypes_48_68_Q2U,
-	GameTypes_73p, GameTypes_73p_U2Q, GameTypes_73p_Q2U,
-	GameTypes_73p, GameTypes_73p_U2Q, GameTypes_73p_Q2U,
-	GameTypes_73p, GameTypes_73p_U2Q, GameTypes_73p_Q2U
+	GameTypes_3, GameTypes_3_U2Q,
+	GameTypes_48_68, GameTypes_48_68_U2Q,
+	GameTypes_48_68, GameTypes_48_68_U2Q,
+	GameTypes_48_68, GameTypes_48_68_U2Q,
+	GameTypes_48_68, GameTypes_48_68_U2Q,
+	GameTypes_73p, GameTypes_73p_U2Q,
+	GameTypes_73p, GameTypes_73p_U2Q,
+	GameTypes_73p, GameTypes_73p_U2Q
 };
 
 static s16 FlagStatus_U2Q[udtFlagStatus::Count];
-static s16 FlagStatus_Q2U[udtFlagStatus::Count * 2];
 static const s16 FlagStatus[udtFlagStatus::Count * 2] =
 {
 	(s16)udtFlagStatus::InBase, 0,
@@ -702,20 +677,19 @@ static const s16 FlagStatus[udtFlagStatus::Count * 2] =
 	(s16)udtFlagStatus::Missing, 2
 };
 
-static const s16* FlagStatusTables[udtProtocol::Count * 3] =
+static const s16* FlagStatusTables[udtProtocol::Count * 2] =
 {
-	FlagStatus, FlagStatus_U2Q, FlagStatus_Q2U,
-	FlagStatus, FlagStatus_U2Q, FlagStatus_Q2U,
-	FlagStatus, FlagStatus_U2Q, FlagStatus_Q2U,
-	FlagStatus, FlagStatus_U2Q, FlagStatus_Q2U,
-	FlagStatus, FlagStatus_U2Q, FlagStatus_Q2U,
-	FlagStatus, FlagStatus_U2Q, FlagStatus_Q2U,
-	FlagStatus, FlagStatus_U2Q, FlagStatus_Q2U,
-	FlagStatus, FlagStatus_U2Q, FlagStatus_Q2U
+	FlagStatus, FlagStatus_U2Q,
+	FlagStatus, FlagStatus_U2Q,
+	FlagStatus, FlagStatus_U2Q,
+	FlagStatus, FlagStatus_U2Q,
+	FlagStatus, FlagStatus_U2Q,
+	FlagStatus, FlagStatus_U2Q,
+	FlagStatus, FlagStatus_U2Q,
+	FlagStatus, FlagStatus_U2Q
 };
 
 static s16 Weapons_3_68_U2Q[udtWeapon::Count];
-static s16 Weapons_3_68_Q2U[udtWeapon::Count * 2];
 static const s16 Weapons_3_68[udtWeapon::Count * 2] =
 {
 	(s16)udtWeapon::Gauntlet, 1,
@@ -735,7 +709,6 @@ static const s16 Weapons_3_68[udtWeapon::Count * 2] =
 };
 
 static s16 Weapons_73p_U2Q[udtWeapon::Count];
-static s16 Weapons_73p_Q2U[udtWeapon::Count * 2];
 static const s16 Weapons_73p[udtWeapon::Count * 2] =
 {
 	(s16)udtWeapon::Gauntlet, 1,
@@ -754,20 +727,19 @@ static const s16 Weapons_73p[udtWeapon::Count * 2] =
 	(s16)udtWeapon::GrapplingHook, 10
 };
 
-static const s16* WeaponTables[udtProtocol::Count * 3] =
+static const s16* WeaponTables[udtProtocol::Count * 2] =
 {
-	Weapons_3_68, Weapons_3_68_U2Q, Weapons_3_68_Q2U,
-	Weapons_3_68, Weapons_3_68_U2Q, Weapons_3_68_Q2U,
-	Weapons_3_68, Weapons_3_68_U2Q, Weapons_3_68_Q2U,
-	Weapons_3_68, Weapons_3_68_U2Q, Weapons_3_68_Q2U,
-	Weapons_3_68, Weapons_3_68_U2Q, Weapons_3_68_Q2U,
-	Weapons_73p, Weapons_73p_U2Q, Weapons_73p_Q2U,
-	Weapons_73p, Weapons_73p_U2Q, Weapons_73p_Q2U,
-	Weapons_73p, Weapons_73p_U2Q, Weapons_73p_Q2U
+	Weapons_3_68, Weapons_3_68_U2Q,
+	Weapons_3_68, Weapons_3_68_U2Q,
+	Weapons_3_68, Weapons_3_68_U2Q,
+	Weapons_3_68, Weapons_3_68_U2Q,
+	Weapons_3_68, Weapons_3_68_U2Q,
+	Weapons_73p, Weapons_73p_U2Q,
+	Weapons_73p, Weapons_73p_U2Q,
+	Weapons_73p, Weapons_73p_U2Q
 };
 
 static s16 MeansOfDeath_3_68_U2Q[udtMeanOfDeath::Count];
-static s16 MeansOfDeath_3_68_Q2U[udtMeanOfDeath::Count * 2];
 static const s16 MeansOfDeath_3_68[udtMeanOfDeath::Count * 2] =
 {
 	(s16)udtMeanOfDeath::Shotgun, 1,
@@ -804,7 +776,6 @@ static const s16 MeansOfDeath_3_68[udtMeanOfDeath::Count * 2] =
 };
 
 static s16 MeansOfDeath_73p_U2Q[udtMeanOfDeath::Count];
-static s16 MeansOfDeath_73p_Q2U[udtMeanOfDeath::Count * 2];
 static const s16 MeansOfDeath_73p[udtMeanOfDeath::Count * 2] =
 {
 	(s16)udtMeanOfDeath::Shotgun, 1,
@@ -840,20 +811,19 @@ static const s16 MeansOfDeath_73p[udtMeanOfDeath::Count * 2] =
 	(s16)udtMeanOfDeath::HeavyMachineGun, 32
 };
 
-static const s16* MeanOfDeathTables[udtProtocol::Count * 3] =
+static const s16* MeanOfDeathTables[udtProtocol::Count * 2] =
 {
-	MeansOfDeath_3_68, MeansOfDeath_3_68_U2Q, MeansOfDeath_3_68_Q2U,
-	MeansOfDeath_3_68, MeansOfDeath_3_68_U2Q, MeansOfDeath_3_68_Q2U,
-	MeansOfDeath_3_68, MeansOfDeath_3_68_U2Q, MeansOfDeath_3_68_Q2U,
-	MeansOfDeath_3_68, MeansOfDeath_3_68_U2Q, MeansOfDeath_3_68_Q2U,
-	MeansOfDeath_3_68, MeansOfDeath_3_68_U2Q, MeansOfDeath_3_68_Q2U,
-	MeansOfDeath_73p, MeansOfDeath_73p_U2Q, MeansOfDeath_73p_Q2U,
-	MeansOfDeath_73p, MeansOfDeath_73p_U2Q, MeansOfDeath_73p_Q2U,
-	MeansOfDeath_73p, MeansOfDeath_73p_U2Q, MeansOfDeath_73p_Q2U
+	MeansOfDeath_3_68, MeansOfDeath_3_68_U2Q,
+	MeansOfDeath_3_68, MeansOfDeath_3_68_U2Q,
+	MeansOfDeath_3_68, MeansOfDeath_3_68_U2Q,
+	MeansOfDeath_3_68, MeansOfDeath_3_68_U2Q,
+	MeansOfDeath_3_68, MeansOfDeath_3_68_U2Q,
+	MeansOfDeath_73p, MeansOfDeath_73p_U2Q,
+	MeansOfDeath_73p, MeansOfDeath_73p_U2Q,
+	MeansOfDeath_73p, MeansOfDeath_73p_U2Q
 };
 
 static s16 Items_3_68_U2Q[udtItem::Count];
-static s16 Items_3_68_Q2U[udtItem::Count * 2];
 static const s16 Items_3_68[udtItem::Count * 2] =
 {
 	(s16)udtItem::AmmoBFG, 25,
@@ -919,7 +889,6 @@ static const s16 Items_3_68[udtItem::Count * 2] =
 };
 
 static s16 Items_73_U2Q[udtItem::Count];
-static s16 Items_73_Q2U[udtItem::Count * 2];
 static const s16 Items_73[udtItem::Count * 2] =
 {
 	(s16)udtItem::AmmoBFG, 26,
@@ -985,7 +954,6 @@ static const s16 Items_73[udtItem::Count * 2] =
 };
 
 static s16 Items_90p_U2Q[udtItem::Count];
-static s16 Items_90p_Q2U[udtItem::Count * 2];
 static const s16 Items_90p[udtItem::Count * 2] =
 {
 	(s16)udtItem::AmmoBFG, 26,
@@ -1050,20 +1018,19 @@ static const s16 Items_90p[udtItem::Count * 2] =
 	(s16)udtItem::WeaponShotgun, 10
 };
 
-static const s16* ItemTables[udtProtocol::Count * 3] =
+static const s16* ItemTables[udtProtocol::Count * 2] =
 {
-	Items_3_68, Items_3_68_U2Q, Items_3_68_Q2U,
-	Items_3_68, Items_3_68_U2Q, Items_3_68_Q2U,
-	Items_3_68, Items_3_68_U2Q, Items_3_68_Q2U,
-	Items_3_68, Items_3_68_U2Q, Items_3_68_Q2U,
-	Items_3_68, Items_3_68_U2Q, Items_3_68_Q2U,
-	Items_73, Items_73_U2Q, Items_73_Q2U,
-	Items_90p, Items_90p_U2Q, Items_90p_Q2U,
-	Items_90p, Items_90p_U2Q, Items_90p_Q2U
+	Items_3_68, Items_3_68_U2Q,
+	Items_3_68, Items_3_68_U2Q,
+	Items_3_68, Items_3_68_U2Q,
+	Items_3_68, Items_3_68_U2Q,
+	Items_3_68, Items_3_68_U2Q,
+	Items_73, Items_73_U2Q,
+	Items_90p, Items_90p_U2Q,
+	Items_90p, Items_90p_U2Q
 };
 
 static s16 PMTypes_U2Q[udtPlayerMovementType::Count];
-static s16 PMTypes_Q2U[udtPlayerMovementType::Count * 2];
 static const s16 PMTypes[udtPlayerMovementType::Count * 2] =
 {
 	(s16)udtPlayerMovementType::Normal, 0,
@@ -1075,16 +1042,16 @@ static const s16 PMTypes[udtPlayerMovementType::Count * 2] =
 	(s16)udtPlayerMovementType::SPIntermission, 6
 };
 
-static const s16* PMTypeTables[udtProtocol::Count * 3] =
+static const s16* PMTypeTables[udtProtocol::Count * 2] =
 {
-	PMTypes, PMTypes_U2Q, PMTypes_Q2U,
-	PMTypes, PMTypes_U2Q, PMTypes_Q2U,
-	PMTypes, PMTypes_U2Q, PMTypes_Q2U,
-	PMTypes, PMTypes_U2Q, PMTypes_Q2U,
-	PMTypes, PMTypes_U2Q, PMTypes_Q2U,
-	PMTypes, PMTypes_U2Q, PMTypes_Q2U,
-	PMTypes, PMTypes_U2Q, PMTypes_Q2U,
-	PMTypes, PMTypes_U2Q, PMTypes_Q2U
+	PMTypes, PMTypes_U2Q,
+	PMTypes, PMTypes_U2Q,
+	PMTypes, PMTypes_U2Q,
+	PMTypes, PMTypes_U2Q,
+	PMTypes, PMTypes_U2Q,
+	PMTypes, PMTypes_U2Q,
+	PMTypes, PMTypes_U2Q,
+	PMTypes, PMTypes_U2Q
 };
 
 struct MagicNumberTableGroup
@@ -1120,41 +1087,10 @@ static const MagicNumberTableGroup MagicNumberTables[udtMagicNumberType::Count]
 };
 
 
-static int SortCallback(const void* a, const void* b)
-{
-	return *((const s16*)a + 1) - *((const s16*)b + 1);
-}
+udtMagicNumberMap MagicNumberMaps[udtMagicNumberType::Count][udtProtocol::Count][2];
+static s16 MagicNumberMapData[UDT_MAGIC_NUMBER_MAP_DATA_COUNT]; // The tables that aren't built in place.
+static u32 MagicNumberMapDataCount = 0;
 
-void BuildLookUpTables()
-{
-	for(u32 mnt = 0; mnt < (u32)udtMagicNumberType::Count; ++mnt)
-	{
-		const MagicNumberTableGroup& tableGroup = MagicNumberTables[mnt];
-		s16* prevTable_U2Q = NULL;
-		s16* prevTable_Q2U = NULL;
-		for(u32 p = 0; p < (u32)udtProtocol::Count; ++p)
-		{
-			const s16* const table = tableGroup.Tables[3 * p + 0];
-			s16* const table_U2Q = (s16*)tableGroup.Tables[3 * p + 1];
-			s16* const table_Q2U = (s16*)tableGroup.Tables[3 * p + 2];
-			if(table_U2Q != prevTable_U2Q)
-			{
-				for(u32 i = 0; i < tableGroup.Count; ++i)
-				{
-					const s16 newIdx = table[2 * i + 0];
-					table_U2Q[newIdx] = table[2 * i + 1];
-				}
-			}
-			if(table_Q2U != prevTable_Q2U)
-			{
-				memcpy(table_Q2U, table, (size_t)(tableGroup.Count * 2) * sizeof(s16));
-				qsort(table_Q2U, (size_t)tableGroup.Count, 2 * sizeof(s16), &SortCallback);
-			}
-			prevTable_U2Q = table_U2Q;
-			prevTable_Q2U = table_Q2U;
-		}
-	}
-}
 
 struct idGameType68_CPMA
 {
@@ -1175,25 +1111,6 @@ struct idGameType68_CPMA
 	};
 };
 
-static s32 GetUDTGameTypeCPMA(s32 gt)
-{
-	switch((idGameType68_CPMA::Id)gt)
-	{
-		case idGameType68_CPMA::HM: return (s32)udtGameType::HM;
-		case idGameType68_CPMA::FFA: return (s32)udtGameType::FFA;
-		case idGameType68_CPMA::Duel: return (s32)udtGameType::Duel;
-		case idGameType68_CPMA::SP: return (s32)udtGameType::SP;
-		case idGameType68_CPMA::TDM: return (s32)udtGameType::TDM;
-		case idGameType68_CPMA::CTF: return (s32)udtGameType::CTF;
-		case idGameType68_CPMA::CA: return (s32)udtGameType::CA;
-		case idGameType68_CPMA::FT: return (s32)udtGameType::FT;
-		case idGameType68_CPMA::CTFS: return (s32)udtGameType::CTFS;
-		case idGameType68_CPMA::NTF: return (s32)udtGameType::NTF;
-		case idGameType68_CPMA::TwoVsTwo: return (s32)udtGameType::TwoVsTwo;
-		default: return UDT_S32_MIN;
-	}
-}
-
 static s32 GetIdGameTypeCPMA(s32 gt)
 {
 	switch((udtGameType::Id)gt)
@@ -1234,142 +1151,135 @@ static s32 GetIdExtraItemCPMA(s32 item)
 	}
 }
 
-static s32 GetUDTExtraItemCPMA(s32 item)
-{
-	switch((idItem68_CPMA::Id)item)
-	{
-		case idItem68_CPMA::ItemArmorJacket: return (s32)udtItem::ItemArmorJacket;
-		case idItem68_CPMA::ItemBackpack: return (s32)udtItem::ItemBackpack;
-		case idItem68_CPMA::TeamCTFNeutralflag: return (s32)udtItem::FlagNeutral;
-		default: return UDT_S32_MIN;
-	}
-}
-
-bool GetIdNumber(s32& idNumber, udtMagicNumberType::Id numberType, u32 udtNumber, udtProtocol::Id protocol, udtMod::Id mod)
+static s16* AllocateMapData(u32 count)
 {
-	if((u32)numberType >= (u32)udtMagicNumberType::Count ||
-	   (u32)protocol >= (u32)udtProtocol::Count)
-	{
-		return false;
-	}
+	UDT_ASSERT_OR_FATAL_MSG(MagicNumberMapDataCount + count <= (u32)UDT_MAGIC_NUMBER_MAP_DATA_COUNT, "The magic number map data buffer is too small.");
 
-	if(numberType == udtMagicNumberType::GameType &&
-	   protocol <= udtProtocol::Dm68 &&
-	   mod == udtMod::CPMA)
+	s16* const data = MagicNumberMapData + MagicNumberMapDataCount;
+	MagicNumberMapDataCount += count;
+	for(u32 i = 0; i < count; ++i)
 	{
-		const s32 result = GetIdGameTypeCPMA((s32)udtNumber);
-		const bool success = result != UDT_S32_MIN;
-		if(success) idNumber = result;
-		return success;
+		data[i] = UNDEFINED;
 	}
 
-	if(numberType == udtMagicNumberType::Item &&
-	   protocol <= udtProtocol::Dm68 &&
-	   mod == udtMod::CPMA)
-	{
-		const s32 result = GetIdExtraItemCPMA((s32)udtNumber);
-		if(result != UDT_S32_MIN)
-		{
-			idNumber = result;
-			return true;
-		}
-	}
+	return data;
+}
 
-	const MagicNumberTableGroup* tableGroup = NULL;
-	for(u32 i = 0; i < (u32)udtMagicNumberType::Count; ++i)
+static void BuildIdToUDTTable(udtMagicNumberMap& map)
+{
+	s32 minIdNumber = UDT_S32_MAX;
+	s32 maxIdNumber = UDT_S32_MIN;
+	for(u32 i = 0; i < map.UDTNumberCount; ++i)
 	{
-		if(MagicNumberTables[i].Type == numberType)
+		const s32 idNumber = (s32)map.UDTToId[i];
+		if(idNumber != UNDEFINED)
 		{
-			tableGroup = &MagicNumberTables[i];
-			break;
+			minIdNumber = udt_min(minIdNumber, idNumber);
+			maxIdNumber = udt_max(maxIdNumber, idNumber);
 		}
 	}
 
-	if(tableGroup == NULL || udtNumber >= tableGroup->Count)
+	if(minIdNumber > maxIdNumber)
 	{
-		return false;
+		map.IdToUDT = NULL;
+		map.MinIdNumber = 0;
+		map.IdNumberCount = 0;
+		return;
 	}
 
-	const s16 result = tableGroup->Tables[(u32)protocol * 3 + 1][udtNumber];
-	if(result == UNDEFINED)
+	const u32 idNumberCount = (u32)(maxIdNumber - minIdNumber + 1);
+	s16* const idToUDT = AllocateMapData(idNumberCount);
+	for(u32 i = 0; i < map.UDTNumberCount; ++i)
 	{
-		return false;
+		const s32 idNumber = (s32)map.UDTToId[i];
+		const u32 index = (u32)(idNumber - minIdNumber);
+		if(idNumber != UNDEFINED && idToUDT[index] == UNDEFINED)
+		{
+			idToUDT[index] = (s16)i;
+		}
 	}
 
-	idNumber = (s32)result;
-
-	return true;
-}
-
-static int BinarySearchCallback(const void* a, const void* b)
-{
-	return *(const s16*)a - *(const s16*)b;
+	map.IdToUDT = idToUDT;
+	map.MinIdNumber = minIdNumber;
+	map.IdNumberCount = idNumberCount;
 }
 
-bool GetUDTNumber(u32& udtNumber, udtMagicNumberType::Id numberType, s32 idNumber, udtProtocol::Id protocol, udtMod::Id mod)
+static void BuildMagicNumberMaps()
 {
-	if((u32)numberType >= (u32)udtMagicNumberType::Count ||
-	   (u32)protocol >= (u32)udtProtocol::Count)
+	MagicNumberMapDataCount = 0;
+	for(u32 mnt = 0; mnt < (u32)udtMagicNumberType::Count; ++mnt)
 	{
-		return false;
-	}
+		const MagicNumberTableGroup& tableGroup = MagicNumberTables[mnt];
+		const u32 type = (u32)tableGroup.Type;
+		for(u32 p = 0; p < (u32)udtProtocol::Count; ++p)
+		{
+			udtMagicNumberMap& map = MagicNumberMaps[type][p][0];
+			const s16* const table_U2Q = tableGroup.Tables[2 * p + 1];
+			if(p > 0 && table_U2Q == tableGroup.Tables[2 * (p - 1) + 1])
+			{
+				// Same numbers as the previous protocol.
+				map = MagicNumberMaps[type][p - 1][0];
+			}
+			else
+			{
+				map.UDTToId = table_U2Q;
+				map.UDTNumberCount = tableGroup.Count;
+				BuildIdToUDTTable(map);
+			}
 
-	if(numberType == udtMagicNumberType::GameType && 
-	   protocol <= udtProtocol::Dm68 && 
-	   mod == udtMod::CPMA)
-	{
-		const s32 result = GetUDTGameTypeCPMA(idNumber);
-		const bool success = result != UDT_S32_MIN;
-		if(success) udtNumber = (u32)result;
-		return success;
-	}
+			udtMagicNumberMap& cpmaMap = MagicNumberMaps[type][p][1];
+			cpmaMap = map;
+			if(p > (u32)udtProtocol::Dm68 ||
+			   (tableGroup.Type != udtMagicNumberType::GameType && tableGroup.Type != udtMagicNumberType::Item))
+			{
+				continue;
+			}
 
-	if(numberType == udtMagicNumberType::Item && 
-	   protocol <= udtProtocol::Dm68 &&
-	   mod == udtMod::CPMA)
-	{
-		const s32 result = GetUDTExtraItemCPMA(idNumber);
-		if(result != UDT_S32_MIN)
-		{
-			udtNumber = (u32)result;
-			return true;
+			// CPMA has its own game type numbers and extra items.
+			s16* const cpmaTable_U2Q = AllocateMapData(tableGroup.Count);
+			for(u32 i = 0; i < tableGroup.Count; ++i)
+			{
+				const s32 idNumber = tableGroup.Type == udtMagicNumberType::GameType ? GetIdGameTypeCPMA((s32)i) : GetIdExtraItemCPMA((s32)i);
+				if(idNumber != UDT_S32_MIN)
+				{
+					cpmaTable_U2Q[i] = (s16)idNumber;
+				}
+				else if(tableGroup.Type == udtMagicNumberType::Item)
+				{
+					cpmaTable_U2Q[i] = table_U2Q[i];
+				}
+			}
+			cpmaMap.UDTToId = cpmaTable_U2Q;
+			BuildIdToUDTTable(cpmaMap);
 		}
 	}
+}
 
-	const MagicNumberTableGroup* tableGroup = NULL;
-	for(u32 i = 0; i < (u32)udtMagicNumberType::Count; ++i)
+void BuildLookUpTables()
+{
+	for(u32 mnt = 0; mnt < (u32)udtMagicNumberType::Count; ++mnt)
 	{
-		if(MagicNumberTables[i].Type == numberType)
+		const MagicNumberTableGroup& tableGroup = MagicNumberTables[mnt];
+		s16* prevTable_U2Q = NULL;
+		for(u32 p = 0; p < (u32)udtProtocol::Count; ++p)
 		{
-			tableGroup = &MagicNumberTables[i];
-			break;
+			const s16* const table = tableGroup.Tables[2 * p + 0];
+			s16* const table_U2Q = (s16*)tableGroup.Tables[2 * p + 1];
+			if(table_U2Q != prevTable_U2Q)
+			{
+				for(u32 i = 0; i < tableGroup.Count; ++i)
+				{
+					const s16 newIdx = table[2 * i + 0];
+					table_U2Q[newIdx] = table[2 * i + 1];
+				}
+			}
+			prevTable_U2Q = table_U2Q;
 		}
 	}
 
-	if(tableGroup == NULL)
-	{
-		return false;
-	}
-
-	const s16* const table = tableGroup->Tables[(u32)protocol * 3 + 2];
-	const void* const idNumberPtr = bsearch(&idNumber, table + 1, (size_t)tableGroup->Count, sizeof(s16) * 2, &BinarySearchCallback);
-	if(idNumberPtr == NULL)
-	{
-		return false;
-	}
-
-	udtNumber = (u32)*((const s16*)idNumberPtr - 1);
-
-	return true;
+	BuildMagicNumberMaps();
 }
 
-s32 GetIdNumber(udtMagicNumberType::Id numberType, u32 udtNumber, udtProtocol::Id protocol, udtMod::Id mod)
-{
-	s32 idNumber = UDT_S32_MIN;
-	GetIdNumber(idNumber, numberType, udtNumber, protocol, mod);
-
-	return idNumber;
-}
 
 s32 GetIdEntityStateFlagMask(udtEntityFlag::Id udtFlagId, udtProtocol::Id protocol)
 {
@@ -4,8 +4,84 @@
 #include "uberdemotools.h"
 
 
+// Direct-indexed translation tables for a single number type, protocol and mod.
+// Undefined entries are set to UDT_S16_MIN.
+struct udtMagicNumberMap
+{
+	const s16* UDTToId; // Indexed by the UDT number.
+	const s16* IdToUDT; // Indexed by the id number minus MinIdNumber.
+	s32 MinIdNumber;
+	u32 IdNumberCount;
+	u32 UDTNumberCount;
+};
+
+// The last index is 1 for CPMA and 0 for everything else, since no other mod has its own numbers.
+extern udtMagicNumberMap MagicNumberMaps[udtMagicNumberType::Count][udtProtocol::Count][2];
+
 extern void BuildLookUpTables();
-extern bool GetIdNumber(s32& idNumber, udtMagicNumberType::Id numberType, u32 udtNumber, udtProtocol::Id protocol, udtMod::Id mod = udtMod::None);
-extern bool GetUDTNumber(u32& udtNumber, udtMagicNumberType::Id numberType, s32 idNumber, udtProtocol::Id protocol, udtMod::Id mod = udtMod::None);
-extern s32 GetIdNumber(udtMagicNumberType::Id numberType, u32 udtNumber, udtProtocol::Id protocol, udtMod::Id mod = udtMod::None); // Returns S32_MIN when not available.
 extern s32 GetIdEntityStateFlagMask(udtEntityFlag::Id udtFlagId, udtProtocol::Id protocol);
+
+inline const udtMagicNumberMap& GetMagicNumberMap(udtMagicNumberType::Id numberType, udtProtocol::Id protocol, udtMod::Id mod)
+{
+	return MagicNumberMaps[numberType][protocol][mod == udtMod::CPMA ? 1 : 0];
+}
+
+inline bool GetIdNumber(s32& idNumber, udtMagicNumberType::Id numberType, u32 udtNumber, udtProtocol::Id protocol, udtMod::Id mod = udtMod::None)
+{
+	if((u32)numberType >= (u32)udtMagicNumberType::Count ||
+	   (u32)protocol >= (u32)udtProtocol::Count)
+	{
+		return false;
+	}
+
+	const udtMagicNumberMap& map = GetMagicNumberMap(numberType, protocol, mod);
+	if(udtNumber >= map.UDTNumberCount)
+	{
+		return false;
+	}
+
+	const s16 result = map.UDTToId[udtNumber];
+	if(result == UDT_S16_MIN)
+	{
+		return false;
+	}
+
+	idNumber = (s32)result;
+
+	return true;
+}
+
+inline bool GetUDTNumber(u32& udtNumber, udtMagicNumberType::Id numberType, s32 idNumber, udtProtocol::Id protocol, udtMod::Id mod = udtMod::None)
+{
+	if((u32)numberType >= (u32)udtMagicNumberType::Count ||
+	   (u32)protocol >= (u32)udtProtocol::Count)
+	{
+		return false;
+	}
+
+	const udtMagicNumberMap& map = GetMagicNumberMap(numberType, protocol, mod);
+	const u32 index = (u32)idNumber - (u32)map.MinIdNumber;
+	if(index >= map.IdNumberCount)
+	{
+		return false;
+	}
+
+	const s16 result = map.IdToUDT[index];
+	if(result == UDT_S16_MIN)
+	{
+		return false;
+	}
+
+	udtNumber = (u32)result;
+
+	return true;
+}
+
+// Returns S32_MIN when not available.
+inline s32 GetIdNumber(udtMagicNumberType::Id numberType, u32 udtNumber, udtProtocol::Id protocol, udtMod::Id mod = udtMod::None)
+{
+	s32 idNumber = UDT_S32_MIN;
+	GetIdNumber(idNumber, numberType, udtNumber, protocol, mod);
+
+	return idNumber;
+}
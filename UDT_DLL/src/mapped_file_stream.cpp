@@ -0,0 +1,218 @@
+#include "mapped_file_stream.hpp"
+#include "utils.hpp"
+
+
+#if defined(UDT_WINDOWS)
+
+
+#include "string.hpp"
+#include "scoped_stack_allocator.hpp"
+#include "thread_local_allocators.hpp"
+
+#include <Windows.h>
+
+
+bool udtMappedFileStream::Open(const char* filePath, u32 offset)
+{
+	Close();
+
+	udtVMLinearAllocator& allocator = udtThreadLocalAllocators::GetTempAllocator();
+	udtVMScopedStackAllocator allocatorScope(allocator);
+	wchar_t* const wideFilePath = udtString::ConvertToUTF16(allocator, udtString::NewConstRef(filePath));
+	const HANDLE file = CreateFileW(wideFilePath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if(file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER size;
+	if(GetFileSizeEx(file, &size) == FALSE ||
+	   size.QuadPart == 0 ||
+	   size.QuadPart > (LONGLONG)UDT_S32_MAX ||
+	   (LONGLONG)offset > size.QuadPart)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	const HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if(mapping == NULL)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	const void* const data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if(data == NULL)
+	{
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	_data = (const u8*)data;
+	_fileHandle = (void*)file;
+	_mapHandle = (void*)mapping;
+	_byteCount = (u32)size.QuadPart;
+	_offset = offset;
+
+	return true;
+}
+
+s32 udtMappedFileStream::Close()
+{
+	if(_data != NULL)
+	{
+		UnmapViewOfFile((LPCVOID)_data);
+		_data = NULL;
+	}
+
+	if(_mapHandle != NULL)
+	{
+		CloseHandle((HANDLE)_mapHandle);
+		_mapHandle = NULL;
+	}
+
+	if(_fileHandle != NULL)
+	{
+		CloseHandle((HANDLE)_fileHandle);
+		_fileHandle = NULL;
+	}
+
+	_byteCount = 0;
+	_offset = 0;
+
+	return 0;
+}
+
+
+#else
+
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+bool udtMappedFileStream::Open(const char* filePath, u32 offset)
+{
+	Close();
+
+	const int file = open(filePath, O_RDONLY | O_CLOEXEC);
+	if(file == -1)
+	{
+		return false;
+	}
+
+	struct stat fileStat;
+	if(fstat(file, &fileStat) != 0 ||
+	   fileStat.st_size == 0 ||
+	   fileStat.st_size > (off_t)UDT_S32_MAX ||
+	   (off_t)offset > fileStat.st_size)
+	{
+		close(file);
+		return false;
+	}
+
+	// The mapping keeps its own reference to the file, we don't need the descriptor anymore.
+	void* const data = mmap(NULL, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);
+	if(data == MAP_FAILED)
+	{
+		return false;
+	}
+
+	madvise(data, (size_t)fileStat.st_size, MADV_SEQUENTIAL);
+
+	_data = (const u8*)data;
+	_byteCount = (u32)fileStat.st_size;
+	_offset = offset;
+
+	return true;
+}
+
+s32 udtMappedFileStream::Close()
+{
+	if(_data != NULL)
+	{
+		munmap((void*)_data, (size_t)_byteCount);
+		_data = NULL;
+	}
+
+	_byteCount = 0;
+	_offset = 0;
+
+	return 0;
+}
+
+
+#endif
+
+
+udtMappedFileStream::udtMappedFileStream()
+{
+	_data = NULL;
+	_fileHandle = NULL;
+	_mapHandle = NULL;
+	_byteCount = 0;
+	_offset = 0;
+}
+
+udtMappedFileStream::~udtMappedFileStream()
+{
+	Close();
+}
+
+u32 udtMappedFileStream::Read(void* dstBuff, u32 elementSize, u32 count)
+{
+	const u32 byteCount = elementSize * count;
+	if(_offset + byteCount > _byteCount)
+	{
+		return 0;
+	}
+
+	memcpy(dstBuff, _data + _offset, (size_t)byteCount);
+	_offset += byteCount;
+
+	return count;
+}
+
+u32 udtMappedFileStream::Write(const void* /*srcBuff*/, u32 /*elementSize*/, u32 /*count*/)
+{
+	return 0;
+}
+
+s32 udtMappedFileStream::Seek(s32 offset, udtSeekOrigin::Id origin)
+{
+	switch(origin)
+	{
+		case udtSeekOrigin::Start: return SetOffsetIfValid(offset);
+		case udtSeekOrigin::Current: return SetOffsetIfValid((s32)_offset + offset);
+		case udtSeekOrigin::End: return SetOffsetIfValid((s32)_byteCount - offset);
+		default: return -1;
+	}
+}
+
+s32 udtMappedFileStream::Offset()
+{
+	return (s32)_offset;
+}
+
+u64 udtMappedFileStream::Length()
+{
+	return (u64)_byteCount;
+}
+
+s32 udtMappedFileStream::SetOffsetIfValid(s32 newOffset)
+{
+	// Seeking to the very end is valid: that's where the parser runner ends up after the last message.
+	if(newOffset < 0 || newOffset > (s32)_byteCount)
+	{
+		return -1;
+	}
+
+	_offset = (u32)newOffset;
+
+	return 0;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+
+#include "stream.hpp"
+
+
+// Maps an entire file in memory for read-only access.
+// Reads through the udtStream interface are still possible but the main point is to let 
+// the parser runner decode messages directly from the mapped pages without copying them.
+// Like udtReadOnlySequentialFileStream, it's intended to be created once and used for multiple files.
+struct udtMappedFileStream : udtStream
+{
+public:
+	udtMappedFileStream();
+	~udtMappedFileStream();
+
+	bool Open(const char* filePath, u32 offset = 0);
+
+	u32  Read(void* dstBuff, u32 elementSize, u32 count) override;
+	u32  Write(const void* srcBuff, u32 elementSize, u32 count) override;
+	s32  Seek(s32 offset, udtSeekOrigin::Id origin) override;
+	s32  Offset() override;
+	u64  Length() override;
+	s32  Close() override;
+	const u8* GetMappedBuffer() override { return _data; }
+
+private:
+	UDT_NO_COPY_SEMANTICS(udtMappedFileStream);
+
+	s32  SetOffsetIfValid(s32 newOffset);
+
+	const u8* _data;   // If invalid: NULL.
+	void* _fileHandle; // Only used on Windows. If invalid: NULL.
+	void* _mapHandle;  // Only used on Windows. If invalid: NULL.
+	u32 _byteCount;
+	u32 _offset;
+};
@@ -153,6 +153,54 @@ static const u16 HuffmanEncoderTable[256] =
 	7546, 3850, 11354, 12298, 15642, 14986, 8666, 20491, 90, 13706, 12186, 6794, 11162, 10458, 759, 582
 };
 
+// Decodes up to 2 symbols per look-up, built from HuffmanDecoderTable by BuildHuffmanDecoderTables.
+// The index is the next 12 bits of input.
+// Bits  0- 7: first symbol
+// Bits  8-15: second symbol
+// Bits 16-19: bit count of the first symbol
+// Bits 20-24: bit count of both symbols, 0 if the second one doesn't fit in the index
+#define HUFFMAN_PAIR_INDEX_BITS 12
+static u32 HuffmanPairDecoderTable[1 << HUFFMAN_PAIR_INDEX_BITS];
+
+void BuildHuffmanDecoderTables()
+{
+	for(u32 i = 0; i < (u32)UDT_COUNT_OF(HuffmanPairDecoderTable); ++i)
+	{
+		const u32 first = (u32)HuffmanDecoderTable[i & 0x7FF];
+		const u32 firstBitCount = first >> 8;
+		u32 entry = (first & 0xFF) | (firstBitCount << 16);
+
+		// The code of the second symbol is complete if decoding it with the unknown bits set to 0 
+		// doesn't read any of them.
+		const u32 second = (u32)HuffmanDecoderTable[(i >> firstBitCount) & 0x7FF];
+		const u32 totalBitCount = firstBitCount + (second >> 8);
+		if(totalBitCount <= (u32)HUFFMAN_PAIR_INDEX_BITS)
+		{
+			entry |= ((second & 0xFF) << 8) | (totalBitCount << 20);
+		}
+
+		HuffmanPairDecoderTable[i] = entry;
+	}
+}
+
+// Unaligned 64-bit load that doesn't read past the end of the buffer, the missing bytes read as 0.
+// The buffer can be supplied by the user and be followed by anything, including unmapped memory.
+static UDT_FORCE_INLINE u64 LoadInputBits(const u8* data, s32 byteIndex, s32 byteCount)
+{
+	if(byteIndex + 8 <= byteCount)
+	{
+		return *(const u64*)(data + byteIndex);
+	}
+
+	u64 result = 0;
+	for(s32 i = byteIndex; i < byteCount; ++i)
+	{
+		result |= (u64)data[i] << (u32)((i - byteIndex) * 8);
+	}
+
+	return result;
+}
+
 static UDT_FORCE_INLINE void HuffmanPutBit(u8* fout, s32 bitIndex, s32 bit)
 {
 	const s32 byteIndex = bitIndex >> 3;
@@ -988,6 +1036,13 @@ static const idNetField PlayerStateFields91[] =
 static const s32 PlayerStateFieldCount91 = sizeof(PlayerStateFields91) / sizeof(PlayerStateFields91[0]);
 
 
+// Fields: the suffix of the field lists, Protocol: the suffix of the state types.
+#define UDT_SPECIALIZED_DELTA_READERS(Fields, Protocol) \
+	_realReadDeltaEntity[0] = &udtMessage::ReadDeltaEntityT<EntityStateFields##Fields, EntityStateFieldCount##Fields, (u32)sizeof(idEntityState##Protocol), true>; \
+	_realReadDeltaEntity[1] = &udtMessage::ReadDeltaEntityT<EntityStateFields##Fields, EntityStateFieldCount##Fields, (u32)sizeof(idEntityState##Protocol), false>; \
+	_realReadDeltaPlayer[0] = &udtMessage::ReadDeltaPlayerT<PlayerStateFields##Fields, PlayerStateFieldCount##Fields, (u32)sizeof(idPlayerState##Protocol), true>; \
+	_realReadDeltaPlayer[1] = &udtMessage::ReadDeltaPlayerT<PlayerStateFields##Fields, PlayerStateFieldCount##Fields, (u32)sizeof(idPlayerState##Protocol), false>
+
 udtMessage::udtMessage()
 {
 	_protocol = udtProtocol::Dm68;
@@ -997,6 +1052,7 @@ udtMessage::udtMessage()
 	_entityStateFieldCount = EntityStateFieldCount68;
 	_playerStateFields = PlayerStateFields68;
 	_playerStateFieldCount = PlayerStateFieldCount68;
+	UDT_SPECIALIZED_DELTA_READERS(68, 68);
 	_fileName = udtString::NewNull();
 }
 
@@ -1018,6 +1074,7 @@ void udtMessage::InitProtocol(udtProtocol::Id protocol)
 			_entityStateFieldCount = EntityStateFieldCount91;
 			_playerStateFields = PlayerStateFields91;
 			_playerStateFieldCount = PlayerStateFieldCount91;
+			UDT_SPECIALIZED_DELTA_READERS(91, 91);
 			break;
 
 		case udtProtocol::Dm90:
@@ -1027,6 +1084,7 @@ void udtMessage::InitProtocol(udtProtocol::Id protocol)
 			_entityStateFieldCount = EntityStateFieldCount90;
 			_playerStateFields = PlayerStateFields90;
 			_playerStateFieldCount = PlayerStateFieldCount90;
+			UDT_SPECIALIZED_DELTA_READERS(90, 90);
 			break;
 
 		case udtProtocol::Dm73:
@@ -1036,6 +1094,7 @@ void udtMessage::InitProtocol(udtProtocol::Id protocol)
 			_entityStateFieldCount = EntityStateFieldCount73;
 			_playerStateFields = PlayerStateFields73;
 			_playerStateFieldCount = PlayerStateFieldCount73;
+			UDT_SPECIALIZED_DELTA_READERS(73, 73);
 			break;
 
 		case udtProtocol::Dm3:
@@ -1045,6 +1104,10 @@ void udtMessage::InitProtocol(udtProtocol::Id protocol)
 			_entityStateFieldCount = EntityStateFieldCount3;
 			_playerStateFields = PlayerStateFields3;
 			_playerStateFieldCount = PlayerStateFieldCount3;
+			_realReadDeltaEntity[0] = &udtMessage::RealReadDeltaEntity;
+			_realReadDeltaEntity[1] = &udtMessage::RealReadDeltaEntity;
+			_realReadDeltaPlayer[0] = &udtMessage::RealReadDeltaPlayer;
+			_realReadDeltaPlayer[1] = &udtMessage::RealReadDeltaPlayer;
 			break;
 
 		case udtProtocol::Dm48:
@@ -1054,6 +1117,10 @@ void udtMessage::InitProtocol(udtProtocol::Id protocol)
 			_entityStateFieldCount = EntityStateFieldCount48;
 			_playerStateFields = PlayerStateFields48;
 			_playerStateFieldCount = PlayerStateFieldCount48;
+			_realReadDeltaEntity[0] = &udtMessage::RealReadDeltaEntity;
+			_realReadDeltaEntity[1] = &udtMessage::RealReadDeltaEntity;
+			_realReadDeltaPlayer[0] = &udtMessage::RealReadDeltaPlayer;
+			_realReadDeltaPlayer[1] = &udtMessage::RealReadDeltaPlayer;
 			break;
 
 		case udtProtocol::Dm66:
@@ -1063,6 +1130,7 @@ void udtMessage::InitProtocol(udtProtocol::Id protocol)
 			_entityStateFieldCount = EntityStateFieldCount68;
 			_playerStateFields = PlayerStateFields68;
 			_playerStateFieldCount = PlayerStateFieldCount68;
+			UDT_SPECIALIZED_DELTA_READERS(68, 66);
 			break;
 
 		case udtProtocol::Dm67:
@@ -1072,6 +1140,7 @@ void udtMessage::InitProtocol(udtProtocol::Id protocol)
 			_entityStateFieldCount = EntityStateFieldCount68;
 			_playerStateFields = PlayerStateFields68;
 			_playerStateFieldCount = PlayerStateFieldCount68;
+			UDT_SPECIALIZED_DELTA_READERS(68, 67);
 			break;
 
 		case udtProtocol::Dm68:
@@ -1082,6 +1151,7 @@ void udtMessage::InitProtocol(udtProtocol::Id protocol)
 			_entityStateFieldCount = EntityStateFieldCount68;
 			_playerStateFields = PlayerStateFields68;
 			_playerStateFieldCount = PlayerStateFieldCount68;
+			UDT_SPECIALIZED_DELTA_READERS(68, 68);
 			break;
 	}
 }
@@ -1256,7 +1326,7 @@ s32 udtMessage::RealReadBits(s32 signedBits)
 				return -1;
 			}
 
-			u64 readBits = *(const u64*)&bufferData[Buffer.readcount];
+			u64 readBits = LoadInputBits(bufferData, Buffer.readcount, Buffer.maxsize);
 			const u64 bitPosition = (u64)Buffer.bit & 7;
 			const u64 diff = 64 - (u64)bits;
 			readBits >>= bitPosition;
@@ -1269,27 +1339,38 @@ s32 udtMessage::RealReadBits(s32 signedBits)
 	} 
 	else
 	{
+		//
+		// A single 64-bit load gives us at least 57 bits of input.
+		// The most we can read is 7 raw bits and 4 symbols of 11 bits each, 51 bits total.
+		//
+		const s32 startBitIndex = Buffer.bit;
+		const u64 input = LoadInputBits(bufferData, startBitIndex >> 3, Buffer.maxsize) >> ((u32)startBitIndex & 7);
 		const s32 nbits = bits & 7;
-		s32 bitIndex = Buffer.bit;
-		if(nbits)
-		{		
-			const s16 allBits = *(const s16*)(bufferData + (bitIndex >> 3)) >> (bitIndex & 7);
-			value = allBits & ((1 << nbits) - 1);
-			bitIndex += nbits;
-			bits -= nbits;
-		}
-
-		if(bits)
+		value = (s32)input & ((1 << nbits) - 1);
+		u32 inputBitCount = (u32)nbits;
+		s32 valueBitCount = nbits;
+		s32 symbolCount = bits >> 3;
+		while(symbolCount > 0)
 		{
-			for(s32 i = 0; i < bits; i += 8)
+			const u32 entry = HuffmanPairDecoderTable[(input >> inputBitCount) & ((1 << HUFFMAN_PAIR_INDEX_BITS) - 1)];
+			const u32 pairBitCount = entry >> 20;
+			if(symbolCount >= 2 && pairBitCount != 0)
+			{
+				value |= (s32)((entry & 0xFFFF) << valueBitCount);
+				valueBitCount += 16;
+				inputBitCount += pairBitCount;
+				symbolCount -= 2;
+			}
+			else
 			{
-				const u16 code = ((*(const u32*)(bufferData + (bitIndex >> 3))) >> ((u32)bitIndex & 7)) & 0x7FF;
-				const u16 entry = HuffmanDecoderTable[code];
-				value |= (s32(entry & 0xFF) << (i + nbits));
-				bitIndex += s32(entry >> 8);
+				value |= (s32)((entry & 0xFF) << valueBitCount);
+				valueBitCount += 8;
+				inputBitCount += (entry >> 16) & 15;
+				symbolCount -= 1;
 			}
 		}
 
+		const s32 bitIndex = startBitIndex + (s32)inputBitCount;
 		Buffer.bit = bitIndex;
 		Buffer.readcount = (bitIndex >> 3) + 1;
 	}
@@ -1718,56 +1799,10 @@ void udtMessage::ReadDeltaPlayerDM3(idPlayerStateBase* to)
 	}
 }
 
-bool udtMessage::RealReadDeltaPlayer(const idPlayerStateBase* from, idPlayerStateBase* to)
+void udtMessage::ReadDeltaPlayerArrays(idPlayerStateBase* to)
 {
-	s32			i, lc;
-	s32			bits;
-	s32			*fromF, *toF;
-	idLargestPlayerState dummy;
-
-	if(!from) 
-	{
-		from = &dummy;
-		memset(&dummy, 0, sizeof(dummy));
-	}
-	memcpy(to, from, _protocolSizeOfPlayerState);
-	
-	if(_protocol <= udtProtocol::Dm48)
-	{
-		ReadDeltaPlayerDM3(to);
-		return ValidState();
-	}
-
-	lc = ReadByte();
-	if(lc > _playerStateFieldCount || lc < 0)
-	{
-		Context->LogError("udtMessage::RealReadDeltaPlayer: Invalid playerState field count: %d (max is %d) (in file: %s)", lc, _playerStateFieldCount, GetFileNamePtr());
-		SetValid(false);
-		return false;
-	}
-
-	const idNetField* field;
-	for(i = 0, field = _playerStateFields; i < lc; i++, field++)
-	{
-		fromF = (s32 *)((u8 *)from + field->offset);
-		toF = (s32 *)((u8 *)to + field->offset);
-
-		if(ReadBit() == 0) 
-		{
-			*toF = *fromF;
-			continue;
-		} 
+	s32 i, bits;
 
-		*toF = ReadField(field->bits);
-	}
-	for(i = lc, field = &_playerStateFields[lc]; i < _playerStateFieldCount; i++, field++)
-	{
-		fromF = (s32 *)((u8 *)from + field->offset);
-		toF = (s32 *)((u8 *)to + field->offset);
-		*toF = *fromF;
-	}
-
-	// read the arrays
 	if(ReadBit()) 
 	{
 		// parse stats
@@ -1822,6 +1857,57 @@ bool udtMessage::RealReadDeltaPlayer(const idPlayerStateBase* from, idPlayerStat
 			}
 		}
 	}
+}
+
+bool udtMessage::RealReadDeltaPlayer(const idPlayerStateBase* from, idPlayerStateBase* to)
+{
+	s32			i, lc;
+	s32			*fromF, *toF;
+	idLargestPlayerState dummy;
+
+	if(!from) 
+	{
+		from = &dummy;
+		memset(&dummy, 0, sizeof(dummy));
+	}
+	memcpy(to, from, _protocolSizeOfPlayerState);
+	
+	if(_protocol <= udtProtocol::Dm48)
+	{
+		ReadDeltaPlayerDM3(to);
+		return ValidState();
+	}
+
+	lc = ReadByte();
+	if(lc > _playerStateFieldCount || lc < 0)
+	{
+		Context->LogError("udtMessage::RealReadDeltaPlayer: Invalid playerState field count: %d (max is %d) (in file: %s)", lc, _playerStateFieldCount, GetFileNamePtr());
+		SetValid(false);
+		return false;
+	}
+
+	const idNetField* field;
+	for(i = 0, field = _playerStateFields; i < lc; i++, field++)
+	{
+		fromF = (s32 *)((u8 *)from + field->offset);
+		toF = (s32 *)((u8 *)to + field->offset);
+
+		if(ReadBit() == 0) 
+		{
+			*toF = *fromF;
+			continue;
+		} 
+
+		*toF = ReadField(field->bits);
+	}
+	for(i = lc, field = &_playerStateFields[lc]; i < _playerStateFieldCount; i++, field++)
+	{
+		fromF = (s32 *)((u8 *)from + field->offset);
+		toF = (s32 *)((u8 *)to + field->offset);
+		*toF = *fromF;
+	}
+
+	ReadDeltaPlayerArrays(to);
 
 	return ValidState();
 }
@@ -2106,6 +2192,161 @@ bool udtMessage::RealReadDeltaEntity(bool& addedOrChanged, const idEntityStateBa
 	return ValidState();
 }
 
+template<bool Huffman>
+UDT_FORCE_INLINE s32 udtMessage::ReadBitT()
+{
+	return Huffman ? RealReadBitHuffman() : RealReadBitNoHuffman();
+}
+
+template<bool Huffman>
+UDT_FORCE_INLINE s32 udtMessage::ReadFloatT()
+{
+	if(ReadBitT<Huffman>())
+	{
+		return RealReadBits(32);
+	}
+
+	union FloatAndInt
+	{
+		FloatAndInt(f32 f) : AsFloat(f) {}
+
+		f32 AsFloat;
+		s32 AsInt;
+	};
+
+	const s32 intValue = RealReadBits(FLOAT_INT_BITS) - FLOAT_INT_BIAS;
+	const FloatAndInt realValue((f32)intValue);
+
+	return realValue.AsInt;
+}
+
+//
+// Unlike the generic versions, the reads don't switch to the dummy functions when the message becomes invalid.
+// What the dummy functions would have read (-1) is assigned instead so that the output is exactly the same.
+//
+
+template<const idNetField* Fields, s32 FieldCount, u32 StateSize, bool Huffman>
+bool udtMessage::ReadDeltaEntityT(bool& addedOrChanged, const idEntityStateBase* from, idEntityStateBase* to, s32 number)
+{
+	if(number < 0 || number >= MAX_GENTITIES) 
+	{
+		Context->LogError("udtMessage::RealReadDeltaEntity: Bad delta entity number: %d (max is %d) (in file: %s)", number, MAX_GENTITIES - 1, GetFileNamePtr());
+		SetValid(false);
+		return false;
+	}
+
+	// check for a remove
+	if(ReadBitT<Huffman>() == 1) 
+	{
+		Com_Memset(to, 0, StateSize);
+		to->number = MAX_GENTITIES - 1;
+		addedOrChanged = false;
+		return ValidState();
+	}
+
+	// check for no delta
+	if(ReadBitT<Huffman>() == 0) 
+	{
+		Com_Memcpy(to, from, StateSize);
+		to->number = number;
+		addedOrChanged = false;
+		return ValidState();
+	}
+
+	addedOrChanged = true;
+	const s32 fieldCount = RealReadBits(8);
+	if(fieldCount > FieldCount || fieldCount < 0)
+	{
+		Context->LogError("udtMessage::RealReadDeltaEntity: Invalid entityState field count: %d (max is %d) (in file: %s)", fieldCount, FieldCount, GetFileNamePtr());
+		SetValid(false);
+		return false;
+	}
+
+	to->number = number;
+
+	for(s32 i = 0; i < fieldCount; ++i) 
+	{
+		const idNetField& field = Fields[i];
+		const s32* const fromF = (const s32*)((const u8*)from + field.offset);
+		s32* const toF = (s32*)((u8*)to + field.offset);
+
+		if(!Buffer.valid)
+		{
+			*toF = -1;
+			continue;
+		}
+
+		if(ReadBitT<Huffman>() == 0) 
+		{
+			*toF = *fromF;
+			continue;
+		} 
+
+		if(ReadBitT<Huffman>() == 0)
+		{
+			*toF = 0;
+			continue;
+		}
+
+		*toF = (field.bits == 0) ? ReadFloatT<Huffman>() : RealReadBits(field.bits);
+	}
+
+	for(s32 i = fieldCount; i < FieldCount; ++i)
+	{
+		const idNetField& field = Fields[i];
+		const s32* const fromF = (const s32*)((const u8*)from + field.offset);
+		s32* const toF = (s32*)((u8*)to + field.offset);
+		*toF = *fromF;
+	}
+
+	return ValidState();
+}
+
+template<const idNetField* Fields, s32 FieldCount, u32 StateSize, bool Huffman>
+bool udtMessage::ReadDeltaPlayerT(const idPlayerStateBase* from, idPlayerStateBase* to)
+{
+	idLargestPlayerState dummy;
+	if(!from) 
+	{
+		from = &dummy;
+		memset(&dummy, 0, sizeof(dummy));
+	}
+	memcpy(to, from, StateSize);
+
+	const s32 fieldCount = RealReadBits(8);
+	if(fieldCount > FieldCount || fieldCount < 0)
+	{
+		Context->LogError("udtMessage::RealReadDeltaPlayer: Invalid playerState field count: %d (max is %d) (in file: %s)", fieldCount, FieldCount, GetFileNamePtr());
+		SetValid(false);
+		return false;
+	}
+
+	// The fields past fieldCount were already copied over.
+	for(s32 i = 0; i < fieldCount; ++i)
+	{
+		const idNetField& field = Fields[i];
+		s32* const toF = (s32*)((u8*)to + field.offset);
+
+		if(!Buffer.valid)
+		{
+			*toF = -1;
+			continue;
+		}
+
+		if(ReadBitT<Huffman>() == 0) 
+		{
+			continue;
+		} 
+
+		*toF = (field.bits == 0) ? ReadFloatT<Huffman>() : RealReadBits(field.bits);
+	}
+
+	// The arrays are rare enough that we don't bother specializing them.
+	ReadDeltaPlayerArrays(to);
+
+	return ValidState();
+}
+
 void udtMessage::SetValid(bool valid)
 {
 	Buffer.valid = valid;
@@ -2117,8 +2358,8 @@ void udtMessage::SetValid(bool valid)
 		_readString = &udtMessage::RealReadString;
 		_readData = &udtMessage::RealReadData;
 		_peekByte = &udtMessage::RealPeekByte;
-		_readDeltaEntity = &udtMessage::RealReadDeltaEntity;
-		_readDeltaPlayer = &udtMessage::RealReadDeltaPlayer;
+		_readDeltaEntity = _realReadDeltaEntity[Buffer.oob ? 1 : 0];
+		_readDeltaPlayer = _realReadDeltaPlayer[Buffer.oob ? 1 : 0];
 		_writeBits = &udtMessage::RealWriteBits;
 		_writeFloat = &udtMessage::RealWriteFloat;
 		_writeString = &udtMessage::RealWriteString;
@@ -5,6 +5,9 @@
 #include "context.hpp"
 
 
+extern void BuildHuffmanDecoderTables(); // Must be called once before reading any Huffman-compressed message.
+
+
 struct idMessage
 {
 	u8*  data;
@@ -66,6 +69,7 @@ public:
 
 private:
 	void  ReadDeltaPlayerDM3(idPlayerStateBase* to);
+	void  ReadDeltaPlayerArrays(idPlayerStateBase* to);
 	void  ReadDeltaEntityDM3(const idEntityStateBase* from, idEntityStateBase* to, s32 number);
 
 	s32   DummyRead() { return -1; }
@@ -91,6 +95,15 @@ private:
 	bool  RealReadDeltaEntity(bool& addedOrChanged, const idEntityStateBase* from, idEntityStateBase* to, s32 number);
 	bool  RealReadDeltaPlayer(const idPlayerStateBase* from, idPlayerStateBase* to);
 
+	// Specialized versions of the above for a given protocol's field list and Huffman mode.
+	// The bit reads are direct calls the compiler can inline instead of going through the function pointers.
+	template<bool Huffman> s32 ReadBitT();
+	template<bool Huffman> s32 ReadFloatT();
+	template<const idNetField* Fields, s32 FieldCount, u32 StateSize, bool Huffman>
+	bool  ReadDeltaEntityT(bool& addedOrChanged, const idEntityStateBase* from, idEntityStateBase* to, s32 number);
+	template<const idNetField* Fields, s32 FieldCount, u32 StateSize, bool Huffman>
+	bool  ReadDeltaPlayerT(const idPlayerStateBase* from, idPlayerStateBase* to);
+
 	void  RealWriteBits(s32 value, s32 bits);
 	void  RealWriteFloat(s32 c);
 	void  RealWriteString(const char* s, s32 length, s32 bufferLength, char* buffer);
@@ -137,6 +150,8 @@ private:
 	PeekByteFunc         _peekByte;
 	ReadDeltaEntityFunc  _readDeltaEntity;
 	ReadDeltaPlayerFunc  _readDeltaPlayer;
+	ReadDeltaEntityFunc  _realReadDeltaEntity[2]; // Selected by InitProtocol, indexed by Buffer.oob.
+	ReadDeltaPlayerFunc  _realReadDeltaPlayer[2]; // Selected by InitProtocol, indexed by Buffer.oob.
 	WriteBitsFunc        _writeBits;
 	WriteFloatFunc       _writeFloat;
 	WriteStringFunc      _writeString;
@@ -12,14 +12,12 @@
 
 
 #define    UDT_MIN_BYTE_SIZE_PER_THREAD    ((u64)(6 * (1<<20)))
-#define    UDT_MAX_THREAD_COUNT            (16)
 
 
 struct FileInfo
 {
 	u64 ByteCount;
 	const char* FilePath;
-	u32 ThreadIdx;
 	u32 InputIdx;
 };
 
@@ -27,23 +25,23 @@ static int SortByFileSizesDescending(const void* aPtr, const void* bPtr)
 {
 	const u64 a = ((FileInfo*)aPtr)->ByteCount;
 	const u64 b = ((FileInfo*)bPtr)->ByteCount;
+	if(a != b)
+	{
+		return a > b ? -1 : 1;
+	}
 
-	return (int)(b - a);
-}
-
-static int SortByThreadIndexAscending(const void* aPtr, const void* bPtr)
-{
-	const u32 a = ((FileInfo*)aPtr)->ThreadIdx;
-	const u32 b = ((FileInfo*)bPtr)->ThreadIdx;
+	// Keep the order deterministic for files of equal size.
+	const u32 aIdx = ((FileInfo*)aPtr)->InputIdx;
+	const u32 bIdx = ((FileInfo*)bPtr)->InputIdx;
 
-	return (int)(a - b);
+	return (int)aIdx - (int)bIdx;
 }
 
 udtDemoThreadAllocator::udtDemoThreadAllocator()
 {
 }
 
-bool udtDemoThreadAllocator::Process(const char** filePaths, u32 fileCount, u32 maxThreadCount)
+bool udtDemoThreadAllocator::Process(const char** filePaths, u32 fileCount, u32 maxThreadCount, u32 minByteCountPerThread)
 {
 	if(maxThreadCount <= 1 || fileCount <= 1)
 	{
@@ -57,6 +55,8 @@ bool udtDemoThreadAllocator::Process(const char** filePaths, u32 fileCount, u32
 		return false;
 	}
 
+	const u64 minByteCount = minByteCountPerThread > 0 ? (u64)minByteCountPerThread : UDT_MIN_BYTE_SIZE_PER_THREAD;
+
 	// Get file sizes and make sure we have enough data to process
 	// to even consider launching new threads.
 	udtVMArray<FileInfo> files("DemoThreadAllocator::Process::FilesArray");
@@ -67,78 +67,43 @@ bool udtDemoThreadAllocator::Process(const char** filePaths, u32 fileCount, u32
 		const u64 byteCount = udtFileStream::GetFileLength(filePaths[i]);
 		files[i].FilePath = filePaths[i];
 		files[i].ByteCount = byteCount;
-		files[i].ThreadIdx = (u32)-1;
 		files[i].InputIdx = i;
 		totalByteCount += byteCount;
 	}
 
-	if(totalByteCount < 2 * UDT_MIN_BYTE_SIZE_PER_THREAD)
+	if(totalByteCount < 2 * minByteCount)
 	{
 		return false;
 	}
 
 	// Prepare the final thread array.
-	maxThreadCount = udt_min(maxThreadCount, (u32)UDT_MAX_THREAD_COUNT);
 	maxThreadCount = udt_min(maxThreadCount, processorCoreCount);
 	maxThreadCount = udt_min(maxThreadCount, fileCount);
-	const u32 finalThreadCount = udt_min(maxThreadCount, (u32)(totalByteCount / UDT_MIN_BYTE_SIZE_PER_THREAD));
+	const u32 finalThreadCount = (u32)udt_min((u64)maxThreadCount, totalByteCount / minByteCount);
 	Threads.Resize(finalThreadCount);
 	memset(Threads.GetStartAddress(), 0, (size_t)Threads.GetSize() * sizeof(udtParsingThreadData));
 	for(u32 i = 0; i < finalThreadCount; ++i)
 	{
+		Threads[i].TotalByteCount = totalByteCount;
 		Threads[i].Finished = false;
 		Threads[i].Stop = false;
 		Threads[i].Result = false;
 	}
 
-	// Sort files by size.
+	// Processing the largest files first means the last files grabbed by the threads are the smallest ones,
+	// which keeps the time the threads spend waiting for the last one to finish short.
 	qsort(files.GetStartAddress(), (size_t)fileCount, sizeof(FileInfo), &SortByFileSizesDescending);
 
-	// Assign files to threads.
-	for(u32 i = 0; i < fileCount; ++i)
-	{
-		u32 threadIdx = 0;
-		u64 smallestThreadByteCount = (u64)-1;
-		for(u32 j = 0; j < finalThreadCount; ++j)
-		{
-			if(Threads[j].TotalByteCount < smallestThreadByteCount)
-			{
-				smallestThreadByteCount = Threads[j].TotalByteCount;
-				threadIdx = j;
-			}
-		}
-
-		Threads[threadIdx].TotalByteCount += files[i].ByteCount;
-		files[i].ThreadIdx = threadIdx;
-	}
-
-	// Sort files by thread index.
-	qsort(files.GetStartAddress(), (size_t)fileCount, sizeof(FileInfo), &SortByThreadIndexAscending);
-	assert(files[0].ThreadIdx == 0); // Ascending order means thread 0 is always first.
-
 	// Build and finalize the arrays.
-	u32 threadIdx = 0;
-	u32 firstFileIdx = 0;
 	FilePaths.Resize(fileCount);
 	FileSizes.Resize(fileCount);
 	InputIndices.Resize(fileCount);
 	for(u32 i = 0; i < fileCount; ++i)
 	{
-		if(files[i].ThreadIdx != threadIdx)
-		{
-			assert(threadIdx < Threads.GetSize());
-			Threads[threadIdx].FirstFileIndex = firstFileIdx;
-			Threads[threadIdx].FileCount = i - firstFileIdx;
-			firstFileIdx = i;
-			++threadIdx;
-		}
-
 		FilePaths[i] = files[i].FilePath;
 		FileSizes[i] = files[i].ByteCount;
 		InputIndices[i] = files[i].InputIdx;
 	}
-	Threads[threadIdx].FirstFileIndex = firstFileIdx;
-	Threads[threadIdx].FileCount = fileCount - firstFileIdx;
 	
 	return true;
 }
@@ -202,9 +167,6 @@ static void ThreadFunction(void* userData)
 		return;
 	}
 
-	const u32 startIdx = data->FirstFileIndex;
-	const u32 endIdx = startIdx + data->FileCount;
-
 	udtTimer timer;
 	timer.Start();
 
@@ -219,31 +181,50 @@ static void ThreadFunction(void* userData)
 	udtParseArg newParseInfo = *shared->ParseInfo;
 	newParseInfo.ProgressCb = &MultiThreadedProgressProgressCallback;
 	newParseInfo.ProgressContext = &progressContext;
+	// The cores are already busy with other demos.
+	newParseInfo.Flags &= ~(u32)udtParseArgFlag::ParallelGameStates;
 
 	s32* const errorCodes = shared->MultiParseInfo->OutputErrorCodes;
 
-	if(!InitContextWithPlugIns(*data->Context, newParseInfo, data->FileCount, (udtParsingJobType::Id)shared->JobType, shared->JobSpecificInfo))
+	// We don't know in advance how many demos this thread will process.
+	// The demo count is only used as a hint by the plug-ins.
+	if(!InitContextWithPlugIns(*data->Context, newParseInfo, shared->FileCount, (udtParsingJobType::Id)shared->JobType, shared->JobSpecificInfo))
 	{
 		data->Result = false;
 		data->Finished = true;
 		return;
 	}
 
+	udtParserContext* const context = data->Context;
+	context->InputIndices.Clear();
+
+	InstrumentationBeginThread(shared->ParseInfo->StagePerfStats, data->ThreadIndex);
+
 	u64 actualProcessedByteCount = 0;
-	for(u32 i = startIdx; i < endIdx; ++i)
+	u32 contextDemoIdx = 0;
+	for(;;)
 	{
 		if(shared->ParseInfo->CancelOperation != NULL && *shared->ParseInfo->CancelOperation != 0)
 		{
 			break;
 		}
 
-		const u32 originalInputIdx = data->Context->InputIndices[i - startIdx];
+		const s32 fileIdx = udtAtomicIncrement(&shared->NextFileIndex) - 1;
+		if(fileIdx >= (s32)shared->FileCount)
+		{
+			break;
+		}
+
+		const u32 i = (u32)fileIdx;
+		const u32 originalInputIdx = shared->InputIndices[i];
 		const u64 currentJobByteCount = shared->FileSizes[i];
 		progressContext.CurrentJobByteCount = currentJobByteCount;
+		context->InputIndices.Add(originalInputIdx);
 
 		const udtParsingJobType::Id jobType = (udtParsingJobType::Id)shared->JobType;
-		const bool success = ProcessSingleDemoFile(jobType, data->Context, i - startIdx, originalInputIdx, &newParseInfo, shared->FilePaths[i], shared->JobSpecificInfo);
+		const bool success = ProcessSingleDemoFile(jobType, context, contextDemoIdx, originalInputIdx, &newParseInfo, shared->FilePaths[i], shared->JobSpecificInfo);
 		errorCodes[originalInputIdx] = GetErrorCode(success, shared->ParseInfo->CancelOperation);
+		++contextDemoIdx;
 
 		progressContext.ProcessedByteCount += currentJobByteCount;
 		if(success)
@@ -252,6 +233,9 @@ static void ThreadFunction(void* userData)
 		}
 	}
 
+	data->Instrumented = InstrumentationEndThread(data->StageCounters);
+
+	context->DemoCount = contextDemoIdx;
 	data->Context->UpdatePlugInBufferStructs();
 	
 	if(data->Shared->ParseInfo->PerformanceStats != NULL)
@@ -269,14 +253,12 @@ static void ThreadFunction(void* userData)
 }
 
 bool udtMultiThreadedParsing::Process(udtTimer& jobTimer, 
-									  udtParserContext* contexts,
 									  udtDemoThreadAllocator& threadInfo,
 									  const udtParseArg* parseInfo,
 									  const udtMultiParseArg* multiParseInfo,
 									  udtParsingJobType::Id jobType,
 									  const void* jobSpecificInfo)
 {
-	assert(contexts != NULL);
 	assert(parseInfo != NULL);
 	assert(multiParseInfo != NULL);
 	assert(jobType < (u32)udtParsingJobType::Count);
@@ -286,6 +268,11 @@ bool udtMultiThreadedParsing::Process(udtTimer& jobTimer,
 		PerfStatsInit(parseInfo->PerformanceStats);
 	}
 
+	if(parseInfo->StagePerfStats != NULL)
+	{
+		StagePerfStatsInit(parseInfo->StagePerfStats);
+	}
+
 	const u32 threadCount = threadInfo.Threads.GetSize();
 
 	udtParsingSharedData sharedData;
@@ -295,7 +282,10 @@ bool udtMultiThreadedParsing::Process(udtTimer& jobTimer,
 	sharedData.ParseInfo = parseInfo;
 	sharedData.FilePaths = threadInfo.FilePaths.GetStartAddress();
 	sharedData.FileSizes = threadInfo.FileSizes.GetStartAddress();
+	sharedData.InputIndices = threadInfo.InputIndices.GetStartAddress();
 	sharedData.JobType = (u32)jobType;
+	sharedData.FileCount = threadInfo.FilePaths.GetSize();
+	sharedData.NextFileIndex = 0;
 	
 	for(u32 i = 0, count = multiParseInfo->FileCount; i < count; ++i)
 	{
@@ -311,20 +301,12 @@ bool udtMultiThreadedParsing::Process(udtTimer& jobTimer,
 	threads.Resize(threadCount);
 	for(u32 i = 0; i < threadCount; ++i)
 	{
-		udtParserContext* const context = contexts + i;
 		udtParsingThreadData& threadData = threadInfo.Threads[i];
-		const u32 demoCount = threadData.FileCount;
-		const u32 firstDemoIdx = threadData.FirstFileIndex;
-		context->InputIndices.Resize(demoCount);
-		for(u32 j = 0; j < demoCount; ++j)
-		{
-			context->InputIndices[j] = threadInfo.InputIndices[firstDemoIdx + j];
-		}
-
 		udtThread& thread = threads[i];
 		new (&thread) udtThread;
-		threadData.Context = contexts + i;
+		assert(threadData.Context != NULL);
 		threadData.Shared = &sharedData;
+		threadData.ThreadIndex = i;
 		if(!thread.CreateAndStart(&ThreadFunction, &threadData))
 		{
 			success = false;
@@ -363,14 +345,18 @@ bool udtMultiThreadedParsing::Process(udtTimer& jobTimer,
 
 		progressTimer.Restart();
 
-		// The actual progress is that of the slowest thread.
-		f32 progress = 2.0f;
+		// All threads work towards the same total.
+		f32 progress = 0.0f;
 		for(u32 i = 0; i < threadCount; ++i)
 		{
-			progress = udt_min(progress, threadInfo.Threads[i].Progress);
+			progress += threadInfo.Threads[i].Progress;
 		}
+		progress = udt_min(progress, 1.0f);
 
-		(*parseInfo->ProgressCb)(progress, parseInfo->ProgressContext);
+		if(parseInfo->ProgressCb != NULL)
+		{
+			(*parseInfo->ProgressCb)(progress, parseInfo->ProgressContext);
+		}
 	}
 	
 	// If the above code is correct and never fails, this is redundant.
@@ -391,6 +377,17 @@ thread_clean_up:
 		PerfStatsFinalize(parseInfo->PerformanceStats, threadCount, jobTimer.GetElapsedUs());
 	}
 
+	if(success && parseInfo->StagePerfStats != NULL)
+	{
+		for(u32 i = 0; i < threadCount; ++i)
+		{
+			if(threadInfo.Threads[i].Instrumented)
+			{
+				StagePerfStatsAddThread(parseInfo->StagePerfStats, threadInfo.Threads[i].StageCounters);
+			}
+		}
+	}
+
 #if defined(UDT_DEBUG) && defined(UDT_LOG_ALLOCATOR_DEBUG_STATS)
 	contexts[0].Parser._tempAllocator.Clear();
 	LogLinearAllocatorDebugStats(contexts[0].Context, contexts[0].Parser._tempAllocator);
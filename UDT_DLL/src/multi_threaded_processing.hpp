@@ -5,26 +5,31 @@
 #include "array.hpp"
 #include "api_helpers.hpp"
 #include "timer.hpp"
+#include "instrumentation.hpp"
 
 
 struct udtParsingSharedData
 {
 	const char** FilePaths;
 	u64* FileSizes;
+	u32* InputIndices;
 	const udtParseArg* ParseInfo;
 	const udtMultiParseArg* MultiParseInfo;
 	const void* JobSpecificInfo;
 	u32 JobType; // Of type udtParsingJobType::Id.
+	u32 FileCount;
+	volatile s32 NextFileIndex; // Threads grab the next demo to process from here.
 };
 
 struct udtParsingThreadData
 {
-	u64 TotalByteCount;
+	u64 TotalByteCount; // All the threads share the same total.
 	udtParsingSharedData* Shared;
 	udtParserContext* Context;
-	u32 FirstFileIndex;
-	u32 FileCount;
-	f32 Progress;
+	udtStageCounters StageCounters;
+	u32 ThreadIndex;
+	f32 Progress; // The thread's contribution to the total progress.
+	bool Instrumented; // True if StageCounters is valid.
 	bool Finished;
 	bool Stop;
 	bool Result;
@@ -35,7 +40,10 @@ struct udtDemoThreadAllocator
 	udtDemoThreadAllocator();
 
 	// Returns true if more than 1 thread should be launched.
-	bool Process(const char** filePaths, u32 fileCount, u32 maxThreadCount);
+	// Files are not assigned to threads up front: they're sorted by descending size 
+	// and each thread grabs the next unprocessed one when it's done with its current demo.
+	// A minByteCountPerThread value of 0 means the default value is used.
+	bool Process(const char** filePaths, u32 fileCount, u32 maxThreadCount, u32 minByteCountPerThread = 0);
 
 	udtVMArray<const char*> FilePaths { "DemoThreadAllocator::FilePathsArray" };
 	udtVMArray<u64> FileSizes { "DemoThreadAllocator::FileSizesArray" };
@@ -45,8 +53,8 @@ struct udtDemoThreadAllocator
 
 struct udtMultiThreadedParsing
 {
+	// The caller assigns a context to every thread.
 	bool Process(udtTimer& jobTimer,
-				 udtParserContext* contexts, 
                  udtDemoThreadAllocator& threadInfo, 
 				 const udtParseArg* parseInfo, 
 				 const udtMultiParseArg* multiParseInfo,
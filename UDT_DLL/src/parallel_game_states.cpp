@@ -0,0 +1,345 @@
+#include "parallel_game_states.hpp"
+#include "parser_runner.hpp"
+#include "analysis_splitter.hpp"
+#include "context_pool.hpp"
+#include "file_stream.hpp"
+#include "threads.hpp"
+#include "system.hpp"
+#include "utils.hpp"
+
+// For the placement new operator.
+#include <new>
+#include <string.h>
+
+
+#define    UDT_MIN_BYTE_SIZE_PER_GAMESTATE_THREAD    ((u64)(2 * (1<<20)))
+#define    UDT_GAMESTATE_THREAD_JOIN_TIMEOUT_MS      100
+
+
+struct udtGameStateSegment
+{
+	u64 StartOffset;
+	u64 EndOffset; // Offset of the next gamestate message, parsed as well. The file size for the last one.
+	u32 ThreadIndex;
+	u32 DemoIndex; // The demo index in the thread's context.
+	bool Parsed;
+	bool Success;
+};
+
+struct udtGameStateSharedData
+{
+	udtGameStateSegment* Segments;
+	const udtParseArg* ParseInfo;
+	const char* FilePath;
+	u64 FileByteCount;
+	u32 SegmentCount;
+	udtProtocol::Id Protocol;
+	volatile s32 NextSegmentIndex;
+};
+
+struct udtGameStateThreadData
+{
+	udtGameStateSharedData* Shared;
+	udtParserContext* Context;
+	u64 ProcessedByteCount; // Of the segments this thread is done with.
+	u64 CurrentStartOffset;
+	u64 CurrentByteCount;
+	volatile f32 Progress; // Of the whole file.
+	u32 ThreadIndex;
+	u32 DemoCount;
+};
+
+static void GameStateThreadProgressCallback(f32 jobProgress, void* userData)
+{
+	udtGameStateThreadData* const data = (udtGameStateThreadData*)userData;
+	const u64 fileByteCount = data->Shared->FileByteCount;
+
+	// The runner's progress is relative to the rest of the file, not to the segment.
+	const u64 jobByteCount = (u64)((f64)(fileByteCount - data->CurrentStartOffset) * (f64)jobProgress);
+	const u64 processedByteCount = data->ProcessedByteCount + udt_min(jobByteCount, data->CurrentByteCount);
+	data->Progress = (f32)processedByteCount / (f32)fileByteCount;
+}
+
+static bool ParseGameStateSegment(udtGameStateThreadData& data, udtGameStateSegment& segment, u32 segmentIndex)
+{
+	const udtGameStateSharedData& shared = *data.Shared;
+	udtParserContext* const context = data.Context;
+	context->ResetForNextDemo(true);
+
+	UDT_INIT_DEMO_FILE_READER_AT(file, shared.FilePath, context, (u32)segment.StartOffset, shared.ParseInfo->Flags);
+
+	udtBaseParser& parser = context->Parser;
+	if(!parser.Init(&context->Context, shared.Protocol, shared.Protocol))
+	{
+		return false;
+	}
+
+	parser.SetFilePath(shared.FilePath);
+	parser.SkipCommandsBeforeGameState = segmentIndex > 0;
+
+	// From here on, the plug-ins have started processing a demo and must be told when it's over.
+	segment.DemoIndex = data.DemoCount++;
+	segment.Parsed = true;
+
+	udtParserRunner runner;
+	if(!runner.Init(parser, file, shared.ParseInfo->CancelOperation))
+	{
+		parser.FinishParsing(false);
+		return false;
+	}
+
+	// Reading the next gamestate message as well lets the plug-ins wrap up the current gamestate
+	// the same way they would in a sequential parse. Its commands are processed here and skipped by the next segment.
+	while(runner.ParseNextMessage())
+	{
+		if((u64)parser._inFileOffset >= segment.EndOffset)
+		{
+			break;
+		}
+	}
+
+	runner.FinishParsing();
+
+	return runner.WasSuccess();
+}
+
+static void GameStateThreadFunction(void* userData)
+{
+	udtGameStateThreadData* const data = (udtGameStateThreadData*)userData;
+	udtGameStateSharedData* const shared = data->Shared;
+	const s32* const cancelOperation = shared->ParseInfo->CancelOperation;
+
+	for(;;)
+	{
+		if(cancelOperation != NULL && *cancelOperation != 0)
+		{
+			break;
+		}
+
+		const s32 segmentIdx = udtAtomicIncrement(&shared->NextSegmentIndex) - 1;
+		if(segmentIdx >= (s32)shared->SegmentCount)
+		{
+			break;
+		}
+
+		udtGameStateSegment& segment = shared->Segments[segmentIdx];
+		data->CurrentStartOffset = segment.StartOffset;
+		data->CurrentByteCount = segment.EndOffset - segment.StartOffset;
+		segment.ThreadIndex = data->ThreadIndex;
+		segment.Success = ParseGameStateSegment(*data, segment, (u32)segmentIdx);
+		data->ProcessedByteCount += data->CurrentByteCount;
+		data->Progress = (f32)data->ProcessedByteCount / (f32)shared->FileByteCount;
+	}
+}
+
+static bool CanMergeGameStates(udtParserContext* context)
+{
+	const u32 plugInCount = context->PlugIns.GetSize();
+	if(plugInCount == 0)
+	{
+		return false;
+	}
+
+	for(u32 i = 0; i < plugInCount; ++i)
+	{
+		if(!context->PlugIns[i].PlugIn->CanMergeGameStates())
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool FindGameStates(udtVMArray<u32>& fileOffsets, udtParserContext* context, const udtParseArg* info, const char* demoFilePath)
+{
+	// The sequential parse can't seek.
+	udtFileStream file;
+	if(!file.Open(demoFilePath, udtFileOpenMode::Read))
+	{
+		return false;
+	}
+
+	// The parse that follows reports the same warnings, so the scan stays silent.
+	context->Context.SetCallbacks(NULL, NULL, NULL);
+	const bool success = FindGamestateFileOffsets(fileOffsets, context->Parser, file, info->CancelOperation);
+	context->Context.SetCallbacks(info->MessageCb, info->ProgressCb, info->ProgressContext);
+
+	return success;
+}
+
+bool ParseGameStatesInParallel(bool& success, udtParserContext* context, const udtParseArg* info, const char* demoFilePath)
+{
+	success = false;
+	if(!CanMergeGameStates(context))
+	{
+		return false;
+	}
+
+	u32 processorCoreCount = 1;
+	GetProcessorCoreCount(processorCoreCount);
+	if(processorCoreCount <= 1)
+	{
+		return false;
+	}
+
+	const u64 fileByteCount = udtFileStream::GetFileLength(demoFilePath);
+	const u32 maxThreadCount = (u32)udt_min((u64)processorCoreCount, fileByteCount / UDT_MIN_BYTE_SIZE_PER_GAMESTATE_THREAD);
+	if(maxThreadCount <= 1 || fileByteCount >= (u64)UDT_U32_MAX)
+	{
+		return false;
+	}
+
+	udtVMArray<u32> fileOffsets("ParseGameStatesInParallel::FileOffsetsArray");
+	if(!FindGameStates(fileOffsets, context, info, demoFilePath) || fileOffsets.GetSize() <= 1)
+	{
+		return false;
+	}
+
+	const u32 segmentCount = fileOffsets.GetSize();
+	const u32 threadCount = udt_min(maxThreadCount, segmentCount);
+	const u32 plugInCount = context->PlugIns.GetSize();
+
+	udtVMArray<udtGameStateSegment> segments("ParseGameStatesInParallel::SegmentsArray");
+	segments.Resize(segmentCount);
+	memset(segments.GetStartAddress(), 0, (size_t)segmentCount * sizeof(udtGameStateSegment));
+	for(u32 i = 0; i < segmentCount; ++i)
+	{
+		segments[i].StartOffset = i == 0 ? 0 : (u64)fileOffsets[i];
+		segments[i].EndOffset = i + 1 < segmentCount ? (u64)fileOffsets[i + 1] : fileByteCount;
+	}
+
+	udtVMArray<u32> plugInIds("ParseGameStatesInParallel::PlugInIdsArray");
+	for(u32 i = 0; i < plugInCount; ++i)
+	{
+		plugInIds.Add(context->PlugIns[i].PlugIn->Id);
+	}
+
+	udtGameStateSharedData shared;
+	shared.Segments = segments.GetStartAddress();
+	shared.ParseInfo = info;
+	shared.FilePath = demoFilePath;
+	shared.FileByteCount = fileByteCount;
+	shared.SegmentCount = segmentCount;
+	shared.Protocol = context->Parser._inProtocol;
+	shared.NextSegmentIndex = 0;
+
+	udtVMArray<udtGameStateThreadData> threadData("ParseGameStatesInParallel::ThreadDataArray");
+	threadData.Resize(threadCount);
+	memset(threadData.GetStartAddress(), 0, (size_t)threadCount * sizeof(udtGameStateThreadData));
+	udtVMArray<udtThread> threads("ParseGameStatesInParallel::ThreadsArray");
+	threads.Resize(threadCount);
+	for(u32 i = 0; i < threadCount; ++i)
+	{
+		new (&threads[i]) udtThread;
+	}
+
+	// The helper contexts are created here since they must be released by this thread.
+	bool contextsReady = true;
+	u32 contextCount = 0;
+	for(; contextCount < threadCount; ++contextCount)
+	{
+		udtGameStateThreadData& data = threadData[contextCount];
+		data.Shared = &shared;
+		data.ThreadIndex = contextCount;
+		data.Context = udtParserContextPool::Acquire();
+		if(data.Context == NULL)
+		{
+			contextsReady = false;
+			break;
+		}
+
+		if(!data.Context->Init(segmentCount, plugInIds.GetStartAddress(), plugInCount) ||
+		   !data.Context->Context.SetCallbacks(info->MessageCb, &GameStateThreadProgressCallback, &data))
+		{
+			contextsReady = false;
+			++contextCount;
+			break;
+		}
+
+		for(u32 j = 0; j < plugInCount; ++j)
+		{
+			data.Context->PlugIns[j].PlugIn->EnableGameStateSegments();
+		}
+	}
+
+	// The threads grab the segments in order, so any thread that started will parse them all if need be.
+	u32 threadsStarted = 0;
+	if(contextsReady)
+	{
+		for(; threadsStarted < threadCount; ++threadsStarted)
+		{
+			if(!threads[threadsStarted].CreateAndStart(&GameStateThreadFunction, &threadData[threadsStarted]))
+			{
+				break;
+			}
+		}
+	}
+
+	for(u32 i = 0; i < threadsStarted; ++i)
+	{
+		while(!threads[i].TimedJoin(UDT_GAMESTATE_THREAD_JOIN_TIMEOUT_MS))
+		{
+			f32 progress = 0.0f;
+			for(u32 j = 0; j < threadsStarted; ++j)
+			{
+				progress += threadData[j].Progress;
+			}
+			context->Context.NotifyProgress(udt_clamp(progress, 0.0f, 1.0f));
+		}
+		threads[i].Release();
+	}
+
+	for(u32 i = 0; i < threadCount; ++i)
+	{
+		threads[i].~udtThread();
+	}
+
+	if(threadsStarted > 0)
+	{
+		for(u32 i = 0; i < plugInCount; ++i)
+		{
+			context->PlugIns[i].PlugIn->StartMergingDemo();
+		}
+
+		success = true;
+		for(u32 s = 0; s < segmentCount; ++s)
+		{
+			const udtGameStateSegment& segment = segments[s];
+			if(!segment.Parsed)
+			{
+				success = false;
+				break;
+			}
+
+			udtParserContext* const source = threadData[segment.ThreadIndex].Context;
+			for(u32 i = 0; i < plugInCount; ++i)
+			{
+				context->PlugIns[i].PlugIn->MergeGameState(*source->PlugIns[i].PlugIn, segment.DemoIndex, (s32)s);
+			}
+
+			// Like the sequential parse, we keep what was read up to the error.
+			if(!segment.Success)
+			{
+				success = false;
+				break;
+			}
+		}
+
+		for(u32 i = 0; i < plugInCount; ++i)
+		{
+			context->PlugIns[i].PlugIn->FinishMergingDemo();
+		}
+		context->Parser.PlugInEarlyExits.Add(0);
+	}
+
+	for(u32 i = 0; i < contextCount; ++i)
+	{
+		if(threadData[i].Context != NULL)
+		{
+			udtParserContextPool::Release(threadData[i].Context);
+		}
+	}
+
+	return threadsStarted > 0;
+}
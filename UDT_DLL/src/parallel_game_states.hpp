@@ -0,0 +1,12 @@
+#pragma once
+
+
+#include "parser_context.hpp"
+
+
+// Parses the gamestates of a demo on separate threads and merges the plug-in data back into the context
+// as if the demo had been parsed in one go. Each thread parses from a gamestate message to the next one.
+// The context's parser must have been initialized for the demo but not run.
+// Returns false when the demo should be parsed sequentially instead: no file was read by the parser yet.
+// Otherwise, success tells whether all the gamestates were parsed successfully.
+extern bool ParseGameStatesInParallel(bool& success, udtParserContext* context, const udtParseArg* info, const char* demoFilePath);
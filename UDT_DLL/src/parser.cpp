@@ -2,6 +2,9 @@
 #include "utils.hpp"
 #include "scoped_stack_allocator.hpp"
 #include "path.hpp"
+#include "instrumentation.hpp"
+
+#include <stdlib.h>
 
 
 udtBaseParser::udtBaseParser() 
@@ -13,6 +16,8 @@ udtBaseParser::udtBaseParser()
 
 	UserData = NULL;
 	EnablePlugIns = true;
+	DecodeAllSnapshots = false;
+	SkipCommandsBeforeGameState = false;
 
 	_inFileName = udtString::NewEmptyConstant();
 	_inFilePath = udtString::NewEmptyConstant();
@@ -26,13 +31,10 @@ udtBaseParser::udtBaseParser()
 	_inGameStateIndex = -1;
 	_inServerTime = UDT_S32_MIN;
 	_inLastSnapshotMessageNumber = UDT_S32_MIN;
-
-	_outFileName = udtString::NewEmptyConstant();
-	_outFilePath = udtString::NewEmptyConstant();
-	_outServerCommandSequence = 0;
-	_outSnapshotsWritten = 0;
-	_outWriteFirstMessage = false;
-	_outWriteMessage = false;
+	_inReadSnapshotMessageNumber = UDT_S32_MIN;
+	_inReadSnapshotDeltaNum = -1;
+	_inSkippedSnapshots = false;
+	_inPlugInsDone = false;
 }
 
 udtBaseParser::~udtBaseParser()
@@ -48,6 +50,10 @@ bool udtBaseParser::Init(udtContext* context, udtProtocol::Id inProtocol, udtPro
 	}
 
 	EnablePlugIns = enablePlugIns;
+	DecodeAllSnapshots = false;
+	SkipCommandsBeforeGameState = false;
+	_inSkippedSnapshots = false;
+	_inPlugInsDone = false;
 
 	_context = context;
 	_inProtocol = inProtocol;
@@ -57,14 +63,15 @@ bool udtBaseParser::Init(udtContext* context, udtProtocol::Id inProtocol, udtPro
 	_protocolConverter = context->GetProtocolConverter(outProtocol, inProtocol);
 	_protocolConverter->ResetForNextDemo();
 
-	_outMsg.InitContext(context);
-	_outMsg.InitProtocol(outProtocol);
-
 	_inFileName = udtString::NewEmptyConstant();
 	_inFilePath = udtString::NewEmptyConstant();
-	_outFileName = udtString::NewEmptyConstant();
-	_outFilePath = udtString::NewEmptyConstant();
 
+	// Outputs left open by a demo that wasn't finished are closed without their end marker.
+	for(u32 i = 0, count = _outputs.GetSize(); i < count; ++i)
+	{
+		_outputs[i]->File.Close();
+		_outputs[i]->WriteMessage = false;
+	}
 	_cuts.Clear();
 	_persistentAllocator.Clear();
 	_configStringAllocator.Clear();
@@ -85,6 +92,7 @@ bool udtBaseParser::Init(udtContext* context, udtProtocol::Id inProtocol, udtPro
 	{
 		for(u32 i = 0; i < PlugIns.GetSize(); ++i)
 		{
+			UDT_INSTRUMENT_PLUG_IN(PlugIns[i]->Id);
 			PlugIns[i]->StartProcessingDemo();
 		}
 	}
@@ -102,11 +110,14 @@ void udtBaseParser::ResetForGamestateMessage()
 	_inParseEntitiesNum = 0;
 	_inServerTime = UDT_S32_MIN;
 	_inLastSnapshotMessageNumber = UDT_S32_MIN;
+	_inReadSnapshotMessageNumber = UDT_S32_MIN;
+	_inReadSnapshotDeltaNum = -1;
 
-	_outServerCommandSequence = 0;
-	_outSnapshotsWritten = 0;
-	_outWriteFirstMessage = false;
-	_outWriteMessage = false;
+	// The cuts being written get finished by UpdateCuts at the end of this message.
+	for(u32 i = 0, count = _outputs.GetSize(); i < count; ++i)
+	{
+		_outputs[i]->CopyMessage = false;
+	}
 
 	memset(_inEntityBaselines, 0, sizeof(_inEntityBaselines));
 	memset(_inSnapshots, 0, sizeof(_inSnapshots));
@@ -129,6 +140,7 @@ void udtBaseParser::SetFilePath(const char* filePath)
 
 void udtBaseParser::Destroy()
 {
+	DestroyCutOutputs();
 }
 
 bool udtBaseParser::ParseNextMessage(const udtMessage& inMsg, s32 inServerMessageSequence, u32 fileOffset)
@@ -143,9 +155,18 @@ bool udtBaseParser::ParseNextMessage(const udtMessage& inMsg, s32 inServerMessag
 
 bool udtBaseParser::ParseServerMessage()
 {
-	_outMsg.Init(_outMsgData, sizeof(_outMsgData));
+	UDT_INSTRUMENT_STAGE(ParseMessage);
 
-	_outMsg.SetHuffman(_outProtocol >= udtProtocol::Dm66);
+	for(u32 i = 0, count = _outputs.GetSize(); i < count; ++i)
+	{
+		udtCutOutput& output = *_outputs[i];
+		if(output.WriteMessage)
+		{
+			output.Msg.Init(output.MsgData, sizeof(output.MsgData));
+			output.CopyMessage = CanCopyMessage(output);
+			output.Msg.SetHuffman(_outProtocol >= udtProtocol::Dm66);
+		}
+	}
 	_inMsg.SetHuffman(_inProtocol >= udtProtocol::Dm66);
 
 	//
@@ -163,21 +184,26 @@ bool udtBaseParser::ParseServerMessage()
 		}
 	}
 	_inReliableSequenceAcknowledge = reliableSequenceAcknowledge;
-	if(ShouldWriteMessage())
+	for(u32 i = 0, count = _outputs.GetSize(); i < count; ++i)
 	{
-		_outMsg.WriteLong(_inReliableSequenceAcknowledge);
+		if(ShouldWriteMessage(*_outputs[i]))
+		{
+			_outputs[i]->Msg.WriteLong(_inReliableSequenceAcknowledge);
+		}
 	}
 
-	if(EnablePlugIns && !PlugIns.IsEmpty())
+	if(EnablePlugIns && !_messageBundleStartPlugIns.IsEmpty())
 	{
 		udtMessageBundleCallbackArg info;
 		info.ReliableSequenceAcknowledge = reliableSequenceAcknowledge;
-		for(u32 i = 0, count = PlugIns.GetSize(); i < count; ++i)
+		for(u32 i = 0, count = _messageBundleStartPlugIns.GetSize(); i < count; ++i)
 		{
-			PlugIns[i]->ProcessMessageBundleStart(info, *this);
+			UDT_INSTRUMENT_PLUG_IN(_messageBundleStartPlugIns[i]->Id);
+			_messageBundleStartPlugIns[i]->ProcessMessageBundleStart(info, *this);
 		}
 	}
 
+	bool skipMessageEnd = false;
 	for(;;)
 	{
 		if(_inMsg.Buffer.readcount > _inMsg.Buffer.cursize) 
@@ -202,9 +228,12 @@ bool udtBaseParser::ParseServerMessage()
 		switch(command) 
 		{
 		case svc_nop:
-			if(ShouldWriteMessage())
+			for(u32 i = 0, count = _outputs.GetSize(); i < count; ++i)
 			{
-				_outMsg.WriteByte(svc_nop);
+				if(ShouldWriteMessage(*_outputs[i]))
+				{
+					_outputs[i]->Msg.WriteByte(svc_nop);
+				}
 			}
 			break;
 
@@ -217,6 +246,13 @@ bool udtBaseParser::ParseServerMessage()
 			break;
 
 		case svc_snapshot:
+			if(!ShouldDecodeSnapshot())
+			{
+				// Nothing else follows the snapshot in a message.
+				if(!SkipSnapshot()) return false;
+				skipMessageEnd = true;
+				break;
+			}
 			if(!ParseSnapshot()) return false;
 			break;
 
@@ -227,120 +263,88 @@ bool udtBaseParser::ParseServerMessage()
 			return false;
 		}
 
+		if(skipMessageEnd)
+		{
+			break;
+		}
+
 		if(_inProtocol <= udtProtocol::Dm48)
 		{
 			_inMsg.GoToNextByte();
 		}
 	}
 
-	if(ShouldWriteMessage())
+	for(u32 i = 0, count = _outputs.GetSize(); i < count; ++i)
 	{
-		_outMsg.WriteByte(svc_EOF);
+		if(ShouldWriteMessage(*_outputs[i]))
+		{
+			_outputs[i]->Msg.WriteByte(svc_EOF);
+		}
 	}
 
-	if(EnablePlugIns && !PlugIns.IsEmpty())
+	if(EnablePlugIns && !_messageBundleEndPlugIns.IsEmpty())
 	{
 		udtMessageBundleCallbackArg info;
 		info.ReliableSequenceAcknowledge = reliableSequenceAcknowledge;
-		for(u32 i = 0, count = PlugIns.GetSize(); i < count; ++i)
+		for(u32 i = 0, count = _messageBundleEndPlugIns.GetSize(); i < count; ++i)
 		{
-			PlugIns[i]->ProcessMessageBundleEnd(info, *this);
+			UDT_INSTRUMENT_PLUG_IN(_messageBundleEndPlugIns[i]->Id);
+			_messageBundleEndPlugIns[i]->ProcessMessageBundleEnd(info, *this);
 		}
 	}
 
-	if(_cuts.GetSize() > 0)
+	if(!_cuts.IsEmpty() && !UpdateCuts())
 	{
-		const udtCutInfo cut = _cuts[0];
-		const s32 gameTime = _inServerTime;
-
-		if(_inGameStateIndex == cut.GameStateIndex && !_outWriteMessage &&
-		   gameTime >= cut.StartTimeMs && gameTime <= cut.EndTimeMs)
-		{
-			const bool wroteMessage = _outWriteMessage;
-			_outWriteMessage = true;
-			_outWriteFirstMessage = _outWriteMessage && !wroteMessage;
-		}
-		else if((_inGameStateIndex == cut.GameStateIndex && _outWriteMessage && gameTime > cut.EndTimeMs) ||
-				(_inGameStateIndex > cut.GameStateIndex && _outWriteMessage))
-		{
-			WriteLastMessage();
-			_outWriteMessage = false;
-			_outWriteFirstMessage = false;
-			_outServerCommandSequence = 0;
-			_outSnapshotsWritten = 0;
-			_outFile.Close();
-			_cuts.Remove(0);
-			if(_cuts.GetSize() == 0)
-			{
-				// It was the last cut, we're done parsing the file now.
-				return false;
-			}
-		}
+		// It was the last cut, we're done parsing the file now.
+		return false;
 	}
 
-	if(_outWriteFirstMessage)
+	if(AreAllPlugInsDone())
 	{
-		udtCutInfo& cut = _cuts[0];
-		udtString filePath;
-		if(cut.FilePath != NULL)
-		{
-			filePath = udtString::NewConstRef(cut.FilePath);
-		}
-		else
-		{
-			udtDemoStreamCreatorArg info;
-			memset(&info, 0, sizeof(info));
-			info.StartTimeMs = cut.StartTimeMs;
-			info.EndTimeMs = cut.EndTimeMs;
-			info.Parser = this;
-			info.VeryShortDesc = cut.VeryShortDesc;
-			info.UserData = cut.UserData;
-			info.TempAllocator = &_tempAllocator;
-			info.FilePathAllocator = &_persistentAllocator;
-			filePath = (*cut.StreamCreator)(info);
-		}
-		_outFile.Close();
-		if(_outFile.Open(filePath.GetPtr(), udtFileOpenMode::Write))
-		{
-			_outFilePath = filePath;
-			udtPath::GetFileName(_outFileName, _persistentAllocator, filePath);
-			_outMsg.SetFileName(_outFileName);
-			WriteFirstMessage();
-			_outWriteFirstMessage = false;
-		}
-		else
-		{
-			_cuts.Remove(0);
-		}
+		// Nothing left to learn from this demo.
+		_inPlugInsDone = true;
+		return false;
 	}
-	else if(_outWriteMessage)
+
+	return true;
+}
+
+bool udtBaseParser::HandleInvalidMessageLength()
+{
+	// A snapshot that wasn't decoded could have been the first sign of corruption,
+	// so we keep what was read so far like ParseSnapshot's errors would have.
+	if(_inSkippedSnapshots)
 	{
-		WriteNextMessage();
+		_context->LogWarning("Demo file %s has a message length greater than MAX_SIZE", GetFileNamePtr());
+		return true;
 	}
 
-	return true;
+	_context->LogError("Demo file %s has a message length greater than MAX_SIZE", GetFileNamePtr());
+
+	return false;
 }
 
 void udtBaseParser::FinishParsing(bool /*success*/)
 {
-	// Close any output file stream that is still open, if any.
-	if(!_cuts.IsEmpty() && _outWriteMessage)
+	// Close the output file streams that are still open, if any.
+	for(u32 i = 0, count = _outputs.GetSize(); i < count; ++i)
 	{
-		WriteLastMessage();
-		_outWriteMessage = false;
-		_outWriteFirstMessage = false;
-		_outServerCommandSequence = 0;
-		_outSnapshotsWritten = 0;
-		_outFile.Close();
-		_cuts.Clear();
+		if(_outputs[i]->WriteMessage)
+		{
+			FinishCut(*_outputs[i]);
+		}
 	}
+	_cuts.Clear();
 
-	if(EnablePlugIns)
+	if(EnablePlugIns && !PlugIns.IsEmpty())
 	{
 		for(u32 i = 0, count = PlugIns.GetSize(); i < count; ++i)
 		{
+			UDT_INSTRUMENT_PLUG_IN(PlugIns[i]->Id);
 			PlugIns[i]->FinishProcessingDemo();
 		}
+
+		PlugInEarlyExits.Add(_inPlugInsDone ? 1 : 0);
 	}
 }
 
@@ -368,41 +372,341 @@ void udtBaseParser::AddCut(s32 gsIndex, s32 startTimeMs, s32 endTimeMs, const ch
 	_cuts.Add(cut);
 }
 
-bool udtBaseParser::ShouldWriteMessage() const
+void udtBaseParser::SaveCheckpoint(udtParserCheckpoint& checkpoint, bool saveBaselines) const
+{
+	checkpoint.ServerMessageSequence = _inServerMessageSequence;
+	checkpoint.ServerCommandSequence = _inServerCommandSequence;
+	checkpoint.ReliableSequenceAcknowledge = _inReliableSequenceAcknowledge;
+	checkpoint.ClientNum = _inClientNum;
+	checkpoint.ChecksumFeed = _inChecksumFeed;
+	checkpoint.ParseEntitiesNum = _inParseEntitiesNum;
+	checkpoint.ServerTime = _inServerTime;
+	checkpoint.GameStateIndex = _inGameStateIndex;
+	checkpoint.LastSnapshotMessageNumber = _inLastSnapshotMessageNumber;
+	if(saveBaselines)
+	{
+		memcpy(checkpoint.EntityBaselines, _inEntityBaselines, sizeof(_inEntityBaselines));
+	}
+	memcpy(checkpoint.ParseEntities, _inParseEntities, sizeof(_inParseEntities));
+	memcpy(checkpoint.Snapshots, _inSnapshots, sizeof(_inSnapshots));
+	memcpy(checkpoint.EntityEventTimesMs, _inEntityEventTimesMs, sizeof(_inEntityEventTimesMs));
+	memcpy(checkpoint.BigConfigString, _inBigConfigString, sizeof(_inBigConfigString));
+
+	checkpoint.GameStateFileOffsets.Clear();
+	for(u32 i = 0, count = _inGameStateFileOffsets.GetSize(); i < count; ++i)
+	{
+		checkpoint.GameStateFileOffsets.Add(_inGameStateFileOffsets[i]);
+	}
+
+	// The config strings live in an allocator that gets cleared with every new gamestate message,
+	// so we need our own copies.
+	checkpoint.ConfigStringAllocator.Clear();
+	for(u32 i = 0; i < (u32)UDT_COUNT_OF(_inConfigStrings); ++i)
+	{
+		const udtString& cs = _inConfigStrings[i];
+		checkpoint.ConfigStrings[i] = udtString::IsNull(cs) ? cs : udtString::NewCloneFromRef(checkpoint.ConfigStringAllocator, cs);
+	}
+}
+
+void udtBaseParser::LoadCheckpoint(const udtParserCheckpoint& checkpoint)
+{
+	_inServerMessageSequence = checkpoint.ServerMessageSequence;
+	_inServerCommandSequence = checkpoint.ServerCommandSequence;
+	_inReliableSequenceAcknowledge = checkpoint.ReliableSequenceAcknowledge;
+	_inClientNum = checkpoint.ClientNum;
+	_inChecksumFeed = checkpoint.ChecksumFeed;
+	_inParseEntitiesNum = checkpoint.ParseEntitiesNum;
+	_inServerTime = checkpoint.ServerTime;
+	_inGameStateIndex = checkpoint.GameStateIndex;
+	_inLastSnapshotMessageNumber = checkpoint.LastSnapshotMessageNumber;
+	memcpy(_inEntityBaselines, checkpoint.EntityBaselines, sizeof(_inEntityBaselines));
+	memcpy(_inParseEntities, checkpoint.ParseEntities, sizeof(_inParseEntities));
+	memcpy(_inSnapshots, checkpoint.Snapshots, sizeof(_inSnapshots));
+	memcpy(_inEntityEventTimesMs, checkpoint.EntityEventTimesMs, sizeof(_inEntityEventTimesMs));
+	memcpy(_inBigConfigString, checkpoint.BigConfigString, sizeof(_inBigConfigString));
+
+	_inGameStateFileOffsets.Clear();
+	for(u32 i = 0, count = checkpoint.GameStateFileOffsets.GetSize(); i < count; ++i)
+	{
+		_inGameStateFileOffsets.Add(checkpoint.GameStateFileOffsets[i]);
+	}
+
+	_configStringAllocator.Clear();
+	for(u32 i = 0; i < (u32)UDT_COUNT_OF(_inConfigStrings); ++i)
+	{
+		const udtString& cs = checkpoint.ConfigStrings[i];
+		_inConfigStrings[i] = udtString::IsNull(cs) ? cs : udtString::NewCloneFromRef(_configStringAllocator, cs);
+	}
+
+	_tempAllocator.Clear();
+	_privateTempAllocator.Clear();
+}
+
+bool udtBaseParser::IsWritingCuts() const
+{
+	for(u32 i = 0, count = _outputs.GetSize(); i < count; ++i)
+	{
+		if(_outputs[i]->WriteMessage)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool udtBaseParser::UpdateCuts()
+{
+	const s32 gsIndex = _inGameStateIndex;
+	const s32 gameTime = _inServerTime;
+
+	// The cuts are independent of each other: any number of them can be written at the same time.
+	for(u32 i = 0; i < _cuts.GetSize();)
+	{
+		udtCutInfo& cut = _cuts[i];
+		const bool cutOver = gsIndex > cut.GameStateIndex || (gsIndex == cut.GameStateIndex && gameTime > cut.EndTimeMs);
+		bool removeCut = false;
+		if(cut.Output != NULL)
+		{
+			if(cutOver)
+			{
+				FinishCut(*cut.Output);
+				removeCut = true;
+			}
+			else
+			{
+				WriteNextMessage(*cut.Output);
+			}
+		}
+		else if(gsIndex == cut.GameStateIndex && gameTime >= cut.StartTimeMs && gameTime <= cut.EndTimeMs)
+		{
+			udtCutOutput* const output = GetFreeCutOutput();
+			removeCut = output == NULL || !StartCut(*output, i);
+		}
+		else if(gsIndex > cut.GameStateIndex)
+		{
+			// No message of the demo falls in that time range.
+			// We don't go by the time since the message with the gamestate still has the previous one's.
+			removeCut = true;
+		}
+
+		if(removeCut)
+		{
+			// Keep the order so that the first cut is always the first to be written.
+			_cuts.Remove(i);
+			if(_cuts.IsEmpty())
+			{
+				return false;
+			}
+			continue;
+		}
+
+		++i;
+	}
+
+	return true;
+}
+
+bool udtBaseParser::StartCut(udtCutOutput& output, u32 cutIndex)
+{
+	udtCutInfo& cut = _cuts[cutIndex];
+	udtString filePath;
+	if(cut.FilePath != NULL)
+	{
+		filePath = udtString::NewConstRef(cut.FilePath);
+	}
+	else
+	{
+		udtDemoStreamCreatorArg info;
+		memset(&info, 0, sizeof(info));
+		info.StartTimeMs = cut.StartTimeMs;
+		info.EndTimeMs = cut.EndTimeMs;
+		info.Parser = this;
+		info.VeryShortDesc = cut.VeryShortDesc;
+		info.UserData = cut.UserData;
+		info.TempAllocator = &_tempAllocator;
+		info.FilePathAllocator = &_persistentAllocator;
+		filePath = (*cut.StreamCreator)(info);
+	}
+
+	output.File.Close();
+	if(!output.File.Open(filePath.GetPtr(), udtFileOpenMode::Write))
+	{
+		return false;
+	}
+
+	output.FilePath = filePath;
+	udtPath::GetFileName(output.FileName, _persistentAllocator, filePath);
+	output.Msg.SetFileName(output.FileName);
+	// Reused outputs still hold the previous cut's last message and fresh ones hold garbage.
+	// Starting from zeroes keeps the output independent of which cuts ran before it.
+	memset(output.MsgData, 0, sizeof(output.MsgData));
+	output.ServerCommandSequence = 0;
+	output.SnapshotsWritten = 0;
+	output.CopyMessage = false;
+	output.WriteMessage = true;
+	cut.Output = &output;
+	WriteFirstMessage(output);
+
+	return true;
+}
+
+void udtBaseParser::FinishCut(udtCutOutput& output)
 {
-	return _outWriteMessage && _outProtocol >= udtProtocol::Dm66;
+	WriteLastMessage(output);
+	output.WriteMessage = false;
+	output.CopyMessage = false;
+	output.ServerCommandSequence = 0;
+	output.SnapshotsWritten = 0;
+	output.File.Close();
 }
 
-void udtBaseParser::WriteFirstMessage()
+udtBaseParser::udtCutOutput* udtBaseParser::GetFreeCutOutput()
 {
-	WriteGameState();
-	const s32 length = _outMsg.Buffer.cursize;
-	udtStream& stream = _outFile;
+	udtCutOutput* output = NULL;
+	for(u32 i = 0, count = _outputs.GetSize(); i < count; ++i)
+	{
+		if(!_outputs[i]->WriteMessage)
+		{
+			output = _outputs[i];
+			break;
+		}
+	}
+
+	if(output == NULL)
+	{
+		// @NOTE: We don't use the standard operator new approach to avoid C++ exceptions.
+		output = (udtCutOutput*)malloc(sizeof(udtCutOutput));
+		if(output == NULL)
+		{
+			return NULL;
+		}
+
+		new (output) udtCutOutput;
+		output->FilePath = udtString::NewEmptyConstant();
+		output->FileName = udtString::NewEmptyConstant();
+		output->ServerCommandSequence = 0;
+		output->SnapshotsWritten = 0;
+		output->WriteMessage = false;
+		output->CopyMessage = false;
+		_outputs.Add(output);
+	}
+
+	// The protocol and context can change from one demo to the next.
+	output->Msg.InitContext(_context);
+	output->Msg.InitProtocol(_outProtocol);
+
+	return output;
+}
+
+void udtBaseParser::DestroyCutOutputs()
+{
+	for(u32 i = 0, count = _outputs.GetSize(); i < count; ++i)
+	{
+		_outputs[i]->~udtCutOutput();
+		free(_outputs[i]);
+	}
+	_outputs.Clear();
+}
+
+bool udtBaseParser::ShouldWriteMessage(const udtCutOutput& output) const
+{
+	return output.WriteMessage && !output.CopyMessage && _outProtocol >= udtProtocol::Dm66;
+}
+
+bool udtBaseParser::CanCopyMessage(const udtCutOutput& output) const
+{
+	//
+	// A message can be written verbatim when the output would decode to the same thing:
+	// - same protocol (dm_66 and dm_67 messages get their reliable acknowledge number rewritten)
+	// - no plug-in can modify the snapshots
+	// - every snapshot it can delta from is in the output already
+	// - the output's reliable command sequence numbers are still those of the input
+	//
+	return
+		output.WriteMessage &&
+		_outProtocol == _inProtocol &&
+		_outProtocol >= udtProtocol::Dm68 &&
+		!(EnablePlugIns && !_snapshotPlugIns.IsEmpty()) &&
+		output.SnapshotsWritten >= PACKET_BACKUP &&
+		output.ServerCommandSequence == _inServerCommandSequence + 1;
+}
+
+void udtBaseParser::WriteFirstMessage(udtCutOutput& output)
+{
+	UDT_INSTRUMENT_STAGE(WriteOutput);
+
+	if(_outProtocol == _inProtocol && _outProtocol >= udtProtocol::Dm68)
+	{
+		// Keep the input's reliable command numbers so that later messages can be copied as is.
+		// Older protocols never take the copy path, so their numbering stays as it always was.
+		output.ServerCommandSequence = _inServerCommandSequence;
+	}
+
+	WriteGameState(output);
+	const s32 length = output.Msg.Buffer.cursize;
+	udtStream& stream = output.File;
 	stream.Write(&_inServerMessageSequence, 4, 1);
 	stream.Write(&length, 4, 1);
-	stream.Write(_outMsg.Buffer.data, length, 1);
+	stream.Write(output.Msg.Buffer.data, length, 1);
 }
 
-void udtBaseParser::WriteNextMessage()
+void udtBaseParser::WriteNextMessage(udtCutOutput& output)
 {
-	const s32 length = _outMsg.Buffer.cursize;
-	udtStream& stream = _outFile;
+	UDT_INSTRUMENT_STAGE(WriteOutput);
+
+	udtStream& stream = output.File;
+	if(output.CopyMessage)
+	{
+		// All the commands it holds are now in the output with their original numbers.
+		const s32 length = _inMsg.Buffer.cursize;
+		stream.Write(&_inServerMessageSequence, 4, 1);
+		stream.Write(&length, 4, 1);
+		stream.Write(_inMsg.Buffer.data, length, 1);
+		output.ServerCommandSequence = _inServerCommandSequence + 1;
+		return;
+	}
+
+	const s32 length = output.Msg.Buffer.cursize;
 	stream.Write(&_inServerMessageSequence, 4, 1);
 	stream.Write(&length, 4, 1);
-	stream.Write(_outMsg.Buffer.data, length, 1);
+	stream.Write(output.Msg.Buffer.data, length, 1);
 }
 
-void udtBaseParser::WriteLastMessage()
+void udtBaseParser::WriteLastMessage(udtCutOutput& output)
 {
-	udtStream& stream = _outFile;
+	UDT_INSTRUMENT_STAGE(WriteOutput);
+
+	udtStream& stream = output.File;
 	s32 length = -1;
 	stream.Write(&length, 4, 1);
 	stream.Write(&length, 4, 1);
 	stream.Close();
 }
 
+void udtBaseParser::WriteCommand(udtCutOutput& output, const udtString& commandString, s32 commandStringLength, s32 csIndex)
+{
+	if(csIndex >= 0 && commandStringLength >= MAX_STRING_CHARS)
+	{
+		WriteBigConfigStringCommand(output, _tokenizer.GetArg(1), _tokenizer.GetArg(2));
+	}
+	else if(commandStringLength < MAX_STRING_CHARS)
+	{
+		output.Msg.WriteByte(svc_serverCommand);
+		output.Msg.WriteLong(output.ServerCommandSequence);
+		output.Msg.WriteString(commandString.GetPtr(), commandStringLength);
+		++output.ServerCommandSequence;
+	}
+	else
+	{
+		output.Msg.WriteByte(svc_nop);
+	}
+}
+
 bool udtBaseParser::ParseCommandString()
 {
+	UDT_INSTRUMENT_STAGE(ParseCommand);
+
 	s32 commandStringLength = 0;
 	const s32 commandSequence = _inMsg.ReadLong();
 	const char* const commandStringTemp = _inMsg.ReadString(commandStringLength);
@@ -475,7 +779,12 @@ tokenize:
 		goto tokenize;
 	}
 
-	if(EnablePlugIns && !PlugIns.IsEmpty() && !plugInSkipsThisCommand)
+	if(SkipCommandsBeforeGameState && _inGameStateIndex < 0)
+	{
+		plugInSkipsThisCommand = true;
+	}
+
+	if(EnablePlugIns && !_commandPlugIns.IsEmpty() && !plugInSkipsThisCommand)
 	{
 		udtCommandCallbackArg info;
 		info.CommandSequence = commandSequence;
@@ -485,28 +794,18 @@ tokenize:
 		info.IsConfigString = isConfigString;
 		info.IsEmptyConfigString = isConfigString ? udtString::IsNullOrEmpty(tokenizer.GetArg(2)) : false;
 
-		for(u32 i = 0, count = PlugIns.GetSize(); i < count; ++i)
+		for(u32 i = 0, count = _commandPlugIns.GetSize(); i < count; ++i)
 		{
-			PlugIns[i]->ProcessCommandMessage(info, *this);
+			UDT_INSTRUMENT_PLUG_IN(_commandPlugIns[i]->Id);
+			_commandPlugIns[i]->ProcessCommandMessage(info, *this);
 		}
 	}
 
-	if(ShouldWriteMessage())
+	for(u32 i = 0, count = _outputs.GetSize(); i < count; ++i)
 	{
-		if(csIndex >= 0 && commandStringLength >= MAX_STRING_CHARS)
-		{
-			WriteBigConfigStringCommand(tokenizer.GetArg(1), tokenizer.GetArg(2));
-		}
-		else if(commandStringLength < MAX_STRING_CHARS)
-		{
-			_outMsg.WriteByte(svc_serverCommand);
-			_outMsg.WriteLong(_outServerCommandSequence);
-			_outMsg.WriteString(commandString.GetPtr(), commandStringLength);
-			++_outServerCommandSequence;
-		}
-		else
+		if(ShouldWriteMessage(*_outputs[i]))
 		{
-			_outMsg.WriteByte(svc_nop);
+			WriteCommand(*_outputs[i], commandString, commandStringLength, csIndex);
 		}
 	}
 	
@@ -517,6 +816,8 @@ tokenize:
 
 bool udtBaseParser::ParseGamestate()
 {
+	UDT_INSTRUMENT_STAGE(ParseGameState);
+
 	// @TODO: Reset some data, but not for the 1st gamestate message.
 	ResetForGamestateMessage();
 
@@ -594,16 +895,17 @@ bool udtBaseParser::ParseGamestate()
 		_inChecksumFeed = 0;
 	}
 
-	if(EnablePlugIns && !PlugIns.IsEmpty())
+	if(EnablePlugIns && !_gamestatePlugIns.IsEmpty())
 	{
 		udtGamestateCallbackArg info;
 		info.ServerCommandSequence = _inServerCommandSequence;
 		info.ClientNum = _inClientNum;
 		info.ChecksumFeed = _inChecksumFeed;
 
-		for(u32 i = 0, count = PlugIns.GetSize(); i < count; ++i)
+		for(u32 i = 0, count = _gamestatePlugIns.GetSize(); i < count; ++i)
 		{
-			PlugIns[i]->ProcessGamestateMessage(info, *this);
+			UDT_INSTRUMENT_PLUG_IN(_gamestatePlugIns[i]->Id);
+			_gamestatePlugIns[i]->ProcessGamestateMessage(info, *this);
 		}
 	}
 
@@ -613,8 +915,62 @@ bool udtBaseParser::ParseGamestate()
 	return true;
 }
 
+bool udtBaseParser::ShouldDecodeSnapshot() const
+{
+	// Cuts need the full snapshot data to be written out.
+	return DecodeAllSnapshots || !_cuts.IsEmpty() || (EnablePlugIns && !_snapshotPlugIns.IsEmpty());
+}
+
+bool udtBaseParser::AreAllPlugInsDone() const
+{
+	// Cuts and direct readers of the parser state need the whole file.
+	if(!EnablePlugIns || PlugIns.IsEmpty() || !_cuts.IsEmpty() || DecodeAllSnapshots)
+	{
+		return false;
+	}
+
+	for(u32 i = 0, count = PlugIns.GetSize(); i < count; ++i)
+	{
+		if(!PlugIns[i]->IsJobDone())
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool udtBaseParser::SkipSnapshot()
+{
+	UDT_INSTRUMENT_STAGE(ParseSnapshot);
+
+	// Plug-ins subscribed to commands still get accurate time stamps.
+	if(_inProtocol == udtProtocol::Dm3)
+	{
+		_inMsg.ReadLong(); // Client command sequence.
+	}
+
+	_inServerTime = _inMsg.ReadLong();
+	_inMsg.ReadByte(); // Delta number.
+	_inMsg.ReadByte(); // Snapshot flags.
+
+	// The cheap checks of ParseSnapshot still apply.
+	const s32 areaMaskLength = _inMsg.ReadByte();
+	if(areaMaskLength > (s32)sizeof(idLargestClientSnapshot::areamask))
+	{
+		_context->LogError("udtBaseParser::SkipSnapshot: Invalid size %d for areamask (in file: %s)", areaMaskLength, GetFileNamePtr());
+		return false;
+	}
+
+	_inSkippedSnapshots = true;
+
+	return true;
+}
+
 bool udtBaseParser::ParseSnapshot()
 {
+	UDT_INSTRUMENT_STAGE(ParseSnapshot);
+
 	//
 	// Read in the new snapshot to a temporary buffer
 	// We will only save it if it is valid.
@@ -647,6 +1003,9 @@ bool udtBaseParser::ParseSnapshot()
 
 	newSnap.snapFlags = _inMsg.ReadByte();
 
+	_inReadSnapshotMessageNumber = newSnap.messageNum;
+	_inReadSnapshotDeltaNum = newSnap.deltaNum;
+
 	//
 	// If the frame is delta compressed from data that we
 	// no longer have available, we must suck up the rest of
@@ -718,14 +1077,6 @@ bool udtBaseParser::ParseSnapshot()
 		return false;
 	}
 
-	// Did we write enough snapshots already?
-	const bool noDelta = _outSnapshotsWritten < deltaNum;
-	if(noDelta) 
-	{
-		deltaNum = 0;
-		oldSnap = NULL;
-	}
-
 	// If not valid, dump the entire thing now that 
 	// it has been properly read.
 	if(!newSnap.valid)
@@ -765,7 +1116,7 @@ bool udtBaseParser::ParseSnapshot()
 	// Process plug-ins now so that modifiers can alter the snapshots.
 	//
 
-	if(EnablePlugIns && !PlugIns.IsEmpty())
+	if(EnablePlugIns && !_snapshotPlugIns.IsEmpty())
 	{
 		_inEntities.Clear();
 		_inEntityFlags.Clear();
@@ -804,9 +1155,10 @@ bool udtBaseParser::ParseSnapshot()
 		info.CommandNumber = newSnap.serverCommandNum;
 		info.MessageNumber = newSnap.messageNum;
 
-		for(u32 i = 0, count = PlugIns.GetSize(); i < count; ++i)
+		for(u32 i = 0, count = _snapshotPlugIns.GetSize(); i < count; ++i)
 		{
-			PlugIns[i]->ProcessSnapshotMessage(info, *this);
+			UDT_INSTRUMENT_PLUG_IN(_snapshotPlugIns[i]->Id);
+			_snapshotPlugIns[i]->ProcessSnapshotMessage(info, *this);
 		}
 	}
 
@@ -814,48 +1166,71 @@ bool udtBaseParser::ParseSnapshot()
 	// Write to the output message.
 	//
 
-	if(ShouldWriteMessage())
+	for(u32 i = 0, count = _outputs.GetSize(); i < count; ++i)
 	{
-		_outMsg.WriteByte(svc_snapshot);
-		_outMsg.WriteLong(newSnap.serverTime);
-		_outMsg.WriteByte(deltaNum);
-		_outMsg.WriteByte(newSnap.snapFlags);
-		_outMsg.WriteByte(areaMaskLength);
-		_outMsg.WriteData(&newSnap.areamask, areaMaskLength);
-		_protocolConverter->StartSnapshot(newSnap.serverTime);
-		if(_outProtocol == _inProtocol)
+		udtCutOutput& output = *_outputs[i];
+		if(ShouldWriteMessage(output))
 		{
-			_outMsg.WriteDeltaPlayer(oldSnap ? GetPlayerState(oldSnap, _outProtocol) : NULL, GetPlayerState(&newSnap, _outProtocol));
-			EmitPacketEntities(deltaNum ? oldSnap : NULL, &newSnap);
+			WriteSnapshot(output, newSnap, oldSnap, deltaNum, areaMaskLength);
 		}
-		else
+		else if(output.CopyMessage)
 		{
-			idLargestClientSnapshot oldSnapOutProto;
-			idLargestClientSnapshot newSnapOutProto;
-			if(oldSnap)
-			{
-				_protocolConverter->ConvertSnapshot(oldSnapOutProto, *oldSnap);
-			}
-			_protocolConverter->ConvertSnapshot(newSnapOutProto, newSnap);
-			_outMsg.WriteDeltaPlayer(oldSnap ? GetPlayerState(&oldSnapOutProto, _outProtocol) : NULL, GetPlayerState(&newSnapOutProto, _outProtocol));
-			EmitPacketEntities(deltaNum ? &oldSnapOutProto : NULL, &newSnapOutProto);
+			++output.SnapshotsWritten;
 		}
-		++_outSnapshotsWritten;
 	}
 
 	return true;
 }
 
-void udtBaseParser::WriteGameState()
+void udtBaseParser::WriteSnapshot(udtCutOutput& output, idClientSnapshotBase& newSnap, idClientSnapshotBase* oldSnap, s32 deltaNum, s32 areaMaskLength)
+{
+	// Did we write enough snapshots already?
+	const bool noDelta = output.SnapshotsWritten < deltaNum;
+	if(noDelta) 
+	{
+		deltaNum = 0;
+		oldSnap = NULL;
+	}
+
+	udtMessage& msg = output.Msg;
+	msg.WriteByte(svc_snapshot);
+	msg.WriteLong(newSnap.serverTime);
+	msg.WriteByte(deltaNum);
+	msg.WriteByte(newSnap.snapFlags);
+	msg.WriteByte(areaMaskLength);
+	msg.WriteData(&newSnap.areamask, areaMaskLength);
+	_protocolConverter->StartSnapshot(newSnap.serverTime);
+	if(_outProtocol == _inProtocol)
+	{
+		msg.WriteDeltaPlayer(oldSnap ? GetPlayerState(oldSnap, _outProtocol) : NULL, GetPlayerState(&newSnap, _outProtocol));
+		EmitPacketEntities(msg, deltaNum ? oldSnap : NULL, &newSnap);
+	}
+	else
+	{
+		idLargestClientSnapshot oldSnapOutProto;
+		idLargestClientSnapshot newSnapOutProto;
+		if(oldSnap)
+		{
+			_protocolConverter->ConvertSnapshot(oldSnapOutProto, *oldSnap);
+		}
+		_protocolConverter->ConvertSnapshot(newSnapOutProto, newSnap);
+		msg.WriteDeltaPlayer(oldSnap ? GetPlayerState(&oldSnapOutProto, _outProtocol) : NULL, GetPlayerState(&newSnapOutProto, _outProtocol));
+		EmitPacketEntities(msg, deltaNum ? &oldSnapOutProto : NULL, &newSnapOutProto);
+	}
+	++output.SnapshotsWritten;
+}
+
+void udtBaseParser::WriteGameState(udtCutOutput& output)
 {
-	_outMsg.Init(_outMsgData, sizeof(_outMsgData));
-	_outMsg.Bitstream();
+	udtMessage& msg = output.Msg;
+	msg.Init(output.MsgData, sizeof(output.MsgData));
+	msg.Bitstream();
 
-	_outMsg.WriteLong(_inReliableSequenceAcknowledge);
+	msg.WriteLong(_inReliableSequenceAcknowledge);
 
-	_outMsg.WriteByte(svc_gamestate);
-	_outMsg.WriteLong(_outServerCommandSequence);
-	++_outServerCommandSequence;
+	msg.WriteByte(svc_gamestate);
+	msg.WriteLong(output.ServerCommandSequence);
+	++output.ServerCommandSequence;
 
 	_protocolConverter->StartGameState();
 	
@@ -865,9 +1240,9 @@ void udtBaseParser::WriteGameState()
 		const udtString& cs = _inConfigStrings[i];
 		if(_outProtocol == _inProtocol && !udtString::IsNullOrEmpty(cs))
 		{
-			_outMsg.WriteByte(svc_configstring);
-			_outMsg.WriteShort((s32)i);
-			_outMsg.WriteBigString(cs.GetPtr(), cs.GetLength());
+			msg.WriteByte(svc_configstring);
+			msg.WriteShort((s32)i);
+			msg.WriteBigString(cs.GetPtr(), cs.GetLength());
 			continue;
 		}
 
@@ -877,9 +1252,9 @@ void udtBaseParser::WriteGameState()
 		_protocolConverter->ConvertConfigString(outCs, _tempAllocator, (s32)i, cs.GetPtr(), cs.GetLength());
 		if(outCs.Index >= 0 && outCs.String.GetLength() > 0)
 		{
-			_outMsg.WriteByte(svc_configstring);
-			_outMsg.WriteShort(outCs.Index);
-			_outMsg.WriteBigString(outCs.String.GetPtr(), outCs.String.GetLength());
+			msg.WriteByte(svc_configstring);
+			msg.WriteShort(outCs.Index);
+			msg.WriteBigString(outCs.String.GetPtr(), outCs.String.GetLength());
 		}
 	}
 
@@ -895,24 +1270,24 @@ void udtBaseParser::WriteGameState()
 		// Write the baseline entity if it's not filled with 0 integers.
 		if(memcmp(&nullState, newState, _inProtocolSizeOfEntityState))
 		{
-			_outMsg.WriteByte(svc_baseline);
+			msg.WriteByte(svc_baseline);
 
 			// @NOTE: MSG_WriteBits is called in there with newState.number as an argument.
 			idLargestEntityState newStateOutProto;
 			_protocolConverter->ConvertEntityState(newStateOutProto, *newState);
-			_outMsg.WriteDeltaEntity(&nullState, &newStateOutProto, true);
+			msg.WriteDeltaEntity(&nullState, &newStateOutProto, true);
 		}
 	}
 	
-	_outMsg.WriteByte(svc_EOF);
+	msg.WriteByte(svc_EOF);
 
-	_outMsg.WriteLong(_inClientNum);
-	_outMsg.WriteLong(_inChecksumFeed);
+	msg.WriteLong(_inClientNum);
+	msg.WriteLong(_inChecksumFeed);
 
-	_outMsg.WriteByte(svc_EOF);
+	msg.WriteByte(svc_EOF);
 }
 
-void udtBaseParser::WriteBigConfigStringCommand(const udtString& csIndex, const udtString& csData)
+void udtBaseParser::WriteBigConfigStringCommand(udtCutOutput& output, const udtString& csIndex, const udtString& csData)
 {
 	// Simple example:
 	// cs idx "name0\value0\name1\value1\name2\value2\name3\value3"
@@ -958,11 +1333,11 @@ void udtBaseParser::WriteBigConfigStringCommand(const udtString& csIndex, const
 		};
 		udtString::AppendMultiple(command, cmdPieces, (u32)UDT_COUNT_OF(cmdPieces));
 
-		_outMsg.WriteByte(svc_serverCommand);
-		_outMsg.WriteLong(_outServerCommandSequence);
-		_outMsg.WriteString(command.GetPtr(), (s32)command.GetLength());
+		output.Msg.WriteByte(svc_serverCommand);
+		output.Msg.WriteLong(output.ServerCommandSequence);
+		output.Msg.WriteString(command.GetPtr(), (s32)command.GetLength());
 
-		++_outServerCommandSequence;
+		++output.ServerCommandSequence;
 		dataOffset += maxDataLength;
 	}
 
@@ -970,6 +1345,8 @@ void udtBaseParser::WriteBigConfigStringCommand(const udtString& csIndex, const
 
 bool udtBaseParser::ParsePacketEntities(udtMessage& msg, idClientSnapshotBase* oldframe, idClientSnapshotBase* newframe)
 {
+	UDT_INSTRUMENT_STAGE(ParsePacketEntities);
+
 	_inChangedEntities.Clear();
 	_inRemovedEntities.Clear();
 
@@ -1091,7 +1468,7 @@ bool udtBaseParser::ParsePacketEntities(udtMessage& msg, idClientSnapshotBase* o
 //
 // Write a delta update of an entityState_t list to the output message.
 //
-void udtBaseParser::EmitPacketEntities(idClientSnapshotBase* from, idClientSnapshotBase* to)
+void udtBaseParser::EmitPacketEntities(udtMessage& msg, idClientSnapshotBase* from, idClientSnapshotBase* to)
 {
 	idEntityStateBase* oldent = 0;
 	idEntityStateBase* newent = 0;
@@ -1143,7 +1520,7 @@ void udtBaseParser::EmitPacketEntities(idClientSnapshotBase* from, idClientSnaps
 			idLargestEntityState newEntOutProto;
 			_protocolConverter->ConvertEntityState(oldEntOutProto, *oldent);
 			_protocolConverter->ConvertEntityState(newEntOutProto, *newent);
-			_outMsg.WriteDeltaEntity(&oldEntOutProto, &newEntOutProto, false);
+			msg.WriteDeltaEntity(&oldEntOutProto, &newEntOutProto, false);
 			oldindex++;
 			newindex++;
 			continue;
@@ -1157,7 +1534,7 @@ void udtBaseParser::EmitPacketEntities(idClientSnapshotBase* from, idClientSnaps
 			idEntityStateBase* baseline = GetBaseline(newnum);
 			_protocolConverter->ConvertEntityState(baselineOutProto, *baseline);
 			_protocolConverter->ConvertEntityState(newEntOutProto, *newent);
-			_outMsg.WriteDeltaEntity(&baselineOutProto, &newEntOutProto, true);
+			msg.WriteDeltaEntity(&baselineOutProto, &newEntOutProto, true);
 			newindex++;
 			continue;
 		}
@@ -1167,13 +1544,13 @@ void udtBaseParser::EmitPacketEntities(idClientSnapshotBase* from, idClientSnaps
 			// The old entity isn't present in the new message.
 			idLargestEntityState oldEntOutProto;
 			_protocolConverter->ConvertEntityState(oldEntOutProto, *oldent);
-			_outMsg.WriteDeltaEntity(&oldEntOutProto, NULL, true);
+			msg.WriteDeltaEntity(&oldEntOutProto, NULL, true);
 			oldindex++;
 			continue;
 		}
 	}
 
-	_outMsg.WriteBits(MAX_GENTITIES - 1, GENTITYNUM_BITS);
+	msg.WriteBits(MAX_GENTITIES - 1, GENTITYNUM_BITS);
 }
 
 //
@@ -1240,4 +1617,22 @@ const udtString udtBaseParser::GetConfigString(s32 csIndex) const
 void udtBaseParser::AddPlugIn(udtBaseParserPlugIn* plugIn)
 {
 	PlugIns.Add(plugIn);
+
+	const u32 events = plugIn->SubscribedEvents;
+	if(events & UDT_PLUG_IN_EVENT_BIT(MessageBundleStart)) _messageBundleStartPlugIns.Add(plugIn);
+	if(events & UDT_PLUG_IN_EVENT_BIT(MessageBundleEnd))   _messageBundleEndPlugIns.Add(plugIn);
+	if(events & UDT_PLUG_IN_EVENT_BIT(Gamestate))          _gamestatePlugIns.Add(plugIn);
+	if(events & UDT_PLUG_IN_EVENT_BIT(Snapshot))           _snapshotPlugIns.Add(plugIn);
+	if(events & UDT_PLUG_IN_EVENT_BIT(Command))            _commandPlugIns.Add(plugIn);
+}
+
+void udtBaseParser::ClearPlugIns()
+{
+	PlugIns.Clear();
+	_messageBundleStartPlugIns.Clear();
+	_messageBundleEndPlugIns.Clear();
+	_gamestatePlugIns.Clear();
+	_snapshotPlugIns.Clear();
+	_commandPlugIns.Clear();
+	PlugInEarlyExits.Clear();
 }
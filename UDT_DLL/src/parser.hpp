@@ -29,11 +29,36 @@ struct udtBaseParser;
 typedef udtString (*udtDemoNameCreator)(const udtDemoStreamCreatorArg& info);
 
 
+// The decoding state of a parser in between 2 messages.
+// Don't ever allocate an instance of this on the stack.
+struct udtParserCheckpoint
+{
+	udtVMLinearAllocator ConfigStringAllocator { "ParserCheckpoint::ConfigStrings" };
+	udtVMArray<u32> GameStateFileOffsets { "ParserCheckpoint::GameStateFileOffsetsArray" };
+	s32 ServerMessageSequence;
+	s32 ServerCommandSequence;
+	s32 ReliableSequenceAcknowledge;
+	s32 ClientNum;
+	s32 ChecksumFeed;
+	s32 ParseEntitiesNum;
+	s32 ServerTime;
+	s32 GameStateIndex;
+	s32 LastSnapshotMessageNumber;
+	u8 EntityBaselines[ID_MAX_PARSE_ENTITIES * sizeof(idLargestEntityState)];
+	u8 ParseEntities[ID_MAX_PARSE_ENTITIES * sizeof(idLargestEntityState)];
+	u8 Snapshots[PACKET_BACKUP * sizeof(idLargestClientSnapshot)];
+	s32 EntityEventTimesMs[MAX_GENTITIES];
+	char BigConfigString[BIG_INFO_STRING];
+	udtString ConfigStrings[2 * MAX_CONFIGSTRINGS];
+};
+
+
 // Don't ever allocate an instance of this on the stack.
 struct udtBaseParser
 {
 public:
 	struct udtConfigString;
+	struct udtCutOutput;
 
 public:
 	udtBaseParser();
@@ -45,26 +70,42 @@ public:
 
 	bool	ParseNextMessage(const udtMessage& inMsg, s32 inServerMessageSequence, u32 fileOffset); // Returns true if should continue parsing.
 	void	FinishParsing(bool success);
+	bool	HandleInvalidMessageLength(); // Logs the problem and returns true if what was parsed so far is still valid.
 
 	void	AddCut(s32 gsIndex, s32 startTimeMs, s32 endTimeMs, udtDemoNameCreator streamCreator, const char* veryShortDesc, void* userData = NULL);
 	void	AddCut(s32 gsIndex, s32 startTimeMs, s32 endTimeMs, const char* filePath);
 	void    AddPlugIn(udtBaseParserPlugIn* plugIn);
+	void    ClearPlugIns();
+	void    SaveCheckpoint(udtParserCheckpoint& checkpoint, bool saveBaselines) const; // The baselines only change with gamestate messages.
+	void    LoadCheckpoint(const udtParserCheckpoint& checkpoint); // Keeps the cuts but closes no output file, so only call this in between cuts.
 
 	const udtString       GetConfigString(s32 csIndex) const;
+	bool                  IsWritingCuts() const; // True if at least one output file is open.
 
 private:
 	bool                  ParseServerMessage(); // Returns true if should continue parsing.
-	bool                  ShouldWriteMessage() const;
-	void                  WriteFirstMessage();
-	void                  WriteNextMessage();
-	void                  WriteLastMessage();
-	void                  WriteGameState();
-	void                  WriteBigConfigStringCommand(const udtString& csIndex, const udtString& csData);
+	bool                  UpdateCuts(); // Returns true if should continue parsing.
+	bool                  StartCut(udtCutOutput& output, u32 cutIndex); // Returns false if the output file couldn't be opened.
+	void                  FinishCut(udtCutOutput& output);
+	udtCutOutput*         GetFreeCutOutput(); // Returns NULL on failure.
+	void                  DestroyCutOutputs();
+	bool                  ShouldWriteMessage(const udtCutOutput& output) const;
+	bool                  CanCopyMessage(const udtCutOutput& output) const;
+	void                  WriteFirstMessage(udtCutOutput& output);
+	void                  WriteNextMessage(udtCutOutput& output);
+	void                  WriteLastMessage(udtCutOutput& output);
+	void                  WriteGameState(udtCutOutput& output);
+	void                  WriteCommand(udtCutOutput& output, const udtString& commandString, s32 commandStringLength, s32 csIndex);
+	void                  WriteBigConfigStringCommand(udtCutOutput& output, const udtString& csIndex, const udtString& csData);
+	void                  WriteSnapshot(udtCutOutput& output, idClientSnapshotBase& newSnap, idClientSnapshotBase* oldSnap, s32 deltaNum, s32 areaMaskLength);
 	bool                  ParseCommandString();
 	bool                  ParseGamestate();
 	bool                  ParseSnapshot();
+	bool                  ShouldDecodeSnapshot() const;
+	bool                  AreAllPlugInsDone() const;
+	bool                  SkipSnapshot(); // Only reads the header.
 	bool                  ParsePacketEntities(udtMessage& msg, idClientSnapshotBase* oldframe, idClientSnapshotBase* newframe);
-	void                  EmitPacketEntities(idClientSnapshotBase* from, idClientSnapshotBase* to);
+	void                  EmitPacketEntities(udtMessage& msg, idClientSnapshotBase* from, idClientSnapshotBase* to);
 	bool                  DeltaEntity(udtMessage& msg, idClientSnapshotBase *frame, s32 newnum, idEntityStateBase* old, bool unchanged);
 	void                  ResetForGamestateMessage();
 
@@ -82,11 +123,27 @@ public:
 		udtDemoNameCreator StreamCreator;
 		void* UserData;
 		const char* VeryShortDesc;
+		udtCutOutput* Output; // NULL until the cut starts.
 		s32 GameStateIndex;
 		s32 StartTimeMs;
 		s32 EndTimeMs;
 	};
 
+	// Every cut being written has its own output file and encoding state,
+	// so that overlapping cuts can all be written while decoding the input once.
+	struct udtCutOutput
+	{
+		udtFileStream File;
+		udtString FilePath;
+		udtString FileName;
+		u8 MsgData[ID_MAX_MSG_LENGTH];
+		udtMessage Msg; // This instance *DOES* have ownership of the raw message data.
+		s32 ServerCommandSequence;
+		s32 SnapshotsWritten;
+		bool WriteMessage; // The file is open and its cut started.
+		bool CopyMessage; // The current message will be written as it was read instead of being re-encoded.
+	};
+
 public:
 	// General.
 	udtVMLinearAllocator _persistentAllocator { "Parser::Persistent" }; // Memory we need to be able to access to during the entire parsing phase.
@@ -102,8 +159,16 @@ public:
 
 	// Callbacks. Useful for doing additional analysis/processing in the same demo reading pass.
 	void* UserData; // Put whatever you want in there. Useful for callbacks.
-	udtVMArray<udtBaseParserPlugIn*> PlugIns { "Parser::PlugInsArray" };
+	udtVMArray<udtBaseParserPlugIn*> PlugIns { "Parser::PlugInsArray" }; // Use AddPlugIn and ClearPlugIns to modify.
+	udtVMArray<udtBaseParserPlugIn*> _messageBundleStartPlugIns { "Parser::MessageBundleStartPlugInsArray" };
+	udtVMArray<udtBaseParserPlugIn*> _messageBundleEndPlugIns { "Parser::MessageBundleEndPlugInsArray" };
+	udtVMArray<udtBaseParserPlugIn*> _gamestatePlugIns { "Parser::GamestatePlugInsArray" };
+	udtVMArray<udtBaseParserPlugIn*> _snapshotPlugIns { "Parser::SnapshotPlugInsArray" };
+	udtVMArray<udtBaseParserPlugIn*> _commandPlugIns { "Parser::CommandPlugInsArray" };
+	udtVMArray<u8> PlugInEarlyExits { "Parser::PlugInEarlyExitsArray" }; // One per demo processed with plug-ins. Non-zero if all plug-ins were done before the end of the file.
 	bool EnablePlugIns;
+	bool DecodeAllSnapshots; // Set this after Init if you read the snapshot state of the parser directly.
+	bool SkipCommandsBeforeGameState; // Set this after Init when starting at a gamestate other than the first: the commands preceding it belong to the previous one.
 
 	// Input.
 	udtString _inFilePath;
@@ -119,6 +184,10 @@ public:
 	s32 _inServerTime;
 	s32 _inGameStateIndex;
 	s32 _inLastSnapshotMessageNumber;
+	s32 _inReadSnapshotMessageNumber; // Of the last snapshot read, valid or not.
+	s32 _inReadSnapshotDeltaNum; // Of the last snapshot read, valid or not. The message number it was delta-compressed from, -1 if none.
+	bool _inSkippedSnapshots; // True if at least one snapshot wasn't decoded, and therefore wasn't validated.
+	bool _inPlugInsDone; // True if parsing stopped because all plug-ins were done.
 	u8 _inMsgData[ID_MAX_MSG_LENGTH];
 	u8 _inEntityBaselines[ID_MAX_PARSE_ENTITIES * sizeof(idLargestEntityState)]; // Type depends on protocol. Must be zeroed initially.
 	u8 _inParseEntities[ID_MAX_PARSE_ENTITIES * sizeof(idLargestEntityState)]; // Type depends on protocol.
@@ -133,16 +202,8 @@ public:
 	udtVMArray<u8> _inEntityFlags { "Parser::EntityFlagsArray" };
 
 	// Output.
-	udtFileStream _outFile;
-	udtString _outFilePath;
-	udtString _outFileName;
-	udtVMArray<udtCutInfo> _cuts { "Parser::CutsArray" };
-	u8 _outMsgData[ID_MAX_MSG_LENGTH];
-	udtMessage _outMsg; // This instance *DOES* have ownership of the raw message data.
-	s32 _outServerCommandSequence;
-	s32 _outSnapshotsWritten;
-	bool _outWriteFirstMessage;
-	bool _outWriteMessage;
+	udtVMArray<udtCutInfo> _cuts { "Parser::CutsArray" }; // The cuts not finished yet, started or not.
+	udtVMArray<udtCutOutput*> _outputs { "Parser::OutputsArray" }; // Outputs are reused once their cut is finished. They never move since their messages point to their own data.
 
 private:
 	idTokenizer _tokenizer; // Make sure plug-ins don't get write access to this.
@@ -10,10 +10,12 @@
 #include "plug_in_captures.hpp"
 #include "plug_in_obituaries.hpp"
 #include "plug_in_scores.hpp"
+#include "plug_in_probe.hpp"
 
 // For the placement new operator.
 #include <new>
 #include <assert.h>
+#include <stdlib.h>
 
 
 typedef void(*PlugInConstructionFunc)(udtBaseParserPlugIn*);
@@ -46,9 +48,49 @@ static const size_t SizeOfAllPlugIns = UDT_PRIVATE_PLUG_IN_LIST(UDT_PRIVATE_PLUG
 #undef UDT_PRIVATE_PLUG_IN_ITEM
 
 
+template<typename T>
+static T* CreateOnDemand(T*& object)
+{
+	if(object == NULL)
+	{
+		// @NOTE: We don't use the standard operator new approach to avoid C++ exceptions.
+		object = (T*)malloc(sizeof(T));
+		if(object != NULL)
+		{
+			new (object) T;
+		}
+	}
+
+	return object;
+}
+
+template<typename T>
+static void DestroyOnDemand(T*& object)
+{
+	if(object != NULL)
+	{
+		object->~T();
+		free(object);
+		object = NULL;
+	}
+}
+
+template<typename T>
+static void PurgeOnDemand(T* object)
+{
+	if(object != NULL)
+	{
+		udtVMLinearAllocator::PurgeThreadAllocators(object, (uptr)sizeof(T));
+	}
+}
+
+
 udtParserContext_s::udtParserContext_s()
 {
 	DemoCount = 0;
+	_streamingCutter = NULL;
+	_seekIndexWriter = NULL;
+	_seekIndex = NULL;
 
 	// @NOTE: This data can never be relocated.
 	PlugInAllocator.Init((uptr)SizeOfAllPlugIns);
@@ -57,16 +99,17 @@ udtParserContext_s::udtParserContext_s()
 udtParserContext_s::~udtParserContext_s()
 {
 	DestroyPlugIns();
+	DestroyOnDemand(_streamingCutter);
+	DestroyOnDemand(_seekIndexWriter);
+	DestroyOnDemand(_seekIndex);
 }
 
 bool udtParserContext_s::Init(u32 demoCount, const u32* plugInIds, u32 plugInCount)
 {
-#if defined(UDT_WINDOWS)
 	if(!DemoReader.Init())
 	{
 		return false;
 	}
-#endif
 
 	DemoCount = demoCount;
 
@@ -75,6 +118,7 @@ bool udtParserContext_s::Init(u32 demoCount, const u32* plugInIds, u32 plugInCou
 		const u32 plugInId = plugInIds[i];
 		udtBaseParserPlugIn* const plugIn = (udtBaseParserPlugIn*)PlugInAllocator.AllocateAndGetAddress(PlugInByteSizes[plugInId]);
 		(*PlugInConstructors[plugInId])(plugIn);
+		plugIn->Id = plugInId;
 
 		plugIn->Init(demoCount, PlugInTempAllocator);
 
@@ -97,13 +141,21 @@ void udtParserContext_s::ResetForNextDemo(bool keepPlugInData)
 		InputIndices.Clear();
 		PlugInAllocator.Clear();
 		PlugIns.Clear();
-		Parser.PlugIns.Clear();
+		Parser.ClearPlugIns();
 	}
 
 	Context.Reset();
 	PlugInTempAllocator.Clear();
 }
 
+void udtParserContext_s::Purge()
+{
+	udtVMLinearAllocator::PurgeThreadAllocators(this, (uptr)sizeof(udtParserContext_s));
+	PurgeOnDemand(_streamingCutter);
+	PurgeOnDemand(_seekIndexWriter);
+	PurgeOnDemand(_seekIndex);
+}
+
 bool udtParserContext_s::CopyBuffersStruct(u32 plugInId, void* buffersStruct)
 {
 	// Look for the right plug-in.
@@ -142,6 +194,51 @@ void udtParserContext_s::GetPlugInById(udtBaseParserPlugIn*& plugIn, u32 plugInI
 	}
 }
 
+udtStream* udtParserContext_s::OpenDemoFile(const char* filePath, u32 offset, u32 parseFlags)
+{
+	// Mapping can fail for empty files or when running out of address space.
+	// We then silently fall back to the read-ahead stream.
+	if((parseFlags & (u32)udtParseArgFlag::MemoryMappedInput) != 0 &&
+	   MappedDemoReader.Open(filePath, offset))
+	{
+		return &MappedDemoReader;
+	}
+
+	if(!DemoReader.Open(filePath, offset))
+	{
+		return NULL;
+	}
+
+	return &DemoReader;
+}
+
+udtStreamingCutter* udtParserContext_s::GetStreamingCutter()
+{
+	return CreateOnDemand(_streamingCutter);
+}
+
+udtSeekIndexWriter* udtParserContext_s::GetSeekIndexWriter()
+{
+	return CreateOnDemand(_seekIndexWriter);
+}
+
+udtSeekIndex* udtParserContext_s::LoadSeekIndex(const char* demoFilePath, udtProtocol::Id protocol)
+{
+	// Most demos don't have an index, so we only create the loader once we know there's something to load.
+	if(!udtSeekIndex::HasIndexFile(demoFilePath))
+	{
+		return NULL;
+	}
+
+	udtSeekIndex* const seekIndex = CreateOnDemand(_seekIndex);
+	if(seekIndex == NULL || !seekIndex->Load(demoFilePath, protocol))
+	{
+		return NULL;
+	}
+
+	return seekIndex;
+}
+
 void udtParserContext_s::DestroyPlugIns()
 {
 	for(u32 i = 0, count = PlugIns.GetSize(); i < count; ++i)
@@ -8,12 +8,17 @@
 #include "modifier_context.hpp"
 #include "json_writer_context.hpp"
 #include "read_only_sequ_file_stream.hpp"
+#include "mapped_file_stream.hpp"
+#include "streaming_cutter.hpp"
+#include "seek_index.hpp"
+#include "demo_stream_parser.hpp"
 
 
 #define UDT_PRIVATE_PLUG_IN_LIST(N) \
 	UDT_PLUG_IN_LIST(N) \
 	N(FindPatterns, "", udtPatternSearchPlugIn,    udtCutSection) \
-	N(ConvertToUDT, "", udtParserPlugInQuakeToUDT, udtNothing)
+	N(ConvertToUDT, "", udtParserPlugInQuakeToUDT, udtNothing) \
+	N(Probe,        "", udtParserPlugInProbe,      udtNothing)
 
 #define UDT_PRIVATE_PLUG_IN_ITEM(Enum, Desc, Type, OutputType) Enum,
 struct udtPrivateParserPlugIn
@@ -43,10 +48,15 @@ public:
 
 	bool Init(u32 demoCount, const u32* plugInIds = NULL, u32 plugInCount = 0); // Called once for all.
 	void ResetForNextDemo(bool keepPlugInData); // Called once per demo processed.
+	void Purge(); // De-commits the memory pages the allocators don't use. Must be called by the thread that created the context.
 	bool CopyBuffersStruct(u32 plugInId, void* buffersStruct);
 	void UpdatePlugInBufferStructs();
 	u32  GetDemoCount() const { return DemoCount; }
 	void GetPlugInById(udtBaseParserPlugIn*& plugIn, u32 plugInId);
+	udtStream* OpenDemoFile(const char* filePath, u32 offset, u32 parseFlags); // Returns NULL on failure.
+	udtStreamingCutter* GetStreamingCutter(); // Created on first use. Returns NULL on failure.
+	udtSeekIndexWriter* GetSeekIndexWriter(); // Created on first use. Returns NULL on failure.
+	udtSeekIndex* LoadSeekIndex(const char* demoFilePath, udtProtocol::Id protocol); // Returns NULL if the demo has no up-to-date index.
 
 private:
 	void DestroyPlugIns();
@@ -60,14 +70,17 @@ public:
 	udtVMArray<AddOnItem> PlugIns { "ParserContext::PlugInsArray" }; // There is only 1 (shared) plug-in instance for each plug-in ID passed.
 	udtVMArray<u32> InputIndices { "ParserContext::InputIndicesArray" };
 	udtVMLinearAllocator PlugInTempAllocator { "ParserContext::PlugInTemp" };
-#if defined(UDT_WINDOWS)
 	udtReadOnlySequentialFileStream DemoReader;
-#endif
+	udtMappedFileStream MappedDemoReader;
+	udtDemoStreamParser DemoStreamParser;
 	u32 DemoCount;
-};
 
+private:
+	udtStreamingCutter* _streamingCutter; // Embeds a full parser, so only the jobs cutting by pattern pay for it.
+	udtSeekIndexWriter* _seekIndexWriter; // These embed a parser checkpoint, so only the jobs using seek indices pay for them.
+	udtSeekIndex* _seekIndex;
+};
 
-#if defined(UDT_WINDOWS)
 
 struct udtStreamScopeGuard
 {
@@ -87,25 +100,11 @@ private:
 	udtStream& _stream;
 };
 
-#endif
-
-
-#if defined(UDT_WINDOWS)
-#	define UDT_INIT_DEMO_FILE_READER(name, filePath, context) \
-		udtReadOnlySequentialFileStream& name = context->DemoReader; \
-		udtStreamScopeGuard name##ScopeGuard(name); \
-		if(!name.Open(filePath)) return false;
-#	define UDT_INIT_DEMO_FILE_READER_AT(name, filePath, context, offset) \
-		udtReadOnlySequentialFileStream& name = context->DemoReader; \
-		udtStreamScopeGuard name##ScopeGuard(name); \
-		if(!name.Open(filePath, offset)) return false;
-#else
-#	define UDT_INIT_DEMO_FILE_READER(name, filePath, context) \
-		udtFileStream name; \
-		if(!name.Open(filePath, udtFileOpenMode::Read)) return false;
-#	define UDT_INIT_DEMO_FILE_READER_AT(name, filePath, context, offset) \
-		udtFileStream name; \
-		if(!name.Open(filePath, udtFileOpenMode::Read)) return false; \
-		if(fileOffset > 0 && name.Seek((s32)offset, udtSeekOrigin::Start) != 0) return false;
-
-#endif
+
+#define UDT_INIT_DEMO_FILE_READER_AT(name, filePath, context, offset, parseFlags) \
+	udtStream* const name##Ptr = context->OpenDemoFile(filePath, offset, parseFlags); \
+	if(name##Ptr == NULL) return false; \
+	udtStream& name = *name##Ptr; \
+	udtStreamScopeGuard name##ScopeGuard(name);
+#define UDT_INIT_DEMO_FILE_READER(name, filePath, context, parseFlags) \
+	UDT_INIT_DEMO_FILE_READER_AT(name, filePath, context, 0, parseFlags)
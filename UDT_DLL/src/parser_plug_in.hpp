@@ -58,13 +58,34 @@ struct udtCommandCallbackArg
 	bool IsEmptyConfigString;
 };
 
+// The callbacks a plug-in can subscribe to.
+struct udtParserPlugInEvent
+{
+	enum Id
+	{
+		MessageBundleStart,
+		MessageBundleEnd,
+		Gamestate,
+		Snapshot,
+		Command,
+		Count
+	};
+};
+
+#define UDT_PLUG_IN_EVENT_BIT(event)    (1 << (u32)udtParserPlugInEvent::event)
+#define UDT_PLUG_IN_ALL_EVENTS          ((1 << (u32)udtParserPlugInEvent::Count) - 1)
+
 
 struct udtBaseParserPlugIn
 {
 	udtBaseParserPlugIn() 
-		: TempAllocator(NULL)
+		: Id(UDT_U32_MAX)
+		, SubscribedEvents(UDT_PLUG_IN_ALL_EVENTS)
+		, TempAllocator(NULL)
 		, DemoCount(0)
 		, StartItemCount(0)
+		, JobDone(false)
+		, GameStateSegments(false)
 	{
 	}
 
@@ -77,6 +98,7 @@ struct udtBaseParserPlugIn
 	{
 		DemoCount = demoCount;
 		TempAllocator = &tempAllocator;
+		SubscribedEvents = GetSubscribedEvents();
 		InitAllocators(demoCount);
 	}
 
@@ -86,6 +108,7 @@ struct udtBaseParserPlugIn
 		TempAllocator->Clear();
 
 		StartItemCount = GetItemCount();
+		JobDone = false;
 
 		StartDemoAnalysis();
 	}
@@ -94,37 +117,96 @@ struct udtBaseParserPlugIn
 	void FinishProcessingDemo()
 	{
 		FinishDemoAnalysis();
+		AddDemoBufferRange();
+	}
 
-		const u32 firstIndex = StartItemCount;
-		const u32 lastIndex = GetItemCount();
-		const u32 count = lastIndex - firstIndex;
-		udtParseDataBufferRange range;
-		range.FirstIndex = firstIndex;
-		range.Count = count;
-		BufferRanges.Add(range);
+	// Call for each demo whose gamestates were processed separately by other instances of the same plug-in type.
+	// The source demo index is the instance's demo index, the gamestate index is the one in the merged demo.
+	// Only the items of the first gamestate of the source demo are kept.
+	void StartMergingDemo()
+	{
+		StartItemCount = GetItemCount();
+		JobDone = false;
+	}
+
+	void MergeGameState(const udtBaseParserPlugIn& source, u32 sourceDemoIndex, s32 gameStateIndex)
+	{
+		const udtParseDataBufferRange& range = source.BufferRanges[sourceDemoIndex];
+		AppendFirstGameState(source, range.FirstIndex, range.Count, gameStateIndex);
+	}
+
+	void FinishMergingDemo()
+	{
+		FinishMergedDemoAnalysis();
+		AddDemoBufferRange();
+	}
+
+	// Call once, before processing any demo, on the instances that process the gamestates of a demo separately.
+	void EnableGameStateSegments()
+	{
+		GameStateSegments = true;
 	}
 
 	virtual void InitAllocators(u32 demoCount) = 0; // Initialize your private allocators, including FinalAllocator.
 
+	// The parser only invokes the callbacks you subscribe to.
+	// When no plug-in subscribes to snapshots, the parser can skip decoding them.
+	virtual u32  GetSubscribedEvents() const { return UDT_PLUG_IN_ALL_EVENTS; } // Bit mask of udtParserPlugInEvent::Id values.
+
 	// Only needed for analysis plug-ins.
 	virtual void CopyBuffersStruct(void* /*buffersStruct*/) const {}
 	virtual void UpdateBufferStruct() {}
 	virtual u32  GetItemCount() const { return 0; }
 
+	// Only needed for plug-ins that can process the gamestates of a demo in parallel.
+	virtual bool CanMergeGameStates() const { return false; }
+
 	virtual void ProcessMessageBundleStart(const udtMessageBundleCallbackArg& /*arg*/, udtBaseParser& /*parser*/) {}
 	virtual void ProcessMessageBundleEnd(const udtMessageBundleCallbackArg& /*arg*/, udtBaseParser& /*parser*/) {}
 	virtual void ProcessGamestateMessage(const udtGamestateCallbackArg& /*arg*/, udtBaseParser& /*parser*/) {}
 	virtual void ProcessSnapshotMessage(const udtSnapshotCallbackArg& /*arg*/, udtBaseParser& /*parser*/) {}
 	virtual void ProcessCommandMessage(const udtCommandCallbackArg& /*arg*/, udtBaseParser& /*parser*/) {}
+
+	// The parser stops reading the demo once all its plug-ins are done.
+	bool IsJobDone() const { return JobDone; }
+
+	u32 Id; // Of type udtPrivateParserPlugIn::Id when created by the parser context.
+	u32 SubscribedEvents; // Read by the parser when the plug-in is added. Set by Init.
 	
 protected:
 	virtual void StartDemoAnalysis() {}
 	virtual void FinishDemoAnalysis() {}
 
+	// Call this when no later message of the current demo can change your output.
+	// FinishDemoAnalysis still gets called.
+	void SetJobDone() { JobDone = true; }
+
+	// The source is of the same type. The items are in the range [firstItem, firstItem + itemCount[ of its final array.
+	// The item strings must be cloned since they belong to the source's allocators.
+	virtual void AppendFirstGameState(const udtBaseParserPlugIn& /*source*/, u32 /*firstItem*/, u32 /*itemCount*/, s32 /*gameStateIndex*/) {}
+
+	// When processing gamestate segments, post-processing that applies to a whole demo must be skipped
+	// and done in FinishMergedDemoAnalysis instead.
+	virtual void FinishMergedDemoAnalysis() {}
+	bool IsProcessingGameStateSegments() const { return GameStateSegments; }
+
 	udtVMLinearAllocator* TempAllocator; // Don't create your own temp allocator, use this one.
 	udtVMArray<udtParseDataBufferRange> BufferRanges { "BaseParserPlugIn::BufferRangesArray" };
 	
 private:
+	void AddDemoBufferRange()
+	{
+		const u32 firstIndex = StartItemCount;
+		const u32 lastIndex = GetItemCount();
+		const u32 count = lastIndex - firstIndex;
+		udtParseDataBufferRange range;
+		range.FirstIndex = firstIndex;
+		range.Count = count;
+		BufferRanges.Add(range);
+	}
+
 	u32 DemoCount;
 	u32 StartItemCount;
+	bool JobDone;
+	bool GameStateSegments;
 };
@@ -1,5 +1,11 @@
 #include "parser_runner.hpp"
 #include "utils.hpp"
+#include "instrumentation.hpp"
+
+
+// RealReadBits can read a few bytes past the end of the message.
+// We only decode in place when we know those bytes are still part of the mapping.
+#define UDT_MAPPED_MESSAGE_PADDING 16
 
 
 udtParserRunner::udtParserRunner()
@@ -7,8 +13,10 @@ udtParserRunner::udtParserRunner()
 	_fileStartOffset = 0;
 	_fileOffset = 0;
 	_maxByteCount = 0;
+	_fileByteCount = 0;
 	_parser = NULL;
 	_file = NULL;
+	_mappedData = NULL;
 	_cancelOperation = NULL;
 	_success = false;
 }
@@ -23,7 +31,9 @@ bool udtParserRunner::Init(udtBaseParser& parser, udtStream& file, const s32* ca
 	_inMsg.InitProtocol(parser._inProtocol);
 
 	_fileStartOffset = (u64)file.Offset();
-	_maxByteCount = file.Length() - _fileStartOffset;
+	_fileByteCount = file.Length();
+	_maxByteCount = _fileByteCount - _fileStartOffset;
+	_mappedData = file.GetMappedBuffer();
 
 	_timer.Start();
 
@@ -38,9 +48,38 @@ bool udtParserRunner::ParseNextMessage()
 		return false;
 	}
 
-	const u64 fileOffset = _fileOffset;
+	const u64 fileOffset = _fileStartOffset + _fileOffset;
 
 	s32 inServerMessageSequence = 0;
+	const bool messageRead = _mappedData != NULL ? 
+		ReadMappedMessage(inServerMessageSequence) : 
+		ReadMessage(inServerMessageSequence);
+	if(!messageRead)
+	{
+		return false;
+	}
+
+	_inMsg.Buffer.readcount = 0;
+	if(!_parser->ParseNextMessage(_inMsg, inServerMessageSequence, (u32)fileOffset))
+	{
+		SetSuccess(true);
+		return false;
+	}
+
+	const u64 currentByteCount = fileOffset - _fileStartOffset;
+	const f32 currentProgress = (f32)currentByteCount / (f32)_maxByteCount;
+	_parser->_context->NotifyProgress(currentProgress);
+	_fileOffset += (u64)_inMsg.Buffer.cursize + 8;
+
+	SetSuccess(true);
+
+	return true;
+}
+
+bool udtParserRunner::ReadMessage(s32& inServerMessageSequence)
+{
+	UDT_INSTRUMENT_STAGE(ReadMessage);
+
 	u32 elementsRead = _file->Read(&inServerMessageSequence, 4, 1);
 	if(elementsRead != 1)
 	{
@@ -67,8 +106,7 @@ bool udtParserRunner::ParseNextMessage()
 
 	if((u32)_inMsg.Buffer.cursize > (u32)_inMsg.Buffer.maxsize)
 	{
-		_parser->_context->LogError("Demo file %s has a message length greater than MAX_SIZE", _parser->GetFileNamePtr());
-		SetSuccess(false);
+		HandleInvalidMessageLength();
 		return false;
 	}
 
@@ -80,23 +118,67 @@ bool udtParserRunner::ParseNextMessage()
 		return false;
 	}
 
-	_inMsg.Buffer.readcount = 0;
-	if(!_parser->ParseNextMessage(_inMsg, inServerMessageSequence, (u32)fileOffset))
+	return true;
+}
+
+bool udtParserRunner::ReadMappedMessage(s32& inServerMessageSequence)
+{
+	UDT_INSTRUMENT_STAGE(ReadMessage);
+
+	const u64 messageOffset = _fileStartOffset + _fileOffset;
+	if(messageOffset + 8 > _fileByteCount)
 	{
+		_parser->_context->LogWarning("Demo file %s is truncated", _parser->GetFileNamePtr());
 		SetSuccess(true);
 		return false;
 	}
 
-	const u64 currentByteCount = fileOffset - _fileStartOffset;
-	const f32 currentProgress = (f32)currentByteCount / (f32)_maxByteCount;
-	_parser->_context->NotifyProgress(currentProgress);
-	_fileOffset += (u64)_inMsg.Buffer.cursize + 8;
+	const u8* const header = _mappedData + messageOffset;
+	s32 messageLength = 0;
+	memcpy(&inServerMessageSequence, header, 4);
+	memcpy(&messageLength, header + 4, 4);
+	if(messageLength == -1)
+	{
+		SetSuccess(true);
+		return false;
+	}
 
-	SetSuccess(true);
+	if((u32)messageLength > (u32)ID_MAX_MSG_LENGTH)
+	{
+		HandleInvalidMessageLength();
+		return false;
+	}
+
+	const u64 messageEnd = messageOffset + 8 + (u64)messageLength;
+	if(messageEnd > _fileByteCount)
+	{
+		_parser->_context->LogWarning("Demo file %s is truncated", _parser->GetFileNamePtr());
+		SetSuccess(true);
+		return false;
+	}
+
+	if(messageEnd + UDT_MAPPED_MESSAGE_PADDING <= _fileByteCount)
+	{
+		// The message data is never written to, the const cast is safe.
+		_inMsg.Init((u8*)(header + 8), ID_MAX_MSG_LENGTH);
+	}
+	else
+	{
+		// Too close to the end of the file for reading in place.
+		_inMsg.Init(_parser->_inMsgData, ID_MAX_MSG_LENGTH);
+		memcpy(_inMsg.Buffer.data, header + 8, (size_t)messageLength);
+	}
+	_inMsg.Buffer.cursize = messageLength;
+	_file->Seek((s32)messageEnd, udtSeekOrigin::Start);
 
 	return true;
 }
 
+void udtParserRunner::HandleInvalidMessageLength()
+{
+	SetSuccess(_parser->HandleInvalidMessageLength());
+}
+
 void udtParserRunner::FinishParsing()
 {
 	_parser->FinishParsing(_success);
@@ -19,14 +19,19 @@ private:
 
 private:
 	void SetSuccess(bool success);
+	bool ReadMessage(s32& serverMessageSequence);       // Copies the message to the parser's buffer.
+	bool ReadMappedMessage(s32& serverMessageSequence); // Decodes straight from the mapped file when possible.
+	void HandleInvalidMessageLength();
 
 	udtMessage _inMsg;
 	udtTimer _timer;
 	u64 _fileStartOffset;
 	u64 _fileOffset;
 	u64 _maxByteCount;
+	u64 _fileByteCount;
 	udtBaseParser* _parser;
 	udtStream* _file;
+	const u8* _mappedData; // If invalid: NULL.
 	const s32* _cancelOperation;
 	bool _success;
 };
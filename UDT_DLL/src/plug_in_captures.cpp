@@ -1,4 +1,5 @@
 #include "plug_in_captures.hpp"
+#include "utils.hpp"
 
 
 udtParserPlugInCaptures::udtParserPlugInCaptures()
@@ -43,6 +44,24 @@ void udtParserPlugInCaptures::FinishDemoAnalysis()
 	_analyzer.FinishDemoAnalysis();
 }
 
+void udtParserPlugInCaptures::AppendFirstGameState(const udtBaseParserPlugIn& sourceBase, u32 firstItem, u32 itemCount, s32 gameStateIndex)
+{
+	const udtParserPlugInCaptures& source = (const udtParserPlugInCaptures&)sourceBase;
+	for(u32 i = firstItem, end = firstItem + itemCount; i < end; ++i)
+	{
+		if(source._analyzer.Captures[i].GameStateIndex != 0)
+		{
+			continue;
+		}
+
+		udtParseDataCapture capture = source._analyzer.Captures[i];
+		capture.GameStateIndex = gameStateIndex;
+		CloneApiStructString(capture.MapName, _analyzer.StringAllocator, source._analyzer.StringAllocator);
+		CloneApiStructString(capture.PlayerName, _analyzer.StringAllocator, source._analyzer.StringAllocator);
+		_analyzer.Captures.Add(capture);
+	}
+}
+
 void udtParserPlugInCaptures::ProcessGamestateMessage(const udtGamestateCallbackArg& arg, udtBaseParser& parser)
 {
 	_analyzer.ProcessGamestateMessage(arg, parser);
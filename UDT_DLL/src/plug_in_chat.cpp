@@ -71,6 +71,31 @@ void udtParserPlugInChat::StartDemoAnalysis()
 	_gameStateIndex = -1;
 }
 
+void udtParserPlugInChat::AppendFirstGameState(const udtBaseParserPlugIn& sourceBase, u32 firstItem, u32 itemCount, s32 gameStateIndex)
+{
+	const udtParserPlugInChat& source = (const udtParserPlugInChat&)sourceBase;
+	for(u32 i = firstItem, end = firstItem + itemCount; i < end; ++i)
+	{
+		if(source.ChatEvents[i].GameStateIndex != 0)
+		{
+			continue;
+		}
+
+		udtParseDataChat chatEvent = source.ChatEvents[i];
+		chatEvent.GameStateIndex = gameStateIndex;
+		for(u32 j = 0; j < 2; ++j)
+		{
+			udtChatEventData& strings = chatEvent.Strings[j];
+			CloneApiStructString(strings.OriginalCommand, _stringAllocator, source._stringAllocator);
+			CloneApiStructString(strings.ClanName, _stringAllocator, source._stringAllocator);
+			CloneApiStructString(strings.PlayerName, _stringAllocator, source._stringAllocator);
+			CloneApiStructString(strings.Message, _stringAllocator, source._stringAllocator);
+			CloneApiStructString(strings.Location, _stringAllocator, source._stringAllocator);
+		}
+		ChatEvents.Add(chatEvent);
+	}
+}
+
 void udtParserPlugInChat::ProcessCommandMessage(const udtCommandCallbackArg& /*info*/, udtBaseParser& parser)
 {
 	const idTokenizer& tokenizer = parser.GetTokenizer();
@@ -13,14 +13,19 @@ public:
 	~udtParserPlugInChat();
 
 	void InitAllocators(u32 demoCount) override;
+	u32  GetSubscribedEvents() const override { return UDT_PLUG_IN_EVENT_BIT(Gamestate) | UDT_PLUG_IN_EVENT_BIT(Command); }
 	void CopyBuffersStruct(void* buffersStruct) const override;
 	void UpdateBufferStruct() override;
 	u32  GetItemCount() const override;
+	bool CanMergeGameStates() const override { return true; }
 
 	void StartDemoAnalysis() override;
 	void ProcessCommandMessage(const udtCommandCallbackArg& info, udtBaseParser& parser) override;
 	void ProcessGamestateMessage(const udtGamestateCallbackArg& arg, udtBaseParser& parser) override;
 
+protected:
+	void AppendFirstGameState(const udtBaseParserPlugIn& source, u32 firstItem, u32 itemCount, s32 gameStateIndex) override;
+
 private:
 	UDT_NO_COPY_SEMANTICS(udtParserPlugInChat);
 
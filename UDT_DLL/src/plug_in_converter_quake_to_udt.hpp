@@ -16,6 +16,7 @@ public:
 	void SetOutputStream(udtStream* output);
 
 	void InitAllocators(u32 demoCount) override;
+	u32  GetSubscribedEvents() const override { return UDT_PLUG_IN_EVENT_BIT(Gamestate) | UDT_PLUG_IN_EVENT_BIT(Snapshot) | UDT_PLUG_IN_EVENT_BIT(Command); }
 
 	void StartDemoAnalysis() override;
 	void FinishDemoAnalysis() override;
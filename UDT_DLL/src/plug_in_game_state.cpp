@@ -85,6 +85,47 @@ void udtParserPlugInGameState::FinishDemoAnalysis()
 	AddCurrentGameState();
 }
 
+void udtParserPlugInGameState::AppendFirstGameState(const udtBaseParserPlugIn& sourceBase, u32 firstItem, u32 itemCount, s32 /*gameStateIndex*/)
+{
+	// There is exactly one item per gamestate, in order.
+	if(itemCount == 0)
+	{
+		return;
+	}
+
+	const udtParserPlugInGameState& source = (const udtParserPlugInGameState&)sourceBase;
+	udtParseDataGameState gameState = source._gameStates[firstItem];
+	CloneApiStructString(gameState.DemoTakerName, _stringAllocator, source._stringAllocator);
+
+	const u32 firstMatchIndex = _matches.GetSize();
+	for(u32 i = 0; i < gameState.MatchCount; ++i)
+	{
+		_matches.Add(source._matches[gameState.FirstMatchIndex + i]);
+	}
+	gameState.FirstMatchIndex = firstMatchIndex;
+
+	const u32 firstKeyValuePairIndex = _keyValuePairs.GetSize();
+	for(u32 i = 0; i < gameState.KeyValuePairCount; ++i)
+	{
+		udtGameStateKeyValuePair info = source._keyValuePairs[gameState.FirstKeyValuePairIndex + i];
+		CloneApiStructString(info.Name, _stringAllocator, source._stringAllocator);
+		CloneApiStructString(info.Value, _stringAllocator, source._stringAllocator);
+		_keyValuePairs.Add(info);
+	}
+	gameState.FirstKeyValuePairIndex = firstKeyValuePairIndex;
+
+	const u32 firstPlayerIndex = _players.GetSize();
+	for(u32 i = 0; i < gameState.PlayerCount; ++i)
+	{
+		udtGameStatePlayerInfo player = source._players[gameState.FirstPlayerIndex + i];
+		CloneApiStructString(player.FirstName, _stringAllocator, source._stringAllocator);
+		_players.Add(player);
+	}
+	gameState.FirstPlayerIndex = firstPlayerIndex;
+
+	_gameStates.Add(gameState);
+}
+
 void udtParserPlugInGameState::ProcessGamestateMessage(const udtGamestateCallbackArg& info, udtBaseParser& parser)
 {
 	_analyzer.ProcessGamestateMessage(info, parser);
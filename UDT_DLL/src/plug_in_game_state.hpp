@@ -15,9 +15,11 @@ public:
 	~udtParserPlugInGameState();
 
 	void InitAllocators(u32 demoCount) override;
+	u32  GetSubscribedEvents() const override { return UDT_PLUG_IN_EVENT_BIT(Gamestate) | UDT_PLUG_IN_EVENT_BIT(Snapshot) | UDT_PLUG_IN_EVENT_BIT(Command); }
 	void CopyBuffersStruct(void* buffersStruct) const override;
 	void UpdateBufferStruct() override;
 	u32  GetItemCount() const override;
+	bool CanMergeGameStates() const override { return true; }
 
 	void StartDemoAnalysis() override;
 	void FinishDemoAnalysis() override;
@@ -25,6 +27,9 @@ public:
 	void ProcessSnapshotMessage(const udtSnapshotCallbackArg& info, udtBaseParser& parser) override;
 	void ProcessCommandMessage(const udtCommandCallbackArg& info, udtBaseParser& parser) override;
 
+protected:
+	void AppendFirstGameState(const udtBaseParserPlugIn& source, u32 firstItem, u32 itemCount, s32 gameStateIndex) override;
+
 private:
 	UDT_NO_COPY_SEMANTICS(udtParserPlugInGameState);
 
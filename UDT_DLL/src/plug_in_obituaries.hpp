@@ -2,6 +2,7 @@
 
 
 #include "analysis_obituaries.hpp"
+#include "utils.hpp"
 
 
 struct udtParserPlugInObituaries : udtBaseParserPlugIn
@@ -39,6 +40,16 @@ public:
 		return Analyzer.Obituaries.GetSize();
 	}
 
+	bool CanMergeGameStates() const override
+	{
+		return true;
+	}
+
+	u32  GetSubscribedEvents() const override
+	{
+		return UDT_PLUG_IN_EVENT_BIT(Gamestate) | UDT_PLUG_IN_EVENT_BIT(Snapshot) | UDT_PLUG_IN_EVENT_BIT(Command);
+	}
+
 	void StartDemoAnalysis() override
 	{
 		Analyzer.ResetForNextDemo();
@@ -61,6 +72,28 @@ public:
 
 	udtObituariesAnalyzer Analyzer;
 
+protected:
+	void AppendFirstGameState(const udtBaseParserPlugIn& sourceBase, u32 firstItem, u32 itemCount, s32 gameStateIndex) override
+	{
+		const udtParserPlugInObituaries& source = (const udtParserPlugInObituaries&)sourceBase;
+		udtVMLinearAllocator& allocator = Analyzer.GetStringAllocator();
+		const udtVMLinearAllocator& sourceAllocator = source.Analyzer.GetStringAllocator();
+		for(u32 i = firstItem, end = firstItem + itemCount; i < end; ++i)
+		{
+			if(source.Analyzer.Obituaries[i].GameStateIndex != 0)
+			{
+				continue;
+			}
+
+			udtParseDataObituary info = source.Analyzer.Obituaries[i];
+			info.GameStateIndex = gameStateIndex;
+			CloneApiStructString(info.AttackerName, allocator, sourceAllocator);
+			CloneApiStructString(info.TargetName, allocator, sourceAllocator);
+			CloneApiStructString(info.MeanOfDeathName, allocator, sourceAllocator);
+			Analyzer.Obituaries.Add(info);
+		}
+	}
+
 private:
 	UDT_NO_COPY_SEMANTICS(udtParserPlugInObituaries);
 
@@ -272,6 +272,7 @@ void udtPatternSearchPlugIn::ProcessCommandMessage(const udtCommandCallbackArg&
 void udtPatternSearchPlugIn::StartDemoAnalysis()
 {
 	CutSections.Clear();
+	_cutSectionsSignature.Clear();
 
 	for(u32 i = 0, analyzerCount = _analyzers.GetSize(); i < analyzerCount; ++i)
 	{
@@ -292,17 +293,66 @@ void udtPatternSearchPlugIn::FinishDemoAnalysis()
 		_analyzers[i]->FinishAnalysis();
 	}
 
+	BuildCutSections(CutSections);
+}
+
+bool udtPatternSearchPlugIn::GetCurrentCutSections(udtVMArray<udtCutSection>& cutSections)
+{
+	// Only rebuild the list when an analyzer added or extended a cut section.
+	bool changed = false;
+	const u32 analyzerCount = _analyzers.GetSize();
+	if(_cutSectionsSignature.GetSize() != 3 * analyzerCount)
+	{
+		_cutSectionsSignature.Resize(3 * analyzerCount);
+		memset(_cutSectionsSignature.GetStartAddress(), 0, (size_t)_cutSectionsSignature.GetSize() * sizeof(s32));
+		changed = true;
+	}
+
+	for(u32 i = 0; i < analyzerCount; ++i)
+	{
+		const udtVMArray<udtCutSection>& analyzerCutSections = _analyzers[i]->CutSections;
+		const u32 cutCount = analyzerCutSections.GetSize();
+		const s32 startTimeMs = cutCount > 0 ? analyzerCutSections[cutCount - 1].StartTimeMs : 0;
+		const s32 endTimeMs = cutCount > 0 ? analyzerCutSections[cutCount - 1].EndTimeMs : 0;
+		s32* const signature = &_cutSectionsSignature[3 * i];
+		if(signature[0] != (s32)cutCount || signature[1] != startTimeMs || signature[2] != endTimeMs)
+		{
+			signature[0] = (s32)cutCount;
+			signature[1] = startTimeMs;
+			signature[2] = endTimeMs;
+			changed = true;
+		}
+	}
+
+	if(!changed)
+	{
+		return false;
+	}
+
+	BuildCutSections(cutSections);
+
+	return true;
+}
+
+void udtPatternSearchPlugIn::BuildCutSections(udtVMArray<udtCutSection>& result)
+{
+	result.Clear();
+	if(_analyzers.GetSize() == 0)
+	{
+		return;
+	}
+
 	// If we only have 1 analyzer, we don't need to do any sorting.
 	if(_analyzers.GetSize() == 1)
 	{
-		MergeRanges(CutSections, _analyzers[0]->CutSections);
+		MergeRanges(result, _analyzers[0]->CutSections);
 		return;
 	}
 
 	//
 	// Create a list with all the cut sections.
 	//
-	udtVMArray<CutSection> tempCutSections("CutByPatternPlugIn::FinishDemoAnalysis::TempCutSectionsArray");
+	udtVMArray<CutSection> tempCutSections("CutByPatternPlugIn::BuildCutSections::TempCutSectionsArray");
 	for(u32 i = 0, analyzerCount = _analyzers.GetSize(); i < analyzerCount; ++i)
 	{
 		udtPatternSearchAnalyzerBase* const analyzer = _analyzers[i];
@@ -337,14 +387,13 @@ void udtPatternSearchPlugIn::FinishDemoAnalysis()
 	//
 	if((GetInfo().Flags & (u32)udtPatternSearchArgMask::MergeCutSections) != 0)
 	{
-		udtVMArray<udtCutSection> cutSections("CutByPatternPlugIn::FinishDemoAnalysis::MergedCutSectionsArray");
+		udtVMArray<udtCutSection> cutSections("CutByPatternPlugIn::BuildCutSections::MergedCutSectionsArray");
 		AppendCutSections(cutSections, tempCutSections);
-		MergeRanges(CutSections, cutSections);
+		MergeRanges(result, cutSections);
 	}
 	else
 	{
-		CutSections.Clear();
-		AppendCutSections(CutSections, tempCutSections);
+		AppendCutSections(result, tempCutSections);
 	}
 }
 
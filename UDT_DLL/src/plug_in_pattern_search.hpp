@@ -16,6 +16,7 @@ public:
 	~udtPatternSearchPlugIn() {}
 
 	void InitAllocators(u32 demoCount) override;
+	u32  GetSubscribedEvents() const override { return UDT_PLUG_IN_EVENT_BIT(Gamestate) | UDT_PLUG_IN_EVENT_BIT(Snapshot) | UDT_PLUG_IN_EVENT_BIT(Command); }
 	void StartDemoAnalysis() override;
 	void FinishDemoAnalysis() override;
 	void ProcessGamestateMessage(const udtGamestateCallbackArg& info, udtBaseParser& parser) override;
@@ -33,6 +34,10 @@ public:
 
 	udtVMLinearAllocator& GetTempAllocator() { return *TempAllocator; }
 
+	// Builds the list of cut sections found so far the same way FinishDemoAnalysis does.
+	// Returns false and leaves the list untouched if nothing changed since the last call.
+	bool GetCurrentCutSections(udtVMArray<udtCutSection>& cutSections);
+
 	udtVMArray<udtCutSection> CutSections { "CutByPatternPlugIn::CutSectionsArray" }; // Final array.
 
 private:
@@ -41,9 +46,11 @@ private:
 	void FindPlayerInConfigStrings(udtBaseParser& parser);
 	void FindPlayerInServerCommand(const udtCommandCallbackArg& info, udtBaseParser& parser);
 	bool GetPlayerName(udtString& playerName, udtVMLinearAllocator& allocator, udtBaseParser& parser, s32 csIdx);
+	void BuildCutSections(udtVMArray<udtCutSection>& result);
 
 	udtVMArray<udtPatternSearchAnalyzerBase*> _analyzers { "CutByPatternPlugIn::AnalyzersArray" };
 	udtVMArray<udtPatternType::Id> _analyzerTypes { "CutByPatternPlugIn::AnalyzerTypesArray" };
+	udtVMArray<s32> _cutSectionsSignature { "CutByPatternPlugIn::CutSectionsSignatureArray" }; // Cut count and last cut times of every analyzer.
 	udtVMLinearAllocator _analyzerAllocator { "CutByPatternPlugIn::AnalyzerData" };
 	udtVMScopedStackAllocator _analyzerAllocatorScope;
 
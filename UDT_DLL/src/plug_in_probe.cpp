@@ -0,0 +1,173 @@
+#include "plug_in_probe.hpp"
+#include "utils.hpp"
+#include "scoped_stack_allocator.hpp"
+
+#include <string.h>
+
+
+udtParserPlugInProbe::udtParserPlugInProbe()
+{
+	memset(&Info, 0, sizeof(Info));
+	_messageCount = UDT_PROBE_DEFAULT_MESSAGE_COUNT;
+	_messagesLeft = 0;
+	_gameStateRead = false;
+	_infoChanged = false;
+}
+
+udtParserPlugInProbe::~udtParserPlugInProbe()
+{
+}
+
+void udtParserPlugInProbe::SetMessageCount(u32 messageCount)
+{
+	_messageCount = messageCount > 0 ? messageCount : UDT_PROBE_DEFAULT_MESSAGE_COUNT;
+}
+
+void udtParserPlugInProbe::InitAllocators(u32 demoCount)
+{
+	_analyzer.InitAllocators(*TempAllocator, demoCount);
+}
+
+void udtParserPlugInProbe::StartDemoAnalysis()
+{
+	memset(&Info, 0, sizeof(Info));
+	Info.DemoTakerPlayerIndex = -1;
+	Info.FirstSnapshotTimeMs = UDT_S32_MIN;
+
+	_analyzer.ResetForNextDemo();
+	_messagesLeft = 0;
+	_gameStateRead = false;
+	_infoChanged = false;
+}
+
+void udtParserPlugInProbe::FinishDemoAnalysis()
+{
+	_analyzer.FinishDemoAnalysis();
+}
+
+void udtParserPlugInProbe::ProcessGamestateMessage(const udtGamestateCallbackArg& arg, udtBaseParser& parser)
+{
+	if(_gameStateRead)
+	{
+		// The config strings now describe the next gamestate, so we keep what we have.
+		SetJobDone();
+		return;
+	}
+
+	_analyzer.ProcessGamestateMessage(arg, parser);
+	_gameStateRead = true;
+	_infoChanged = true;
+	_messagesLeft = _messageCount;
+	Info.DemoTakerPlayerIndex = arg.ClientNum;
+}
+
+void udtParserPlugInProbe::ProcessCommandMessage(const udtCommandCallbackArg& arg, udtBaseParser& parser)
+{
+	if(!_gameStateRead || IsJobDone())
+	{
+		return;
+	}
+
+	_analyzer.ProcessCommandMessage(arg, parser);
+	if(arg.IsConfigString)
+	{
+		_infoChanged = true;
+	}
+}
+
+void udtParserPlugInProbe::ProcessMessageBundleEnd(const udtMessageBundleCallbackArg& /*arg*/, udtBaseParser& parser)
+{
+	if(!_gameStateRead || IsJobDone())
+	{
+		return;
+	}
+
+	if(Info.FirstSnapshotTimeMs == UDT_S32_MIN)
+	{
+		Info.FirstSnapshotTimeMs = parser._inServerTime;
+	}
+
+	if(_infoChanged)
+	{
+		WriteInfo(parser);
+		_infoChanged = false;
+	}
+
+	if(_messagesLeft == 0)
+	{
+		SetJobDone();
+		return;
+	}
+
+	--_messagesLeft;
+}
+
+void udtParserPlugInProbe::WriteInfo(udtBaseParser& parser)
+{
+	const udtProtocol::Id protocol = parser._inProtocol;
+	Info.Valid = 1;
+	Info.Protocol = (u32)protocol;
+	Info.Mod = (u32)_analyzer.Mod();
+	Info.GameType = (u32)_analyzer.GameType();
+	WriteString(Info.MapName, (u32)sizeof(Info.MapName), _analyzer.MapName(), protocol);
+	WriteString(Info.ModVersion, (u32)sizeof(Info.ModVersion), _analyzer.ModVersion(), protocol);
+
+	udtVMScopedStackAllocator allocatorScope(*TempAllocator);
+
+	Info.PlayerCount = 0;
+	u32 nameOffset = 0;
+	const s32 firstPlayerCsIndex = GetIdNumber(udtMagicNumberType::ConfigStringIndex, udtConfigStringIndex::FirstPlayer, protocol);
+	for(s32 i = 0; i < 64; ++i)
+	{
+		const udtString& cs = parser._inConfigStrings[firstPlayerCsIndex + i];
+		if(udtString::IsNullOrEmpty(cs))
+		{
+			continue;
+		}
+
+		udtString clan, name;
+		bool hasClan;
+		if(!GetClanAndPlayerName(clan, name, hasClan, *TempAllocator, protocol, cs.GetPtr()))
+		{
+			continue;
+		}
+
+		const udtString cleanName = udtString::NewCleanCloneFromRef(*TempAllocator, protocol, name);
+		const u32 byteCount = cleanName.GetLength() + 1;
+		if(nameOffset + byteCount > (u32)sizeof(Info.PlayerNames))
+		{
+			break;
+		}
+
+		memcpy(Info.PlayerNames + nameOffset, cleanName.GetPtr(), (size_t)byteCount);
+		nameOffset += byteCount;
+		Info.PlayerIndices[Info.PlayerCount++] = (u8)i;
+	}
+}
+
+void udtParserPlugInProbe::WriteString(char* dest, u32 destByteCount, const udtString& string, udtProtocol::Id protocol)
+{
+	dest[0] = '\0';
+	if(udtString::IsNullOrEmpty(string))
+	{
+		return;
+	}
+
+	udtVMScopedStackAllocator allocatorScope(*TempAllocator);
+
+	const udtString cleanString = udtString::NewCleanCloneFromRef(*TempAllocator, protocol, string);
+	const char* const source = cleanString.GetPtr();
+	u32 length = udt_min(cleanString.GetLength(), destByteCount - 1);
+
+	// Don't cut a UTF-8 sequence in half.
+	if(length < cleanString.GetLength())
+	{
+		while(length > 0 && ((u8)source[length] & 0xC0) == 0x80)
+		{
+			--length;
+		}
+	}
+
+	memcpy(dest, source, (size_t)length);
+	dest[length] = '\0';
+}
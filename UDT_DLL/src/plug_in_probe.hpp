@@ -0,0 +1,39 @@
+#pragma once
+
+
+#include "parser.hpp"
+#include "parser_plug_in.hpp"
+#include "analysis_general.hpp"
+
+
+// Reads the first gamestate and a few messages after it, then tells the parser it's done.
+struct udtParserPlugInProbe : udtBaseParserPlugIn
+{
+public:
+	udtParserPlugInProbe();
+	~udtParserPlugInProbe();
+
+	void SetMessageCount(u32 messageCount);
+
+	void InitAllocators(u32 demoCount) override;
+	u32  GetSubscribedEvents() const override { return UDT_PLUG_IN_EVENT_BIT(Gamestate) | UDT_PLUG_IN_EVENT_BIT(Command) | UDT_PLUG_IN_EVENT_BIT(MessageBundleEnd); }
+	void StartDemoAnalysis() override;
+	void FinishDemoAnalysis() override;
+	void ProcessGamestateMessage(const udtGamestateCallbackArg& arg, udtBaseParser& parser) override;
+	void ProcessCommandMessage(const udtCommandCallbackArg& arg, udtBaseParser& parser) override;
+	void ProcessMessageBundleEnd(const udtMessageBundleCallbackArg& arg, udtBaseParser& parser) override;
+
+	udtProbeDemoInfo Info; // Valid after the parser's FinishParsing.
+
+private:
+	UDT_NO_COPY_SEMANTICS(udtParserPlugInProbe);
+
+	void WriteInfo(udtBaseParser& parser);
+	void WriteString(char* dest, u32 destByteCount, const udtString& string, udtProtocol::Id protocol);
+
+	udtGeneralAnalyzer _analyzer;
+	u32 _messageCount;
+	u32 _messagesLeft;
+	bool _gameStateRead;
+	bool _infoChanged; // A config string changed since the last WriteInfo call.
+};
@@ -42,6 +42,23 @@ void udtParserPlugInRawCommands::FinishDemoAnalysis()
 {
 }
 
+void udtParserPlugInRawCommands::AppendFirstGameState(const udtBaseParserPlugIn& sourceBase, u32 firstItem, u32 itemCount, s32 gameStateIndex)
+{
+	const udtParserPlugInRawCommands& source = (const udtParserPlugInRawCommands&)sourceBase;
+	for(u32 i = firstItem, end = firstItem + itemCount; i < end; ++i)
+	{
+		if(source._commands[i].GameStateIndex != 0)
+		{
+			continue;
+		}
+
+		udtParseDataRawCommand info = source._commands[i];
+		info.GameStateIndex = gameStateIndex;
+		CloneApiStructString(info.RawCommand, _stringAllocator, source._stringAllocator);
+		_commands.Add(info);
+	}
+}
+
 void udtParserPlugInRawCommands::ProcessGamestateMessage(const udtGamestateCallbackArg& /*arg*/, udtBaseParser& /*parser*/)
 {
 	++_gameStateIndex;
@@ -58,6 +75,3 @@ void udtParserPlugInRawCommands::ProcessCommandMessage(const udtCommandCallbackA
 	_commands.Add(info);
 }
 
-void udtParserPlugInRawCommands::ProcessSnapshotMessage(const udtSnapshotCallbackArg& /*arg*/, udtBaseParser& /*parser*/)
-{
-}
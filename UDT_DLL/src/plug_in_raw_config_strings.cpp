@@ -42,6 +42,23 @@ void udtParserPlugInRawConfigStrings::FinishDemoAnalysis()
 {
 }
 
+void udtParserPlugInRawConfigStrings::AppendFirstGameState(const udtBaseParserPlugIn& sourceBase, u32 firstItem, u32 itemCount, s32 gameStateIndex)
+{
+	const udtParserPlugInRawConfigStrings& source = (const udtParserPlugInRawConfigStrings&)sourceBase;
+	for(u32 i = firstItem, end = firstItem + itemCount; i < end; ++i)
+	{
+		if(source._configStrings[i].GameStateIndex != 0)
+		{
+			continue;
+		}
+
+		udtParseDataRawConfigString cs = source._configStrings[i];
+		cs.GameStateIndex = gameStateIndex;
+		CloneApiStructString(cs.RawConfigString, _stringAllocator, source._stringAllocator);
+		_configStrings.Add(cs);
+	}
+}
+
 void udtParserPlugInRawConfigStrings::ProcessGamestateMessage(const udtGamestateCallbackArg& /*arg*/, udtBaseParser& parser)
 {
 	++_gameStateIndex;
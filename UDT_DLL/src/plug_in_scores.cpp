@@ -83,6 +83,42 @@ void udtParserPlugInScores::StartDemoAnalysis()
 }
 
 void udtParserPlugInScores::FinishDemoAnalysis()
+{
+	if(!IsProcessingGameStateSegments())
+	{
+		FixFirstScore();
+	}
+}
+
+void udtParserPlugInScores::AppendFirstGameState(const udtBaseParserPlugIn& sourceBase, u32 firstItem, u32 itemCount, s32 gameStateIndex)
+{
+	const udtParserPlugInScores& source = (const udtParserPlugInScores&)sourceBase;
+	for(u32 i = firstItem, end = firstItem + itemCount; i < end; ++i)
+	{
+		if(source._scores[i].GameStateIndex != 0)
+		{
+			continue;
+		}
+
+		udtParseDataScore scores = source._scores[i];
+		scores.GameStateIndex = gameStateIndex;
+		CloneApiStructString(scores.Name1, _stringAllocator, source._stringAllocator);
+		CloneApiStructString(scores.Name2, _stringAllocator, source._stringAllocator);
+		CloneApiStructString(scores.CleanName1, _stringAllocator, source._stringAllocator);
+		CloneApiStructString(scores.CleanName2, _stringAllocator, source._stringAllocator);
+		_scores.Add(scores);
+	}
+
+	// The last gamestate's value is the one used when parsing the demo in one go.
+	_firstSnapshotTimeMs = source._firstSnapshotTimeMs;
+}
+
+void udtParserPlugInScores::FinishMergedDemoAnalysis()
+{
+	FixFirstScore();
+}
+
+void udtParserPlugInScores::FixFirstScore()
 {
 	// @NOTE: The current range hasn't been added yet.
 	const u32 rangeCount = BufferRanges.GetSize();
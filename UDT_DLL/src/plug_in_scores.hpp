@@ -14,9 +14,11 @@ public:
 	~udtParserPlugInScores();
 
 	void InitAllocators(u32 demoCount) override;
+	u32  GetSubscribedEvents() const override { return UDT_PLUG_IN_EVENT_BIT(Gamestate) | UDT_PLUG_IN_EVENT_BIT(Snapshot) | UDT_PLUG_IN_EVENT_BIT(Command) | UDT_PLUG_IN_EVENT_BIT(MessageBundleEnd); }
 	void CopyBuffersStruct(void* buffersStruct) const override;
 	void UpdateBufferStruct() override;
 	u32  GetItemCount() const override;
+	bool CanMergeGameStates() const override { return true; }
 	void StartDemoAnalysis() override;
 	void FinishDemoAnalysis() override;
 	void ProcessGamestateMessage(const udtGamestateCallbackArg& arg, udtBaseParser& parser) override;
@@ -24,6 +26,10 @@ public:
 	void ProcessCommandMessage(const udtCommandCallbackArg& arg, udtBaseParser& parser) override;
 	void ProcessMessageBundleEnd(const udtMessageBundleCallbackArg& arg, udtBaseParser& parser) override;
 
+protected:
+	void AppendFirstGameState(const udtBaseParserPlugIn& source, u32 firstItem, u32 itemCount, s32 gameStateIndex) override;
+	void FinishMergedDemoAnalysis() override;
+
 private:
 	UDT_NO_COPY_SEMANTICS(udtParserPlugInScores);
 
@@ -41,6 +47,7 @@ private:
 	void DetectGameType();
 	void DetectMod();
 	void AddScore();
+	void FixFirstScore();
 	void GetScoresCPMA(udtParseDataScore& scores);
 	void GetScoresQ3(udtParseDataScore& scores);
 	void GetScoresQL(udtParseDataScore& scores);
@@ -1,5 +1,11 @@
 #include "read_only_sequ_file_stream.hpp"
 #include "memory.hpp"
+#include "assert_or_fatal.hpp"
+#include "utils.hpp"
+
+
+#define BLOCK_SIZE  (128*1024)
+#define BLOCK_COUNT (2)
 
 
 #if defined(UDT_WINDOWS)
@@ -8,16 +14,10 @@
 #include "string.hpp"
 #include "scoped_stack_allocator.hpp"
 #include "thread_local_allocators.hpp"
-#include "assert_or_fatal.hpp"
-#include "utils.hpp"
 
 #include <Windows.h>
 
 
-#define BLOCK_SIZE  (128*1024)
-#define BLOCK_COUNT (2)
-
-
 static bool GetDeviceSectorSize(u32& sectorSize, const WCHAR* deviceName)
 {
 	const HANDLE file = CreateFileW(deviceName, STANDARD_RIGHTS_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
@@ -127,6 +127,12 @@ udtReadOnlySequentialFileStream::~udtReadOnlySequentialFileStream()
 
 bool udtReadOnlySequentialFileStream::Init()
 {
+	// Contexts get re-initialized when they're reused.
+	if(_data->_buffer != NULL)
+	{
+		return true;
+	}
+
 	for(int i = 0; i < BLOCK_COUNT; ++i)
 	{
 		const HANDLE event = CreateEvent(NULL, TRUE, FALSE, NULL);
@@ -237,6 +243,279 @@ void udtReadOnlySequentialFileStream::WaitForBlock(u32 blockIndex)
 	}
 }
 
+s32 udtReadOnlySequentialFileStream::Close()
+{
+	if(_data->_file != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(_data->_file);
+		_data->_file = INVALID_HANDLE_VALUE;
+	}
+
+	return 0;
+}
+
+void udtReadOnlySequentialFileStream::Destroy()
+{
+	Close();
+
+	for(int i = 0; i < BLOCK_COUNT; ++i)
+	{
+		const HANDLE event = _data->_blocks[i].Event;
+		if(event != NULL)
+		{
+			CloseHandle(event);
+		}
+	}
+
+	if(_data->_realBuffer != NULL)
+	{
+		VirtualFree(_data->_realBuffer, 0, MEM_RELEASE);
+	}
+	
+	free(_data);
+}
+
+
+#else
+
+
+#include <aio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+struct BlockInfo
+{
+	aiocb ControlBlock;
+	u32 BlockIndex;
+	bool RequestPending;
+	bool Ready;
+};
+
+struct udtReadOnlySequentialFileStreamImpl
+{
+	BlockInfo _blocks[BLOCK_COUNT];
+	u8* _buffer;     // Page-aligned buffer used for the reads.
+	int _file;       // If invalid: -1.
+	u32 _blockSize;
+	u32 _fileByteCount;
+	u32 _fileOffset;
+};
+
+static void ReadBlockSynchronously(int file, BlockInfo& block, u8* blockData, u32 blockSize)
+{
+	const off_t offset = (off_t)block.BlockIndex * (off_t)blockSize;
+	u32 byteCount = 0;
+	while(byteCount < blockSize)
+	{
+		const ssize_t result = pread(file, blockData + byteCount, (size_t)(blockSize - byteCount), offset + (off_t)byteCount);
+		if(result < 0 && errno == EINTR)
+		{
+			continue;
+		}
+
+		if(result <= 0)
+		{
+			break;
+		}
+
+		byteCount += (u32)result;
+	}
+
+	block.RequestPending = false;
+	block.Ready = true;
+}
+
+static bool WaitForRequest(BlockInfo& block)
+{
+	const aiocb* const requests[1] = { &block.ControlBlock };
+	while(aio_error(&block.ControlBlock) == EINPROGRESS)
+	{
+		// Returns early with EINTR when a signal is caught, we just wait again.
+		aio_suspend(requests, 1, NULL);
+	}
+
+	block.RequestPending = false;
+
+	return aio_return(&block.ControlBlock) >= 0;
+}
+
+udtReadOnlySequentialFileStream::udtReadOnlySequentialFileStream()
+{
+	_data = (udtReadOnlySequentialFileStreamImpl*)udt_malloc(sizeof(udtReadOnlySequentialFileStreamImpl));
+	_data->_buffer = NULL;
+	_data->_file = -1;
+	_data->_blockSize = 0;
+	_data->_fileByteCount = 0;
+	_data->_fileOffset = 0;
+	for(u32 i = 0; i < BLOCK_COUNT; ++i)
+	{
+		_data->_blocks[i].BlockIndex = i;
+		_data->_blocks[i].RequestPending = false;
+		_data->_blocks[i].Ready = false;
+	}
+}
+
+udtReadOnlySequentialFileStream::~udtReadOnlySequentialFileStream()
+{
+	Destroy();
+}
+
+bool udtReadOnlySequentialFileStream::Init()
+{
+	if(_data->_buffer != NULL)
+	{
+		return true;
+	}
+
+	// Anonymous mappings are always page-aligned, which keeps every block aligned as well.
+	const size_t byteCount = (size_t)BLOCK_SIZE * (size_t)BLOCK_COUNT;
+	void* const buffer = mmap(NULL, byteCount, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if(buffer == MAP_FAILED)
+	{
+		return false;
+	}
+
+	_data->_buffer = (u8*)buffer;
+	_data->_blockSize = BLOCK_SIZE;
+
+	return true;
+}
+
+bool udtReadOnlySequentialFileStream::Open(const char* filePath, u32 offset)
+{
+	Close();
+	_data->_fileOffset = 0;
+	for(u32 i = 0; i < BLOCK_COUNT; ++i)
+	{
+		_data->_blocks[i].BlockIndex = i;
+		_data->_blocks[i].RequestPending = false;
+		_data->_blocks[i].Ready = false;
+	}
+
+	const int file = open(filePath, O_RDONLY | O_CLOEXEC);
+	if(file == -1)
+	{
+		return false;
+	}
+
+	struct stat fileStat;
+	if(fstat(file, &fileStat) != 0)
+	{
+		close(file);
+		return false;
+	}
+
+	// We read everything exactly once, front to back: let the kernel read ahead aggressively.
+	posix_fadvise(file, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+	const u32 blockSize = _data->_blockSize;
+	_data->_file = file;
+	_data->_fileByteCount = (u32)fileStat.st_size;
+	_data->_fileOffset = offset;
+
+	const u32 blockCount = (_data->_fileByteCount + blockSize - 1) / blockSize;
+	const u32 requestCount = udt_min(blockCount, (u32)BLOCK_COUNT - 1);
+	const u32 firstBlockIndex = offset / BLOCK_SIZE;
+	for(u32 i = 0; i < requestCount; ++i)
+	{
+		RequestBlock(firstBlockIndex + i);
+	}
+
+	return true;
+}
+
+void udtReadOnlySequentialFileStream::RequestBlock(u32 blockIndex)
+{
+	const u32 blockSize = _data->_blockSize;
+	const u32 blockId = blockIndex % BLOCK_COUNT;
+	BlockInfo& block = _data->_blocks[blockId];
+	if(block.BlockIndex == blockIndex && (block.RequestPending || block.Ready))
+	{
+		return;
+	}
+
+	aiocb& request = block.ControlBlock;
+	memset(&request, 0, sizeof(request));
+	request.aio_fildes = _data->_file;
+	request.aio_offset = (off_t)blockIndex * (off_t)blockSize;
+	request.aio_buf = _data->_buffer + blockId * blockSize;
+	request.aio_nbytes = (size_t)blockSize;
+	request.aio_sigevent.sigev_notify = SIGEV_NONE;
+	const bool success = aio_read(&request) == 0;
+	block.BlockIndex = blockIndex;
+	block.RequestPending = success;
+	block.Ready = false;
+}
+
+void udtReadOnlySequentialFileStream::WaitForBlock(u32 blockIndex)
+{
+	const u32 blockSize = _data->_blockSize;
+	const u32 blockId = blockIndex % BLOCK_COUNT;
+	BlockInfo& block = _data->_blocks[blockId];
+	if(block.BlockIndex == blockIndex && block.Ready)
+	{
+		return;
+	}
+
+	if(block.BlockIndex == blockIndex && block.RequestPending && WaitForRequest(block))
+	{
+		block.Ready = true;
+		return;
+	}
+
+	// The asynchronous request either couldn't be queued or failed.
+	if(block.RequestPending)
+	{
+		WaitForRequest(block);
+	}
+	block.BlockIndex = blockIndex;
+	ReadBlockSynchronously(_data->_file, block, _data->_buffer + blockId * blockSize, blockSize);
+}
+
+s32 udtReadOnlySequentialFileStream::Close()
+{
+	// We can't let a pending request write into our buffer after the next file was opened.
+	for(u32 i = 0; i < BLOCK_COUNT; ++i)
+	{
+		BlockInfo& block = _data->_blocks[i];
+		if(block.RequestPending)
+		{
+			aio_cancel(_data->_file, &block.ControlBlock);
+			WaitForRequest(block);
+		}
+		block.Ready = false;
+	}
+
+	if(_data->_file != -1)
+	{
+		close(_data->_file);
+		_data->_file = -1;
+	}
+
+	return 0;
+}
+
+void udtReadOnlySequentialFileStream::Destroy()
+{
+	Close();
+
+	if(_data->_buffer != NULL)
+	{
+		munmap(_data->_buffer, (size_t)BLOCK_SIZE * (size_t)BLOCK_COUNT);
+	}
+
+	free(_data);
+}
+
+
+#endif
+
+
 u32 udtReadOnlySequentialFileStream::Read(void* dstBuff, u32 elementSize, u32 count)
 {
 	u32 byteCount = elementSize * count;
@@ -312,39 +591,3 @@ u64 udtReadOnlySequentialFileStream::Length()
 {
 	return (u64)_data->_fileByteCount;
 }
-
-s32 udtReadOnlySequentialFileStream::Close()
-{
-	if(_data->_file != INVALID_HANDLE_VALUE)
-	{
-		CloseHandle(_data->_file);
-		_data->_file = INVALID_HANDLE_VALUE;
-	}
-
-	return 0;
-}
-
-void udtReadOnlySequentialFileStream::Destroy()
-{
-	Close();
-
-	for(int i = 0; i < BLOCK_COUNT; ++i)
-	{
-		const HANDLE event = _data->_blocks[i].Event;
-		if(event != NULL)
-		{
-			CloseHandle(event);
-		}
-	}
-
-	if(_data->_realBuffer != NULL)
-	{
-		VirtualFree(_data->_realBuffer, 0, MEM_RELEASE);
-	}
-	
-	free(_data);
-}
-
-
-#endif
-
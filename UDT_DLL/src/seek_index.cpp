@@ -0,0 +1,988 @@
+#include "seek_index.hpp"
+#include "file_stream.hpp"
+#include "thread_local_allocators.hpp"
+#include "scoped_stack_allocator.hpp"
+#include "utils.hpp"
+
+
+#define    UDT_SEEK_INDEX_MAGIC          0x49544455 // "UDTI"
+#define    UDT_SEEK_INDEX_VERSION        2
+#define    UDT_SEEK_INDEX_NULL_STRING    UDT_U32_MAX
+#define    UDT_SEEK_INDEX_HASHED_BYTES   (8 + ID_MAX_MSG_LENGTH) // The first message, which is the first gamestate in practice.
+
+
+struct udtSeekIndexHeader
+{
+	u32 Magic;
+	u32 Version;
+	u64 DemoByteCount;
+	u64 DemoModificationTime;
+	u64 DemoStartHash;
+	u32 Protocol;
+	u32 GameStateCount;
+	u32 KeyframeCount;
+	u32 DataByteCount;
+};
+
+
+static udtString CreateIndexFilePath(udtVMLinearAllocator& allocator, const char* demoFilePath)
+{
+	return udtString::NewFromConcatenating(allocator, udtString::NewConstRef(demoFilePath), udtString::NewConstRef(UDT_SEEK_INDEX_FILE_EXTENSION));
+}
+
+// FNV-1a of the start of the demo.
+// Catches demos rewritten in place with the same size faster than the file system's time stamp resolution.
+static bool HashDemoStart(u64& hash, const char* demoFilePath)
+{
+	udtFileStream file;
+	if(!file.Open(demoFilePath, udtFileOpenMode::Read))
+	{
+		return false;
+	}
+
+	udtVMLinearAllocator& allocator = udtThreadLocalAllocators::GetTempAllocator();
+	udtVMScopedStackAllocator allocatorScope(allocator);
+
+	u8* const data = allocator.AllocateAndGetAddress((uptr)UDT_SEEK_INDEX_HASHED_BYTES);
+	const u32 byteCount = file.Read(data, 1, (u32)UDT_SEEK_INDEX_HASHED_BYTES);
+	hash = (u64)14695981039346656037ULL;
+	for(u32 i = 0; i < byteCount; ++i)
+	{
+		hash ^= (u64)data[i];
+		hash *= (u64)1099511628211ULL;
+	}
+
+	return true;
+}
+
+static bool IsHeaderValid(const udtSeekIndexHeader& header, u64 indexByteCount, const char* demoFilePath, udtProtocol::Id protocol)
+{
+	const u64 expectedByteCount =
+		(u64)sizeof(udtSeekIndexHeader) +
+		(u64)header.GameStateCount * (u64)sizeof(udtSeekIndexGameState) +
+		(u64)header.KeyframeCount * (u64)sizeof(udtSeekIndexKeyframe) +
+		(u64)header.DataByteCount;
+
+	if(header.Magic != UDT_SEEK_INDEX_MAGIC ||
+	   header.Version != UDT_SEEK_INDEX_VERSION ||
+	   header.Protocol != (u32)protocol ||
+	   expectedByteCount != indexByteCount ||
+	   header.DemoByteCount != udtFileStream::GetFileLength(demoFilePath) ||
+	   header.DemoModificationTime != udtFileStream::GetModificationTime(demoFilePath))
+	{
+		return false;
+	}
+
+	u64 demoStartHash = 0;
+
+	return
+		HashDemoStart(demoStartHash, demoFilePath) &&
+		header.DemoStartHash == demoStartHash;
+}
+
+// For every group of 32 words, writes a mask of the words that aren't 0 followed by said words.
+// Most of the data in entity states and snapshots is 0.
+static void WriteSparseWords(udtStream& stream, const u8* data, u32 byteCount)
+{
+	const u32 wordCount = byteCount / 4;
+	for(u32 i = 0; i < wordCount; i += 32)
+	{
+		const u32 groupWordCount = udt_min(wordCount - i, (u32)32);
+		u32 words[32];
+		memcpy(words, data + i * 4, (size_t)groupWordCount * 4);
+
+		u32 mask = 0;
+		for(u32 j = 0; j < groupWordCount; ++j)
+		{
+			if(words[j] != 0)
+			{
+				mask |= (u32)1 << j;
+			}
+		}
+
+		stream.Write(&mask, 4, 1);
+		for(u32 j = 0; j < groupWordCount; ++j)
+		{
+			if((mask & ((u32)1 << j)) != 0)
+			{
+				stream.Write(&words[j], 4, 1);
+			}
+		}
+	}
+
+	const u32 tailByteCount = byteCount & 3;
+	if(tailByteCount > 0)
+	{
+		stream.Write(data + wordCount * 4, tailByteCount, 1);
+	}
+}
+
+static bool ReadSparseWords(udtStream& stream, u8* data, u32 byteCount)
+{
+	const u32 wordCount = byteCount / 4;
+	for(u32 i = 0; i < wordCount; i += 32)
+	{
+		const u32 groupWordCount = udt_min(wordCount - i, (u32)32);
+		u32 words[32];
+		memset(words, 0, sizeof(words));
+
+		u32 mask = 0;
+		if(stream.Read(&mask, 4, 1) != 1)
+		{
+			return false;
+		}
+
+		if(groupWordCount < 32 && (mask >> groupWordCount) != 0)
+		{
+			return false;
+		}
+
+		for(u32 j = 0; j < groupWordCount; ++j)
+		{
+			if((mask & ((u32)1 << j)) != 0 &&
+			   stream.Read(&words[j], 4, 1) != 1)
+			{
+				return false;
+			}
+		}
+
+		memcpy(data + i * 4, words, (size_t)groupWordCount * 4);
+	}
+
+	const u32 tailByteCount = byteCount & 3;
+	if(tailByteCount > 0 &&
+	   stream.Read(data + wordCount * 4, tailByteCount, 1) != 1)
+	{
+		return false;
+	}
+
+	return true;
+}
+
+static void WriteConfigString(udtStream& stream, u32 index, const udtString& configString)
+{
+	const u16 index16 = (u16)index;
+	const u32 length = udtString::IsNull(configString) ? (u32)UDT_SEEK_INDEX_NULL_STRING : configString.GetLength();
+	stream.Write(&index16, 2, 1);
+	stream.Write(&length, 4, 1);
+	if(length != UDT_SEEK_INDEX_NULL_STRING && length > 0)
+	{
+		stream.Write(configString.GetPtr(), length, 1);
+	}
+}
+
+static bool ReadConfigString(udtStream& stream, udtParserCheckpoint& state)
+{
+	u16 index = 0;
+	u32 length = 0;
+	if(stream.Read(&index, 2, 1) != 1 ||
+	   stream.Read(&length, 4, 1) != 1 ||
+	   (u32)index >= (u32)UDT_COUNT_OF(state.ConfigStrings))
+	{
+		return false;
+	}
+
+	if(length == UDT_SEEK_INDEX_NULL_STRING)
+	{
+		state.ConfigStrings[index] = udtString::NewNull();
+		return true;
+	}
+
+	if(length > (u32)(stream.Length() - (u64)stream.Offset()))
+	{
+		return false;
+	}
+
+	udtString configString = udtString::NewEmpty(state.ConfigStringAllocator, length + 1);
+	char* const configStringPtr = configString.GetWritePtr();
+	if(length > 0 && stream.Read(configStringPtr, length, 1) != 1)
+	{
+		return false;
+	}
+	configString.SetLength(length);
+	configStringPtr[length] = '\0';
+	state.ConfigStrings[index] = configString;
+
+	return true;
+}
+
+static bool AreSameConfigStrings(const udtString& a, const udtString& b)
+{
+	const bool aNull = udtString::IsNull(a);
+	const bool bNull = udtString::IsNull(b);
+	if(aNull || bNull)
+	{
+		return aNull && bNull;
+	}
+
+	return udtString::Equals(a, b);
+}
+
+static void GetUsedParseEntities(u8* usedEntities, const udtParserCheckpoint& state, u32 snapshotMask, u32 snapshotByteCount)
+{
+	memset(usedEntities, 0, (size_t)ID_MAX_PARSE_ENTITIES);
+	for(u32 i = 0; i < (u32)PACKET_BACKUP; ++i)
+	{
+		if((snapshotMask & ((u32)1 << i)) == 0)
+		{
+			continue;
+		}
+
+		const idClientSnapshotBase* const snapshot = (const idClientSnapshotBase*)(state.Snapshots + i * snapshotByteCount);
+		const s32 entityCount = udt_clamp(snapshot->numEntities, 0, (s32)ID_MAX_PARSE_ENTITIES);
+		for(s32 e = 0; e < entityCount; ++e)
+		{
+			usedEntities[(snapshot->parseEntitiesNum + e) & (ID_MAX_PARSE_ENTITIES - 1)] = 1;
+		}
+	}
+}
+
+// Works both ways since XOR is its own inverse.
+static void XorWithBaseline(u8* output, const u8* input, const u8* baselines, s32 number, u32 entityByteCount)
+{
+	if(number < 0 || number >= (s32)MAX_GENTITIES)
+	{
+		memcpy(output, input, (size_t)entityByteCount);
+		return;
+	}
+
+	const u8* const baseline = baselines + (u32)number * entityByteCount;
+	for(u32 i = 0; i < entityByteCount; ++i)
+	{
+		output[i] = input[i] ^ baseline[i];
+	}
+}
+
+static bool IsEventTimeRecent(s32 eventTimeMs, s32 maxServerTimeMs)
+{
+	return eventTimeMs != UDT_S32_MIN && (s64)eventTimeMs + (s64)EVENT_VALID_MSEC >= (s64)maxServerTimeMs;
+}
+
+// The big config string only matters when the bcs0 and bcs2 commands of a sequence are on different sides of the keyframe.
+// Once bcs2 was processed, it holds 'cs <index> "<value>"' and the config string at <index> was set to <value>.
+static bool IsBigConfigStringPending(const udtParserCheckpoint& state)
+{
+	const udtString bigString = udtString::NewConstRef(state.BigConfigString);
+	if(bigString.GetLength() == 0)
+	{
+		return false;
+	}
+
+	if(!udtString::StartsWith(bigString, "cs ") || !udtString::EndsWith(bigString, "\""))
+	{
+		return true;
+	}
+
+	const char* const indexString = state.BigConfigString + 3;
+	s32 index = 0;
+	u32 indexLength = 0;
+	while(indexString[indexLength] >= '0' && indexString[indexLength] <= '9')
+	{
+		index = index * 10 + (s32)(indexString[indexLength] - '0');
+		++indexLength;
+		if(indexLength > 5)
+		{
+			return true;
+		}
+	}
+
+	const u32 valueOffset = 3 + indexLength + 2;
+	if(indexLength == 0 ||
+	   index >= (s32)UDT_COUNT_OF(state.ConfigStrings) ||
+	   valueOffset > bigString.GetLength() - 1 ||
+	   indexString[indexLength] != ' ' ||
+	   indexString[indexLength + 1] != '"')
+	{
+		return true;
+	}
+
+	const udtString& configString = state.ConfigStrings[index];
+	const u32 valueLength = bigString.GetLength() - 1 - valueOffset;
+	return
+		udtString::IsNull(configString) ||
+		configString.GetLength() != valueLength ||
+		memcmp(configString.GetPtr(), state.BigConfigString + valueOffset, (size_t)valueLength) != 0;
+}
+
+
+udtSeekIndexWriter::udtSeekIndexWriter()
+{
+	memset(&_keyframe, 0, sizeof(_keyframe));
+	for(u32 i = 0; i < (u32)UDT_COUNT_OF(_configStrings); ++i)
+	{
+		_configStrings[i] = udtString::NewNull();
+	}
+	_demoFilePath = udtString::NewNull();
+	_indexFilePath = udtString::NewNull();
+	_parser = NULL;
+	_gameStateIndex = -1;
+	_maxServerTimeMs = UDT_S32_MIN;
+	_lastKeyframeTimeMs = UDT_S32_MIN;
+	_referencedSnapshots = 0;
+	_overwrittenSnapshots = 0;
+	_pendingKeyframe = false;
+	_enabled = false;
+}
+
+udtSeekIndexWriter::~udtSeekIndexWriter()
+{
+}
+
+void udtSeekIndexWriter::StartDemo(udtBaseParser& parser, const char* demoFilePath)
+{
+	_parser = &parser;
+	_parser->DecodeAllSnapshots = true; // Keyframes are made of the parser's snapshot state.
+	_data.Clear();
+	_gameStates.Clear();
+	_keyframes.Clear();
+	_configStringAllocator.Clear();
+	_filePathAllocator.Clear();
+	_gameStateIndex = -1;
+	_maxServerTimeMs = UDT_S32_MIN;
+	_lastKeyframeTimeMs = UDT_S32_MIN;
+	_pendingKeyframe = false;
+	_enabled = false;
+
+	_demoFilePath = udtString::NewClone(_filePathAllocator, demoFilePath);
+	_indexFilePath = CreateIndexFilePath(_filePathAllocator, demoFilePath);
+
+	udtFileStream indexFile;
+	if(indexFile.Open(_indexFilePath.GetPtr(), udtFileOpenMode::Read))
+	{
+		udtSeekIndexHeader header;
+		if(indexFile.Read(&header, (u32)sizeof(header), 1) == 1 &&
+		   IsHeaderValid(header, indexFile.Length(), demoFilePath, parser._inProtocol))
+		{
+			return;
+		}
+	}
+
+	_enabled = true;
+}
+
+void udtSeekIndexWriter::ProcessMessage()
+{
+	if(!_enabled)
+	{
+		return;
+	}
+
+	udtBaseParser& parser = *_parser;
+	if(parser._inGameStateIndex != _gameStateIndex)
+	{
+		FinishKeyframe();
+		_gameStateIndex = parser._inGameStateIndex;
+		StartGameState();
+		if(!_enabled)
+		{
+			return;
+		}
+	}
+	else if(_pendingKeyframe)
+	{
+		UpdateKeyframe();
+	}
+
+	const s32 serverTimeMs = parser._inServerTime;
+	if(_gameStateIndex < 0 || serverTimeMs == UDT_S32_MIN)
+	{
+		return;
+	}
+
+	_maxServerTimeMs = udt_max(_maxServerTimeMs, serverTimeMs);
+	if(_lastKeyframeTimeMs == UDT_S32_MIN || serverTimeMs < _lastKeyframeTimeMs)
+	{
+		_lastKeyframeTimeMs = serverTimeMs;
+	}
+	else if(!_pendingKeyframe && serverTimeMs - _lastKeyframeTimeMs >= UDT_SEEK_INDEX_KEYFRAME_INTERVAL_MS)
+	{
+		StartKeyframe();
+	}
+}
+
+void udtSeekIndexWriter::FinishDemo(bool success)
+{
+	if(!_enabled)
+	{
+		return;
+	}
+
+	_enabled = false;
+	if(!success)
+	{
+		return;
+	}
+
+	FinishKeyframe();
+	if(_gameStates.IsEmpty())
+	{
+		return;
+	}
+
+	const char* const demoFilePath = _demoFilePath.GetPtr();
+	udtSeekIndexHeader header;
+	header.Magic = UDT_SEEK_INDEX_MAGIC;
+	header.Version = UDT_SEEK_INDEX_VERSION;
+	header.DemoByteCount = udtFileStream::GetFileLength(demoFilePath);
+	header.DemoModificationTime = udtFileStream::GetModificationTime(demoFilePath);
+	header.DemoStartHash = 0;
+	header.Protocol = (u32)_parser->_inProtocol;
+	header.GameStateCount = _gameStates.GetSize();
+	header.KeyframeCount = _keyframes.GetSize();
+	header.DataByteCount = (u32)_data.Length();
+	if(header.DemoModificationTime == 0 ||
+	   !HashDemoStart(header.DemoStartHash, demoFilePath))
+	{
+		return;
+	}
+
+	udtFileStream indexFile;
+	if(!indexFile.Open(_indexFilePath.GetPtr(), udtFileOpenMode::Write))
+	{
+		return;
+	}
+
+	const bool written =
+		indexFile.Write(&header, (u32)sizeof(header), 1) == 1 &&
+		indexFile.Write(_gameStates.GetStartAddress(), (u32)sizeof(udtSeekIndexGameState), header.GameStateCount) == header.GameStateCount &&
+		(header.KeyframeCount == 0 || indexFile.Write(_keyframes.GetStartAddress(), (u32)sizeof(udtSeekIndexKeyframe), header.KeyframeCount) == header.KeyframeCount) &&
+		(header.DataByteCount == 0 || indexFile.Write(_data.GetBuffer(), header.DataByteCount, 1) == 1);
+	indexFile.Close();
+	if(!written)
+	{
+		udtFileStream::Delete(_indexFilePath.GetPtr());
+	}
+}
+
+void udtSeekIndexWriter::StartGameState()
+{
+	udtBaseParser& parser = *_parser;
+	if(_gameStateIndex < 0)
+	{
+		return;
+	}
+
+	if((u32)_gameStateIndex != _gameStates.GetSize() ||
+	   (u32)_gameStateIndex >= parser._inGameStateFileOffsets.GetSize())
+	{
+		_enabled = false;
+		return;
+	}
+
+	_maxServerTimeMs = UDT_S32_MIN;
+	_lastKeyframeTimeMs = UDT_S32_MIN;
+
+	udtSeekIndexGameState gameState;
+	gameState.FileOffset = parser._inGameStateFileOffsets[_gameStateIndex];
+	gameState.DataOffset = (u32)_data.Length();
+
+	WriteSparseWords(_data, parser._inEntityBaselines, (u32)parser._inProtocolSizeOfEntityState * (u32)ID_MAX_PARSE_ENTITIES);
+
+	// Keyframes only store the config strings that differ from the ones we have here.
+	_configStringAllocator.Clear();
+	u32 configStringCount = 0;
+	for(u32 i = 0; i < (u32)UDT_COUNT_OF(_configStrings); ++i)
+	{
+		const udtString& configString = parser._inConfigStrings[i];
+		if(udtString::IsNull(configString))
+		{
+			_configStrings[i] = udtString::NewNull();
+		}
+		else
+		{
+			_configStrings[i] = udtString::NewCloneFromRef(_configStringAllocator, configString);
+			++configStringCount;
+		}
+	}
+
+	_data.Write(&configStringCount, 4, 1);
+	for(u32 i = 0; i < (u32)UDT_COUNT_OF(_configStrings); ++i)
+	{
+		if(!udtString::IsNull(_configStrings[i]))
+		{
+			WriteConfigString(_data, i, _configStrings[i]);
+		}
+	}
+
+	gameState.DataByteCount = (u32)_data.Length() - gameState.DataOffset;
+	_gameStates.Add(gameState);
+}
+
+void udtSeekIndexWriter::StartKeyframe()
+{
+	udtBaseParser& parser = *_parser;
+	parser.SaveCheckpoint(_state, false);
+
+	_keyframe.FileOffset = parser._inFileOffset + 8 + (u32)parser._inMsg.Buffer.cursize;
+	_keyframe.DataOffset = 0;
+	_keyframe.DataByteCount = 0;
+	_keyframe.GameStateIndex = _gameStateIndex;
+	_keyframe.MaxServerTimeMs = _maxServerTimeMs;
+	_referencedSnapshots = 0;
+	_overwrittenSnapshots = 0;
+	_pendingKeyframe = true;
+	_lastKeyframeTimeMs = parser._inServerTime;
+}
+
+void udtSeekIndexWriter::UpdateKeyframe()
+{
+	// Even snapshots that get dropped for being delta-compressed from bad data
+	// read their delta source and change the state of the parser, so we keep track of all of them.
+	udtBaseParser& parser = *_parser;
+	const s32 messageNumber = parser._inServerMessageSequence;
+	if(parser._inReadSnapshotMessageNumber != messageNumber)
+	{
+		return;
+	}
+
+	const s32 deltaNum = parser._inReadSnapshotDeltaNum;
+	if(deltaNum > 0)
+	{
+		const u32 bit = (u32)1 << ((u32)deltaNum & (u32)PACKET_MASK);
+		if((_overwrittenSnapshots & bit) == 0)
+		{
+			_referencedSnapshots |= bit;
+		}
+	}
+
+	const idClientSnapshotBase* const snapshot = parser.GetClientSnapshot(messageNumber & PACKET_MASK);
+	if(snapshot->valid && snapshot->messageNum == messageNumber)
+	{
+		_overwrittenSnapshots |= (u32)1 << ((u32)messageNumber & (u32)PACKET_MASK);
+	}
+
+	// PACKET_BACKUP is 32: once all snapshots were replaced, nothing from before the keyframe can be referenced.
+	if(_overwrittenSnapshots == UDT_U32_MAX)
+	{
+		FinishKeyframe();
+	}
+}
+
+void udtSeekIndexWriter::FinishKeyframe()
+{
+	if(!_pendingKeyframe)
+	{
+		return;
+	}
+
+	_pendingKeyframe = false;
+
+	const udtParserCheckpoint& state = _state;
+	const u32 entityByteCount = (u32)_parser->_inProtocolSizeOfEntityState;
+	const u32 snapshotByteCount = (u32)_parser->_inProtocolSizeOfClientSnapshot;
+	udtStream& data = _data;
+	_keyframe.DataOffset = (u32)data.Length();
+
+	data.Write(&state.ServerMessageSequence, 4, 1);
+	data.Write(&state.ServerCommandSequence, 4, 1);
+	data.Write(&state.ReliableSequenceAcknowledge, 4, 1);
+	data.Write(&state.ClientNum, 4, 1);
+	data.Write(&state.ChecksumFeed, 4, 1);
+	data.Write(&state.ParseEntitiesNum, 4, 1);
+	data.Write(&state.ServerTime, 4, 1);
+	data.Write(&state.LastSnapshotMessageNumber, 4, 1);
+
+	data.Write(&_referencedSnapshots, 4, 1);
+	for(u32 i = 0; i < (u32)PACKET_BACKUP; ++i)
+	{
+		if((_referencedSnapshots & ((u32)1 << i)) == 0)
+		{
+			continue;
+		}
+
+		const u8* const snapshotData = state.Snapshots + i * snapshotByteCount;
+		WriteSparseWords(data, snapshotData, snapshotByteCount);
+	}
+
+	// Consecutive snapshots mostly share the same parse entities, so each one gets written once.
+	// Entities are stored relative to their baseline since a lot of them never change.
+	u8 usedEntities[ID_MAX_PARSE_ENTITIES];
+	GetUsedParseEntities(usedEntities, state, _referencedSnapshots, snapshotByteCount);
+	u8 entityData[sizeof(idLargestEntityState)];
+	for(u32 i = 0; i < (u32)ID_MAX_PARSE_ENTITIES; ++i)
+	{
+		if(usedEntities[i] == 0)
+		{
+			continue;
+		}
+
+		const u8* const entity = state.ParseEntities + i * entityByteCount;
+		const s32 number = ((const idEntityStateBase*)entity)->number;
+		const u16 index = (u16)i;
+		data.Write(&index, 2, 1);
+		data.Write(&number, 4, 1);
+		XorWithBaseline(entityData, entity, _parser->_inEntityBaselines, number, entityByteCount);
+		WriteSparseWords(data, entityData, entityByteCount);
+	}
+	const u16 endIndex = (u16)ID_MAX_PARSE_ENTITIES;
+	data.Write(&endIndex, 2, 1);
+
+	// Event times are only compared against the current server time with EVENT_VALID_MSEC of tolerance,
+	// so the ones too old to matter anymore behave exactly like the UDT_S32_MIN they get loaded as.
+	u32 eventTimeCount = 0;
+	for(u32 i = 0; i < (u32)MAX_GENTITIES; ++i)
+	{
+		if(IsEventTimeRecent(state.EntityEventTimesMs[i], _keyframe.MaxServerTimeMs))
+		{
+			++eventTimeCount;
+		}
+	}
+
+	data.Write(&eventTimeCount, 4, 1);
+	for(u32 i = 0; i < (u32)MAX_GENTITIES; ++i)
+	{
+		if(IsEventTimeRecent(state.EntityEventTimesMs[i], _keyframe.MaxServerTimeMs))
+		{
+			const u16 index = (u16)i;
+			data.Write(&index, 2, 1);
+			data.Write(&state.EntityEventTimesMs[i], 4, 1);
+		}
+	}
+
+	u32 bigConfigStringLength = 0;
+	if(IsBigConfigStringPending(state))
+	{
+		while(bigConfigStringLength < (u32)BIG_INFO_STRING - 1 && state.BigConfigString[bigConfigStringLength] != '\0')
+		{
+			++bigConfigStringLength;
+		}
+	}
+	data.Write(&bigConfigStringLength, 4, 1);
+	if(bigConfigStringLength > 0)
+	{
+		data.Write(state.BigConfigString, bigConfigStringLength, 1);
+	}
+
+	u32 configStringCount = 0;
+	for(u32 i = 0; i < (u32)UDT_COUNT_OF(_configStrings); ++i)
+	{
+		if(!AreSameConfigStrings(state.ConfigStrings[i], _configStrings[i]))
+		{
+			++configStringCount;
+		}
+	}
+
+	data.Write(&configStringCount, 4, 1);
+	for(u32 i = 0; i < (u32)UDT_COUNT_OF(_configStrings); ++i)
+	{
+		if(!AreSameConfigStrings(state.ConfigStrings[i], _configStrings[i]))
+		{
+			WriteConfigString(data, i, state.ConfigStrings[i]);
+		}
+	}
+
+	_keyframe.DataByteCount = (u32)data.Length() - _keyframe.DataOffset;
+	_keyframes.Add(_keyframe);
+}
+
+
+udtSeekIndex::udtSeekIndex()
+{
+	_gameStatesOffset = 0;
+	_keyframesOffset = 0;
+	_dataOffset = 0;
+	_gameStateCount = 0;
+	_keyframeCount = 0;
+	_dataByteCount = 0;
+	_protocol = udtProtocol::Invalid;
+	_fileOffset = 0;
+	_firstGameState = 0;
+	_keyframeGameState = 0;
+	_loaded = false;
+}
+
+udtSeekIndex::~udtSeekIndex()
+{
+}
+
+bool udtSeekIndex::HasIndexFile(const char* demoFilePath)
+{
+	udtVMLinearAllocator& allocator = udtThreadLocalAllocators::GetTempAllocator();
+	udtVMScopedStackAllocator allocatorScope(allocator);
+
+	return udtFileStream::Exists(CreateIndexFilePath(allocator, demoFilePath).GetPtr());
+}
+
+bool udtSeekIndex::Load(const char* demoFilePath, udtProtocol::Id protocol)
+{
+	_loaded = false;
+	_fileAllocator.Clear();
+
+	const udtString indexFilePath = CreateIndexFilePath(_fileAllocator, demoFilePath);
+	udtFileStream indexFile;
+	if(!indexFile.Open(indexFilePath.GetPtr(), udtFileOpenMode::Read))
+	{
+		return false;
+	}
+
+	const u64 indexByteCount = indexFile.Length();
+	if(indexByteCount < (u64)sizeof(udtSeekIndexHeader) || indexByteCount > (u64)UDT_U32_MAX)
+	{
+		return false;
+	}
+
+	const uptr indexOffset = indexFile.ReadAll(_fileAllocator);
+	if(indexOffset == uptr(~0))
+	{
+		return false;
+	}
+
+	udtSeekIndexHeader header;
+	memcpy(&header, _fileAllocator.GetAddressAt(indexOffset), sizeof(header));
+	if(!IsHeaderValid(header, indexByteCount, demoFilePath, protocol))
+	{
+		return false;
+	}
+
+	_gameStatesOffset = indexOffset + (uptr)sizeof(udtSeekIndexHeader);
+	_keyframesOffset = _gameStatesOffset + (uptr)header.GameStateCount * (uptr)sizeof(udtSeekIndexGameState);
+	_dataOffset = _keyframesOffset + (uptr)header.KeyframeCount * (uptr)sizeof(udtSeekIndexKeyframe);
+	_gameStateCount = header.GameStateCount;
+	_keyframeCount = header.KeyframeCount;
+	_dataByteCount = header.DataByteCount;
+	_protocol = protocol;
+	_loaded = true;
+
+	return true;
+}
+
+bool udtSeekIndex::PrepareKeyframe(u32& keyframeFileOffset, u32 fileOffset, s32 gameStateIndex, s32 cutGameStateIndex, s32 cutStartTimeMs)
+{
+	if(!_loaded)
+	{
+		return false;
+	}
+
+	// The parser will number the first gamestate message it reads gameStateIndex.
+	u32 firstGameState = 0;
+	if(fileOffset > 0)
+	{
+		while(firstGameState < _gameStateCount && GetGameState(firstGameState).FileOffset != fileOffset)
+		{
+			++firstGameState;
+		}
+	}
+
+	const s32 cutGameState = (s32)firstGameState + cutGameStateIndex - gameStateIndex;
+	if(cutGameState < (s32)firstGameState || cutGameState >= (s32)_gameStateCount)
+	{
+		return false;
+	}
+
+	// If the largest server time so far is less than the cut's start time, the cut can't have started yet.
+	u32 keyframeIndex = UDT_U32_MAX;
+	for(u32 i = 0; i < _keyframeCount; ++i)
+	{
+		const udtSeekIndexKeyframe& keyframe = GetKeyframe(i);
+		if(keyframe.GameStateIndex == cutGameState &&
+		   keyframe.MaxServerTimeMs < cutStartTimeMs &&
+		   keyframe.FileOffset > fileOffset)
+		{
+			keyframeIndex = i;
+		}
+	}
+
+	if(keyframeIndex == UDT_U32_MAX)
+	{
+		return false;
+	}
+
+	const udtSeekIndexKeyframe& keyframe = GetKeyframe(keyframeIndex);
+	if(!DecodeKeyframe(keyframe, GetGameState((u32)cutGameState)))
+	{
+		return false;
+	}
+
+	_state.GameStateIndex = cutGameStateIndex;
+	_fileOffset = fileOffset;
+	_firstGameState = firstGameState;
+	_keyframeGameState = (u32)cutGameState;
+	keyframeFileOffset = keyframe.FileOffset;
+
+	return true;
+}
+
+void udtSeekIndex::ApplyKeyframe(udtBaseParser& parser)
+{
+	// The parser's file offsets are relative to where it started reading.
+	_state.GameStateFileOffsets.Clear();
+	for(u32 i = 0, count = parser._inGameStateFileOffsets.GetSize(); i < count; ++i)
+	{
+		_state.GameStateFileOffsets.Add(parser._inGameStateFileOffsets[i]);
+	}
+	for(u32 i = _firstGameState; i <= _keyframeGameState; ++i)
+	{
+		_state.GameStateFileOffsets.Add(GetGameState(i).FileOffset - _fileOffset);
+	}
+
+	parser.LoadCheckpoint(_state);
+}
+
+bool udtSeekIndex::DecodeKeyframe(const udtSeekIndexKeyframe& keyframe, const udtSeekIndexGameState& gameState)
+{
+	if((u64)gameState.DataOffset + (u64)gameState.DataByteCount > (u64)_dataByteCount ||
+	   (u64)keyframe.DataOffset + (u64)keyframe.DataByteCount > (u64)_dataByteCount)
+	{
+		return false;
+	}
+
+	udtParserCheckpoint& state = _state;
+	const u32 entityByteCount = udtGetSizeOfIdEntityState((u32)_protocol);
+	const u32 snapshotByteCount = udtGetSizeOfidClientSnapshot((u32)_protocol);
+	const u8* const data = _fileAllocator.GetAddressAt(_dataOffset);
+
+	udtReadOnlyMemoryStream stream;
+	if(!stream.Open(data + gameState.DataOffset, gameState.DataByteCount))
+	{
+		return false;
+	}
+
+	memset(state.EntityBaselines, 0, sizeof(state.EntityBaselines));
+	if(!ReadSparseWords(stream, state.EntityBaselines, entityByteCount * (u32)ID_MAX_PARSE_ENTITIES))
+	{
+		return false;
+	}
+
+	state.ConfigStringAllocator.Clear();
+	for(u32 i = 0; i < (u32)UDT_COUNT_OF(state.ConfigStrings); ++i)
+	{
+		state.ConfigStrings[i] = udtString::NewNull();
+	}
+
+	u32 configStringCount = 0;
+	if(stream.Read(&configStringCount, 4, 1) != 1)
+	{
+		return false;
+	}
+
+	for(u32 i = 0; i < configStringCount; ++i)
+	{
+		if(!ReadConfigString(stream, state))
+		{
+			return false;
+		}
+	}
+
+	if(!stream.Open(data + keyframe.DataOffset, keyframe.DataByteCount))
+	{
+		return false;
+	}
+
+	s32 values[8];
+	if(stream.Read(values, 4, 8) != 8)
+	{
+		return false;
+	}
+	state.ServerMessageSequence = values[0];
+	state.ServerCommandSequence = values[1];
+	state.ReliableSequenceAcknowledge = values[2];
+	state.ClientNum = values[3];
+	state.ChecksumFeed = values[4];
+	state.ParseEntitiesNum = values[5];
+	state.ServerTime = values[6];
+	state.LastSnapshotMessageNumber = values[7];
+
+	memset(state.ParseEntities, 0, sizeof(state.ParseEntities));
+	memset(state.Snapshots, 0, sizeof(state.Snapshots));
+
+	u32 snapshotMask = 0;
+	if(stream.Read(&snapshotMask, 4, 1) != 1)
+	{
+		return false;
+	}
+
+	for(u32 i = 0; i < (u32)PACKET_BACKUP; ++i)
+	{
+		if((snapshotMask & ((u32)1 << i)) == 0)
+		{
+			continue;
+		}
+
+		u8* const snapshotData = state.Snapshots + i * snapshotByteCount;
+		if(!ReadSparseWords(stream, snapshotData, snapshotByteCount))
+		{
+			return false;
+		}
+	}
+
+	u8 entityData[sizeof(idLargestEntityState)];
+	for(;;)
+	{
+		u16 index = 0;
+		if(stream.Read(&index, 2, 1) != 1)
+		{
+			return false;
+		}
+
+		if((u32)index >= (u32)ID_MAX_PARSE_ENTITIES)
+		{
+			break;
+		}
+
+		s32 number = 0;
+		if(stream.Read(&number, 4, 1) != 1 ||
+		   !ReadSparseWords(stream, entityData, entityByteCount))
+		{
+			return false;
+		}
+		XorWithBaseline(state.ParseEntities + (u32)index * entityByteCount, entityData, state.EntityBaselines, number, entityByteCount);
+	}
+
+	for(u32 i = 0; i < (u32)MAX_GENTITIES; ++i)
+	{
+		state.EntityEventTimesMs[i] = UDT_S32_MIN;
+	}
+
+	u32 eventTimeCount = 0;
+	if(stream.Read(&eventTimeCount, 4, 1) != 1)
+	{
+		return false;
+	}
+
+	for(u32 i = 0; i < eventTimeCount; ++i)
+	{
+		u16 index = 0;
+		s32 timeMs = 0;
+		if(stream.Read(&index, 2, 1) != 1 ||
+		   stream.Read(&timeMs, 4, 1) != 1 ||
+		   (u32)index >= (u32)MAX_GENTITIES)
+		{
+			return false;
+		}
+		state.EntityEventTimesMs[index] = timeMs;
+	}
+
+	u32 bigConfigStringLength = 0;
+	memset(state.BigConfigString, 0, sizeof(state.BigConfigString));
+	if(stream.Read(&bigConfigStringLength, 4, 1) != 1 ||
+	   bigConfigStringLength >= (u32)BIG_INFO_STRING ||
+	   (bigConfigStringLength > 0 && stream.Read(state.BigConfigString, bigConfigStringLength, 1) != 1))
+	{
+		return false;
+	}
+
+	if(stream.Read(&configStringCount, 4, 1) != 1)
+	{
+		return false;
+	}
+
+	for(u32 i = 0; i < configStringCount; ++i)
+	{
+		if(!ReadConfigString(stream, state))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+const udtSeekIndexGameState& udtSeekIndex::GetGameState(u32 index) const
+{
+	return ((const udtSeekIndexGameState*)_fileAllocator.GetAddressAt(_gameStatesOffset))[index];
+}
+
+const udtSeekIndexKeyframe& udtSeekIndex::GetKeyframe(u32 index) const
+{
+	return ((const udtSeekIndexKeyframe*)_fileAllocator.GetAddressAt(_keyframesOffset))[index];
+}
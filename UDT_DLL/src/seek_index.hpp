@@ -0,0 +1,112 @@
+#pragma once
+
+
+#include "parser.hpp"
+#include "memory_stream.hpp"
+#include "array.hpp"
+
+
+#define    UDT_SEEK_INDEX_FILE_EXTENSION          ".udtidx"
+#define    UDT_SEEK_INDEX_KEYFRAME_INTERVAL_MS    10000
+
+
+struct udtSeekIndexGameState
+{
+	u32 FileOffset; // Of the gamestate message.
+	u32 DataOffset; // The baselines and config strings.
+	u32 DataByteCount;
+};
+
+struct udtSeekIndexKeyframe
+{
+	u32 FileOffset; // Of the first message to read after loading the keyframe.
+	u32 DataOffset;
+	u32 DataByteCount;
+	s32 GameStateIndex;
+	s32 MaxServerTimeMs; // The largest server time since the gamestate message.
+};
+
+// Writes the seek index file of a demo while it gets parsed from the start.
+// The index file has the demo's path with UDT_SEEK_INDEX_FILE_EXTENSION appended to it.
+// It stores the file offsets of all gamestate messages and a keyframe of the parser's decoding state
+// every UDT_SEEK_INDEX_KEYFRAME_INTERVAL_MS of game time or so.
+// A keyframe only stores the snapshots and entities the messages after it actually delta from,
+// so it's only finished when the parser reached a point where nothing older can be referenced.
+// Don't ever allocate an instance of this on the stack.
+struct udtSeekIndexWriter
+{
+public:
+	udtSeekIndexWriter();
+	~udtSeekIndexWriter();
+
+	void StartDemo(udtBaseParser& parser, const char* demoFilePath); // After the parser's Init and SetFilePath. Does nothing if the index is up to date.
+	void ProcessMessage(); // After every message the parser successfully processed.
+	void FinishDemo(bool success); // After the parser's FinishParsing.
+
+private:
+	UDT_NO_COPY_SEMANTICS(udtSeekIndexWriter);
+
+	void StartGameState();
+	void StartKeyframe();
+	void UpdateKeyframe(); // Finds out what the pending keyframe needs to store.
+	void FinishKeyframe();
+
+	udtParserCheckpoint _state; // Of the pending keyframe.
+	udtSeekIndexKeyframe _keyframe; // The pending keyframe.
+	udtVMMemoryStream _data;
+	udtVMArray<udtSeekIndexGameState> _gameStates { "SeekIndexWriter::GameStatesArray" };
+	udtVMArray<udtSeekIndexKeyframe> _keyframes { "SeekIndexWriter::KeyframesArray" };
+	udtVMLinearAllocator _configStringAllocator { "SeekIndexWriter::ConfigStrings" };
+	udtVMLinearAllocator _filePathAllocator { "SeekIndexWriter::FilePaths" };
+	udtString _configStrings[2 * MAX_CONFIGSTRINGS]; // The ones of the current gamestate message.
+	udtString _demoFilePath;
+	udtString _indexFilePath;
+	udtBaseParser* _parser;
+	s32 _gameStateIndex;
+	s32 _maxServerTimeMs;
+	s32 _lastKeyframeTimeMs;
+	u32 _referencedSnapshots; // Bit i set: the snapshot at index i of the pending keyframe's ring buffer needs to be stored.
+	u32 _overwrittenSnapshots; // Bit i set: the snapshot at index i of the ring buffer was replaced since the pending keyframe.
+	bool _pendingKeyframe;
+	bool _enabled;
+};
+
+// Loads the seek index file of a demo and restores parsers from its keyframes.
+// Don't ever allocate an instance of this on the stack.
+struct udtSeekIndex
+{
+public:
+	udtSeekIndex();
+	~udtSeekIndex();
+
+	static bool HasIndexFile(const char* demoFilePath); // Doesn't check whether the index is up to date.
+
+	bool Load(const char* demoFilePath, udtProtocol::Id protocol); // Returns false if there's no index or it's outdated.
+
+	// Finds the last keyframe where the cut hasn't started yet and decodes it.
+	// fileOffset and gameStateIndex are the values the parser would otherwise be initialized and read the demo with.
+	// On success, keyframeFileOffset is where to start reading the demo from instead.
+	bool PrepareKeyframe(u32& keyframeFileOffset, u32 fileOffset, s32 gameStateIndex, s32 cutGameStateIndex, s32 cutStartTimeMs);
+	void ApplyKeyframe(udtBaseParser& parser); // After a successful PrepareKeyframe and the parser's Init.
+
+private:
+	UDT_NO_COPY_SEMANTICS(udtSeekIndex);
+
+	bool DecodeKeyframe(const udtSeekIndexKeyframe& keyframe, const udtSeekIndexGameState& gameState);
+	const udtSeekIndexGameState& GetGameState(u32 index) const;
+	const udtSeekIndexKeyframe& GetKeyframe(u32 index) const;
+
+	udtParserCheckpoint _state; // Of the prepared keyframe.
+	udtVMLinearAllocator _fileAllocator { "SeekIndex::File" };
+	uptr _gameStatesOffset;
+	uptr _keyframesOffset;
+	uptr _dataOffset;
+	u32 _gameStateCount;
+	u32 _keyframeCount;
+	u32 _dataByteCount;
+	udtProtocol::Id _protocol;
+	u32 _fileOffset; // Where the parser would have started reading from without the prepared keyframe.
+	u32 _firstGameState; // Index of the first gamestate the parser would have read without the prepared keyframe.
+	u32 _keyframeGameState; // Index of the gamestate of the prepared keyframe.
+	bool _loaded;
+};
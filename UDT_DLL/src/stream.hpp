@@ -26,6 +26,7 @@ struct udtStream
 	virtual s32 Offset() = 0; // -1 for failure.
 	virtual u64 Length() = 0; // -1 for failure.
 	virtual s32 Close() = 0; // 0 for success. Must be safe to call more than once.
+	virtual const u8* GetMappedBuffer() { return NULL; } // The start of the data if it's all mapped in memory, NULL otherwise.
 
 	uptr      ReadAll(udtVMLinearAllocator& allocator);
 	udtString ReadAllAsString(udtVMLinearAllocator& allocator); // Will allocate and set the trailing NULL terminator.
@@ -0,0 +1,580 @@
+#include "streaming_cutter.hpp"
+#include "plug_in_pattern_search.hpp"
+#include "file_stream.hpp"
+
+
+// How far behind the analysis parser the cut parser stays.
+// This is also the minimum amount of time we can go back to for starting a cut.
+#define    UDT_STREAMING_CUT_DELAY_MS           (60 * 1000)
+// How often the cut parser gets to catch up.
+#define    UDT_STREAMING_CUT_ADVANCE_MS         (5 * 1000)
+// The oldest checkpoint must be old enough for starting any settled cut.
+#define    UDT_STREAMING_CUT_CHECKPOINT_MS      ((UDT_STREAMING_CUT_DELAY_MS + UDT_STREAMING_CUT_ADVANCE_MS) / (UDT_STREAMING_CUT_CHECKPOINT_COUNT - 1))
+#define    UDT_STREAMING_CUT_MAX_BYTE_COUNT     UDT_MB(64)
+#define    UDT_STREAMING_CUT_MIN_DROP_COUNT     1024
+
+
+static bool AreSameCuts(const udtCutSection& a, const udtCutSection& b)
+{
+	// The pattern types don't affect the output.
+	if(a.GameStateIndex != b.GameStateIndex ||
+	   a.StartTimeMs != b.StartTimeMs ||
+	   a.EndTimeMs != b.EndTimeMs)
+	{
+		return false;
+	}
+
+	if(a.VeryShortDesc == NULL || b.VeryShortDesc == NULL)
+	{
+		return a.VeryShortDesc == b.VeryShortDesc;
+	}
+
+	return strcmp(a.VeryShortDesc, b.VeryShortDesc) == 0;
+}
+
+
+udtStreamingCutter::udtStreamingCutter()
+{
+	_cutCbInfo.OutputFolderPath = NULL;
+	_analysisParser = NULL;
+	_plugIn = NULL;
+	_firstMessageIndex = 0;
+	_oldestMessageIndex = 0;
+	_messageCount = 0;
+	_cutParserMessageIndex = 0;
+	_completedCutCount = 0;
+	_scanCutIndex = (u32)-1;
+	_scanMessageIndex = 0;
+	_droppedServerTimeMs = UDT_S32_MIN;
+	_droppedGameStateIndex = -1;
+	_advanceServerTimeMs = UDT_S32_MIN;
+	_advanceGameStateIndex = -1;
+	_failed = false;
+	memset(&_scanCut, 0, sizeof(_scanCut));
+	_finalCutFilePath = udtString::NewNull();
+	for(u32 i = 0; i < (u32)UDT_STREAMING_CUT_CHECKPOINT_COUNT; ++i)
+	{
+		_checkpoints[i].Valid = false;
+	}
+}
+
+udtStreamingCutter::~udtStreamingCutter()
+{
+}
+
+void udtStreamingCutter::StartDemo(udtBaseParser& analysisParser, udtPatternSearchPlugIn& plugIn, const char* outputFolderPath)
+{
+	_analysisParser = &analysisParser;
+	_plugIn = &plugIn;
+	_cutCbInfo.OutputFolderPath = outputFolderPath;
+	_firstMessageIndex = 0;
+	_oldestMessageIndex = 0;
+	_messageCount = 0;
+	_cutParserMessageIndex = 0;
+	_completedCutCount = 0;
+	_scanCutIndex = (u32)-1;
+	_scanMessageIndex = 0;
+	_droppedServerTimeMs = UDT_S32_MIN;
+	_droppedGameStateIndex = -1;
+	_advanceServerTimeMs = UDT_S32_MIN;
+	_advanceGameStateIndex = -1;
+	_failed = false;
+	for(u32 i = 0; i < (u32)UDT_STREAMING_CUT_CHECKPOINT_COUNT; ++i)
+	{
+		_checkpoints[i].Valid = false;
+	}
+
+	_messages.Clear();
+	_messageData.Clear();
+	_cutSections.Clear();
+	_committedCuts.Clear();
+	_outputFilePaths.Clear();
+	_filePathAllocator.Clear();
+	_finalCutFilePath = udtString::NewNull();
+
+	// The cut parser starts in the same state as the analysis parser,
+	// which is why we don't need a checkpoint for the first message.
+	_cutParser.Init(analysisParser._context, analysisParser._inProtocol, analysisParser._outProtocol, 0, false);
+	_cutParser.SetFilePath(analysisParser._inFilePath.GetPtr());
+
+	// Checkpoints copy the snapshot state from one parser to the other
+	// and the cut parser has no cut to write most of the time.
+	analysisParser.DecodeAllSnapshots = true;
+	_cutParser.DecodeAllSnapshots = true;
+	_inMsg.InitContext(analysisParser._context);
+	_inMsg.InitProtocol(analysisParser._inProtocol);
+}
+
+void udtStreamingCutter::ProcessMessage()
+{
+	if(_failed)
+	{
+		return;
+	}
+
+	const udtBaseParser& parser = *_analysisParser;
+	const s32 byteCount = parser._inMsg.Buffer.cursize;
+
+	Message message;
+	message.DataOffset = _messageData.GetSize();
+	message.ByteCount = byteCount;
+	message.ServerMessageSequence = parser._inServerMessageSequence;
+	message.FileOffset = parser._inFileOffset;
+	message.ServerTimeMs = parser._inServerTime;
+	message.GameStateIndex = parser._inGameStateIndex;
+	if(byteCount > 0)
+	{
+		memcpy(_messageData.Extend((u32)byteCount), parser._inMsg.Buffer.data, (size_t)byteCount);
+	}
+	_messages.Add(message);
+	++_messageCount;
+
+	SaveCheckpointIfNeeded();
+
+	// Switching back and forth between both parsers for every message is not cache friendly.
+	if(parser._inGameStateIndex == _advanceGameStateIndex &&
+	   parser._inServerTime >= _advanceServerTimeMs &&
+	   parser._inServerTime < _advanceServerTimeMs + UDT_STREAMING_CUT_ADVANCE_MS)
+	{
+		return;
+	}
+
+	_advanceServerTimeMs = parser._inServerTime;
+	_advanceGameStateIndex = parser._inGameStateIndex;
+	AdvanceCutParser(false);
+	if(_failed)
+	{
+		return;
+	}
+
+	DropOldMessages();
+}
+
+bool udtStreamingCutter::FinishDemo(bool success)
+{
+	if(!success)
+	{
+		Fail();
+	}
+	else
+	{
+		AdvanceCutParser(true);
+	}
+
+	// Closes the output file of the last cut if it's still open.
+	const bool wasWriting = _cutParser.IsWritingCuts();
+	_cutParser.FinishParsing(success);
+	if(wasWriting && !_failed && !RenameCutFileIfNeeded())
+	{
+		Fail();
+	}
+
+	_messages.Clear();
+	_messageData.Clear();
+
+	if(_failed)
+	{
+		for(u32 i = 0, count = _outputFilePaths.GetSize(); i < count; ++i)
+		{
+			udtFileStream::Delete(_outputFilePaths[i].GetPtr());
+		}
+	}
+
+	return !_failed;
+}
+
+void udtStreamingCutter::AdvanceCutParser(bool analysisFinished)
+{
+	if(_failed)
+	{
+		return;
+	}
+
+	if(analysisFinished)
+	{
+		_cutSections.Clear();
+		for(u32 i = 0, count = _plugIn->CutSections.GetSize(); i < count; ++i)
+		{
+			_cutSections.Add(_plugIn->CutSections[i]);
+		}
+	}
+	else if(!_plugIn->GetCurrentCutSections(_cutSections) && !_cutParser.IsWritingCuts() && _completedCutCount >= _cutSections.GetSize())
+	{
+		// Nothing new and nothing to do.
+		return;
+	}
+
+	// We can't take back what the cut parser already did.
+	if(!UpdateCommittedCuts())
+	{
+		Fail();
+		return;
+	}
+
+	SyncCutParserCuts();
+
+	for(;;)
+	{
+		if(_cutParser.IsWritingCuts())
+		{
+			if(_cutParserMessageIndex >= _messageCount ||
+			   !IsSettled(_cutParserMessageIndex, analysisFinished))
+			{
+				break;
+			}
+
+			if(!ProcessMessageWithCutParser(_cutParserMessageIndex))
+			{
+				Fail();
+				return;
+			}
+
+			continue;
+		}
+
+		if(_completedCutCount >= _cutSections.GetSize())
+		{
+			break;
+		}
+
+		u32 startIndex = 0;
+		if(!FindCutStart(startIndex, _cutSections[_completedCutCount], analysisFinished))
+		{
+			break;
+		}
+
+		// Skip as many messages as we can.
+		const Checkpoint* const checkpoint = FindCheckpoint(_cutParserMessageIndex, startIndex);
+		if(checkpoint != NULL && checkpoint->MessageIndex > _cutParserMessageIndex)
+		{
+			_cutParser.LoadCheckpoint(checkpoint->State);
+			_cutParserMessageIndex = checkpoint->MessageIndex;
+		}
+		else if(_cutParserMessageIndex < _oldestMessageIndex)
+		{
+			Fail();
+			return;
+		}
+
+		while(_cutParserMessageIndex <= startIndex)
+		{
+			if(!ProcessMessageWithCutParser(_cutParserMessageIndex))
+			{
+				Fail();
+				return;
+			}
+		}
+	}
+}
+
+bool udtStreamingCutter::ProcessMessageWithCutParser(u32 messageIndex)
+{
+	const Message& message = GetMessage(messageIndex);
+	const bool wasWriting = _cutParser.IsWritingCuts();
+	const u32 cutCount = _cutParser._cuts.GetSize();
+
+	// Copy the data since the message reading code can read a little past the end.
+	memcpy(_cutParser._inMsgData, _messageData.GetStartAddress() + message.DataOffset, (size_t)message.ByteCount);
+	_inMsg.Init(_cutParser._inMsgData, ID_MAX_MSG_LENGTH);
+	_inMsg.Buffer.cursize = message.ByteCount;
+	_inMsg.Buffer.readcount = 0;
+	const bool keepParsing = _cutParser.ParseNextMessage(_inMsg, message.ServerMessageSequence, message.FileOffset);
+	_cutParserMessageIndex = messageIndex + 1;
+
+	const bool writing = _cutParser.IsWritingCuts();
+	const u32 removedCutCount = cutCount - _cutParser._cuts.GetSize();
+	_completedCutCount += removedCutCount;
+
+	// The next cut can start with the same message that ends the current one.
+	if(wasWriting && removedCutCount > 0 && !RenameCutFileIfNeeded())
+	{
+		return false;
+	}
+	if(writing && (!wasWriting || removedCutCount > 0))
+	{
+		_outputFilePaths.Add(udtString::NewCloneFromRef(_filePathAllocator, _cutParser._cuts[0].Output->FilePath));
+	}
+
+	const u32 committedCutCount = udt_min(_completedCutCount + (writing ? 1 : 0), _cutSections.GetSize());
+	while(_committedCuts.GetSize() < committedCutCount)
+	{
+		_committedCuts.Add(_cutSections[_committedCuts.GetSize()]);
+	}
+
+	// The parser stops by itself when done with its last cut.
+	return keepParsing || _cutParser._cuts.IsEmpty();
+}
+
+bool udtStreamingCutter::FindCutStart(u32& messageIndex, const udtCutSection& cut, bool analysisFinished)
+{
+	if(_scanCutIndex != _completedCutCount || !AreSameCuts(_scanCut, cut))
+	{
+		_scanCutIndex = _completedCutCount;
+		_scanCut = cut;
+		_scanMessageIndex = 0;
+	}
+
+	u32 i = udt_max(_scanMessageIndex, _cutParserMessageIndex);
+	if(i < _oldestMessageIndex)
+	{
+		// Make sure the cut couldn't have started in one of the messages we no longer have.
+		if(_droppedGameStateIndex > cut.GameStateIndex ||
+		   (_droppedGameStateIndex == cut.GameStateIndex && _droppedServerTimeMs >= cut.StartTimeMs))
+		{
+			Fail();
+			return false;
+		}
+
+		i = _oldestMessageIndex;
+	}
+
+	// Same test as the one the parser uses for starting a cut.
+	for(; i < _messageCount; ++i)
+	{
+		if(!IsSettled(i, analysisFinished))
+		{
+			break;
+		}
+
+		const Message& message = GetMessage(i);
+		if(message.GameStateIndex == cut.GameStateIndex &&
+		   message.ServerTimeMs >= cut.StartTimeMs &&
+		   message.ServerTimeMs <= cut.EndTimeMs)
+		{
+			_scanMessageIndex = i;
+			messageIndex = i;
+			return true;
+		}
+	}
+
+	_scanMessageIndex = i;
+
+	return false;
+}
+
+bool udtStreamingCutter::IsSettled(u32 messageIndex, bool analysisFinished) const
+{
+	if(analysisFinished)
+	{
+		return true;
+	}
+
+	const Message& message = GetMessage(messageIndex);
+	const udtBaseParser& parser = *_analysisParser;
+	if(message.GameStateIndex < parser._inGameStateIndex)
+	{
+		return true;
+	}
+
+	return (s64)parser._inServerTime - (s64)message.ServerTimeMs >= (s64)UDT_STREAMING_CUT_DELAY_MS;
+}
+
+bool udtStreamingCutter::UpdateCommittedCuts()
+{
+	const u32 cutCount = _committedCuts.GetSize();
+	if(cutCount > _cutSections.GetSize())
+	{
+		return false;
+	}
+
+	const u32 closedCutCount = udt_min(_completedCutCount, cutCount);
+	for(u32 i = 0; i < closedCutCount; ++i)
+	{
+		if(!AreSameCuts(_committedCuts[i], _cutSections[i]))
+		{
+			return false;
+		}
+	}
+
+	if(closedCutCount == cutCount)
+	{
+		return true;
+	}
+
+	// The cut being written can still be extended by merging in new sections.
+	// Since its output file name has the end time in it, we'll rename the file when it's closed.
+	udtCutSection& committedCut = _committedCuts[closedCutCount];
+	const udtCutSection& cut = _cutSections[closedCutCount];
+	if(committedCut.EndTimeMs == cut.EndTimeMs)
+	{
+		return AreSameCuts(committedCut, cut);
+	}
+
+	committedCut.EndTimeMs = cut.EndTimeMs;
+	if(!AreSameCuts(committedCut, cut) ||
+	   cut.EndTimeMs < _cutParser._inServerTime)
+	{
+		return false;
+	}
+
+	udtDemoStreamCreatorArg info;
+	memset(&info, 0, sizeof(info));
+	info.StartTimeMs = cut.StartTimeMs;
+	info.EndTimeMs = cut.EndTimeMs;
+	info.Parser = &_cutParser;
+	info.VeryShortDesc = cut.VeryShortDesc;
+	info.UserData = &_cutCbInfo;
+	info.TempAllocator = &_cutParser._tempAllocator;
+	info.FilePathAllocator = &_filePathAllocator;
+	_finalCutFilePath = udtString::NewCloneFromRef(_filePathAllocator, CallbackCutDemoFileNameCreation(info));
+
+	return true;
+}
+
+bool udtStreamingCutter::RenameCutFileIfNeeded()
+{
+	if(udtString::IsNull(_finalCutFilePath))
+	{
+		return true;
+	}
+
+	udtString& filePath = _outputFilePaths[_outputFilePaths.GetSize() - 1];
+	const bool success = udtFileStream::Rename(filePath.GetPtr(), _finalCutFilePath.GetPtr());
+	if(success)
+	{
+		filePath = _finalCutFilePath;
+	}
+	_finalCutFilePath = udtString::NewNull();
+
+	return success;
+}
+
+void udtStreamingCutter::SyncCutParserCuts()
+{
+	// The cut being written, if any, is always the first one.
+	udtBaseParser::udtCutOutput* const output = _cutParser._cuts.IsEmpty() ? NULL : _cutParser._cuts[0].Output;
+	_cutParser._cuts.Clear();
+	for(u32 i = _completedCutCount, count = _cutSections.GetSize(); i < count; ++i)
+	{
+		const udtCutSection& cut = _cutSections[i];
+		_cutParser.AddCut(
+			cut.GameStateIndex, cut.StartTimeMs, cut.EndTimeMs,
+			&CallbackCutDemoFileNameCreation, cut.VeryShortDesc, &_cutCbInfo);
+	}
+
+	if(output != NULL && !_cutParser._cuts.IsEmpty())
+	{
+		_cutParser._cuts[0].Output = output;
+	}
+}
+
+udtStreamingCutter::Checkpoint* udtStreamingCutter::FindCheckpoint(u32 minMessageIndex, u32 maxMessageIndex)
+{
+	Checkpoint* result = NULL;
+	for(u32 i = 0; i < (u32)UDT_STREAMING_CUT_CHECKPOINT_COUNT; ++i)
+	{
+		Checkpoint& checkpoint = _checkpoints[i];
+		if(checkpoint.Valid &&
+		   checkpoint.MessageIndex >= minMessageIndex &&
+		   checkpoint.MessageIndex <= maxMessageIndex &&
+		   (result == NULL || checkpoint.MessageIndex > result->MessageIndex))
+		{
+			result = &checkpoint;
+		}
+	}
+
+	return result;
+}
+
+void udtStreamingCutter::SaveCheckpointIfNeeded()
+{
+	// The config strings aren't valid before the first gamestate message.
+	const udtBaseParser& parser = *_analysisParser;
+	if(parser._inGameStateIndex < 0)
+	{
+		return;
+	}
+
+	Checkpoint* newest = NULL;
+	Checkpoint* oldest = NULL;
+	for(u32 i = 0; i < (u32)UDT_STREAMING_CUT_CHECKPOINT_COUNT; ++i)
+	{
+		Checkpoint& checkpoint = _checkpoints[i];
+		if(!checkpoint.Valid)
+		{
+			oldest = &checkpoint;
+			continue;
+		}
+
+		if(newest == NULL || checkpoint.MessageIndex > newest->MessageIndex)
+		{
+			newest = &checkpoint;
+		}
+
+		if(oldest == NULL || (oldest->Valid && checkpoint.MessageIndex < oldest->MessageIndex))
+		{
+			oldest = &checkpoint;
+		}
+	}
+
+	if(newest != NULL &&
+	   newest->GameStateIndex == parser._inGameStateIndex &&
+	   (s64)parser._inServerTime - (s64)newest->ServerTimeMs < (s64)UDT_STREAMING_CUT_CHECKPOINT_MS)
+	{
+		return;
+	}
+
+	const bool saveBaselines = !oldest->Valid || oldest->GameStateIndex != parser._inGameStateIndex;
+	parser.SaveCheckpoint(oldest->State, saveBaselines);
+	oldest->MessageIndex = _messageCount;
+	oldest->ServerTimeMs = parser._inServerTime;
+	oldest->GameStateIndex = parser._inGameStateIndex;
+	oldest->Valid = true;
+}
+
+void udtStreamingCutter::DropOldMessages()
+{
+	u32 keepIndex = _messageCount;
+	for(u32 i = 0; i < (u32)UDT_STREAMING_CUT_CHECKPOINT_COUNT; ++i)
+	{
+		if(_checkpoints[i].Valid)
+		{
+			keepIndex = udt_min(keepIndex, _checkpoints[i].MessageIndex);
+		}
+	}
+
+	if(_cutParser.IsWritingCuts())
+	{
+		keepIndex = udt_min(keepIndex, _cutParserMessageIndex);
+	}
+
+	for(; _oldestMessageIndex < keepIndex; ++_oldestMessageIndex)
+	{
+		const Message& message = GetMessage(_oldestMessageIndex);
+		_droppedServerTimeMs = message.ServerTimeMs;
+		_droppedGameStateIndex = message.GameStateIndex;
+	}
+
+	const u32 messageCount = _messages.GetSize();
+	const u32 dropCount = _oldestMessageIndex - _firstMessageIndex;
+	const u32 keptCount = messageCount - dropCount;
+	const u32 dataOffset = keptCount > 0 ? _messages[dropCount].DataOffset : _messageData.GetSize();
+	if(_messageData.GetSize() - dataOffset > (u32)UDT_STREAMING_CUT_MAX_BYTE_COUNT)
+	{
+		Fail();
+		return;
+	}
+
+	if(dropCount < (u32)UDT_STREAMING_CUT_MIN_DROP_COUNT || dropCount < keptCount)
+	{
+		return;
+	}
+
+	const u32 keptByteCount = _messageData.GetSize() - dataOffset;
+	memmove(_messages.GetStartAddress(), _messages.GetStartAddress() + dropCount, (size_t)keptCount * sizeof(Message));
+	_messages.Resize(keptCount);
+	for(u32 i = 0; i < keptCount; ++i)
+	{
+		_messages[i].DataOffset -= dataOffset;
+	}
+	memmove(_messageData.GetStartAddress(), _messageData.GetStartAddress() + dataOffset, (size_t)keptByteCount);
+	_messageData.Resize(keptByteCount);
+	_firstMessageIndex = _oldestMessageIndex;
+}
+
+void udtStreamingCutter::Fail()
+{
+	_failed = true;
+	_messages.Clear();
+	_messageData.Clear();
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+
+#include "parser.hpp"
+#include "cut_section.hpp"
+#include "utils.hpp"
+
+
+#define    UDT_STREAMING_CUT_CHECKPOINT_COUNT    4
+
+
+struct udtPatternSearchPlugIn;
+
+// Applies the cuts found by the pattern search plug-in while the analysis pass is still running,
+// so that the demo doesn't have to be read and parsed a second time.
+// The raw messages of the last minute or so are kept around along with a few checkpoints of the
+// analysis parser's decoding state. When a cut section starts inside that window, a separate
+// parser is restored from the closest checkpoint and replays the buffered messages to write the cut.
+// The cut parser stays a little behind the analysis parser so that sections found a bit late
+// can still be merged and sorted exactly like the 2-pass approach would.
+// If the window gets exceeded, FinishDemo returns false and the caller has to run the second pass.
+// Don't ever allocate an instance of this on the stack.
+struct udtStreamingCutter
+{
+public:
+	udtStreamingCutter();
+	~udtStreamingCutter();
+
+	void StartDemo(udtBaseParser& analysisParser, udtPatternSearchPlugIn& plugIn, const char* outputFolderPath); // After the analysis parser's Init and SetFilePath.
+	void ProcessMessage(); // After every message the analysis parser successfully processed.
+	bool FinishDemo(bool success); // After the analysis parser's FinishParsing. Returns true if all cuts were written.
+
+private:
+	UDT_NO_COPY_SEMANTICS(udtStreamingCutter);
+
+	struct Message
+	{
+		u32 DataOffset;
+		s32 ByteCount;
+		s32 ServerMessageSequence;
+		u32 FileOffset;
+		s32 ServerTimeMs;
+		s32 GameStateIndex;
+	};
+
+	struct Checkpoint
+	{
+		udtParserCheckpoint State;
+		u32 MessageIndex; // Index of the first message to process after loading the state.
+		s32 ServerTimeMs;
+		s32 GameStateIndex;
+		bool Valid;
+	};
+
+	void         AdvanceCutParser(bool analysisFinished);
+	bool         ProcessMessageWithCutParser(u32 messageIndex); // Returns false if the cut parser stopped unexpectedly.
+	bool         FindCutStart(u32& messageIndex, const udtCutSection& cut, bool analysisFinished);
+	bool         IsSettled(u32 messageIndex, bool analysisFinished) const;
+	bool         UpdateCommittedCuts(); // Returns false if the cut parser did something it shouldn't have.
+	bool         RenameCutFileIfNeeded(); // Call right after the cut parser stopped writing.
+	void         SyncCutParserCuts();
+	Checkpoint*  FindCheckpoint(u32 minMessageIndex, u32 maxMessageIndex);
+	void         SaveCheckpointIfNeeded();
+	void         DropOldMessages();
+	void         Fail();
+	const Message& GetMessage(u32 messageIndex) const { return _messages[messageIndex - _firstMessageIndex]; }
+
+	udtBaseParser _cutParser;
+	Checkpoint _checkpoints[UDT_STREAMING_CUT_CHECKPOINT_COUNT];
+	udtMessage _inMsg;
+	udtVMArray<Message> _messages { "StreamingCutter::MessagesArray" };
+	udtVMArray<u8> _messageData { "StreamingCutter::MessageDataArray" };
+	udtVMArray<udtCutSection> _cutSections { "StreamingCutter::CutSectionsArray" }; // The sorted and merged list found so far.
+	udtVMArray<udtCutSection> _committedCuts { "StreamingCutter::CommittedCutsArray" }; // The cuts the cut parser started or finished.
+	udtVMArray<udtString> _outputFilePaths { "StreamingCutter::OutputFilePathsArray" };
+	udtVMLinearAllocator _filePathAllocator { "StreamingCutter::FilePaths" };
+	udtString _finalCutFilePath; // If not null, what the file of the cut being written will be renamed to.
+	udtCutSection _scanCut; // The cut we're looking for the first message of.
+	CallbackCutDemoFileStreamCreationInfo _cutCbInfo;
+	udtBaseParser* _analysisParser;
+	udtPatternSearchPlugIn* _plugIn;
+	u32 _firstMessageIndex; // Index of _messages[0].
+	u32 _oldestMessageIndex; // Index of the oldest message we still have the data of.
+	u32 _messageCount; // Total number of messages processed by the analysis parser.
+	u32 _cutParserMessageIndex; // Index of the next message the cut parser would process.
+	u32 _completedCutCount; // Number of cuts the cut parser is done with.
+	u32 _scanCutIndex; // Index of _scanCut.
+	u32 _scanMessageIndex; // Where to resume looking for it.
+	s32 _droppedServerTimeMs; // Of the most recent message no longer in the buffer.
+	s32 _droppedGameStateIndex; // Of the most recent message no longer in the buffer.
+	s32 _advanceServerTimeMs; // When the cut parser last got to catch up.
+	s32 _advanceGameStateIndex; // When the cut parser last got to catch up.
+	bool _failed;
+};
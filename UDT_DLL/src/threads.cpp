@@ -7,6 +7,7 @@
 #	include <Windows.h>
 #else
 #	include <pthread.h>
+#	include <sched.h>
 #	include <stdlib.h>
 #	include <string.h>
 #endif
@@ -161,3 +162,151 @@ void udtThread::InvokeUserFunction()
 		(*_entryPoint)(_userData);
 	}
 }
+
+#if !defined(UDT_WINDOWS)
+
+struct udtEventData
+{
+	pthread_mutex_t Mutex;
+	pthread_cond_t Condition;
+	bool Signaled;
+};
+
+#endif
+
+udtEvent::udtEvent()
+{
+	_handle = NULL;
+}
+
+udtEvent::~udtEvent()
+{
+	Release();
+}
+
+bool udtEvent::Create()
+{
+	if(_handle != NULL)
+	{
+		return false;
+	}
+
+#if defined(UDT_WINDOWS)
+
+	_handle = CreateEventA(NULL, FALSE, FALSE, NULL);
+
+	return _handle != NULL;
+
+#else
+
+	udtEventData* const data = (udtEventData*)udt_malloc(sizeof(udtEventData));
+	if(data == NULL)
+	{
+		return false;
+	}
+
+	if(pthread_mutex_init(&data->Mutex, NULL) != 0)
+	{
+		free(data);
+		return false;
+	}
+
+	if(pthread_cond_init(&data->Condition, NULL) != 0)
+	{
+		pthread_mutex_destroy(&data->Mutex);
+		free(data);
+		return false;
+	}
+
+	data->Signaled = false;
+	_handle = data;
+
+	return true;
+
+#endif
+}
+
+void udtEvent::Signal()
+{
+#if defined(UDT_WINDOWS)
+	SetEvent((HANDLE)_handle);
+#else
+	udtEventData* const data = (udtEventData*)_handle;
+	pthread_mutex_lock(&data->Mutex);
+	data->Signaled = true;
+	pthread_cond_signal(&data->Condition);
+	pthread_mutex_unlock(&data->Mutex);
+#endif
+}
+
+void udtEvent::Wait()
+{
+#if defined(UDT_WINDOWS)
+	WaitForSingleObject((HANDLE)_handle, INFINITE);
+#else
+	udtEventData* const data = (udtEventData*)_handle;
+	pthread_mutex_lock(&data->Mutex);
+	while(!data->Signaled)
+	{
+		pthread_cond_wait(&data->Condition, &data->Mutex);
+	}
+	data->Signaled = false;
+	pthread_mutex_unlock(&data->Mutex);
+#endif
+}
+
+void udtEvent::Release()
+{
+	if(_handle != NULL)
+	{
+#if defined(UDT_WINDOWS)
+		CloseHandle((HANDLE)_handle);
+#else
+		udtEventData* const data = (udtEventData*)_handle;
+		pthread_cond_destroy(&data->Condition);
+		pthread_mutex_destroy(&data->Mutex);
+		free(data);
+#endif
+
+		_handle = NULL;
+	}
+}
+
+s32 udtAtomicIncrement(volatile s32* value)
+{
+#if defined(UDT_WINDOWS)
+	return (s32)InterlockedIncrement((volatile LONG*)value);
+#else
+	return __sync_add_and_fetch(value, 1);
+#endif
+}
+
+s32 udtAtomicLoad(volatile s32* value)
+{
+#if defined(UDT_WINDOWS)
+	return (s32)InterlockedCompareExchange((volatile LONG*)value, 0, 0);
+#else
+	const s32 result = *value;
+	__sync_synchronize();
+	return result;
+#endif
+}
+
+void udtAtomicStore(volatile s32* value, s32 newValue)
+{
+#if defined(UDT_WINDOWS)
+	InterlockedExchange((volatile LONG*)value, (LONG)newValue);
+#else
+	__sync_synchronize();
+	*value = newValue;
+#endif
+}
+
+void udtYieldThread()
+{
+#if defined(UDT_WINDOWS)
+	SwitchToThread();
+#else
+	sched_yield();
+#endif
+}
@@ -24,3 +24,31 @@ private:
 	void* _userData;
 	ThreadEntryPoint _entryPoint;
 };
+
+// Auto-reset event: Wait returns once Signal has been called and clears the signaled state.
+// Signaling when no thread is waiting makes the next Wait return right away.
+struct udtEvent
+{
+	udtEvent();
+	~udtEvent();
+
+	bool Create();
+	void Signal();
+	void Wait();
+	void Release();
+
+private:
+	void* _handle;
+};
+
+// Returns the incremented value. Acts as a full memory barrier.
+extern s32 udtAtomicIncrement(volatile s32* value);
+
+// Returns the current value. Later reads can't be moved before this one.
+extern s32 udtAtomicLoad(volatile s32* value);
+
+// Earlier writes can't be moved after this one.
+extern void udtAtomicStore(volatile s32* value, s32 newValue);
+
+// Gives the rest of the time slice to another thread that's ready to run.
+extern void udtYieldThread();
@@ -611,6 +611,18 @@ void WriteNullStringToApiStruct(u32& offset)
 	offsetAndLength[1] = 0;
 }
 
+void CloneApiStructString(u32& offset, udtVMLinearAllocator& allocator, const udtVMLinearAllocator& sourceAllocator)
+{
+	const u32* const offsetAndLength = &offset;
+	if(offsetAndLength[0] == UDT_U32_MAX)
+	{
+		return;
+	}
+
+	const udtString clone = udtString::NewClone(allocator, sourceAllocator.GetStringAt((uptr)offsetAndLength[0]), offsetAndLength[1]);
+	WriteStringToApiStruct(offset, clone);
+}
+
 void PlayerStateToEntityState(idEntityStateBase& es, s32& lastEventSequence, const idPlayerStateBase& ps, bool extrapolate, s32 serverTimeMs, udtProtocol::Id protocol)
 {
 	s32 healthStatIdx = GetIdNumber(udtMagicNumberType::LifeStatsIndex, udtLifeStatsIndex::Health, protocol, udtMod::None);
@@ -87,6 +87,7 @@ extern void        PerfStatsAddCurrentThread(u64* perfStats, u64 totalDemoByteCo
 extern void        PerfStatsFinalize(u64* perfStats, u32 threadCount, u64 durationMs);
 extern void        WriteStringToApiStruct(u32& offset, const udtString& string);
 extern void        WriteNullStringToApiStruct(u32& offset);
+extern void        CloneApiStructString(u32& offset, udtVMLinearAllocator& allocator, const udtVMLinearAllocator& sourceAllocator); // Null strings are left untouched.
 extern void        PlayerStateToEntityState(idEntityStateBase& es, s32& lastEventSequence, const idPlayerStateBase& ps, bool extrapolate, s32 serverTimeMs, udtProtocol::Id protocol);
 
 // Gets the integer value of a config string variable.
@@ -28,22 +28,30 @@ bool VirtualMemoryDecommitAndRelease(void* address, uptr /*byteCount*/)
 	return VirtualFree((LPVOID)address, 0, MEM_RELEASE) != FALSE;
 }
 
+void* VirtualMemoryGrow(void* /*address*/, uptr /*committedByteCount*/, uptr /*reservedByteCount*/, uptr /*newReservedByteCount*/)
+{
+	// There's no way to move pages to a new reservation, the caller will have to copy the data.
+	return NULL;
+}
+
+void VirtualMemoryAdviseHugePages(void* /*address*/, uptr /*byteCount*/)
+{
+	// Large pages need the "lock pages in memory" privilege and can't be committed on demand.
+}
+
 
 #else
 
 
 #include <sys/mman.h>
-#include <fcntl.h>
 
 
 void* VirtualMemoryReserve(uptr byteCount)
 {
 	// "some implementations require fd to be -1 if MAP_ANONYMOUS is specified, and portable applications should ensure this."
-	// void* const address = mmap(NULL, (size_t)byteCount, PROT_NONE, MAP_ANONYMOUS, -1, 0);
-	// @NOTE: Unfortunately, the code above didn't work on the Linux I tried it on...
-
-	const int fd = open("/dev/zero", O_RDWR);
-	void* const address = mmap(NULL, (size_t)byteCount, PROT_NONE, MAP_PRIVATE | MAP_FILE, fd, 0);
+	// MAP_ANONYMOUS alone is rejected: it needs to be combined with either MAP_PRIVATE or MAP_SHARED.
+	// Mapping /dev/zero instead works too but costs 2 extra system calls and a file descriptor we'd have to close.
+	void* const address = mmap(NULL, (size_t)byteCount, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
 	if(address == MAP_FAILED)
 	{
 		return NULL;
@@ -67,5 +75,46 @@ bool VirtualMemoryDecommitAndRelease(void* address, uptr byteCount)
 	return munmap(address, (size_t)byteCount) == 0;
 }
 
+void* VirtualMemoryGrow(void* address, uptr committedByteCount, uptr reservedByteCount, uptr newReservedByteCount)
+{
+#if defined(MREMAP_MAYMOVE)
+	if(committedByteCount == 0)
+	{
+		return NULL;
+	}
+
+	// mremap only works on a range that has the same protection everywhere, so we only move the committed pages.
+	// The kernel moves the page table entries instead of copying the data.
+	u8* const newAddress = (u8*)mremap(address, (size_t)committedByteCount, (size_t)newReservedByteCount, MREMAP_MAYMOVE);
+	if(newAddress == (u8*)MAP_FAILED)
+	{
+		return NULL;
+	}
+
+	// The rest of the old reservation was still in the way so the pages always move.
+	if(reservedByteCount > committedByteCount && newAddress != (u8*)address)
+	{
+		munmap((u8*)address + committedByteCount, (size_t)(reservedByteCount - committedByteCount));
+	}
+
+	// The new pages have the protection of the old committed ones.
+	if(newReservedByteCount > committedByteCount)
+	{
+		mprotect(newAddress + committedByteCount, (size_t)(newReservedByteCount - committedByteCount), PROT_NONE);
+	}
+
+	return newAddress;
+#else
+	return NULL;
+#endif
+}
+
+void VirtualMemoryAdviseHugePages(void* address, uptr byteCount)
+{
+#if defined(MADV_HUGEPAGE)
+	madvise(address, (size_t)byteCount, MADV_HUGEPAGE);
+#endif
+}
+
 
 #endif
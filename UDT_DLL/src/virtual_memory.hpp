@@ -8,3 +8,11 @@ extern void* VirtualMemoryReserve(uptr byteCount);
 extern bool  VirtualMemoryCommit(void* address, uptr byteCount);
 extern bool  VirtualMemoryDecommit(void* address, uptr byteCount);
 extern bool  VirtualMemoryDecommitAndRelease(void* address, uptr byteCount);
+
+// Moves the committed pages to a bigger reservation without copying them when the system allows it.
+// Returns NULL if it can't, in which case the old reservation is left untouched.
+// On success, the first committedByteCount bytes are committed and the old address is no longer valid.
+extern void* VirtualMemoryGrow(void* address, uptr committedByteCount, uptr reservedByteCount, uptr newReservedByteCount);
+
+// Asks the system to back the range with huge pages as it gets committed. Only a hint.
+extern void  VirtualMemoryAdviseHugePages(void* address, uptr byteCount);
@@ -799,6 +799,7 @@ namespace Uber.DemoTools
             PlayerStatsNames,
             PlugInNames,
             PerfStatsNames,
+            PerfStageNames,
             Count
         }
 
@@ -913,7 +914,7 @@ namespace Uber.DemoTools
             public IntPtr ProgressContext; // void*
             public IntPtr CancelOperation; // s32*
             public IntPtr PerformanceStats; // u64*
-            public IntPtr Reserved1;
+            public IntPtr StagePerfStats; // udtStagePerfStats*
             public UInt32 PlugInCount;
             public Int32 GameStateIndex;
             public UInt32 FileOffset;
@@ -929,6 +930,8 @@ namespace Uber.DemoTools
             public IntPtr OutputErrorCodes; // s32*
 		    public UInt32 FileCount;
 		    public UInt32 MaxThreadCount;
+		    public UInt32 MinByteCountPerThread;
+		    public Int32 Reserved1;
 	    }
 
         [StructLayout(LayoutKind.Sequential, Pack = 1)]
@@ -960,7 +963,8 @@ namespace Uber.DemoTools
         [Flags]
         public enum udtCutByPatternArgFlags : uint
         {
-            MergeCutSections = 1 << 0
+            MergeCutSections = 1 << 0,
+            TwoPassCutting = 1 << 1
         }
 
         public enum udtStringComparisonMode : uint